@@ -107,6 +107,7 @@ static void gst_ass_render_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
 static void gst_ass_render_finalize (GObject * object);
+static void gst_ass_render_clear_overlay_buffers (GstAssRender * render);
 
 static GstStateChangeReturn gst_ass_render_change_state (GstElement * element,
     GstStateChange transition);
@@ -294,6 +295,8 @@ gst_ass_render_finalize (GObject * object)
 
   g_mutex_clear (&render->ass_mutex);
 
+  gst_ass_render_clear_overlay_buffers (render);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -395,6 +398,7 @@ gst_ass_render_change_state (GstElement * element, GstStateChange transition)
         gst_video_overlay_composition_unref (render->composition);
         render->composition = NULL;
       }
+      gst_ass_render_clear_overlay_buffers (render);
       render->track_init_ok = FALSE;
       render->renderer_init_ok = FALSE;
       g_mutex_unlock (&render->ass_mutex);
@@ -704,10 +708,9 @@ gst_ass_render_get_src_caps (GstPad * pad, GstAssRender * render,
 }
 
 static void
-blit_bgra_premultiplied (GstAssRender * render, ASS_Image * ass_image,
-    guint8 * data, gint width, gint height, gint stride, gint x_off, gint y_off)
+blit_bgra_premultiplied (ASS_Image * ass_image, guint8 * data, gint width,
+    gint height, gint stride, gint x_off, gint y_off)
 {
-  guint counter = 0;
   gint alpha, r, g, b, k;
   const guint8 *src;
   guint8 *dst;
@@ -716,52 +719,44 @@ blit_bgra_premultiplied (GstAssRender * render, ASS_Image * ass_image,
   gint src_skip;
   gint dst_x, dst_y;
 
-  memset (data, 0, stride * height);
+  dst_x = ass_image->dst_x + x_off;
+  dst_y = ass_image->dst_y + y_off;
 
-  while (ass_image) {
-    dst_x = ass_image->dst_x + x_off;
-    dst_y = ass_image->dst_y + y_off;
-
-    if (dst_y >= height || dst_x >= width)
-      goto next;
-
-    alpha = 255 - (ass_image->color & 0xff);
-    r = ((ass_image->color) >> 24) & 0xff;
-    g = ((ass_image->color) >> 16) & 0xff;
-    b = ((ass_image->color) >> 8) & 0xff;
-    src = ass_image->bitmap;
-    dst = data + dst_y * stride + dst_x * 4;
-
-    w = MIN (ass_image->w, width - dst_x);
-    h = MIN (ass_image->h, height - dst_y);
-    src_skip = ass_image->stride - w;
-    dst_skip = stride - w * 4;
-
-    for (y = 0; y < h; y++) {
-      for (x = 0; x < w; x++) {
-        k = src[0] * alpha / 255;
-        if (dst[3] == 0) {
-          dst[3] = k;
-          dst[2] = (k * r) / 255;
-          dst[1] = (k * g) / 255;
-          dst[0] = (k * b) / 255;
-        } else {
-          dst[3] = k + (255 - k) * dst[3] / 255;
-          dst[2] = (k * r + (255 - k) * dst[2]) / 255;
-          dst[1] = (k * g + (255 - k) * dst[1]) / 255;
-          dst[0] = (k * b + (255 - k) * dst[0]) / 255;
-        }
-        src++;
-        dst += 4;
+  if (dst_y >= height || dst_x >= width)
+    return;
+
+  alpha = 255 - (ass_image->color & 0xff);
+  r = ((ass_image->color) >> 24) & 0xff;
+  g = ((ass_image->color) >> 16) & 0xff;
+  b = ((ass_image->color) >> 8) & 0xff;
+  src = ass_image->bitmap;
+  dst = data + dst_y * stride + dst_x * 4;
+
+  w = MIN (ass_image->w, width - dst_x);
+  h = MIN (ass_image->h, height - dst_y);
+  src_skip = ass_image->stride - w;
+  dst_skip = stride - w * 4;
+
+  for (y = 0; y < h; y++) {
+    for (x = 0; x < w; x++) {
+      k = src[0] * alpha / 255;
+      if (dst[3] == 0) {
+        dst[3] = k;
+        dst[2] = (k * r) / 255;
+        dst[1] = (k * g) / 255;
+        dst[0] = (k * b) / 255;
+      } else {
+        dst[3] = k + (255 - k) * dst[3] / 255;
+        dst[2] = (k * r + (255 - k) * dst[2]) / 255;
+        dst[1] = (k * g + (255 - k) * dst[1]) / 255;
+        dst[0] = (k * b + (255 - k) * dst[0]) / 255;
       }
-      src += src_skip;
-      dst += dst_skip;
+      src++;
+      dst += 4;
     }
-  next:
-    counter++;
-    ass_image = ass_image->next;
+    src += src_skip;
+    dst += dst_skip;
   }
-  GST_LOG_OBJECT (render, "amount of rendered ass_image: %u", counter);
 }
 
 static gboolean
@@ -988,45 +983,271 @@ gst_ass_render_process_text (GstAssRender * render, GstBuffer * buffer,
   gst_buffer_unmap (buffer, &map);
 }
 
-static GstVideoOverlayComposition *
-gst_ass_render_composite_overlay (GstAssRender * render, ASS_Image * images)
+/* Maximum number of overlay rectangles per composition; when there are more
+ * clusters the closest ones are merged */
+#define MAX_OVERLAY_RECTANGLES 8
+
+/* Maximum number of overlay buffers kept around for reuse */
+#define MAX_OVERLAY_BUFFERS 16
+
+typedef struct
+{
+  gint x1, y1, x2, y2;
+  /* index of the cluster this one was merged into, or -1 */
+  gint merged_into;
+} GstAssRenderCluster;
+
+static inline gint64
+cluster_area (gint x1, gint y1, gint x2, gint y2)
+{
+  return (gint64) (x2 - x1) * (y2 - y1);
+}
+
+static gint64
+gst_ass_render_cluster_union_cost (const GstAssRenderCluster * a,
+    const GstAssRenderCluster * b)
+{
+  return cluster_area (MIN (a->x1, b->x1), MIN (a->y1, b->y1),
+      MAX (a->x2, b->x2), MAX (a->y2, b->y2)) -
+      cluster_area (a->x1, a->y1, a->x2, a->y2) -
+      cluster_area (b->x1, b->y1, b->x2, b->y2);
+}
+
+static gboolean
+gst_ass_render_cluster_should_merge (const GstAssRenderCluster * a,
+    const GstAssRenderCluster * b)
+{
+  /* Overlapping images have to be blitted into the same rectangle to keep
+   * their stacking order */
+  if (a->x1 < b->x2 && b->x1 < a->x2 && a->y1 < b->y2 && b->y1 < a->y2)
+    return TRUE;
+
+  /* Otherwise only merge if the common bounding box is not much larger than
+   * both boxes, e.g. for the glyphs of one line of text */
+  return gst_ass_render_cluster_union_cost (a, b) <=
+      cluster_area (a->x1, a->y1, a->x2, a->y2) +
+      cluster_area (b->x1, b->y1, b->x2, b->y2);
+}
+
+static void
+gst_ass_render_cluster_merge (GArray * clusters, guint into, guint from)
+{
+  GstAssRenderCluster *a = &g_array_index (clusters, GstAssRenderCluster, into);
+  GstAssRenderCluster *b = &g_array_index (clusters, GstAssRenderCluster, from);
+
+  a->x1 = MIN (a->x1, b->x1);
+  a->y1 = MIN (a->y1, b->y1);
+  a->x2 = MAX (a->x2, b->x2);
+  a->y2 = MAX (a->y2, b->y2);
+  b->merged_into = into;
+}
+
+static gint
+gst_ass_render_cluster_resolve (GArray * clusters, gint idx)
+{
+  while (idx >= 0 && g_array_index (clusters, GstAssRenderCluster,
+          idx).merged_into >= 0)
+    idx = g_array_index (clusters, GstAssRenderCluster, idx).merged_into;
+
+  return idx;
+}
+
+/* Groups the images into clusters with tight bounding boxes. Returns the
+ * number of clusters that were not merged into another one, @image_clusters
+ * contains the cluster index for every image or -1 if it is not visible */
+static guint
+gst_ass_render_cluster_images (GstAssRender * render, ASS_Image * images,
+    GArray * clusters, GArray * image_clusters)
+{
+  ASS_Image *image;
+  guint n_clusters = 0;
+  gboolean merged;
+  guint i, j;
+
+  for (image = images; image; image = image->next) {
+    GstAssRenderCluster box;
+    gint idx = -1;
+
+    box.x1 = image->dst_x;
+    box.y1 = image->dst_y;
+    box.x2 = MIN (image->dst_x + image->w, render->width);
+    box.y2 = MIN (image->dst_y + image->h, render->height);
+    box.merged_into = -1;
+
+    if (box.x1 < box.x2 && box.y1 < box.y2) {
+      for (i = 0; i < clusters->len; i++) {
+        GstAssRenderCluster *c =
+            &g_array_index (clusters, GstAssRenderCluster, i);
+
+        if (c->merged_into < 0
+            && gst_ass_render_cluster_should_merge (c, &box)) {
+          c->x1 = MIN (c->x1, box.x1);
+          c->y1 = MIN (c->y1, box.y1);
+          c->x2 = MAX (c->x2, box.x2);
+          c->y2 = MAX (c->y2, box.y2);
+          idx = i;
+          break;
+        }
+      }
+
+      if (idx < 0) {
+        g_array_append_val (clusters, box);
+        idx = clusters->len - 1;
+        n_clusters++;
+      }
+    }
+
+    g_array_append_val (image_clusters, idx);
+  }
+
+  /* Growing clusters can start to overlap others, merge until stable */
+  do {
+    merged = FALSE;
+    for (i = 0; i < clusters->len; i++) {
+      if (g_array_index (clusters, GstAssRenderCluster, i).merged_into >= 0)
+        continue;
+
+      for (j = i + 1; j < clusters->len; j++) {
+        GstAssRenderCluster *a, *b;
+
+        a = &g_array_index (clusters, GstAssRenderCluster, i);
+        b = &g_array_index (clusters, GstAssRenderCluster, j);
+        if (b->merged_into >= 0 || !gst_ass_render_cluster_should_merge (a, b))
+          continue;
+
+        gst_ass_render_cluster_merge (clusters, i, j);
+        n_clusters--;
+        merged = TRUE;
+      }
+    }
+  } while (merged);
+
+  /* Limit the number of rectangles by merging the cheapest pairs */
+  while (n_clusters > MAX_OVERLAY_RECTANGLES) {
+    gint64 cost, best_cost = G_MAXINT64;
+    guint best_i = 0, best_j = 0;
+
+    for (i = 0; i < clusters->len; i++) {
+      if (g_array_index (clusters, GstAssRenderCluster, i).merged_into >= 0)
+        continue;
+
+      for (j = i + 1; j < clusters->len; j++) {
+        if (g_array_index (clusters, GstAssRenderCluster, j).merged_into >= 0)
+          continue;
+
+        cost = gst_ass_render_cluster_union_cost (&g_array_index (clusters,
+                GstAssRenderCluster, i), &g_array_index (clusters,
+                GstAssRenderCluster, j));
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_i = i;
+          best_j = j;
+        }
+      }
+    }
+
+    gst_ass_render_cluster_merge (clusters, best_i, best_j);
+    n_clusters--;
+  }
+
+  for (i = 0; i < image_clusters->len; i++) {
+    gint *idx = &g_array_index (image_clusters, gint, i);
+
+    *idx = gst_ass_render_cluster_resolve (clusters, *idx);
+  }
+
+  return n_clusters;
+}
+
+/* Returns a writable buffer of @size bytes, either one of the previous overlay
+ * buffers that is not used by any composition anymore or a new one */
+static GstBuffer *
+gst_ass_render_acquire_overlay_buffer (GstAssRender * render, gsize size)
+{
+  GstBuffer *buffer = NULL;
+  GList *l, *best = NULL;
+  gsize best_maxsize = 0;
+
+  for (l = render->overlay_buffers; l; l = l->next) {
+    gsize maxsize;
+
+    if (!gst_buffer_is_writable (l->data))
+      continue;
+
+    gst_buffer_get_sizes (l->data, NULL, &maxsize);
+    if (maxsize < size)
+      continue;
+
+    if (best == NULL || maxsize < best_maxsize) {
+      best = l;
+      best_maxsize = maxsize;
+    }
+  }
+
+  if (best) {
+    GstVideoMeta *vmeta;
+
+    buffer = best->data;
+    render->overlay_buffers =
+        g_list_delete_link (render->overlay_buffers, best);
+
+    vmeta = gst_buffer_get_video_meta (buffer);
+    if (vmeta)
+      gst_buffer_remove_meta (buffer, (GstMeta *) vmeta);
+    gst_buffer_set_size (buffer, size);
+  } else {
+    buffer = gst_buffer_new_and_alloc (size);
+  }
+
+  return buffer;
+}
+
+/* Takes ownership of @buffer */
+static void
+gst_ass_render_release_overlay_buffer (GstAssRender * render,
+    GstBuffer * buffer)
+{
+  render->overlay_buffers = g_list_prepend (render->overlay_buffers, buffer);
+
+  if (g_list_length (render->overlay_buffers) > MAX_OVERLAY_BUFFERS) {
+    GList *last = g_list_last (render->overlay_buffers);
+
+    gst_buffer_unref (last->data);
+    render->overlay_buffers =
+        g_list_delete_link (render->overlay_buffers, last);
+  }
+}
+
+static void
+gst_ass_render_clear_overlay_buffers (GstAssRender * render)
+{
+  g_list_free_full (render->overlay_buffers,
+      (GDestroyNotify) gst_buffer_unref);
+  render->overlay_buffers = NULL;
+}
+
+static GstVideoOverlayRectangle *
+gst_ass_render_create_rectangle (GstAssRender * render, ASS_Image * images,
+    GArray * image_clusters, gint cluster, const GstAssRenderCluster * box)
 {
-  GstVideoOverlayComposition *composition;
   GstVideoOverlayRectangle *rectangle;
   GstVideoMeta *vmeta;
   GstMapInfo map;
   GstBuffer *buffer;
   ASS_Image *image;
-  gint min_x, min_y;
-  gint max_x, max_y;
+  guint counter = 0;
   gint width, height;
   gint stride;
   gpointer data;
+  guint i;
 
-  min_x = G_MAXINT;
-  min_y = G_MAXINT;
-  max_x = 0;
-  max_y = 0;
-
-  /* find bounding box of all images, to limit the overlay rectangle size */
-  for (image = images; image; image = image->next) {
-    if (min_x > image->dst_x)
-      min_x = image->dst_x;
-    if (min_y > image->dst_y)
-      min_y = image->dst_y;
-    if (max_x < image->dst_x + image->w)
-      max_x = image->dst_x + image->w;
-    if (max_y < image->dst_y + image->h)
-      max_y = image->dst_y + image->h;
-  }
-
-  width = MIN (max_x - min_x, render->width);
-  height = MIN (max_y - min_y, render->height);
+  width = box->x2 - box->x1;
+  height = box->y2 - box->y1;
 
   GST_DEBUG_OBJECT (render, "render overlay rectangle %dx%d%+d%+d",
-      width, height, min_x, min_y);
+      width, height, box->x1, box->y1);
 
-  buffer = gst_buffer_new_and_alloc (4 * width * height);
+  buffer = gst_ass_render_acquire_overlay_buffer (render, 4 * width * height);
   if (!buffer) {
     GST_ERROR_OBJECT (render, "Failed to allocate overlay buffer");
     return NULL;
@@ -1041,17 +1262,66 @@ gst_ass_render_composite_overlay (GstAssRender * render, ASS_Image * images)
     return NULL;
   }
 
-  blit_bgra_premultiplied (render, images, data, width, height, stride,
-      -min_x, -min_y);
+  memset (data, 0, stride * height);
+  for (image = images, i = 0; image; image = image->next, i++) {
+    if (g_array_index (image_clusters, gint, i) != cluster)
+      continue;
+
+    blit_bgra_premultiplied (image, data, width, height, stride, -box->x1,
+        -box->y1);
+    counter++;
+  }
   gst_video_meta_unmap (vmeta, 0, &map);
 
-  rectangle = gst_video_overlay_rectangle_new_raw (buffer, min_x, min_y,
+  GST_LOG_OBJECT (render, "amount of rendered ass_image: %u", counter);
+
+  rectangle = gst_video_overlay_rectangle_new_raw (buffer, box->x1, box->y1,
       width, height, GST_VIDEO_OVERLAY_FORMAT_FLAG_PREMULTIPLIED_ALPHA);
 
-  gst_buffer_unref (buffer);
+  /* the rectangle keeps the buffer busy until it is released */
+  gst_ass_render_release_overlay_buffer (render, buffer);
+
+  return rectangle;
+}
+
+static GstVideoOverlayComposition *
+gst_ass_render_composite_overlay (GstAssRender * render, ASS_Image * images)
+{
+  GstVideoOverlayComposition *composition = NULL;
+  GArray *clusters, *image_clusters;
+  guint n_clusters;
+  guint i;
+
+  clusters = g_array_new (FALSE, FALSE, sizeof (GstAssRenderCluster));
+  image_clusters = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  n_clusters = gst_ass_render_cluster_images (render, images, clusters,
+      image_clusters);
+
+  GST_DEBUG_OBJECT (render, "rendering %u overlay rectangles", n_clusters);
+
+  for (i = 0; i < clusters->len; i++) {
+    const GstAssRenderCluster *box =
+        &g_array_index (clusters, GstAssRenderCluster, i);
+    GstVideoOverlayRectangle *rectangle;
+
+    if (box->merged_into >= 0)
+      continue;
+
+    rectangle = gst_ass_render_create_rectangle (render, images,
+        image_clusters, i, box);
+    if (!rectangle)
+      continue;
+
+    if (composition)
+      gst_video_overlay_composition_add_rectangle (composition, rectangle);
+    else
+      composition = gst_video_overlay_composition_new (rectangle);
+    gst_video_overlay_rectangle_unref (rectangle);
+  }
 
-  composition = gst_video_overlay_composition_new (rectangle);
-  gst_video_overlay_rectangle_unref (rectangle);
+  g_array_free (image_clusters, TRUE);
+  g_array_free (clusters, TRUE);
 
   return composition;
 }
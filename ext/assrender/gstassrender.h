@@ -82,6 +82,7 @@ struct _GstAssRender
 
   /* overlay stuff */
   GstVideoOverlayComposition *composition;
+  GList *overlay_buffers;
   gint width, height;
   gboolean attach_compo_to_buffer;
 };
@@ -39,6 +39,7 @@
 #endif
 
 #include <openssl/ssl.h>
+#include <openssl/ec.h>
 
 GST_DEBUG_CATEGORY_STATIC (gst_dtls_certificate_debug);
 #define GST_CAT_DEFAULT gst_dtls_certificate_debug
@@ -53,12 +54,14 @@ enum
 {
   PROP_0,
   PROP_PEM,
+  PROP_KEY_TYPE,
   NUM_PROPERTIES
 };
 
 static GParamSpec *properties[NUM_PROPERTIES];
 
 #define DEFAULT_PEM NULL
+#define DEFAULT_KEY_TYPE GST_DTLS_KEY_TYPE_RSA
 
 struct _GstDtlsCertificatePrivate
 {
@@ -66,8 +69,28 @@ struct _GstDtlsCertificatePrivate
   EVP_PKEY *private_key;
 
   gchar *pem;
+  GstDtlsKeyType key_type;
 };
 
+GType
+gst_dtls_key_type_get_type (void)
+{
+  static gsize id = 0;
+  static const GEnumValue values[] = {
+    {GST_DTLS_KEY_TYPE_RSA, "RSA 2048 bit key", "rsa"},
+    {GST_DTLS_KEY_TYPE_ECDSA, "ECDSA key on the P-256 curve", "ecdsa"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&id)) {
+    GType tmp = g_enum_register_static ("GstDtlsKeyType", values);
+    g_once_init_leave (&id, tmp);
+  }
+
+  return (GType) id;
+}
+
+static void gst_dtls_certificate_constructed (GObject * gobject);
 static void gst_dtls_certificate_finalize (GObject * gobject);
 static void gst_dtls_certificate_set_property (GObject *, guint prop_id,
     const GValue *, GParamSpec *);
@@ -75,6 +98,7 @@ static void gst_dtls_certificate_get_property (GObject *, guint prop_id,
     GValue *, GParamSpec *);
 
 static void init_generated (GstDtlsCertificate *);
+static gboolean generate (GstDtlsCertificate *);
 static void init_from_pem_string (GstDtlsCertificate *, const gchar * pem);
 
 static void
@@ -94,10 +118,18 @@ gst_dtls_certificate_class_init (GstDtlsCertificateClass * klass)
       DEFAULT_PEM,
       G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_KEY_TYPE] =
+      g_param_spec_enum ("key-type",
+      "Key type",
+      "Type of the private key when no pem string is given",
+      GST_TYPE_DTLS_KEY_TYPE, DEFAULT_KEY_TYPE,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   _gst_dtls_init_openssl ();
 
+  gobject_class->constructed = gst_dtls_certificate_constructed;
   gobject_class->finalize = gst_dtls_certificate_finalize;
 }
 
@@ -110,6 +142,27 @@ gst_dtls_certificate_init (GstDtlsCertificate * self)
   priv->x509 = NULL;
   priv->private_key = NULL;
   priv->pem = NULL;
+  priv->key_type = DEFAULT_KEY_TYPE;
+}
+
+static void
+gst_dtls_certificate_constructed (GObject * gobject)
+{
+  GstDtlsCertificate *self = GST_DTLS_CERTIFICATE (gobject);
+  gchar *pem;
+
+  /* the key type is only known once all construct properties are set */
+  pem = self->priv->pem;
+  self->priv->pem = NULL;
+
+  if (pem) {
+    init_from_pem_string (self, pem);
+    g_free (pem);
+  } else {
+    init_generated (self);
+  }
+
+  G_OBJECT_CLASS (gst_dtls_certificate_parent_class)->constructed (gobject);
 }
 
 static void
@@ -140,11 +193,11 @@ gst_dtls_certificate_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_PEM:
       pem = g_value_get_string (value);
-      if (pem) {
-        init_from_pem_string (self, pem);
-      } else {
-        init_generated (self);
-      }
+      g_free (self->priv->pem);
+      self->priv->pem = g_strdup (pem);
+      break;
+    case PROP_KEY_TYPE:
+      self->priv->key_type = g_value_get_enum (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
@@ -162,6 +215,9 @@ gst_dtls_certificate_get_property (GObject * object, guint prop_id,
       g_return_if_fail (self->priv->pem);
       g_value_set_string (value, self->priv->pem);
       break;
+    case PROP_KEY_TYPE:
+      g_value_set_enum (value, self->priv->key_type);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
@@ -171,17 +227,28 @@ static void
 init_generated (GstDtlsCertificate * self)
 {
   GstDtlsCertificatePrivate *priv = self->priv;
-  RSA *rsa;
-  X509_NAME *name = NULL;
 
   g_return_if_fail (!priv->x509);
   g_return_if_fail (!priv->private_key);
 
+  GST_DEBUG_OBJECT (self, "generating certificate with key type %d",
+      priv->key_type);
+
+  if (generate (self))
+    priv->pem = _gst_dtls_x509_to_pem (priv->x509);
+}
+
+static gboolean
+generate (GstDtlsCertificate * self)
+{
+  GstDtlsCertificatePrivate *priv = self->priv;
+  X509_NAME *name = NULL;
+
   priv->private_key = EVP_PKEY_new ();
 
   if (!priv->private_key) {
     GST_WARNING_OBJECT (self, "failed to create private key");
-    return;
+    return FALSE;
   }
 
   priv->x509 = X509_new ();
@@ -190,31 +257,44 @@ init_generated (GstDtlsCertificate * self)
     GST_WARNING_OBJECT (self, "failed to create certificate");
     EVP_PKEY_free (priv->private_key);
     priv->private_key = NULL;
-    return;
+    return FALSE;
   }
-  rsa = RSA_generate_key (2048, RSA_F4, NULL, NULL);
 
-  if (!rsa) {
-    GST_WARNING_OBJECT (self, "failed to generate RSA");
-    EVP_PKEY_free (priv->private_key);
-    priv->private_key = NULL;
-    X509_free (priv->x509);
-    priv->x509 = NULL;
-    return;
+  if (priv->key_type == GST_DTLS_KEY_TYPE_ECDSA) {
+    EC_KEY *ec_key;
+
+    ec_key = EC_KEY_new_by_curve_name (NID_X9_62_prime256v1);
+
+    if (!ec_key || !EC_KEY_generate_key (ec_key)) {
+      GST_WARNING_OBJECT (self, "failed to generate EC key");
+      EC_KEY_free (ec_key);
+      goto fail;
+    }
+    /* peers only know the named curves */
+    EC_KEY_set_asn1_flag (ec_key, OPENSSL_EC_NAMED_CURVE);
+
+    if (!EVP_PKEY_assign_EC_KEY (priv->private_key, ec_key)) {
+      GST_WARNING_OBJECT (self, "failed to assign EC key");
+      EC_KEY_free (ec_key);
+      goto fail;
+    }
+  } else {
+    RSA *rsa;
+
+    rsa = RSA_generate_key (2048, RSA_F4, NULL, NULL);
+
+    if (!rsa) {
+      GST_WARNING_OBJECT (self, "failed to generate RSA");
+      goto fail;
+    }
+
+    if (!EVP_PKEY_assign_RSA (priv->private_key, rsa)) {
+      GST_WARNING_OBJECT (self, "failed to assign RSA");
+      RSA_free (rsa);
+      goto fail;
+    }
   }
 
-  if (!EVP_PKEY_assign_RSA (priv->private_key, rsa)) {
-    GST_WARNING_OBJECT (self, "failed to assign RSA");
-    RSA_free (rsa);
-    rsa = NULL;
-    EVP_PKEY_free (priv->private_key);
-    priv->private_key = NULL;
-    X509_free (priv->x509);
-    priv->x509 = NULL;
-    return;
-  }
-  rsa = NULL;
-
   X509_set_version (priv->x509, 2);
   ASN1_INTEGER_set (X509_get_serialNumber (priv->x509), 0);
   X509_gmtime_adj (X509_get_notBefore (priv->x509), 0);
@@ -231,14 +311,17 @@ init_generated (GstDtlsCertificate * self)
 
   if (!X509_sign (priv->x509, priv->private_key, EVP_sha256 ())) {
     GST_WARNING_OBJECT (self, "failed to sign certificate");
-    EVP_PKEY_free (priv->private_key);
-    priv->private_key = NULL;
-    X509_free (priv->x509);
-    priv->x509 = NULL;
-    return;
+    goto fail;
   }
 
-  self->priv->pem = _gst_dtls_x509_to_pem (priv->x509);
+  return TRUE;
+
+fail:
+  EVP_PKEY_free (priv->private_key);
+  priv->private_key = NULL;
+  X509_free (priv->x509);
+  priv->x509 = NULL;
+  return FALSE;
 }
 
 static void
@@ -44,11 +44,26 @@ typedef struct _GstDtlsCertificate        GstDtlsCertificate;
 typedef struct _GstDtlsCertificateClass   GstDtlsCertificateClass;
 typedef struct _GstDtlsCertificatePrivate GstDtlsCertificatePrivate;
 
+#define GST_TYPE_DTLS_KEY_TYPE (gst_dtls_key_type_get_type())
+
+/*
+ * GstDtlsKeyType:
+ *
+ * Type of the private key of generated certificates.
+ */
+typedef enum {
+    GST_DTLS_KEY_TYPE_RSA,
+    GST_DTLS_KEY_TYPE_ECDSA
+} GstDtlsKeyType;
+
+GType gst_dtls_key_type_get_type(void);
+
 /*
  * GstDtlsCertificate:
  *
  * Handles a X509 certificate and a private key.
  * If a certificate is created without the "pem" property, a self-signed certificate is generated.
+ * The "key-type" property selects the type of the generated private key.
  */
 struct _GstDtlsCertificate {
     GObject parent_instance;
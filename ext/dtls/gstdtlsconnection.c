@@ -75,6 +75,10 @@ static GParamSpec *properties[NUM_PROPERTIES];
 static int connection_ex_index;
 
 static GstClock *system_clock;
+
+/* Process-wide thread pool handling the timeouts of all connections, the
+ * connection is passed as data */
+static GThreadPool *timeout_pool;
 static void handle_timeout (gpointer data, gpointer user_data);
 
 struct _GstDtlsConnectionPrivate
@@ -95,7 +99,6 @@ struct _GstDtlsConnectionPrivate
   GClosure *send_closure;
 
   gboolean timeout_pending;
-  GThreadPool *thread_pool;
 };
 
 static void gst_dtls_connection_finalize (GObject * gobject);
@@ -159,6 +162,12 @@ gst_dtls_connection_class_init (GstDtlsConnectionClass * klass)
   gobject_class->finalize = gst_dtls_connection_finalize;
 
   system_clock = gst_system_clock_obtain ();
+
+  /* Timeouts only happen during the handshake and are cheap to handle, so
+   * one thread shared with all other thread pools around is enough for any
+   * number of connections */
+  timeout_pool = g_thread_pool_new (handle_timeout, NULL, 1, FALSE, NULL);
+  g_assert (timeout_pool);
 }
 
 static void
@@ -183,11 +192,6 @@ gst_dtls_connection_init (GstDtlsConnection * self)
   g_mutex_init (&priv->mutex);
   g_cond_init (&priv->condition);
 
-  /* Thread pool for handling timeouts, we only need one thread for that
-   * really and share threads with all other thread pools around there as
-   * this is not going to happen very often */
-  priv->thread_pool = g_thread_pool_new (handle_timeout, self, 1, FALSE, NULL);
-  g_assert (priv->thread_pool);
   priv->timeout_pending = FALSE;
 }
 
@@ -197,9 +201,6 @@ gst_dtls_connection_finalize (GObject * gobject)
   GstDtlsConnection *self = GST_DTLS_CONNECTION (gobject);
   GstDtlsConnectionPrivate *priv = self->priv;
 
-  g_thread_pool_free (priv->thread_pool, TRUE, TRUE);
-  priv->thread_pool = NULL;
-
   SSL_free (priv->ssl);
   priv->ssl = NULL;
 
@@ -294,7 +295,7 @@ gst_dtls_connection_start (GstDtlsConnection * self, gboolean is_client)
 static void
 handle_timeout (gpointer data, gpointer user_data)
 {
-  GstDtlsConnection *self = user_data;
+  GstDtlsConnection *self = data;
   GstDtlsConnectionPrivate *priv;
   gint ret;
 
@@ -317,6 +318,9 @@ handle_timeout (gpointer data, gpointer user_data)
     }
   }
   g_mutex_unlock (&priv->mutex);
+
+  /* reference taken when pushing to the pool */
+  g_object_unref (self);
 }
 
 static gboolean
@@ -330,8 +334,7 @@ schedule_timeout_handling (GstClock * clock, GstClockTime time, GstClockID id,
     self->priv->timeout_pending = TRUE;
 
     GST_TRACE_OBJECT (self, "Schedule timeout now");
-    g_thread_pool_push (self->priv->thread_pool, GINT_TO_POINTER (0xc0ffee),
-        NULL);
+    g_thread_pool_push (timeout_pool, g_object_ref (self), NULL);
   }
   g_mutex_unlock (&self->priv->mutex);
 
@@ -370,8 +373,7 @@ gst_dtls_connection_check_timeout_locked (GstDtlsConnection * self)
         self->priv->timeout_pending = TRUE;
         GST_TRACE_OBJECT (self, "Schedule timeout now");
 
-        g_thread_pool_push (self->priv->thread_pool, GINT_TO_POINTER (0xc0ffee),
-            NULL);
+        g_thread_pool_push (timeout_pool, g_object_ref (self), NULL);
       }
     }
   } else {
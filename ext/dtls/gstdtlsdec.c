@@ -63,6 +63,7 @@ enum
   PROP_CONNECTION_ID,
   PROP_PEM,
   PROP_PEER_PEM,
+  PROP_KEY_TYPE,
 
   PROP_DECODER_KEY,
   PROP_SRTP_CIPHER,
@@ -75,6 +76,7 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_CONNECTION_ID NULL
 #define DEFAULT_PEM NULL
 #define DEFAULT_PEER_PEM NULL
+#define DEFAULT_KEY_TYPE GST_DTLS_KEY_TYPE_RSA
 
 #define DEFAULT_DECODER_KEY NULL
 #define DEFAULT_SRTP_CIPHER 0
@@ -102,7 +104,9 @@ static GstFlowReturn sink_chain (GstPad *, GstObject * parent, GstBuffer *);
 static GstFlowReturn sink_chain_list (GstPad *, GstObject * parent,
     GstBufferList *);
 
-static GstDtlsAgent *get_agent_by_pem (const gchar * pem);
+static GstDtlsAgent *get_agent_by_pem (const gchar * pem,
+    GstDtlsKeyType key_type);
+static gboolean is_generated_cert_agent (GstDtlsAgent *);
 static void agent_weak_ref_notify (gchar * pem, GstDtlsAgent *);
 static void create_connection (GstDtlsDec *, gchar * id);
 static void connection_weak_ref_notify (gchar * id, GstDtlsConnection *);
@@ -149,6 +153,14 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
       "The X509 certificate received in the DTLS handshake, in PEM format",
       DEFAULT_PEER_PEM, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_KEY_TYPE] =
+      g_param_spec_enum ("key-type",
+      "Key type",
+      "Type of the private key of the generated certificate, "
+      "used when no pem string is set",
+      GST_TYPE_DTLS_KEY_TYPE, DEFAULT_KEY_TYPE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   properties[PROP_DECODER_KEY] =
       g_param_spec_boxed ("decoder-key",
       "Decoder key",
@@ -187,7 +199,8 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
 static void
 gst_dtls_dec_init (GstDtlsDec * self)
 {
-  self->agent = get_agent_by_pem (NULL);
+  self->key_type = DEFAULT_KEY_TYPE;
+  self->agent = get_agent_by_pem (NULL, self->key_type);
   self->connection_id = NULL;
   self->connection = NULL;
   self->peer_pem = NULL;
@@ -267,7 +280,21 @@ gst_dtls_dec_set_property (GObject * object, guint prop_id,
       if (self->agent) {
         g_object_unref (self->agent);
       }
-      self->agent = get_agent_by_pem (g_value_get_string (value));
+      self->agent = get_agent_by_pem (g_value_get_string (value),
+          self->key_type);
+      if (self->connection_id) {
+        create_connection (self, self->connection_id);
+      }
+      break;
+    case PROP_KEY_TYPE:
+      self->key_type = g_value_get_enum (value);
+      /* a certificate set with the pem property is kept */
+      if (self->agent && !is_generated_cert_agent (self->agent))
+        break;
+      if (self->agent) {
+        g_object_unref (self->agent);
+      }
+      self->agent = get_agent_by_pem (NULL, self->key_type);
       if (self->connection_id) {
         create_connection (self, self->connection_id);
       }
@@ -294,6 +321,9 @@ gst_dtls_dec_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PEER_PEM:
       g_value_set_string (value, self->peer_pem);
       break;
+    case PROP_KEY_TYPE:
+      g_value_set_enum (value, self->key_type);
+      break;
     case PROP_DECODER_KEY:
       g_value_set_boxed (value, self->decoder_key);
       break;
@@ -602,29 +632,45 @@ sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 static GHashTable *agent_table = NULL;
 G_LOCK_DEFINE_STATIC (agent_table);
 
-static GstDtlsAgent *generated_cert_agent = NULL;
+/* one agent with a generated certificate per key type, shared by all
+ * decoders without a pem */
+static GstDtlsAgent *generated_cert_agents[GST_DTLS_KEY_TYPE_ECDSA + 1];
+
+static gboolean
+is_generated_cert_agent (GstDtlsAgent * agent)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (generated_cert_agents); i++) {
+    if (agent == generated_cert_agents[i])
+      return TRUE;
+  }
+
+  return FALSE;
+}
 
 static GstDtlsAgent *
-get_agent_by_pem (const gchar * pem)
+get_agent_by_pem (const gchar * pem, GstDtlsKeyType key_type)
 {
   GstDtlsAgent *agent;
 
   if (!pem) {
-    if (g_once_init_enter (&generated_cert_agent)) {
+    if (g_once_init_enter (&generated_cert_agents[key_type])) {
       GstDtlsAgent *new_agent;
 
       new_agent = g_object_new (GST_TYPE_DTLS_AGENT, "certificate",
-          g_object_new (GST_TYPE_DTLS_CERTIFICATE, NULL), NULL);
+          g_object_new (GST_TYPE_DTLS_CERTIFICATE, "key-type", key_type,
+              NULL), NULL);
 
-      GST_DEBUG_OBJECT (generated_cert_agent,
+      GST_DEBUG_OBJECT (new_agent,
           "no agent with generated cert found, creating new");
-      g_once_init_leave (&generated_cert_agent, new_agent);
+      g_once_init_leave (&generated_cert_agents[key_type], new_agent);
     } else {
-      GST_DEBUG_OBJECT (generated_cert_agent,
+      GST_DEBUG_OBJECT (generated_cert_agents[key_type],
           "using agent with generated cert");
     }
 
-    agent = generated_cert_agent;
+    agent = generated_cert_agents[key_type];
     g_object_ref (agent);
   } else {
     G_LOCK (agent_table);
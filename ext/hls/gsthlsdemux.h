@@ -54,25 +54,11 @@ G_BEGIN_DECLS
   ((GstHLSDemux *)obj)
 typedef struct _GstHLSDemux GstHLSDemux;
 typedef struct _GstHLSDemuxClass GstHLSDemuxClass;
+typedef struct _GstHLSDemuxStream GstHLSDemuxStream;
 
-/**
- * GstHLSDemux:
- *
- * Opaque #GstHLSDemux data structure.
- */
-struct _GstHLSDemux
+struct _GstHLSDemuxStream
 {
-  GstAdaptiveDemux parent;
-
-  gint srcpad_counter;
-
-  gchar *uri;                   /* Original playlist URI */
-  GstM3U8Client *client;        /* M3U8 client */
-  gboolean do_typefind;         /* Whether we need to typefind the next buffer */
-
-  /* Cache for the last key */
-  gchar *key_url;
-  GstFragment *key_fragment;
+  GstAdaptiveDemuxStream parent;
 
   /* decryption tooling */
 #if defined(HAVE_OPENSSL)
@@ -88,6 +74,25 @@ struct _GstHLSDemux
                               * the last buffer can only be pushed when
                               * resized, so need to store and wait for
                               * EOS to know it is the last */
+};
+
+/**
+ * GstHLSDemux:
+ *
+ * Opaque #GstHLSDemux data structure.
+ */
+struct _GstHLSDemux
+{
+  GstAdaptiveDemux parent;
+
+  gint srcpad_counter;
+
+  gchar *uri;                   /* Original playlist URI */
+  GstM3U8Client *client;        /* M3U8 client */
+  gboolean do_typefind;         /* Whether we need to typefind the next buffer */
+
+  /* Cache of the keys, URI -> GstBuffer, protected by the object lock */
+  GHashTable *keys;
 
   gboolean reset_pts;
 };
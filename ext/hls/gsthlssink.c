@@ -28,6 +28,20 @@
  * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! mpegtsmux ! hlssink max-files=5
  * ]|
  * </refsect2>
+ *
+ * With #GstHlsSink:in-memory set, the segments are not written to disk but
+ * kept in memory, the last #GstHlsSink:max-files of them. Applications can
+ * serve them by connecting to the #GstHlsSink::segment-added signal or by
+ * using the #GstHlsSink::get-segment and #GstHlsSink::get-playlist action
+ * signals. Setting #GstHlsSink:playlist-location to %NULL then also keeps
+ * the playlist in memory only.
+ *
+ * For low-latency streaming, #GstHlsSink:part-duration additionally splits
+ * the in-memory segments into partial segments. They are listed with
+ * EXT-X-PART tags and the playlist is updated as soon as each part is
+ * complete, without waiting for the end of the segment. Parts are announced
+ * with the #GstHlsSink::part-added signal and can also be retrieved with
+ * #GstHlsSink::get-segment.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -39,6 +53,7 @@
 #include <gio/gio.h>
 #include <glib/gstdio.h>
 #include <memory.h>
+#include <string.h>
 
 
 GST_DEBUG_CATEGORY_STATIC (gst_hls_sink_debug);
@@ -50,6 +65,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink_debug);
 #define DEFAULT_MAX_FILES 10
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
+#define DEFAULT_IN_MEMORY FALSE
+#define DEFAULT_PART_DURATION 0
 
 #define GST_M3U8_PLAYLIST_VERSION 3
 
@@ -61,9 +78,22 @@ enum
   PROP_PLAYLIST_ROOT,
   PROP_MAX_FILES,
   PROP_TARGET_DURATION,
-  PROP_PLAYLIST_LENGTH
+  PROP_PLAYLIST_LENGTH,
+  PROP_IN_MEMORY,
+  PROP_PART_DURATION
+};
+
+enum
+{
+  SIGNAL_SEGMENT_ADDED,
+  SIGNAL_PART_ADDED,
+  SIGNAL_GET_SEGMENT,
+  SIGNAL_GET_PLAYLIST,
+  LAST_SIGNAL
 };
 
+static guint gst_hls_sink_signals[LAST_SIGNAL] = { 0 };
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -87,6 +117,19 @@ gst_hls_sink_change_state (GstElement * element, GstStateChange trans);
 static gboolean schedule_next_key_unit (GstHlsSink * sink);
 static GstFlowReturn gst_hls_sink_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * list);
+static GstBufferList *gst_hls_sink_get_segment (GstHlsSink * sink,
+    const gchar * location);
+static gchar *gst_hls_sink_get_playlist (GstHlsSink * sink);
+static void gst_hls_sink_finish_part (GstHlsSink * sink,
+    GstClockTime running_time);
+
+static void
+gst_hls_sink_segment_free (GstHlsSinkSegment * segment)
+{
+  g_free (segment->location);
+  gst_buffer_list_unref (segment->data);
+  g_slice_free (GstHlsSinkSegment, segment);
+}
 
 static void
 gst_hls_sink_dispose (GObject * object)
@@ -106,6 +149,7 @@ gst_hls_sink_finalize (GObject * object)
   g_free (sink->playlist_root);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
+  g_free (sink->playlist_content);
 
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) sink);
 }
@@ -169,6 +213,77 @@ gst_hls_sink_class_init (GstHlsSinkClass * klass)
           "the playlist will be infinite.",
           0, G_MAXUINT, DEFAULT_PLAYLIST_LENGTH,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_IN_MEMORY,
+      g_param_spec_boolean ("in-memory", "In memory",
+          "Keep the last max-files segments in memory instead of writing "
+          "them to disk", DEFAULT_IN_MEMORY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PART_DURATION,
+      g_param_spec_uint64 ("part-duration", "Part duration",
+          "The target duration in nanoseconds of the partial segments in "
+          "in-memory mode (0 - disabled)",
+          0, G_MAXUINT64, DEFAULT_PART_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstHlsSink::segment-added:
+   * @sink: the #GstHlsSink
+   * @location: the location of the segment, as used in the playlist
+   * @data: the content of the segment
+   *
+   * Emitted in in-memory mode when a segment is complete, after the playlist
+   * was updated.
+   */
+  gst_hls_sink_signals[SIGNAL_SEGMENT_ADDED] =
+      g_signal_new ("segment-added", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
+      G_TYPE_NONE, 2, G_TYPE_STRING, GST_TYPE_BUFFER_LIST);
+
+  /**
+   * GstHlsSink::part-added:
+   * @sink: the #GstHlsSink
+   * @location: the location of the partial segment, as used in the playlist
+   * @data: the content of the partial segment
+   *
+   * Emitted in in-memory mode with #GstHlsSink:part-duration set when a
+   * partial segment is complete, after the playlist was updated.
+   */
+  gst_hls_sink_signals[SIGNAL_PART_ADDED] =
+      g_signal_new ("part-added", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
+      G_TYPE_NONE, 2, G_TYPE_STRING, GST_TYPE_BUFFER_LIST);
+
+  /**
+   * GstHlsSink::get-segment:
+   * @sink: the #GstHlsSink
+   * @location: the location of the segment
+   *
+   * Get the content of a segment or partial segment kept in memory.
+   *
+   * Returns: the content of the segment or %NULL if it isn't available
+   */
+  gst_hls_sink_signals[SIGNAL_GET_SEGMENT] =
+      g_signal_new ("get-segment", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstHlsSinkClass, get_segment), NULL, NULL,
+      g_cclosure_marshal_generic, GST_TYPE_BUFFER_LIST, 1, G_TYPE_STRING);
+
+  /**
+   * GstHlsSink::get-playlist:
+   * @sink: the #GstHlsSink
+   *
+   * Get the last written playlist.
+   *
+   * Returns: the playlist or %NULL if none was written yet
+   */
+  gst_hls_sink_signals[SIGNAL_GET_PLAYLIST] =
+      g_signal_new ("get-playlist", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstHlsSinkClass, get_playlist), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_STRING, 0);
+
+  klass->get_segment = gst_hls_sink_get_segment;
+  klass->get_playlist = gst_hls_sink_get_playlist;
 }
 
 static void
@@ -190,6 +305,10 @@ gst_hls_sink_init (GstHlsSink * sink)
   sink->playlist_length = DEFAULT_PLAYLIST_LENGTH;
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
+  sink->in_memory = DEFAULT_IN_MEMORY;
+  sink->part_duration = DEFAULT_PART_DURATION;
+  g_queue_init (&sink->segments);
+  g_queue_init (&sink->parts);
 
   /* haven't added a sink yet, make it is detected as a sink meanwhile */
   GST_OBJECT_FLAG_SET (sink, GST_ELEMENT_FLAG_SINK);
@@ -208,11 +327,76 @@ gst_hls_sink_reset (GstHlsSink * sink)
   gst_event_replace (&sink->force_key_unit_event, NULL);
   gst_segment_init (&sink->segment, GST_FORMAT_UNDEFINED);
 
+  if (sink->current_segment)
+    gst_buffer_list_unref (sink->current_segment);
+  sink->current_segment = NULL;
+  sink->current_end_running_time = GST_CLOCK_TIME_NONE;
+  sink->part_start = 0;
+  sink->part_start_running_time = GST_CLOCK_TIME_NONE;
+  sink->part_index = 0;
+
+  GST_OBJECT_LOCK (sink);
+  g_queue_foreach (&sink->segments, (GFunc) gst_hls_sink_segment_free, NULL);
+  g_queue_clear (&sink->segments);
+  g_queue_foreach (&sink->parts, (GFunc) gst_hls_sink_segment_free, NULL);
+  g_queue_clear (&sink->parts);
+  g_free (sink->playlist_content);
+  sink->playlist_content = NULL;
+  GST_OBJECT_UNLOCK (sink);
+
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
   sink->playlist =
       gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_VERSION, sink->playlist_length,
       FALSE);
+  if (sink->in_memory)
+    sink->playlist->part_target = sink->part_duration;
+}
+
+static GstFlowReturn
+gst_hls_sink_new_sample (GstElement * appsink, GstHlsSink * sink)
+{
+  GstSample *sample = NULL;
+  GstBuffer *buffer;
+  const GstSegment *segment;
+  GstClockTime start = GST_CLOCK_TIME_NONE, end;
+
+  g_signal_emit_by_name (appsink, "pull-sample", &sample);
+  if (sample == NULL)
+    return GST_FLOW_FLUSHING;
+
+  buffer = gst_sample_get_buffer (sample);
+  segment = gst_sample_get_segment (sample);
+
+  /* remember where the data ends for the duration of the last segment */
+  if (segment->format == GST_FORMAT_TIME && GST_BUFFER_PTS_IS_VALID (buffer)) {
+    start = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+        GST_BUFFER_PTS (buffer));
+    end = GST_BUFFER_PTS (buffer);
+    if (GST_BUFFER_DURATION_IS_VALID (buffer))
+      end += GST_BUFFER_DURATION (buffer);
+    end = gst_segment_to_running_time (segment, GST_FORMAT_TIME, end);
+    if (GST_CLOCK_TIME_IS_VALID (end))
+      sink->current_end_running_time = end;
+  }
+
+  /* parts are cut before the first buffer past the part duration */
+  if (sink->part_duration > 0 && GST_CLOCK_TIME_IS_VALID (start)) {
+    if (!GST_CLOCK_TIME_IS_VALID (sink->part_start_running_time)) {
+      sink->part_start_running_time = start;
+    } else if (start >= sink->part_start_running_time + sink->part_duration) {
+      gst_hls_sink_finish_part (sink, start);
+    }
+  }
+
+  /* the segment data only references the buffers, they are never merged */
+  if (sink->current_segment == NULL)
+    sink->current_segment = gst_buffer_list_new ();
+  gst_buffer_list_add (sink->current_segment, gst_buffer_ref (buffer));
+
+  gst_sample_unref (sample);
+
+  return GST_FLOW_OK;
 }
 
 static gboolean
@@ -225,6 +409,27 @@ gst_hls_sink_create_elements (GstHlsSink * sink)
   if (sink->elements_created)
     return TRUE;
 
+  if (sink->in_memory) {
+    sink->appsink = gst_element_factory_make ("appsink", NULL);
+    if (sink->appsink == NULL)
+      goto missing_appsink;
+
+    /* like multifilesink, write segments as they come instead of syncing
+     * on the clock */
+    g_object_set (sink->appsink, "emit-signals", TRUE, "sync", FALSE, NULL);
+    g_signal_connect (sink->appsink, "new-sample",
+        G_CALLBACK (gst_hls_sink_new_sample), sink);
+
+    gst_bin_add (GST_BIN_CAST (sink), sink->appsink);
+
+    pad = gst_element_get_static_pad (sink->appsink, "sink");
+    gst_ghost_pad_set_target (GST_GHOST_PAD (sink->ghostpad), pad);
+    gst_object_unref (pad);
+
+    sink->elements_created = TRUE;
+    return TRUE;
+  }
+
   sink->multifilesink = gst_element_factory_make ("multifilesink", NULL);
   if (sink->multifilesink == NULL)
     goto missing_element;
@@ -250,6 +455,14 @@ missing_element:
       (("Missing element '%s' - check your GStreamer installation."),
           "multifilesink"), (NULL));
   return FALSE;
+
+missing_appsink:
+  gst_element_post_message (GST_ELEMENT_CAST (sink),
+      gst_missing_element_message_new (GST_ELEMENT_CAST (sink), "appsink"));
+  GST_ELEMENT_ERROR (sink, CORE, MISSING_PLUGIN,
+      (("Missing element '%s' - check your GStreamer installation."),
+          "appsink"), (NULL));
+  return FALSE;
 }
 
 static void
@@ -258,8 +471,10 @@ gst_hls_sink_write_playlist (GstHlsSink * sink)
   char *playlist_content;
   GError *error = NULL;
 
+  /* g_file_set_contents() replaces the playlist atomically, readers never
+   * see a partially written file */
   playlist_content = gst_m3u8_playlist_render (sink->playlist);
-  if (!g_file_set_contents (sink->playlist_location,
+  if (sink->playlist_location && !g_file_set_contents (sink->playlist_location,
           playlist_content, -1, &error)) {
     GST_ERROR ("Failed to write playlist: %s", error->message);
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
@@ -267,8 +482,239 @@ gst_hls_sink_write_playlist (GstHlsSink * sink)
     g_error_free (error);
     error = NULL;
   }
-  g_free (playlist_content);
 
+  GST_OBJECT_LOCK (sink);
+  g_free (sink->playlist_content);
+  sink->playlist_content = playlist_content;
+  GST_OBJECT_UNLOCK (sink);
+}
+
+static gchar *
+gst_hls_sink_get_entry_location (GstHlsSink * sink, const gchar * filename)
+{
+  gchar *name, *entry_location;
+
+  name = g_path_get_basename (filename);
+  if (sink->playlist_root == NULL)
+    return name;
+
+  entry_location = g_build_filename (sink->playlist_root, name, NULL);
+  g_free (name);
+
+  return entry_location;
+}
+
+/* Returns the duration between two running times. Without timestamps the
+ * end can be unknown, don't put garbage in the playlist then */
+static GstClockTime
+gst_hls_sink_get_duration (GstHlsSink * sink, GstClockTime start,
+    GstClockTime end)
+{
+  if (!GST_CLOCK_TIME_IS_VALID (start) || !GST_CLOCK_TIME_IS_VALID (end)
+      || end < start) {
+    GST_WARNING_OBJECT (sink, "no valid running time, using duration 0");
+    return 0;
+  }
+
+  return end - start;
+}
+
+/* Inserts the part index before the extension of the segment location */
+static gchar *
+gst_hls_sink_get_part_location (GstHlsSink * sink, guint index)
+{
+  gchar *filename, *name, *ext, *location;
+
+  filename = g_strdup_printf (sink->location, sink->count);
+  name = g_path_get_basename (filename);
+  g_free (filename);
+
+  ext = strrchr (name, '.');
+  if (ext) {
+    *ext++ = '\0';
+    location = g_strdup_printf ("%s.%u.%s", name, index, ext);
+  } else {
+    location = g_strdup_printf ("%s.%u", name, index);
+  }
+  g_free (name);
+
+  return location;
+}
+
+/* Moves the data received since the start of the part to a new in-memory
+ * partial segment and adds it to the playlist */
+static void
+gst_hls_sink_finish_part (GstHlsSink * sink, GstClockTime running_time)
+{
+  GstHlsSinkSegment *part;
+  GstBufferList *data;
+  GstBuffer *first;
+  GstClockTime duration;
+  gboolean independent;
+  gchar *entry_location, *location;
+  guint i, len;
+
+  if (sink->current_segment == NULL)
+    return;
+
+  len = gst_buffer_list_length (sink->current_segment);
+  if (sink->part_start >= len)
+    return;
+
+  /* parts reference the same buffers as their segment */
+  data = gst_buffer_list_new_sized (len - sink->part_start);
+  for (i = sink->part_start; i < len; i++)
+    gst_buffer_list_add (data,
+        gst_buffer_ref (gst_buffer_list_get (sink->current_segment, i)));
+  first = gst_buffer_list_get (data, 0);
+  independent = !GST_BUFFER_FLAG_IS_SET (first, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  duration = gst_hls_sink_get_duration (sink, sink->part_start_running_time,
+      running_time);
+
+  part = g_slice_new (GstHlsSinkSegment);
+  part->location = gst_hls_sink_get_part_location (sink, sink->part_index++);
+  part->data = data;
+  part->count = sink->count;
+
+  GST_INFO_OBJECT (sink, "part %s, duration %" GST_TIME_FORMAT,
+      part->location, GST_TIME_ARGS (duration));
+  entry_location = gst_hls_sink_get_entry_location (sink, part->location);
+  gst_m3u8_playlist_add_part (sink->playlist, entry_location, duration,
+      independent);
+  g_free (entry_location);
+
+  sink->part_start = len;
+  sink->part_start_running_time = running_time;
+
+  location = g_strdup (part->location);
+  data = gst_buffer_list_ref (part->data);
+
+  GST_OBJECT_LOCK (sink);
+  g_queue_push_tail (&sink->parts, part);
+  GST_OBJECT_UNLOCK (sink);
+
+  /* clients can request the part as soon as it is listed */
+  gst_hls_sink_write_playlist (sink);
+
+  g_signal_emit (sink, gst_hls_sink_signals[SIGNAL_PART_ADDED], 0,
+      location, data);
+  g_free (location);
+  gst_buffer_list_unref (data);
+}
+
+/* Moves the data received since the last key unit to a new in-memory
+ * segment and adds it to the playlist */
+static void
+gst_hls_sink_finish_segment (GstHlsSink * sink, GstClockTime running_time)
+{
+  GstHlsSinkSegment *segment;
+  GstBufferList *data;
+  GstClockTime duration;
+  gchar *filename, *entry_location, *location;
+
+  if (sink->current_segment == NULL)
+    return;
+
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    running_time = sink->current_end_running_time;
+
+  if (sink->part_duration > 0)
+    gst_hls_sink_finish_part (sink, running_time);
+
+  filename = g_strdup_printf (sink->location, sink->count++);
+  segment = g_slice_new (GstHlsSinkSegment);
+  segment->location = g_path_get_basename (filename);
+  segment->data = sink->current_segment;
+  segment->count = sink->count - 1;
+  sink->current_segment = NULL;
+  sink->part_start = 0;
+  sink->part_start_running_time = GST_CLOCK_TIME_NONE;
+  sink->part_index = 0;
+
+  duration = gst_hls_sink_get_duration (sink, sink->last_running_time,
+      running_time);
+  if (GST_CLOCK_TIME_IS_VALID (running_time)
+      && running_time >= sink->last_running_time)
+    sink->last_running_time = running_time;
+
+  GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
+  entry_location = gst_hls_sink_get_entry_location (sink, filename);
+  gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
+      NULL, duration, sink->index, FALSE);
+  g_free (entry_location);
+  g_free (filename);
+
+  location = g_strdup (segment->location);
+  data = gst_buffer_list_ref (segment->data);
+
+  GST_OBJECT_LOCK (sink);
+  g_queue_push_tail (&sink->segments, segment);
+  while (sink->max_files > 0
+      && g_queue_get_length (&sink->segments) > (guint) sink->max_files)
+    gst_hls_sink_segment_free (g_queue_pop_head (&sink->segments));
+  /* the playlist only lists the parts of the last segment */
+  while (!g_queue_is_empty (&sink->parts)
+      && ((GstHlsSinkSegment *) g_queue_peek_head (&sink->parts))->count <
+      sink->count - 1)
+    gst_hls_sink_segment_free (g_queue_pop_head (&sink->parts));
+  GST_OBJECT_UNLOCK (sink);
+
+  gst_hls_sink_write_playlist (sink);
+
+  g_signal_emit (sink, gst_hls_sink_signals[SIGNAL_SEGMENT_ADDED], 0,
+      location, data);
+  g_free (location);
+  gst_buffer_list_unref (data);
+}
+
+/* call with the object lock */
+static GstBufferList *
+gst_hls_sink_find_segment (GQueue * segments, const gchar * name)
+{
+  GList *l;
+
+  for (l = segments->head; l; l = l->next) {
+    GstHlsSinkSegment *segment = l->data;
+
+    if (g_str_equal (segment->location, name))
+      return gst_buffer_list_ref (segment->data);
+  }
+
+  return NULL;
+}
+
+static GstBufferList *
+gst_hls_sink_get_segment (GstHlsSink * sink, const gchar * location)
+{
+  GstBufferList *data;
+  gchar *name;
+
+  g_return_val_if_fail (location != NULL, NULL);
+
+  name = g_path_get_basename (location);
+
+  GST_OBJECT_LOCK (sink);
+  data = gst_hls_sink_find_segment (&sink->segments, name);
+  if (data == NULL)
+    data = gst_hls_sink_find_segment (&sink->parts, name);
+  GST_OBJECT_UNLOCK (sink);
+
+  g_free (name);
+
+  return data;
+}
+
+static gchar *
+gst_hls_sink_get_playlist (GstHlsSink * sink)
+{
+  gchar *playlist;
+
+  GST_OBJECT_LOCK (sink);
+  playlist = g_strdup (sink->playlist_content);
+  GST_OBJECT_UNLOCK (sink);
+
+  return playlist;
 }
 
 static void
@@ -290,18 +736,17 @@ gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
         break;
 
       filename = gst_structure_get_string (structure, "filename");
-      gst_structure_get_clock_time (structure, "running-time", &running_time);
-      duration = running_time - sink->last_running_time;
-      sink->last_running_time = running_time;
+      if (!gst_structure_get_clock_time (structure, "running-time",
+              &running_time))
+        running_time = GST_CLOCK_TIME_NONE;
+      duration = gst_hls_sink_get_duration (sink, sink->last_running_time,
+          running_time);
+      if (GST_CLOCK_TIME_IS_VALID (running_time)
+          && running_time >= sink->last_running_time)
+        sink->last_running_time = running_time;
 
       GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-      if (sink->playlist_root == NULL)
-        entry_location = g_path_get_basename (filename);
-      else {
-        gchar *name = g_path_get_basename (filename);
-        entry_location = g_build_filename (sink->playlist_root, name, NULL);
-        g_free (name);
-      }
+      entry_location = gst_hls_sink_get_entry_location (sink, filename);
 
       gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
           NULL, duration, sink->index, discont);
@@ -323,6 +768,8 @@ gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
       break;
     }
     case GST_MESSAGE_EOS:{
+      if (sink->in_memory)
+        gst_hls_sink_finish_segment (sink, GST_CLOCK_TIME_NONE);
       sink->playlist->end_list = TRUE;
       gst_hls_sink_write_playlist (sink);
       break;
@@ -335,6 +782,30 @@ gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
     GST_BIN_CLASS (parent_class)->handle_message (bin, message);
 }
 
+/* Removes the elements created by gst_hls_sink_create_elements(), so that
+ * they are created again according to the in-memory property */
+static void
+gst_hls_sink_remove_elements (GstHlsSink * sink)
+{
+  if (!sink->elements_created)
+    return;
+
+  GST_DEBUG_OBJECT (sink, "Removing internal elements");
+
+  gst_ghost_pad_set_target (GST_GHOST_PAD (sink->ghostpad), NULL);
+
+  if (sink->appsink) {
+    gst_bin_remove (GST_BIN_CAST (sink), sink->appsink);
+    sink->appsink = NULL;
+  }
+  if (sink->multifilesink) {
+    gst_bin_remove (GST_BIN_CAST (sink), sink->multifilesink);
+    sink->multifilesink = NULL;
+  }
+
+  sink->elements_created = FALSE;
+}
+
 static GstStateChangeReturn
 gst_hls_sink_change_state (GstElement * element, GstStateChange trans)
 {
@@ -363,6 +834,7 @@ gst_hls_sink_change_state (GstElement * element, GstStateChange trans)
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       gst_hls_sink_reset (sink);
+      gst_hls_sink_remove_elements (sink);
       break;
     default:
       break;
@@ -407,6 +879,20 @@ gst_hls_sink_set_property (GObject * object, guint prop_id,
       sink->playlist_length = g_value_get_uint (value);
       sink->playlist->window_size = sink->playlist_length;
       break;
+    case PROP_IN_MEMORY:
+      if (sink->elements_created) {
+        GST_WARNING_OBJECT (sink, "in-memory can only be changed in NULL "
+            "state");
+        break;
+      }
+      sink->in_memory = g_value_get_boolean (value);
+      sink->playlist->part_target = sink->in_memory ? sink->part_duration : 0;
+      break;
+    case PROP_PART_DURATION:
+      sink->part_duration = g_value_get_uint64 (value);
+      if (sink->in_memory)
+        sink->playlist->part_target = sink->part_duration;
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -438,6 +924,12 @@ gst_hls_sink_get_property (GObject * object, guint prop_id,
     case PROP_PLAYLIST_LENGTH:
       g_value_set_uint (value, sink->playlist_length);
       break;
+    case PROP_IN_MEMORY:
+      g_value_set_boolean (value, sink->in_memory);
+      break;
+    case PROP_PART_DURATION:
+      g_value_set_uint64 (value, sink->part_duration);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -475,6 +967,13 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstPadProbeInfo * info,
           &timestamp, &stream_time, &running_time, &all_headers, &count);
       GST_INFO_OBJECT (sink, "setting index %d", count);
       sink->index = count;
+
+      /* what multifilesink does when it starts a new file */
+      if (sink->in_memory && sink->current_segment) {
+        gst_hls_sink_finish_segment (sink, running_time);
+        sink->waiting_fku = FALSE;
+        schedule_next_key_unit (sink);
+      }
       break;
     }
     default:
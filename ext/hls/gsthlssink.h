@@ -33,6 +33,14 @@ G_BEGIN_DECLS
 
 typedef struct _GstHlsSink GstHlsSink;
 typedef struct _GstHlsSinkClass GstHlsSinkClass;
+typedef struct _GstHlsSinkSegment GstHlsSinkSegment;
+
+struct _GstHlsSinkSegment
+{
+  gchar *location;
+  GstBufferList *data;
+  gint count;                   /* the segment a part belongs to */
+};
 
 struct _GstHlsSink
 {
@@ -56,11 +64,30 @@ struct _GstHlsSink
   GstSegment segment;
   gboolean waiting_fku;
   GstClockTime last_running_time;
+
+  /* in-memory mode */
+  gboolean in_memory;
+  GstElement *appsink;
+  GstBufferList *current_segment;
+  GstClockTime current_end_running_time;
+  GQueue segments;              /* GstHlsSinkSegment, protected by object lock */
+  gchar *playlist_content;      /* protected by object lock */
+
+  /* partial segments, in-memory mode only */
+  GstClockTime part_duration;
+  guint part_start;             /* first buffer of the part in current_segment */
+  GstClockTime part_start_running_time;
+  guint part_index;
+  GQueue parts;                 /* GstHlsSinkSegment, protected by object lock */
 };
 
 struct _GstHlsSinkClass
 {
   GstBinClass bin_class;
+
+  /* actions */
+  GstBufferList *(*get_segment) (GstHlsSink * sink, const gchar * location);
+  gchar *(*get_playlist) (GstHlsSink * sink);
 };
 
 GType gst_hls_sink_get_type (void);
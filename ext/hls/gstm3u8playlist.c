@@ -35,6 +35,9 @@
 #define M3U8_INT_INF_TAG "#EXTINF:%d,%s\n%s\n"
 #define M3U8_FLOAT_INF_TAG "#EXTINF:%s,%s\n%s\n"
 #define M3U8_ENDLIST_TAG "#EXT-X-ENDLIST"
+#define M3U8_SERVER_CONTROL_TAG "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%s\n"
+#define M3U8_PART_INF_TAG "#EXT-X-PART-INF:PART-TARGET=%s\n"
+#define M3U8_PART_TAG "#EXT-X-PART:DURATION=%s,URI=\"%s\"%s\n"
 
 enum
 {
@@ -65,6 +68,8 @@ gst_m3u8_entry_free (GstM3U8Entry * entry)
 
   g_free (entry->url);
   g_free (entry->title);
+  g_free (entry->rendered);
+  g_free (entry->parts);
   g_free (entry);
 }
 
@@ -99,6 +104,7 @@ gst_m3u8_playlist_new (guint version, guint window_size, gboolean allow_cache)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->pending_parts = g_string_new ("");
 
   return playlist;
 }
@@ -110,6 +116,7 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_string_free (playlist->pending_parts, TRUE);
   g_free (playlist);
 }
 
@@ -128,6 +135,21 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
     return FALSE;
 
   entry = gst_m3u8_entry_new (url, title, duration, discontinuous);
+  /* entries never change once added, render them only once */
+  entry->rendered = gst_m3u8_entry_render (entry, playlist->version);
+
+  /* only the parts of the last segment are listed, the older segments are
+   * complete and can be requested as a whole */
+  if (playlist->entries->length > 0) {
+    GstM3U8Entry *last_entry = g_queue_peek_tail (playlist->entries);
+
+    g_free (last_entry->parts);
+    last_entry->parts = NULL;
+  }
+  if (playlist->pending_parts->len > 0) {
+    entry->parts = g_string_free (playlist->pending_parts, FALSE);
+    playlist->pending_parts = g_string_new ("");
+  }
 
   if (playlist->window_size > 0) {
     /* Delete old entries from the playlist */
@@ -145,6 +167,27 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   return TRUE;
 }
 
+/* Adds a partial segment of the segment in progress. The parts are attached
+ * to the segment by the next gst_m3u8_playlist_add_entry() */
+gboolean
+gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist, const gchar * url,
+    gfloat duration, gboolean independent)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_return_val_if_fail (playlist != NULL, FALSE);
+  g_return_val_if_fail (url != NULL, FALSE);
+
+  if (playlist->type == GST_M3U8_PLAYLIST_TYPE_VOD)
+    return FALSE;
+
+  g_string_append_printf (playlist->pending_parts, M3U8_PART_TAG,
+      g_ascii_dtostr (buf, sizeof (buf), (duration / GST_SECOND)), url,
+      independent ? ",INDEPENDENT=YES" : "");
+
+  return TRUE;
+}
+
 static guint
 gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 {
@@ -164,11 +207,9 @@ gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 static void
 render_entry (GstM3U8Entry * entry, GstM3U8Playlist * playlist)
 {
-  gchar *entry_str;
-
-  entry_str = gst_m3u8_entry_render (entry, playlist->version);
-  g_string_append_printf (playlist->playlist_str, "%s", entry_str);
-  g_free (entry_str);
+  if (entry->parts)
+    g_string_append (playlist->playlist_str, entry->parts);
+  g_string_append (playlist->playlist_str, entry->rendered);
 }
 
 gchar *
@@ -194,11 +235,26 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
   /* #EXT-X-TARGETDURATION */
   g_string_append_printf (playlist->playlist_str, M3U8_TARGETDURATION_TAG,
       gst_m3u8_playlist_target_duration (playlist));
+  if (playlist->part_target > 0) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    /* #EXT-X-SERVER-CONTROL, the minimum hold back is 3 part targets */
+    g_string_append_printf (playlist->playlist_str, M3U8_SERVER_CONTROL_TAG,
+        g_ascii_dtostr (buf, sizeof (buf),
+            (3 * playlist->part_target / GST_SECOND)));
+    /* #EXT-X-PART-INF */
+    g_string_append_printf (playlist->playlist_str, M3U8_PART_INF_TAG,
+        g_ascii_dtostr (buf, sizeof (buf),
+            (playlist->part_target / GST_SECOND)));
+  }
   g_string_append_printf (playlist->playlist_str, "\n");
 
   /* Entries */
   g_queue_foreach (playlist->entries, (GFunc) render_entry, playlist);
 
+  /* Parts of the segment in progress */
+  g_string_append (playlist->playlist_str, playlist->pending_parts->str);
+
   if (playlist->end_list)
     g_string_append_printf (playlist->playlist_str, M3U8_ENDLIST_TAG);
 
@@ -214,6 +270,7 @@ gst_m3u8_playlist_clear (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_clear (playlist->entries);
+  g_string_truncate (playlist->pending_parts, 0);
 }
 
 guint
@@ -37,6 +37,10 @@ struct _GstM3U8Entry
   gchar *title;
   gchar *url;
   gboolean discontinuous;
+
+  /*< Private >*/
+  gchar *rendered;
+  gchar *parts;
 };
 
 struct _GstM3U8Playlist
@@ -47,9 +51,11 @@ struct _GstM3U8Playlist
   gint type;
   gboolean end_list;
   guint sequence_number;
+  gfloat part_target;
 
   /*< Private >*/
   GQueue *entries;
+  GString *pending_parts;
   GString *playlist_str;
 };
 
@@ -64,6 +70,10 @@ gboolean gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
 				     gfloat duration,
 				     guint index,
 				     gboolean discontinuous);
+gboolean gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist,
+                                     const gchar * url,
+                                     gfloat duration,
+                                     gboolean independent);
 gchar * gst_m3u8_playlist_render (GstM3U8Playlist * playlist); 
 void gst_m3u8_playlist_clear (GstM3U8Playlist * playlist); 
 guint gst_m3u8_playlist_n_entries (GstM3U8Playlist * playlist); 
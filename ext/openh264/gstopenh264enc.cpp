@@ -34,12 +34,18 @@
 #include <gst/video/video.h>
 #include <gst/video/gstvideoencoder.h>
 #include <string.h>
+#include <stdio.h>
 
 #include <wels/codec_api.h>
 #include <wels/codec_app_def.h>
 #include <wels/codec_def.h>
 #include <wels/codec_ver.h>
 
+/* independent AVC streams per spatial layer instead of SVC */
+#if OPENH264_MAJOR > 1 || OPENH264_MINOR >= 5
+#define HAVE_SIMULCAST_AVC 1
+#endif
+
 #define GST_OPENH264ENC_GET_PRIVATE(obj) \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj), GST_TYPE_OPENH264ENC, GstOpenh264EncPrivate))
 
@@ -167,6 +173,11 @@ static gboolean gst_openh264enc_set_format (GstVideoEncoder * encoder,
 static GstFlowReturn gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
     GstVideoCodecFrame * frame);
 static GstFlowReturn gst_openh264enc_finish (GstVideoEncoder * encoder);
+static gboolean gst_openh264enc_sink_event (GstVideoEncoder * encoder,
+    GstEvent * event);
+static GstPad *gst_openh264enc_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_openh264enc_release_pad (GstElement * element, GstPad * pad);
 static gboolean gst_openh264enc_propose_allocation (GstVideoEncoder * encoder,
     GstQuery * query);
 static void gst_openh264enc_set_usage_type (GstOpenh264Enc * openh264enc,
@@ -192,6 +203,10 @@ static void gst_openh264enc_set_rate_control (GstOpenh264Enc * openh264enc,
 #define DEFAULT_SLICE_MODE      SM_FIXEDSLCNUM_SLICE
 #define DEFAULT_NUM_SLICES      1
 #define DEFAULT_COMPLEXITY      MEDIUM_COMPLEXITY
+#define DEFAULT_SPATIAL_LAYERS  NULL
+
+/* the input resolution is always encoded as the top layer */
+#define MAX_EXTRA_LAYERS        (MAX_SPATIAL_LAYER_NUM - 1)
 
 enum
 {
@@ -211,9 +226,24 @@ enum
   PROP_SLICE_MODE,
   PROP_NUM_SLICES,
   PROP_COMPLEXITY,
+  PROP_SPATIAL_LAYERS,
   N_PROPERTIES
 };
 
+/* A lower resolution layer, output on the src_%u request pad */
+typedef struct
+{
+  guint width;
+  guint height;
+  guint bitrate;
+
+  GstPad *srcpad;
+  GstCaps *caps;
+  gboolean need_stream_start;
+  gboolean need_caps;
+  gboolean need_segment;
+} GstOpenh264EncLayer;
+
 struct _GstOpenh264EncPrivate
 {
   ISVCEncoder *encoder;
@@ -238,6 +268,11 @@ struct _GstOpenh264EncPrivate
   SliceModeEnum slice_mode;
   guint num_slices;
   ECOMPLEXITY_MODE complexity;
+  gchar *spatial_layers;
+  GstOpenh264EncLayer layers[MAX_EXTRA_LAYERS];
+  guint n_layers;
+  /* number of spatial layers the encoder was configured with */
+  guint n_spatial;
 };
 
 /* pad templates */
@@ -249,12 +284,21 @@ GST_STATIC_PAD_TEMPLATE ("sink",
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("I420"))
     );
 
+#define SRC_CAPS \
+    "video/x-h264, stream-format=(string)\"avc\", alignment=(string)\"au\", profile=(string)\"baseline\""
+
 static GstStaticPadTemplate gst_openh264enc_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS
-    ("video/x-h264, stream-format=(string)\"avc\", alignment=(string)\"au\", profile=(string)\"baseline\"")
+    GST_STATIC_CAPS (SRC_CAPS)
+    );
+
+static GstStaticPadTemplate gst_openh264enc_layer_src_template =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (SRC_CAPS)
     );
 
 /* class initialization */
@@ -277,6 +321,8 @@ gst_openh264enc_class_init (GstOpenh264EncClass * klass)
      base_class_init if you intend to subclass this class. */
   gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
       gst_static_pad_template_get (&gst_openh264enc_src_template));
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_static_pad_template_get (&gst_openh264enc_layer_src_template));
   gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
       gst_static_pad_template_get (&gst_openh264enc_sink_template));
 
@@ -287,6 +333,10 @@ gst_openh264enc_class_init (GstOpenh264EncClass * klass)
   gobject_class->set_property = gst_openh264enc_set_property;
   gobject_class->get_property = gst_openh264enc_get_property;
   gobject_class->finalize = gst_openh264enc_finalize;
+  GST_ELEMENT_CLASS (klass)->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_openh264enc_request_new_pad);
+  GST_ELEMENT_CLASS (klass)->release_pad =
+      GST_DEBUG_FUNCPTR (gst_openh264enc_release_pad);
   video_encoder_class->start = GST_DEBUG_FUNCPTR (gst_openh264enc_start);
   video_encoder_class->stop = GST_DEBUG_FUNCPTR (gst_openh264enc_stop);
   video_encoder_class->set_format =
@@ -296,6 +346,8 @@ gst_openh264enc_class_init (GstOpenh264EncClass * klass)
   video_encoder_class->propose_allocation =
       GST_DEBUG_FUNCPTR (gst_openh264enc_propose_allocation);
   video_encoder_class->finish = GST_DEBUG_FUNCPTR (gst_openh264enc_finish);
+  video_encoder_class->sink_event =
+      GST_DEBUG_FUNCPTR (gst_openh264enc_sink_event);
 
   /* define properties */
   g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_USAGE_TYPE,
@@ -381,6 +433,14 @@ gst_openh264enc_class_init (GstOpenh264EncClass * klass)
       g_param_spec_enum ("complexity", "Complexity / quality / speed tradeoff", "Complexity",
           GST_TYPE_OPENH264ENC_COMPLEXITY, DEFAULT_COMPLEXITY,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SPATIAL_LAYERS,
+      g_param_spec_string ("spatial-layers", "Spatial layers",
+          "Comma separated list of additional layers encoded in the same pass, "
+          "from the largest to the smallest, as WIDTHxHEIGHT:BITRATE. "
+          "Layer N is output on the src_N request pad",
+          DEFAULT_SPATIAL_LAYERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -409,6 +469,10 @@ gst_openh264enc_init (GstOpenh264Enc * openh264enc)
   openh264enc->priv->num_slices = DEFAULT_NUM_SLICES;
   openh264enc->priv->encoder = NULL;
   openh264enc->priv->complexity = DEFAULT_COMPLEXITY;
+  openh264enc->priv->spatial_layers = NULL;
+  openh264enc->priv->n_layers = 0;
+  openh264enc->priv->n_spatial = 1;
+  memset (openh264enc->priv->layers, 0, sizeof (openh264enc->priv->layers));
   gst_openh264enc_set_usage_type (openh264enc, CAMERA_VIDEO_REAL_TIME);
   gst_openh264enc_set_rate_control (openh264enc, RC_QUALITY_MODE);
 }
@@ -428,6 +492,48 @@ gst_openh264enc_set_usage_type (GstOpenh264Enc * openh264enc, gint usage_type)
   }
 }
 
+static void
+gst_openh264enc_set_spatial_layers (GstOpenh264Enc * openh264enc,
+    const gchar * spatial_layers)
+{
+  GstOpenh264EncPrivate *priv = openh264enc->priv;
+  gchar **layers;
+  guint i, n = 0;
+
+  g_free (priv->spatial_layers);
+  priv->spatial_layers = g_strdup (spatial_layers);
+
+  if (spatial_layers == NULL) {
+    priv->n_layers = 0;
+    return;
+  }
+
+  layers = g_strsplit (spatial_layers, ",", -1);
+  for (i = 0; layers[i] != NULL; i++) {
+    guint width, height, bitrate;
+
+    if (n == MAX_EXTRA_LAYERS) {
+      GST_WARNING_OBJECT (openh264enc, "only %d additional layers supported",
+          MAX_EXTRA_LAYERS);
+      break;
+    }
+
+    if (sscanf (layers[i], "%ux%u:%u", &width, &height, &bitrate) != 3 ||
+        width == 0 || height == 0) {
+      GST_WARNING_OBJECT (openh264enc, "invalid layer '%s'", layers[i]);
+      continue;
+    }
+
+    priv->layers[n].width = width;
+    priv->layers[n].height = height;
+    priv->layers[n].bitrate = bitrate;
+    n++;
+  }
+  g_strfreev (layers);
+
+  priv->n_layers = n;
+}
+
 static void
 gst_openh264enc_set_rate_control (GstOpenh264Enc * openh264enc, gint rc_mode)
 {
@@ -519,6 +625,11 @@ gst_openh264enc_set_property (GObject * object, guint property_id,
       openh264enc->priv->complexity = (ECOMPLEXITY_MODE) g_value_get_enum (value);
       break;
 
+    case PROP_SPATIAL_LAYERS:
+      gst_openh264enc_set_spatial_layers (openh264enc,
+          g_value_get_string (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -594,6 +705,10 @@ gst_openh264enc_get_property (GObject * object, guint property_id,
       g_value_set_enum (value, openh264enc->priv->complexity);
       break;
 
+    case PROP_SPATIAL_LAYERS:
+      g_value_set_string (value, openh264enc->priv->spatial_layers);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -614,6 +729,9 @@ gst_openh264enc_finalize (GObject * object)
   }
   openh264enc->priv->input_state = NULL;
 
+  g_free (openh264enc->priv->spatial_layers);
+  openh264enc->priv->spatial_layers = NULL;
+
   G_OBJECT_CLASS (gst_openh264enc_parent_class)->finalize (object);
 }
 
@@ -630,6 +748,7 @@ static gboolean
 gst_openh264enc_stop (GstVideoEncoder * encoder)
 {
   GstOpenh264Enc *openh264enc;
+  guint i;
 
   openh264enc = GST_OPENH264ENC (encoder);
 
@@ -645,12 +764,97 @@ gst_openh264enc_stop (GstVideoEncoder * encoder)
   }
   openh264enc->priv->input_state = NULL;
 
+  for (i = 0; i < MAX_EXTRA_LAYERS; i++) {
+    gst_caps_replace (&openh264enc->priv->layers[i].caps, NULL);
+  }
+
   GST_DEBUG_OBJECT (openh264enc, "openh264_enc_stop called");
 
   return TRUE;
 }
 
 
+/* NALs in the bitstream of a layer are prefixed with a 4 byte start code */
+#define START_CODE_SIZE 4
+
+static guint gst_openh264enc_get_layer_output (GstOpenh264Enc * openh264enc,
+    SLayerBSInfo * bs_info);
+
+/* Creates avcC codec_data with the SPS and PPS of the spatial layer that
+ * goes out on output @out, with the profile and level of its SPS */
+static GstBuffer *
+gst_openh264enc_make_codec_data (GstOpenh264Enc * openh264enc,
+    SFrameBSInfo * bs_info, guint out)
+{
+  guchar *codec_data, *data;
+  const guchar *sps = NULL;
+  gsize size = 5 + 1 + 1;
+  guint n_sps = 0, n_pps = 0;
+  guint8 level = 0;
+  gint l, n, pass;
+  gsize offset;
+
+  for (l = 0; l < bs_info->iLayerNum; l++) {
+    SLayerBSInfo *layer = &bs_info->sLayerInfo[l];
+
+    if (gst_openh264enc_get_layer_output (openh264enc, layer) != out)
+      continue;
+
+    data = layer->pBsBuf;
+    for (n = 0; n < layer->iNalCount; n++) {
+      guint8 nal_type = data[START_CODE_SIZE] & 0x1f;
+
+      if (nal_type == 7) {
+        if (sps == NULL)
+          sps = data + START_CODE_SIZE;
+        level = MAX (level, data[START_CODE_SIZE + 3]);
+        n_sps++;
+      } else if (nal_type == 8) {
+        n_pps++;
+      }
+      if (nal_type == 7 || nal_type == 8)
+        size += 2 + layer->pNalLengthInByte[n] - START_CODE_SIZE;
+      data += layer->pNalLengthInByte[n];
+    }
+  }
+
+  if (sps == NULL || n_pps == 0)
+    return NULL;
+
+  codec_data = (guchar *) g_malloc (size);
+  codec_data[0] = 1; /* version 1 */ ;
+  codec_data[1] = sps[1];       /* profile */
+  codec_data[2] = sps[2];       /* profile constraints */
+  codec_data[3] = level;        /* level */
+  codec_data[4] = 1;    /* NAL length marker length minus one */
+
+  /* SPS in the first pass, PPS in the second */
+  offset = 5;
+  for (pass = 7; pass <= 8; pass++) {
+    codec_data[offset++] = pass == 7 ? n_sps : n_pps;   /* Number of SPS/PPS */
+    for (l = 0; l < bs_info->iLayerNum; l++) {
+      SLayerBSInfo *layer = &bs_info->sLayerInfo[l];
+
+      if (gst_openh264enc_get_layer_output (openh264enc, layer) != out)
+        continue;
+
+      data = layer->pBsBuf;
+      for (n = 0; n < layer->iNalCount; n++) {
+        gint nal_length = layer->pNalLengthInByte[n] - START_CODE_SIZE;
+
+        if ((data[START_CODE_SIZE] & 0x1f) == pass) {
+          GST_WRITE_UINT16_BE (codec_data + offset, nal_length);
+          memcpy (codec_data + offset + 2, data + START_CODE_SIZE, nal_length);
+          offset += 2 + nal_length;
+        }
+        data += layer->pNalLengthInByte[n];
+      }
+    }
+  }
+
+  return gst_buffer_new_wrapped (codec_data, size);
+}
+
 static gboolean
 gst_openh264enc_set_format (GstVideoEncoder * encoder,
     GstVideoCodecState * state)
@@ -662,17 +866,12 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   guint width, height, fps_n, fps_d;
   SEncParamExt enc_params;
   gint ret;
-  guchar *nal_sps_data = NULL;
-  gint nal_sps_length = 0;
-  guchar *nal_pps_data = NULL;
-  gint nal_pps_length = 0;
-  guchar *sps_tmp_buf;
-  guchar *codec_data_tmp_buf;
   GstBuffer *codec_data;
   GstCaps *outcaps;
   GstVideoCodecState *output_state;
   openh264enc->priv->frame_count = 0;
   int video_format = videoFormatI420;
+  guint i, n_spatial, total_bitrate;
 
   debug_caps = gst_caps_to_string (state->caps);
   GST_DEBUG_OBJECT (openh264enc, "gst_e26d4_enc_set_format called, caps: %s",
@@ -691,6 +890,31 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   fps_n = GST_VIDEO_INFO_FPS_N (&state->info);
   fps_d = GST_VIDEO_INFO_FPS_D (&state->info);
 
+  n_spatial = 1;
+  if (priv->n_layers > 0) {
+#ifdef HAVE_SIMULCAST_AVC
+    n_spatial = 1 + priv->n_layers;
+#else
+    GST_WARNING_OBJECT (openh264enc, "this version of openh264 can't encode "
+        "independent spatial layers, only encoding the input resolution");
+#endif
+  }
+
+  /* openh264 wants the layers ordered from the smallest to the largest */
+  for (i = 1; i < n_spatial; i++) {
+    guint prev_width = i == 1 ? width : priv->layers[i - 2].width;
+    guint prev_height = i == 1 ? height : priv->layers[i - 2].height;
+
+    if (priv->layers[i - 1].width > prev_width ||
+        priv->layers[i - 1].height > prev_height) {
+      GST_ELEMENT_ERROR (openh264enc, LIBRARY, SETTINGS, (NULL),
+          ("Spatial layer %u (%ux%u) is larger than the layer above it", i,
+              priv->layers[i - 1].width, priv->layers[i - 1].height));
+      return FALSE;
+    }
+  }
+  priv->n_spatial = n_spatial;
+
   if (priv->encoder != NULL) {
     priv->encoder->Uninitialize ();
     WelsDestroySVCEncoder (priv->encoder);
@@ -705,10 +929,12 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   enc_params.iUsageType = openh264enc->priv->usage_type;
   enc_params.iPicWidth = width;
   enc_params.iPicHeight = height;
-  enc_params.iTargetBitrate = openh264enc->priv->bitrate;
   enc_params.iRCMode = RC_QUALITY_MODE;
   enc_params.iTemporalLayerNum = 1;
-  enc_params.iSpatialLayerNum = 1;
+  enc_params.iSpatialLayerNum = n_spatial;
+#ifdef HAVE_SIMULCAST_AVC
+  enc_params.bSimulcastAVC = n_spatial > 1;
+#endif
   enc_params.iLtrMarkPeriod = 30;
   enc_params.iMultipleThreadIdc = openh264enc->priv->multi_thread;
   enc_params.bEnableDenoise = openh264enc->priv->enable_denoise;
@@ -729,15 +955,29 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   enc_params.bPrefixNalAddingCtrl = 0;
   enc_params.fMaxFrameRate = fps_n * 1.0 / fps_d;
   enc_params.iLoopFilterDisableIdc = openh264enc->priv->deblocking_mode;
-  enc_params.sSpatialLayers[0].uiProfileIdc = PRO_BASELINE;
-  enc_params.sSpatialLayers[0].iVideoWidth = width;
-  enc_params.sSpatialLayers[0].iVideoHeight = height;
-  enc_params.sSpatialLayers[0].fFrameRate = fps_n * 1.0 / fps_d;
-  enc_params.sSpatialLayers[0].iSpatialBitrate = openh264enc->priv->bitrate;
-  enc_params.sSpatialLayers[0].sSliceCfg.uiSliceMode =
-      openh264enc->priv->slice_mode;
-  enc_params.sSpatialLayers[0].sSliceCfg.sSliceArgument.uiSliceNum =
-      openh264enc->priv->num_slices;
+
+  /* the input resolution is the last, largest, spatial layer */
+  total_bitrate = 0;
+  for (i = 0; i < n_spatial; i++) {
+    SSpatialLayerConfig *layer =
+        &enc_params.sSpatialLayers[n_spatial - 1 - i];
+
+    layer->uiProfileIdc = PRO_BASELINE;
+    if (i == 0) {
+      layer->iVideoWidth = width;
+      layer->iVideoHeight = height;
+      layer->iSpatialBitrate = openh264enc->priv->bitrate;
+    } else {
+      layer->iVideoWidth = priv->layers[i - 1].width;
+      layer->iVideoHeight = priv->layers[i - 1].height;
+      layer->iSpatialBitrate = priv->layers[i - 1].bitrate;
+    }
+    layer->fFrameRate = fps_n * 1.0 / fps_d;
+    layer->sSliceCfg.uiSliceMode = openh264enc->priv->slice_mode;
+    layer->sSliceCfg.sSliceArgument.uiSliceNum = openh264enc->priv->num_slices;
+    total_bitrate += layer->iSpatialBitrate;
+  }
+  enc_params.iTargetBitrate = total_bitrate;
 
   priv->framerate = (1 + fps_n / fps_d);
 
@@ -754,45 +994,21 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
 
   ret = priv->encoder->EncodeParameterSets (&bsInfo);
 
-  nal_sps_data = bsInfo.sLayerInfo[0].pBsBuf + 4;
-  nal_sps_length = bsInfo.sLayerInfo[0].pNalLengthInByte[0] - 4;
-
-  nal_pps_data = bsInfo.sLayerInfo[0].pBsBuf + nal_sps_length + 8;
-  nal_pps_length = bsInfo.sLayerInfo[0].pNalLengthInByte[1] - 4;
-
   if (ret != cmResultSuccess) {
     GST_ELEMENT_ERROR (openh264enc, STREAM, ENCODE,
         ("Could not create headers"), ("Could not create SPS"));
     return FALSE;
   }
 
-  sps_tmp_buf = (guchar *) (g_memdup (nal_sps_data, nal_sps_length));
-
-  codec_data_tmp_buf =
-      (guchar *) g_malloc (5 + 3 + nal_sps_length + 3 + nal_pps_length);
-  codec_data_tmp_buf[0] = 1; /* version 1 */ ;
-  codec_data_tmp_buf[1] = sps_tmp_buf[1];       /* profile */
-  codec_data_tmp_buf[2] = sps_tmp_buf[2];       /* profile constraints */
-  codec_data_tmp_buf[3] = sps_tmp_buf[3];       /* level */
-  codec_data_tmp_buf[4] = 1;    /* NAL length marker length minus one */
-  codec_data_tmp_buf[5] = 1;    /* Number of SPS */
-  GST_WRITE_UINT16_BE (codec_data_tmp_buf + 6, nal_sps_length);
-  memcpy (codec_data_tmp_buf + 8, sps_tmp_buf, nal_sps_length);
-
-  g_free (sps_tmp_buf);
-
-  codec_data_tmp_buf[8 + nal_sps_length] = 1;   /* Number of PPS */
-  GST_WRITE_UINT16_BE (codec_data_tmp_buf + 8 + nal_sps_length + 1,
-      nal_pps_length);
-  memcpy (codec_data_tmp_buf + 8 + nal_sps_length + 3, nal_pps_data,
-      nal_pps_length);
-
-  GST_DEBUG_OBJECT (openh264enc, "Got SPS of size %d and PPS of size %d",
-      nal_sps_length, nal_pps_length);
+  codec_data = gst_openh264enc_make_codec_data (openh264enc, &bsInfo, 0);
+  if (codec_data == NULL) {
+    GST_ELEMENT_ERROR (openh264enc, STREAM, ENCODE,
+        ("Could not create headers"), ("No SPS or PPS"));
+    return FALSE;
+  }
 
-  codec_data =
-      gst_buffer_new_wrapped (codec_data_tmp_buf,
-      5 + 3 + nal_sps_length + 3 + nal_pps_length);
+  GST_DEBUG_OBJECT (openh264enc, "Got codec_data of size %" G_GSIZE_FORMAT,
+      gst_buffer_get_size (codec_data));
 
   outcaps =
       gst_caps_copy (gst_static_pad_template_get_caps
@@ -801,6 +1017,31 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
       NULL);
   gst_buffer_unref (codec_data);
 
+  /* every layer is an independent stream with its own parameter sets */
+  for (i = 1; i < n_spatial; i++) {
+    GstOpenh264EncLayer *layer = &priv->layers[i - 1];
+    GstCaps *caps;
+
+    codec_data = gst_openh264enc_make_codec_data (openh264enc, &bsInfo, i);
+    if (codec_data == NULL) {
+      GST_ELEMENT_ERROR (openh264enc, STREAM, ENCODE,
+          ("Could not create headers"), ("No SPS or PPS for layer %u", i));
+      gst_caps_unref (outcaps);
+      return FALSE;
+    }
+
+    caps = gst_caps_copy (gst_static_pad_template_get_caps
+        (&gst_openh264enc_src_template));
+    gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, codec_data,
+        "width", G_TYPE_INT, layer->width,
+        "height", G_TYPE_INT, layer->height,
+        "framerate", GST_TYPE_FRACTION, fps_n, fps_d, NULL);
+    gst_buffer_unref (codec_data);
+    gst_caps_replace (&layer->caps, caps);
+    gst_caps_unref (caps);
+    layer->need_caps = TRUE;
+  }
+
   output_state = gst_video_encoder_set_output_state (encoder, outcaps, state);
   gst_video_codec_state_unref (output_state);
 
@@ -817,6 +1058,178 @@ gst_openh264enc_propose_allocation (GstVideoEncoder * encoder, GstQuery * query)
       (gst_openh264enc_parent_class)->propose_allocation (encoder, query);
 }
 
+/* Index of the output of a layer in the encoded frame: 0 for the top layer
+ * going out on the src pad, N for the src_N pad */
+static guint
+gst_openh264enc_get_layer_output (GstOpenh264Enc * openh264enc,
+    SLayerBSInfo * bs_info)
+{
+  guint n_spatial = openh264enc->priv->n_spatial;
+
+  return n_spatial - 1 - MIN (bs_info->uiSpatialId, n_spatial - 1);
+}
+
+static void
+gst_openh264enc_push_layer (GstOpenh264Enc * openh264enc, guint index,
+    GstBuffer * buffer)
+{
+  GstOpenh264EncLayer *layer = &openh264enc->priv->layers[index];
+  GstPad *pad = NULL;
+  GstFlowReturn ret;
+
+  GST_OBJECT_LOCK (openh264enc);
+  if (layer->srcpad)
+    pad = (GstPad *) gst_object_ref (layer->srcpad);
+  GST_OBJECT_UNLOCK (openh264enc);
+
+  if (pad == NULL) {
+    gst_buffer_unref (buffer);
+    return;
+  }
+
+  if (layer->need_stream_start) {
+    gchar *stream_id;
+
+    stream_id = gst_pad_create_stream_id_printf (pad,
+        GST_ELEMENT_CAST (openh264enc), "layer%u", index + 1);
+    gst_pad_push_event (pad, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+    layer->need_stream_start = FALSE;
+  }
+  if (layer->need_caps && layer->caps) {
+    gst_pad_push_event (pad, gst_event_new_caps (layer->caps));
+    layer->need_caps = FALSE;
+  }
+  if (layer->need_segment) {
+    gst_pad_push_event (pad,
+        gst_event_new_segment (&GST_VIDEO_ENCODER (openh264enc)->
+            input_segment));
+    layer->need_segment = FALSE;
+  }
+
+  ret = gst_pad_push (pad, buffer);
+  if (ret != GST_FLOW_OK) {
+    GST_DEBUG_OBJECT (pad, "pushing layer returned %s",
+        gst_flow_get_name (ret));
+  }
+
+  gst_object_unref (pad);
+}
+
+static gboolean
+gst_openh264enc_sink_event (GstVideoEncoder * encoder, GstEvent * event)
+{
+  GstOpenh264Enc *openh264enc = GST_OPENH264ENC (encoder);
+  GstOpenh264EncPrivate *priv = openh264enc->priv;
+  gboolean ret;
+  guint i;
+
+  /* forward to the layer pads after the base class, which drains the
+   * encoder on EOS */
+  gst_event_ref (event);
+  ret =
+      GST_VIDEO_ENCODER_CLASS (gst_openh264enc_parent_class)->sink_event
+      (encoder, event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEGMENT:
+      for (i = 0; i < MAX_EXTRA_LAYERS; i++)
+        priv->layers[i].need_segment = TRUE;
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      for (i = 0; i < MAX_EXTRA_LAYERS; i++)
+        priv->layers[i].need_segment = TRUE;
+      /* fall through */
+    case GST_EVENT_FLUSH_START:
+    case GST_EVENT_EOS:
+      for (i = 0; i < MAX_EXTRA_LAYERS; i++) {
+        GstPad *pad = NULL;
+
+        GST_OBJECT_LOCK (openh264enc);
+        if (priv->layers[i].srcpad)
+          pad = (GstPad *) gst_object_ref (priv->layers[i].srcpad);
+        GST_OBJECT_UNLOCK (openh264enc);
+
+        if (pad) {
+          gst_pad_push_event (pad, gst_event_ref (event));
+          gst_object_unref (pad);
+        }
+      }
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+
+  return ret;
+}
+
+static GstPad *
+gst_openh264enc_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstOpenh264Enc *openh264enc = GST_OPENH264ENC (element);
+  GstOpenh264EncPrivate *priv = openh264enc->priv;
+  GstOpenh264EncLayer *layer;
+  GstPad *pad;
+  gchar *pad_name;
+  guint index = 0;
+
+  GST_OBJECT_LOCK (openh264enc);
+  if (name == NULL || sscanf (name, "src_%u", &index) != 1) {
+    for (index = 1; index <= MAX_EXTRA_LAYERS; index++) {
+      if (priv->layers[index - 1].srcpad == NULL)
+        break;
+    }
+  }
+
+  if (index < 1 || index > MAX_EXTRA_LAYERS ||
+      priv->layers[index - 1].srcpad != NULL) {
+    GST_OBJECT_UNLOCK (openh264enc);
+    GST_WARNING_OBJECT (openh264enc, "no layer available for pad %s",
+        GST_STR_NULL (name));
+    return NULL;
+  }
+
+  pad_name = g_strdup_printf ("src_%u", index);
+  pad = gst_pad_new_from_template (templ, pad_name);
+  g_free (pad_name);
+  gst_pad_use_fixed_caps (pad);
+
+  layer = &priv->layers[index - 1];
+  layer->srcpad = pad;
+  layer->need_stream_start = TRUE;
+  layer->need_caps = TRUE;
+  layer->need_segment = TRUE;
+  GST_OBJECT_UNLOCK (openh264enc);
+
+  GST_DEBUG_OBJECT (openh264enc, "created pad %s for layer %u",
+      GST_PAD_NAME (pad), index);
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static void
+gst_openh264enc_release_pad (GstElement * element, GstPad * pad)
+{
+  GstOpenh264Enc *openh264enc = GST_OPENH264ENC (element);
+  guint i;
+
+  GST_OBJECT_LOCK (openh264enc);
+  for (i = 0; i < MAX_EXTRA_LAYERS; i++) {
+    if (openh264enc->priv->layers[i].srcpad == pad)
+      openh264enc->priv->layers[i].srcpad = NULL;
+  }
+  GST_OBJECT_UNLOCK (openh264enc);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
 static GstFlowReturn
 gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
     GstVideoCodecFrame * frame)
@@ -934,57 +1347,66 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
     return GST_FLOW_ERROR;
   }
 
-  SLayerBSInfo *bs_info = &frame_info.sLayerInfo[0];
-  gint nal_size = bs_info->pNalLengthInByte[0] - 4;
-  guchar *nal_sps_data, *nal_pps_data;
-  gint nal_sps_length, nal_pps_length, idr_length, tmp_buf_length;
-
-  if (videoFrameTypeIDR == frame_info.eFrameType) {
-    GstMapInfo map;
-
-    /* sps */
-    nal_sps_data = frame_info.sLayerInfo[0].pBsBuf + 4;
-    nal_sps_length = frame_info.sLayerInfo[0].pNalLengthInByte[0] - 4;
-    /* pps */
-    nal_pps_data = nal_sps_data + frame_info.sLayerInfo[0].pNalLengthInByte[0];
-    nal_pps_length = frame_info.sLayerInfo[0].pNalLengthInByte[1] - 4;
-    /* idr */
-    bs_info = &frame_info.sLayerInfo[1];
-    idr_length = bs_info->pNalLengthInByte[0] - 4;
-
-    tmp_buf_length = nal_sps_length + 2 + nal_pps_length + 2 + idr_length + 2;
-    frame->output_buffer =
-        gst_video_encoder_allocate_output_buffer (encoder, tmp_buf_length);
-    gst_buffer_map (frame->output_buffer, &map, GST_MAP_WRITE);
-
-    GST_WRITE_UINT16_BE (map.data, nal_sps_length);
-    memcpy (map.data + 2, nal_sps_data, nal_sps_length);
-
-    GST_WRITE_UINT16_BE (map.data + nal_sps_length + 2, nal_pps_length);
-    memcpy (map.data + nal_sps_length + 2 + 2, nal_pps_data, nal_pps_length);
+  /* The NALs of the top layer go out on the src pad, those of the other
+   * layers, including their parameter sets, on the request pad of their
+   * layer. */
+  guint n_spatial = openh264enc->priv->n_spatial;
+  gsize sizes[MAX_SPATIAL_LAYER_NUM] = { 0, };
+  gsize offsets[MAX_SPATIAL_LAYER_NUM] = { 0, };
+  GstBuffer *buffers[MAX_SPATIAL_LAYER_NUM];
+  GstMapInfo maps[MAX_SPATIAL_LAYER_NUM];
+  gint l, n;
+  guint o;
+
+  for (l = 0; l < frame_info.iLayerNum; l++) {
+    SLayerBSInfo *bs_info = &frame_info.sLayerInfo[l];
+    guint out = gst_openh264enc_get_layer_output (openh264enc, bs_info);
+
+    for (n = 0; n < bs_info->iNalCount; n++)
+      sizes[out] += bs_info->pNalLengthInByte[n] - START_CODE_SIZE + 2;
+  }
 
-    GST_WRITE_UINT16_BE (map.data + nal_sps_length + 2 + nal_pps_length + 2,
-        idr_length);
-    memcpy (map.data + nal_sps_length + 2 + nal_pps_length + 2 + 2,
-        bs_info->pBsBuf + 4, idr_length);
+  frame->output_buffer =
+      gst_video_encoder_allocate_output_buffer (encoder, sizes[0]);
+  buffers[0] = frame->output_buffer;
+  for (o = 1; o < n_spatial; o++)
+    buffers[o] = gst_buffer_new_allocate (NULL, sizes[o], NULL);
+  for (o = 0; o < n_spatial; o++)
+    gst_buffer_map (buffers[o], &maps[o], GST_MAP_WRITE);
+
+  for (l = 0; l < frame_info.iLayerNum; l++) {
+    SLayerBSInfo *bs_info = &frame_info.sLayerInfo[l];
+    guint out = gst_openh264enc_get_layer_output (openh264enc, bs_info);
+    guchar *data = bs_info->pBsBuf;
+
+    for (n = 0; n < bs_info->iNalCount; n++) {
+      gint nal_length = bs_info->pNalLengthInByte[n] - START_CODE_SIZE;
+
+      GST_WRITE_UINT16_BE (maps[out].data + offsets[out], nal_length);
+      memcpy (maps[out].data + offsets[out] + 2, data + START_CODE_SIZE,
+          nal_length);
+      offsets[out] += nal_length + 2;
+      data += bs_info->pNalLengthInByte[n];
+    }
+  }
 
-    gst_buffer_unmap (frame->output_buffer, &map);
+  for (o = 0; o < n_spatial; o++)
+    gst_buffer_unmap (buffers[o], &maps[o]);
 
+  if (videoFrameTypeIDR == frame_info.eFrameType) {
     GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
   } else {
-    GstMapInfo map;
-
-    tmp_buf_length = nal_size + 2;
-    frame->output_buffer =
-        gst_video_encoder_allocate_output_buffer (encoder, tmp_buf_length);
-    gst_buffer_map (frame->output_buffer, &map, GST_MAP_WRITE);
-
-    GST_WRITE_UINT16_BE (map.data, nal_size);
-    memcpy (map.data + 2, bs_info->pBsBuf + 4, nal_size);
+    GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
+  }
 
-    gst_buffer_unmap (frame->output_buffer, &map);
+  for (o = 1; o < n_spatial; o++) {
+    GST_BUFFER_PTS (buffers[o]) = frame->pts;
+    GST_BUFFER_DTS (buffers[o]) = frame->pts;
+    GST_BUFFER_DURATION (buffers[o]) = frame->duration;
+    if (videoFrameTypeIDR != frame_info.eFrameType)
+      GST_BUFFER_FLAG_SET (buffers[o], GST_BUFFER_FLAG_DELTA_UNIT);
 
-    GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
+    gst_openh264enc_push_layer (openh264enc, o - 1, buffers[o]);
   }
 
   GST_LOG_OBJECT (openh264enc, "openh264 picture %scoded OK!",
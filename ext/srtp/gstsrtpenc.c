@@ -162,11 +162,16 @@ enum
   PROP_ALLOW_REPEAT_TX
 };
 
+/* Room srtp_protect() may need after the packet */
+#define SRTP_TRAILER_ROOM (SRTP_MAX_TRAILER_LEN + 10)
+/* Minimum buffer size of the pool used when a packet can't be protected in
+ * place */
+#define SRTP_POOL_MIN_SIZE 1500
+
 typedef struct ProcessBufferItData
 {
   GstSrtpEnc *filter;
   GstPad *pad;
-  GstBufferList *out_list;
   gboolean is_rtcp;
 } ProcessBufferItData;
 
@@ -630,6 +635,10 @@ gst_srtp_enc_dispose (GObject * object)
     gst_buffer_unref (filter->key);
   filter->key = NULL;
 
+  if (filter->pool)
+    gst_object_unref (filter->pool);
+  filter->pool = NULL;
+
   G_OBJECT_CLASS (gst_srtp_enc_parent_class)->dispose (object);
 }
 
@@ -884,6 +893,18 @@ gst_srtp_enc_sink_query (GstPad * pad, GstObject * parent, GstQuery * query,
 
       return TRUE;
     }
+    case GST_QUERY_ALLOCATION:
+    {
+      GstAllocationParams params;
+
+      /* Ask upstream to leave room for the authentication tag and MKI after
+       * the packet so that we can protect it in place */
+      gst_allocation_params_init (&params);
+      params.padding = SRTP_TRAILER_ROOM;
+      gst_query_add_allocation_param (query, NULL, &params);
+
+      return TRUE;
+    }
     default:
       return gst_pad_query_default (pad, parent, query);
   }
@@ -1006,23 +1027,87 @@ gst_srtp_enc_check_set_caps (GstSrtpEnc * filter, GstPad * pad,
   return GST_FLOW_OK;
 }
 
+/* Checks if @buf is a single writable memory with enough room after the
+ * packet for the SRTP trailer */
+static gboolean
+gst_srtp_enc_can_protect_in_place (GstBuffer * buf)
+{
+  GstMemory *mem;
+  gsize size, offset, maxsize;
+
+  if (!gst_buffer_is_writable (buf) || gst_buffer_n_memory (buf) != 1)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (buf, 0);
+  if (GST_MEMORY_IS_READONLY (mem) || !gst_memory_is_writable (mem))
+    return FALSE;
+
+  size = gst_buffer_get_sizes (buf, &offset, &maxsize);
+
+  return maxsize - offset - size >= SRTP_TRAILER_ROOM;
+}
+
+static GstBuffer *
+gst_srtp_enc_acquire_buffer (GstSrtpEnc * filter, gsize size)
+{
+  GstBufferPool *pool;
+  GstBuffer *buf = NULL;
+
+  GST_OBJECT_LOCK (filter);
+  if (filter->pool == NULL || filter->pool_size < size) {
+    GstStructure *config;
+
+    if (filter->pool) {
+      gst_buffer_pool_set_active (filter->pool, FALSE);
+      gst_object_unref (filter->pool);
+    }
+
+    filter->pool_size = MAX (size, SRTP_POOL_MIN_SIZE);
+    GST_DEBUG_OBJECT (filter, "Creating pool of %" G_GSIZE_FORMAT
+        " byte buffers", filter->pool_size);
+
+    filter->pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (filter->pool);
+    gst_buffer_pool_config_set_params (config, NULL, filter->pool_size, 0, 0);
+    gst_buffer_pool_set_config (filter->pool, config);
+    gst_buffer_pool_set_active (filter->pool, TRUE);
+  }
+  pool = gst_object_ref (filter->pool);
+  GST_OBJECT_UNLOCK (filter);
+
+  /* the pool may have been replaced by a bigger one in the meantime */
+  if (gst_buffer_pool_acquire_buffer (pool, &buf, NULL) == GST_FLOW_OK)
+    gst_buffer_set_size (buf, size);
+  else
+    buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+  gst_object_unref (pool);
+
+  return buf;
+}
+
+/* Takes ownership of @buf. The packet is protected in place if possible,
+ * otherwise it is copied into a buffer from our pool first. */
 static GstBuffer *
 gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
     GstBuffer * buf, gboolean is_rtcp)
 {
-  gint size_max, size;
+  gint size;
   GstBuffer *bufout = NULL;
   GstMapInfo mapout;
   err_status_t err;
 
-  /* Create a bigger buffer to add protection */
   size = gst_buffer_get_size (buf);
-  size_max = size + SRTP_MAX_TRAILER_LEN + 10;
-  bufout = gst_buffer_new_allocate (NULL, size_max, NULL);
 
-  gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
-
-  gst_buffer_extract (buf, 0, mapout.data, size);
+  if (gst_srtp_enc_can_protect_in_place (buf)) {
+    bufout = buf;
+    gst_buffer_set_size (bufout, size + SRTP_TRAILER_ROOM);
+    gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+  } else {
+    bufout = gst_srtp_enc_acquire_buffer (filter, size + SRTP_TRAILER_ROOM);
+    gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+    gst_buffer_extract (buf, 0, mapout.data, size);
+  }
 
   GST_OBJECT_LOCK (filter);
 
@@ -1040,10 +1125,13 @@ gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
   if (err == err_status_ok) {
     /* Buffer protected */
     gst_buffer_set_size (bufout, size);
-    gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+    if (bufout != buf) {
+      gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+      gst_buffer_unref (buf);
+    }
 
-    GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d",
-        is_rtcp ? "RTCP" : "RTP", size);
+    GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d%s",
+        is_rtcp ? "RTCP" : "RTP", size, bufout == buf ? " in place" : "");
 
   } else if (err == err_status_key_expired) {
 
@@ -1062,6 +1150,8 @@ gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
   return bufout;
 
 fail:
+  if (bufout != buf)
+    gst_buffer_unref (buf);
   gst_buffer_unref (bufout);
   return NULL;
 }
@@ -1089,7 +1179,10 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
   GST_OBJECT_UNLOCK (filter);
 
-  if ((bufout = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp))) {
+  bufout = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp);
+  buf = NULL;
+
+  if (bufout) {
     /* Push buffer to source pad */
     otherpad = get_rtp_other_pad (pad);
     ret = gst_pad_push (otherpad, bufout);
@@ -1115,7 +1208,8 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
 out:
 
-  gst_buffer_unref (buf);
+  if (buf)
+    gst_buffer_unref (buf);
 
   return ret;
 
@@ -1128,15 +1222,12 @@ static gboolean
 process_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
 {
   ProcessBufferItData *data = user_data;
-  GstBuffer *bufout;
 
-  if ((bufout =
-          gst_srtp_enc_process_buffer (data->filter, data->pad, *buffer,
-              data->is_rtcp))) {
-    gst_buffer_list_add (data->out_list, bufout);
-  } else {
+  /* replaces the buffer in the list, or removes it on errors */
+  *buffer = gst_srtp_enc_process_buffer (data->filter, data->pad, *buffer,
+      data->is_rtcp);
+  if (*buffer == NULL)
     GST_WARNING_OBJECT (data->filter, "Error encoding buffer, dropping");
-  }
 
   return TRUE;
 }
@@ -1148,7 +1239,6 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   GstSrtpEnc *filter = GST_SRTP_ENC (parent);
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
-  GstBufferList *out_list = NULL;
   ProcessBufferItData process_data;
 
   GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
@@ -1170,17 +1260,16 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
   GST_OBJECT_UNLOCK (filter);
 
-  out_list = gst_buffer_list_new ();
+  /* the buffers are replaced by their protected version in the list */
+  buf_list = gst_buffer_list_make_writable (buf_list);
 
   process_data.filter = filter;
   process_data.pad = pad;
   process_data.is_rtcp = is_rtcp;
-  process_data.out_list = out_list;
 
   gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data);
 
-  if (!gst_buffer_list_length (out_list)) {
-    gst_buffer_list_unref (out_list);
+  if (!gst_buffer_list_length (buf_list)) {
     ret = GST_FLOW_OK;
     goto out;
   }
@@ -1189,7 +1278,8 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   otherpad = get_rtp_other_pad (pad);
   GST_LOG_OBJECT (pad, "Pushing buffer chain of %d",
       gst_buffer_list_length (buf_list));
-  ret = gst_pad_push_list (otherpad, out_list);
+  ret = gst_pad_push_list (otherpad, buf_list);
+  buf_list = NULL;
 
   if (ret != GST_FLOW_OK) {
     goto out;
@@ -1209,7 +1299,8 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
 out:
 
-  gst_buffer_list_unref (buf_list);
+  if (buf_list)
+    gst_buffer_list_unref (buf_list);
 
   return ret;
 }
@@ -1293,6 +1384,13 @@ gst_srtp_enc_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_srtp_enc_reset (filter);
+      GST_OBJECT_LOCK (filter);
+      if (filter->pool) {
+        gst_buffer_pool_set_active (filter->pool, FALSE);
+        gst_object_unref (filter->pool);
+        filter->pool = NULL;
+      }
+      GST_OBJECT_UNLOCK (filter);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -84,6 +84,10 @@ struct _GstSrtpEnc
 
   guint replay_window_size;
   gboolean allow_repeat_tx;
+
+  /* for packets that can't be protected in place */
+  GstBufferPool *pool;
+  gsize pool_size;
 };
 
 struct _GstSrtpEncClass
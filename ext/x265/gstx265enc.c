@@ -25,6 +25,10 @@
  *
  * This element encodes raw video into H265 compressed data.
  *
+ * With x265 1.5, additional renditions at other bitrates can be encoded
+ * with the analysis of the main encode, see #GstX265Enc:renditions. The
+ * property and the src_%u request pads don't exist with other versions.
+ *
  **/
 
 #ifdef HAVE_CONFIG_H
@@ -40,6 +44,20 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+
+/* x265 1.5 passes the analysis of a picture in memory through
+ * x265_picture.analysisData, later versions only through a file that is
+ * written in encode order and can't be read back while the main encode is
+ * running. The renditions are only available with the former. */
+#if X265_BUILD >= 43 && X265_BUILD < 51
+#define HAVE_ANALYSIS_REUSE 1
+#endif
+
+/* changing parameters of an open encoder */
+#if X265_BUILD >= 51
+#define HAVE_ENCODER_RECONFIG 1
+#endif
 
 GST_DEBUG_CATEGORY_STATIC (x265_enc_debug);
 #define GST_CAT_DEFAULT x265_enc_debug
@@ -52,7 +70,8 @@ enum
   PROP_OPTION_STRING,
   PROP_X265_LOG_LEVEL,
   PROP_SPEED_PRESET,
-  PROP_TUNE
+  PROP_TUNE,
+  PROP_RENDITIONS
 };
 
 static GString *x265enc_defaults;
@@ -63,6 +82,7 @@ static GString *x265enc_defaults;
 #define PROP_LOG_LEVEL_DEFAULT           -1     // None
 #define PROP_SPEED_PRESET_DEFAULT        6      // Medium
 #define PROP_TUNE_DEFAULT                2      // SSIM
+#define PROP_RENDITIONS_DEFAULT          NULL
 
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
 #define FORMATS "I420, Y444, I420_10LE, Y444_10LE"
@@ -165,23 +185,42 @@ static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
         "width = (int) [ 4, MAX ], " "height = (int) [ 4, MAX ]")
     );
 
+#define SRC_CAPS \
+    "video/x-h265, " \
+    "framerate = (fraction) [0/1, MAX], " \
+    "width = (int) [ 4, MAX ], " "height = (int) [ 4, MAX ], " \
+    "stream-format = (string) { avc, byte-stream }, " \
+    "alignment = (string) au, " "profile = (string) { main }"
+
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("video/x-h265, "
-        "framerate = (fraction) [0/1, MAX], "
-        "width = (int) [ 4, MAX ], " "height = (int) [ 4, MAX ], "
-        "stream-format = (string) { avc, byte-stream }, "
-        "alignment = (string) au, " "profile = (string) { main }")
+    GST_STATIC_CAPS (SRC_CAPS)
     );
 
+#ifdef HAVE_ANALYSIS_REUSE
+static GstStaticPadTemplate rendition_src_factory =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (SRC_CAPS)
+    );
+#endif
+
 static void gst_x265_enc_finalize (GObject * object);
 static gboolean gst_x265_enc_start (GstVideoEncoder * encoder);
 static gboolean gst_x265_enc_stop (GstVideoEncoder * encoder);
 static gboolean gst_x265_enc_flush (GstVideoEncoder * encoder);
 
 static gboolean gst_x265_enc_init_encoder (GstX265Enc * encoder);
+static gboolean gst_x265_enc_apply_dynamic_params (GstX265Enc * encoder,
+    x265_param * param);
+static gboolean gst_x265_enc_init_renditions (GstX265Enc * encoder);
 static void gst_x265_enc_close_encoder (GstX265Enc * encoder);
+static void gst_x265_enc_flush_renditions (GstX265Enc * encoder,
+    gboolean send);
+static void gst_x265_enc_feed_renditions (GstX265Enc * encoder,
+    gboolean drain);
 
 static GstFlowReturn gst_x265_enc_finish (GstVideoEncoder * encoder);
 static GstFlowReturn gst_x265_enc_handle_frame (GstVideoEncoder * encoder,
@@ -194,6 +233,11 @@ static gboolean gst_x265_enc_set_format (GstVideoEncoder * video_enc,
     GstVideoCodecState * state);
 static gboolean gst_x265_enc_propose_allocation (GstVideoEncoder * encoder,
     GstQuery * query);
+static gboolean gst_x265_enc_sink_event (GstVideoEncoder * encoder,
+    GstEvent * event);
+static GstPad *gst_x265_enc_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_x265_enc_release_pad (GstElement * element, GstPad * pad);
 
 static void gst_x265_enc_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -328,6 +372,10 @@ gst_x265_enc_class_init (GstX265EncClass * klass)
   gobject_class->get_property = gst_x265_enc_get_property;
   gobject_class->finalize = gst_x265_enc_finalize;
 
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_x265_enc_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_x265_enc_release_pad);
+
   gstencoder_class->set_format = GST_DEBUG_FUNCPTR (gst_x265_enc_set_format);
   gstencoder_class->handle_frame =
       GST_DEBUG_FUNCPTR (gst_x265_enc_handle_frame);
@@ -338,6 +386,7 @@ gst_x265_enc_class_init (GstX265EncClass * klass)
   gstencoder_class->getcaps = GST_DEBUG_FUNCPTR (gst_x265_enc_sink_getcaps);
   gstencoder_class->propose_allocation =
       GST_DEBUG_FUNCPTR (gst_x265_enc_propose_allocation);
+  gstencoder_class->sink_event = GST_DEBUG_FUNCPTR (gst_x265_enc_sink_event);
 
   g_object_class_install_property (gobject_class, PROP_BITRATE,
       g_param_spec_uint ("bitrate", "Bitrate", "Bitrate in kbit/sec", 1,
@@ -348,13 +397,17 @@ gst_x265_enc_class_init (GstX265EncClass * klass)
   g_object_class_install_property (gobject_class, PROP_QP,
       g_param_spec_int ("qp", "Quantization parameter",
           "QP for P slices in (implied) CQP mode (-1 = disabled)", -1,
-          51, PROP_QP_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          51, PROP_QP_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   g_object_class_install_property (gobject_class, PROP_OPTION_STRING,
       g_param_spec_string ("option-string", "Option string",
-          "String of x264 options (overridden by element properties)",
+          "String of x264 options (overridden by element properties). "
+          "While playing, only options x265 can reconfigure on the fly are "
+          "applied without reopening the encoder",
           PROP_OPTION_STRING_DEFAULT,
-          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   g_object_class_install_property (gobject_class, PROP_X265_LOG_LEVEL,
       g_param_spec_enum ("log-level", "(internal) x265 log level",
@@ -372,6 +425,15 @@ gst_x265_enc_class_init (GstX265EncClass * klass)
           "Preset name for tuning options", GST_X265_ENC_TUNE_TYPE,
           PROP_TUNE_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+#ifdef HAVE_ANALYSIS_REUSE
+  g_object_class_install_property (gobject_class, PROP_RENDITIONS,
+      g_param_spec_string ("renditions", "Renditions",
+          "Comma separated list of bitrates in kbit/sec of additional "
+          "renditions, encoded with the analysis of the main encode. "
+          "Rendition N is output on the src_N request pad",
+          PROP_RENDITIONS_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+#endif
+
   gst_element_class_set_static_metadata (element_class,
       "x265enc", "Codec/Encoder/Video", "H265 Encoder",
       "Thijs Vermeir <thijs.vermeir@barco.com>");
@@ -380,6 +442,10 @@ gst_x265_enc_class_init (GstX265EncClass * klass)
       gst_static_pad_template_get (&sink_factory));
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&src_factory));
+#ifdef HAVE_ANALYSIS_REUSE
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&rendition_src_factory));
+#endif
 }
 
 /* initialize the new element
@@ -400,12 +466,25 @@ gst_x265_enc_init (GstX265Enc * encoder)
   encoder->log_level = PROP_LOG_LEVEL_DEFAULT;
   encoder->speed_preset = PROP_SPEED_PRESET_DEFAULT;
   encoder->tune = PROP_TUNE_DEFAULT;
+  encoder->renditions_prop = NULL;
+  encoder->n_renditions = 0;
+  encoder->n_active = 0;
+  memset (encoder->renditions, 0, sizeof (encoder->renditions));
+  g_queue_init (&encoder->rendition_frames);
 }
 
 typedef struct
 {
   GstVideoCodecFrame *frame;
   GstVideoFrame vframe;
+
+  /* held by the main encoder and by every rendition encoding the frame */
+  gint refcount;
+  /* the input picture, which also owns the analysis data if any */
+  x265_picture pic;
+  gboolean have_analysis;
+  /* the main encoder output the frame, its analysis is complete */
+  gboolean analysis_ready;
 } FrameData;
 
 static FrameData *
@@ -418,48 +497,69 @@ gst_x265_enc_queue_frame (GstX265Enc * enc, GstVideoCodecFrame * frame,
   if (!gst_video_frame_map (&vframe, info, frame->input_buffer, GST_MAP_READ))
     return NULL;
 
-  fdata = g_slice_new (FrameData);
+  fdata = g_slice_new0 (FrameData);
   fdata->frame = gst_video_codec_frame_ref (frame);
   fdata->vframe = vframe;
+  fdata->refcount = 1;
 
   enc->pending_frames = g_list_prepend (enc->pending_frames, fdata);
 
   return fdata;
 }
 
-static void
-gst_x265_enc_dequeue_frame (GstX265Enc * enc, GstVideoCodecFrame * frame)
+static FrameData *
+gst_x265_enc_find_frame (GstX265Enc * enc, guint32 system_frame_number)
 {
   GList *l;
 
   for (l = enc->pending_frames; l; l = l->next) {
     FrameData *fdata = l->data;
 
-    if (fdata->frame != frame)
-      continue;
+    if (fdata->frame->system_frame_number == system_frame_number)
+      return fdata;
+  }
 
-    gst_video_frame_unmap (&fdata->vframe);
-    gst_video_codec_frame_unref (fdata->frame);
-    g_slice_free (FrameData, fdata);
+  return NULL;
+}
 
-    enc->pending_frames = g_list_delete_link (enc->pending_frames, l);
+static void
+gst_x265_enc_free_frame (FrameData * fdata)
+{
+  gst_video_frame_unmap (&fdata->vframe);
+  gst_video_codec_frame_unref (fdata->frame);
+#ifdef HAVE_ANALYSIS_REUSE
+  if (fdata->have_analysis)
+    x265_free_analysis_data (&fdata->pic);
+#endif
+  g_slice_free (FrameData, fdata);
+}
+
+static void
+gst_x265_enc_unref_frame (GstX265Enc * enc, FrameData * fdata)
+{
+  if (--fdata->refcount > 0)
     return;
-  }
+
+  enc->pending_frames = g_list_remove (enc->pending_frames, fdata);
+  gst_x265_enc_free_frame (fdata);
 }
 
 static void
-gst_x265_enc_dequeue_all_frames (GstX265Enc * enc)
+gst_x265_enc_dequeue_frame (GstX265Enc * enc, GstVideoCodecFrame * frame)
 {
-  GList *l;
+  FrameData *fdata;
 
-  for (l = enc->pending_frames; l; l = l->next) {
-    FrameData *fdata = l->data;
+  fdata = gst_x265_enc_find_frame (enc, frame->system_frame_number);
+  if (fdata)
+    gst_x265_enc_unref_frame (enc, fdata);
+}
 
-    gst_video_frame_unmap (&fdata->vframe);
-    gst_video_codec_frame_unref (fdata->frame);
-    g_slice_free (FrameData, fdata);
-  }
-  g_list_free (enc->pending_frames);
+static void
+gst_x265_enc_dequeue_all_frames (GstX265Enc * enc)
+{
+  g_queue_clear (&enc->rendition_frames);
+  g_list_free_full (enc->pending_frames,
+      (GDestroyNotify) gst_x265_enc_free_frame);
   enc->pending_frames = NULL;
 }
 
@@ -475,6 +575,7 @@ static gboolean
 gst_x265_enc_stop (GstVideoEncoder * encoder)
 {
   GstX265Enc *x265enc = GST_X265_ENC (encoder);
+  guint i;
 
   GST_DEBUG_OBJECT (encoder, "stop encoder");
 
@@ -486,6 +587,9 @@ gst_x265_enc_stop (GstVideoEncoder * encoder)
     gst_video_codec_state_unref (x265enc->input_state);
   x265enc->input_state = NULL;
 
+  for (i = 0; i < GST_X265_ENC_MAX_RENDITIONS; i++)
+    gst_caps_replace (&x265enc->renditions[i].caps, NULL);
+
   return TRUE;
 }
 
@@ -517,6 +621,9 @@ gst_x265_enc_finalize (GObject * object)
 
   gst_x265_enc_close_encoder (encoder);
 
+  g_free (encoder->renditions_prop);
+  encoder->renditions_prop = NULL;
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -545,13 +652,15 @@ gst_x265_enc_gst_to_x265_video_format (GstVideoFormat format, gint * nplanes)
 /*
  * gst_x265_enc_parse_options
  * @encoder: Encoder to which options are assigned
+ * @param: x265 parameters to assign the options to
  * @str: Option string
  *
  * Parse option string and assign to x265 parameters
  *
  */
 static gboolean
-gst_x265_enc_parse_options (GstX265Enc * encoder, const gchar * str)
+gst_x265_enc_parse_options (GstX265Enc * encoder, x265_param * param,
+    const gchar * str)
 {
   GStrv kvpairs;
   guint npairs, i;
@@ -567,8 +676,7 @@ gst_x265_enc_parse_options (GstX265Enc * encoder, const gchar * str)
   for (i = 0; i < npairs; i++) {
     GStrv key_val = g_strsplit (kvpairs[i], "=", 2);
 
-    parse_result =
-        x265_param_parse (&encoder->x265param, key_val[0], key_val[1]);
+    parse_result = x265_param_parse (param, key_val[0], key_val[1]);
 
     if (parse_result == X265_PARAM_BAD_NAME) {
       GST_ERROR_OBJECT (encoder, "Bad name for option %s=%s",
@@ -590,6 +698,42 @@ gst_x265_enc_parse_options (GstX265Enc * encoder, const gchar * str)
   return !ret;
 }
 
+/*
+ * gst_x265_enc_apply_dynamic_params
+ * @encoder: Encoder whose properties are applied
+ * @param: x265 parameters to modify
+ *
+ * Apply the properties that can change while playing, i.e. the rate control
+ * and the option-string, to @param. Must be called with the object lock.
+ *
+ */
+static gboolean
+gst_x265_enc_apply_dynamic_params (GstX265Enc * encoder, x265_param * param)
+{
+  if (encoder->qp != -1) {
+    /* CQP */
+    param->rc.qp = encoder->qp;
+    param->rc.rateControlMode = X265_RC_CQP;
+  } else {
+    /* ABR */
+    param->rc.bitrate = encoder->bitrate;
+    param->rc.rateControlMode = X265_RC_ABR;
+  }
+
+  /* apply option-string property */
+  if (encoder->option_string_prop && encoder->option_string_prop->len) {
+    GST_DEBUG_OBJECT (encoder, "Applying option-string: %s",
+        encoder->option_string_prop->str);
+    if (gst_x265_enc_parse_options (encoder, param,
+            encoder->option_string_prop->str) == FALSE) {
+      GST_DEBUG_OBJECT (encoder, "Your option-string contains errors.");
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
 /*
  * gst_x265_enc_init_encoder
  * @encoder:  Encoder which should be initialized.
@@ -638,27 +782,16 @@ gst_x265_enc_init_encoder (GstX265Enc * encoder)
     encoder->x265param.vui.sarHeight = info->par_d;
   }
 
-  if (encoder->qp != -1) {
-    /* CQP */
-    encoder->x265param.rc.qp = encoder->qp;
-    encoder->x265param.rc.rateControlMode = X265_RC_CQP;
-  } else {
-    /* ABR */
-    encoder->x265param.rc.bitrate = encoder->bitrate;
-    encoder->x265param.rc.rateControlMode = X265_RC_ABR;
+  if (!gst_x265_enc_apply_dynamic_params (encoder, &encoder->x265param)) {
+    GST_OBJECT_UNLOCK (encoder);
+    return FALSE;
   }
 
-  /* apply option-string property */
-  if (encoder->option_string_prop && encoder->option_string_prop->len) {
-    GST_DEBUG_OBJECT (encoder, "Applying option-string: %s",
-        encoder->option_string_prop->str);
-    if (gst_x265_enc_parse_options (encoder,
-            encoder->option_string_prop->str) == FALSE) {
-      GST_DEBUG_OBJECT (encoder, "Your option-string contains errors.");
-      GST_OBJECT_UNLOCK (encoder);
-      return FALSE;
-    }
-  }
+#ifdef HAVE_ANALYSIS_REUSE
+  /* the renditions reuse the analysis saved by the main encoder */
+  if (encoder->n_renditions > 0)
+    encoder->x265param.analysisMode = X265_ANALYSIS_SAVE;
+#endif
 
   encoder->reconfig = FALSE;
 
@@ -676,6 +809,45 @@ gst_x265_enc_init_encoder (GstX265Enc * encoder)
 
   encoder->push_header = TRUE;
 
+  return gst_x265_enc_init_renditions (encoder);
+}
+
+/* gst_x265_enc_init_renditions
+ * @encoder:  Encoder whose renditions should be initialized.
+ *
+ * Open one x265 encoder per rendition, with the parameters of the main
+ * encoder apart from the bitrate, loading the analysis of the main encoder.
+ */
+static gboolean
+gst_x265_enc_init_renditions (GstX265Enc * encoder)
+{
+#ifdef HAVE_ANALYSIS_REUSE
+  guint i;
+
+  GST_OBJECT_LOCK (encoder);
+  for (i = 0; i < encoder->n_renditions; i++) {
+    GstX265EncRendition *rendition = &encoder->renditions[i];
+
+    rendition->x265param = encoder->x265param;
+    rendition->x265param.analysisMode = X265_ANALYSIS_LOAD;
+    rendition->x265param.rc.bitrate = rendition->bitrate;
+    rendition->x265param.rc.rateControlMode = X265_RC_ABR;
+
+    rendition->x265enc = x265_encoder_open (&rendition->x265param);
+    if (!rendition->x265enc) {
+      GST_OBJECT_UNLOCK (encoder);
+      GST_ELEMENT_ERROR (encoder, STREAM, ENCODE,
+          ("Can not initialize x265 encoder."),
+          ("Failed to open the encoder of rendition %u", i + 1));
+      gst_x265_enc_close_encoder (encoder);
+      return FALSE;
+    }
+    rendition->push_header = TRUE;
+    encoder->n_active = i + 1;
+  }
+  GST_OBJECT_UNLOCK (encoder);
+#endif
+
   return TRUE;
 }
 
@@ -687,6 +859,22 @@ gst_x265_enc_init_encoder (GstX265Enc * encoder)
 static void
 gst_x265_enc_close_encoder (GstX265Enc * encoder)
 {
+  FrameData *fdata;
+  guint i;
+
+  /* frames the renditions didn't get yet won't be encoded by them anymore */
+  while ((fdata = g_queue_pop_head (&encoder->rendition_frames)))
+    gst_x265_enc_unref_frame (encoder, fdata);
+
+  /* drain the renditions so that they release their input frames */
+  gst_x265_enc_flush_renditions (encoder, FALSE);
+
+  for (i = 0; i < encoder->n_active; i++) {
+    x265_encoder_close (encoder->renditions[i].x265enc);
+    encoder->renditions[i].x265enc = NULL;
+  }
+  encoder->n_active = 0;
+
   if (encoder->x265enc != NULL) {
     x265_encoder_close (encoder->x265enc);
     encoder->x265enc = NULL;
@@ -730,7 +918,8 @@ x265_nal_free (x265_nal * nal)
 }
 
 static gboolean
-gst_x265_enc_set_level_tier_and_profile (GstX265Enc * encoder, GstCaps * caps)
+gst_x265_enc_set_level_tier_and_profile (GstX265Enc * encoder,
+    x265_encoder * x265enc, GstCaps * caps)
 {
   x265_nal *nal, *vps_nal;
   guint32 i_nal;
@@ -738,7 +927,7 @@ gst_x265_enc_set_level_tier_and_profile (GstX265Enc * encoder, GstCaps * caps)
 
   GST_DEBUG_OBJECT (encoder, "set profile, level and tier");
 
-  header_return = x265_encoder_headers (encoder->x265enc, &nal, &i_nal);
+  header_return = x265_encoder_headers (x265enc, &nal, &i_nal);
   if (header_return < 0) {
     GST_ELEMENT_ERROR (encoder, STREAM, ENCODE, ("Encode x265 header failed."),
         ("x265_encoder_headers return code=%d", header_return));
@@ -765,7 +954,7 @@ gst_x265_enc_set_level_tier_and_profile (GstX265Enc * encoder, GstCaps * caps)
 }
 
 static GstBuffer *
-gst_x265_enc_get_header_buffer (GstX265Enc * encoder)
+gst_x265_enc_get_header_buffer (GstX265Enc * encoder, x265_encoder * x265enc)
 {
   x265_nal *nal;
   guint32 i_nal, i, offset;
@@ -773,7 +962,7 @@ gst_x265_enc_get_header_buffer (GstX265Enc * encoder)
   int header_return;
   GstBuffer *buf;
 
-  header_return = x265_encoder_headers (encoder->x265enc, &nal, &i_nal);
+  header_return = x265_encoder_headers (x265enc, &nal, &i_nal);
   if (header_return < 0) {
     GST_ELEMENT_ERROR (encoder, STREAM, ENCODE, ("Encode x265 header failed."),
         ("x265_encoder_headers return code=%d", header_return));
@@ -823,10 +1012,12 @@ gst_x265_enc_get_header_buffer (GstX265Enc * encoder)
 static gboolean
 gst_x265_enc_set_src_caps (GstX265Enc * encoder, GstCaps * caps)
 {
+  GstVideoInfo *info = &encoder->input_state->info;
   GstCaps *outcaps;
   GstStructure *structure;
   GstVideoCodecState *state;
   GstTagList *tags;
+  guint i;
 
   outcaps = gst_caps_new_empty_simple ("video/x-h265");
   structure = gst_caps_get_structure (outcaps, 0);
@@ -835,7 +1026,31 @@ gst_x265_enc_set_src_caps (GstX265Enc * encoder, GstCaps * caps)
       NULL);
   gst_structure_set (structure, "alignment", G_TYPE_STRING, "au", NULL);
 
-  if (!gst_x265_enc_set_level_tier_and_profile (encoder, outcaps)) {
+  for (i = 0; i < encoder->n_active; i++) {
+    GstX265EncRendition *rendition = &encoder->renditions[i];
+    GstCaps *rcaps = gst_caps_copy (outcaps);
+
+    if (!gst_x265_enc_set_level_tier_and_profile (encoder, rendition->x265enc,
+            rcaps)) {
+      gst_caps_unref (rcaps);
+      gst_caps_unref (outcaps);
+      return FALSE;
+    }
+
+    gst_caps_set_simple (rcaps, "width", G_TYPE_INT, info->width,
+        "height", G_TYPE_INT, info->height,
+        "framerate", GST_TYPE_FRACTION, info->fps_n, info->fps_d,
+        "pixel-aspect-ratio", GST_TYPE_FRACTION, info->par_n, info->par_d,
+        NULL);
+    GST_DEBUG_OBJECT (encoder, "rendition %u caps: %" GST_PTR_FORMAT, i + 1,
+        rcaps);
+    gst_caps_replace (&rendition->caps, rcaps);
+    gst_caps_unref (rcaps);
+    rendition->need_caps = TRUE;
+  }
+
+  if (!gst_x265_enc_set_level_tier_and_profile (encoder, encoder->x265enc,
+          outcaps)) {
     gst_caps_unref (outcaps);
     return FALSE;
   }
@@ -952,6 +1167,116 @@ gst_x265_enc_propose_allocation (GstVideoEncoder * encoder, GstQuery * query)
       query);
 }
 
+static gboolean
+gst_x265_enc_sink_event (GstVideoEncoder * video_enc, GstEvent * event)
+{
+  GstX265Enc *encoder = GST_X265_ENC (video_enc);
+  gboolean ret;
+  guint i;
+
+  /* forward to the rendition pads after the base class, which drains the
+   * encoders on EOS */
+  gst_event_ref (event);
+  ret = GST_VIDEO_ENCODER_CLASS (parent_class)->sink_event (video_enc, event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEGMENT:
+      for (i = 0; i < GST_X265_ENC_MAX_RENDITIONS; i++)
+        encoder->renditions[i].need_segment = TRUE;
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      for (i = 0; i < GST_X265_ENC_MAX_RENDITIONS; i++)
+        encoder->renditions[i].need_segment = TRUE;
+      /* fall through */
+    case GST_EVENT_FLUSH_START:
+    case GST_EVENT_EOS:
+      for (i = 0; i < GST_X265_ENC_MAX_RENDITIONS; i++) {
+        GstPad *pad = NULL;
+
+        GST_OBJECT_LOCK (encoder);
+        if (encoder->renditions[i].srcpad)
+          pad = gst_object_ref (encoder->renditions[i].srcpad);
+        GST_OBJECT_UNLOCK (encoder);
+
+        if (pad) {
+          gst_pad_push_event (pad, gst_event_ref (event));
+          gst_object_unref (pad);
+        }
+      }
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+
+  return ret;
+}
+
+static GstPad *
+gst_x265_enc_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstX265Enc *encoder = GST_X265_ENC (element);
+  GstX265EncRendition *rendition;
+  GstPad *pad;
+  gchar *pad_name;
+  guint index = 0;
+
+  GST_OBJECT_LOCK (encoder);
+  if (name == NULL || sscanf (name, "src_%u", &index) != 1) {
+    for (index = 1; index <= GST_X265_ENC_MAX_RENDITIONS; index++) {
+      if (encoder->renditions[index - 1].srcpad == NULL)
+        break;
+    }
+  }
+
+  if (index < 1 || index > GST_X265_ENC_MAX_RENDITIONS ||
+      encoder->renditions[index - 1].srcpad != NULL) {
+    GST_OBJECT_UNLOCK (encoder);
+    GST_WARNING_OBJECT (encoder, "no rendition available for pad %s",
+        GST_STR_NULL (name));
+    return NULL;
+  }
+
+  pad_name = g_strdup_printf ("src_%u", index);
+  pad = gst_pad_new_from_template (templ, pad_name);
+  g_free (pad_name);
+  gst_pad_use_fixed_caps (pad);
+
+  rendition = &encoder->renditions[index - 1];
+  rendition->srcpad = pad;
+  rendition->need_stream_start = TRUE;
+  rendition->need_caps = TRUE;
+  rendition->need_segment = TRUE;
+  GST_OBJECT_UNLOCK (encoder);
+
+  GST_DEBUG_OBJECT (encoder, "created pad %s for rendition %u",
+      GST_PAD_NAME (pad), index);
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static void
+gst_x265_enc_release_pad (GstElement * element, GstPad * pad)
+{
+  GstX265Enc *encoder = GST_X265_ENC (element);
+  guint i;
+
+  GST_OBJECT_LOCK (encoder);
+  for (i = 0; i < GST_X265_ENC_MAX_RENDITIONS; i++) {
+    if (encoder->renditions[i].srcpad == pad)
+      encoder->renditions[i].srcpad = NULL;
+  }
+  GST_OBJECT_UNLOCK (encoder);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
 /* chain function
  * this function does the actual processing
  */
@@ -990,8 +1315,29 @@ gst_x265_enc_handle_frame (GstVideoEncoder * video_enc,
   pic_in.bitDepth = info->finfo->depth[0];
   pic_in.userData = GINT_TO_POINTER (frame->system_frame_number);
 
+#ifdef HAVE_ANALYSIS_REUSE
+  /* saved by the main encoder and loaded by the renditions */
+  if (encoder->n_active > 0) {
+    x265_alloc_analysis_data (&pic_in);
+    fdata->have_analysis = TRUE;
+  }
+#endif
+
+  /* kept for the renditions */
+  fdata->pic = pic_in;
+  fdata->refcount++;
+
   ret = gst_x265_enc_encode_frame (encoder, &pic_in, frame, &i_nal, TRUE);
 
+  /* renditions get the frames in input order, once the main encoder is done
+   * analysing them */
+  if (encoder->n_active > 0) {
+    g_queue_push_tail (&encoder->rendition_frames, fdata);
+    gst_x265_enc_feed_renditions (encoder, FALSE);
+  } else {
+    gst_x265_enc_unref_frame (encoder, fdata);
+  }
+
   /* input buffer is released later on */
   return ret;
 
@@ -1008,18 +1354,214 @@ invalid_frame:
   }
 }
 
+/* gst_x265_enc_reconfig_encoder
+ * @encoder:  Encoder which should be reconfigured.
+ *
+ * Apply changed properties to the running encoder at a frame boundary. If
+ * x265 can't change them on the fly, the pending frames are drained and the
+ * encoder is reopened.
+ */
+static gboolean
+gst_x265_enc_reconfig_encoder (GstX265Enc * encoder)
+{
+#ifdef HAVE_ENCODER_RECONFIG
+  x265_param param;
+  gboolean ok;
+
+  GST_OBJECT_LOCK (encoder);
+  param = encoder->x265param;
+  ok = gst_x265_enc_apply_dynamic_params (encoder, &param);
+  GST_OBJECT_UNLOCK (encoder);
+
+  /* renditions are configured from the main encoder when opened, and
+   * x265_encoder_reconfig() ignores changes of the rate control mode */
+  if (ok && encoder->n_active == 0 &&
+      param.rc.rateControlMode == encoder->x265param.rc.rateControlMode &&
+      x265_encoder_reconfig (encoder->x265enc, &param) == 0) {
+    GST_DEBUG_OBJECT (encoder, "reconfigured encoder");
+    GST_OBJECT_LOCK (encoder);
+    encoder->x265param = param;
+    GST_OBJECT_UNLOCK (encoder);
+    return TRUE;
+  }
+#endif
+
+  GST_INFO_OBJECT (encoder, "can't reconfigure encoder, reopening it");
+
+  gst_x265_enc_flush_frames (encoder, TRUE);
+  return gst_x265_enc_init_encoder (encoder);
+}
+
+static GstBuffer *
+gst_x265_enc_nals_to_buffer (x265_nal * nal, guint32 i_nal)
+{
+  GstBuffer *out_buf;
+  guint32 i;
+  gsize i_size, offset;
+
+  i_size = 0;
+  offset = 0;
+  for (i = 0; i < i_nal; i++)
+    i_size += nal[i].sizeBytes;
+  out_buf = gst_buffer_new_allocate (NULL, i_size, NULL);
+  for (i = 0; i < i_nal; i++) {
+    gst_buffer_fill (out_buf, offset, nal[i].payload, nal[i].sizeBytes);
+    offset += nal[i].sizeBytes;
+  }
+
+  return out_buf;
+}
+
+static void
+gst_x265_enc_push_rendition (GstX265Enc * encoder, guint index,
+    GstBuffer * buffer)
+{
+  GstX265EncRendition *rendition = &encoder->renditions[index];
+  GstPad *pad = NULL;
+  GstFlowReturn ret;
+
+  GST_OBJECT_LOCK (encoder);
+  if (rendition->srcpad)
+    pad = gst_object_ref (rendition->srcpad);
+  GST_OBJECT_UNLOCK (encoder);
+
+  if (pad == NULL) {
+    gst_buffer_unref (buffer);
+    return;
+  }
+
+  if (rendition->need_stream_start) {
+    gchar *stream_id;
+
+    stream_id = gst_pad_create_stream_id_printf (pad,
+        GST_ELEMENT_CAST (encoder), "rendition%u", index + 1);
+    gst_pad_push_event (pad, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+    rendition->need_stream_start = FALSE;
+  }
+  if (rendition->need_caps && rendition->caps) {
+    gst_pad_push_event (pad, gst_event_new_caps (rendition->caps));
+    rendition->need_caps = FALSE;
+  }
+  if (rendition->need_segment) {
+    gst_pad_push_event (pad,
+        gst_event_new_segment (&GST_VIDEO_ENCODER (encoder)->input_segment));
+    rendition->need_segment = FALSE;
+  }
+
+  ret = gst_pad_push (pad, buffer);
+  if (ret != GST_FLOW_OK) {
+    GST_DEBUG_OBJECT (pad, "pushing rendition returned %s",
+        gst_flow_get_name (ret));
+  }
+
+  gst_object_unref (pad);
+}
+
+/* Encodes @pic_in, or drains if %NULL, with the encoder of rendition @index
+ * and pushes the output, if any, on the pad of the rendition */
+static GstFlowReturn
+gst_x265_enc_encode_rendition (GstX265Enc * encoder, guint index,
+    x265_picture * pic_in, guint32 * i_nal, gboolean send)
+{
+  GstX265EncRendition *rendition = &encoder->renditions[index];
+  FrameData *fdata;
+  GstBuffer *out_buf;
+  x265_picture pic_out;
+  x265_nal *nal;
+  int encoder_return;
+
+  encoder_return = x265_encoder_encode (rendition->x265enc,
+      &nal, i_nal, pic_in, &pic_out);
+
+  if (encoder_return < 0) {
+    GST_ELEMENT_ERROR (encoder, STREAM, ENCODE, ("Encode x265 frame failed."),
+        ("x265_encoder_encode of rendition %u return code=%d", index + 1,
+            encoder_return));
+    *i_nal = 0;
+    return GST_FLOW_ERROR;
+  }
+
+  if (!*i_nal)
+    return GST_FLOW_OK;
+
+  fdata = gst_x265_enc_find_frame (encoder, GPOINTER_TO_INT (pic_out.userData));
+  if (!fdata) {
+    GST_LOG_OBJECT (encoder, "frame of rendition %u not found", index + 1);
+    return GST_FLOW_OK;
+  }
+
+  if (send) {
+    out_buf = gst_x265_enc_nals_to_buffer (nal, *i_nal);
+
+    if (rendition->push_header) {
+      GstBuffer *header;
+
+      header = gst_x265_enc_get_header_buffer (encoder, rendition->x265enc);
+      if (header)
+        out_buf = gst_buffer_append (header, out_buf);
+      rendition->push_header = FALSE;
+    }
+
+    GST_BUFFER_PTS (out_buf) = fdata->frame->pts;
+    GST_BUFFER_DTS (out_buf) = pic_out.dts + encoder->dts_offset;
+    GST_BUFFER_DURATION (out_buf) = fdata->frame->duration;
+    if (pic_out.sliceType != X265_TYPE_IDR)
+      GST_BUFFER_FLAG_SET (out_buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+    gst_x265_enc_push_rendition (encoder, index, out_buf);
+  }
+
+  gst_x265_enc_unref_frame (encoder, fdata);
+
+  return GST_FLOW_OK;
+}
+
+/* Feeds the queued input frames to all renditions in input order, together
+ * with the analysis the main encoder saved for them. Stops at the first
+ * frame the main encoder didn't output yet, unless @drain is set, in which
+ * case frames without analysis are dropped. */
+static void
+gst_x265_enc_feed_renditions (GstX265Enc * encoder, gboolean drain)
+{
+  FrameData *fdata;
+  guint32 i_nal;
+  guint i;
+
+  while ((fdata = g_queue_peek_head (&encoder->rendition_frames))) {
+    if (fdata->analysis_ready) {
+      for (i = 0; i < encoder->n_active; i++) {
+        x265_picture pic_in = fdata->pic;
+
+        pic_in.sliceType = X265_TYPE_AUTO;
+
+        fdata->refcount++;
+        if (gst_x265_enc_encode_rendition (encoder, i, &pic_in, &i_nal,
+                TRUE) != GST_FLOW_OK)
+          gst_x265_enc_unref_frame (encoder, fdata);
+      }
+    } else if (!drain) {
+      break;
+    } else {
+      GST_DEBUG_OBJECT (encoder, "dropping frame %u without analysis",
+          fdata->frame->system_frame_number);
+    }
+
+    g_queue_pop_head (&encoder->rendition_frames);
+    gst_x265_enc_unref_frame (encoder, fdata);
+  }
+}
+
 static GstFlowReturn
 gst_x265_enc_encode_frame (GstX265Enc * encoder, x265_picture * pic_in,
     GstVideoCodecFrame * input_frame, guint32 * i_nal, gboolean send)
 {
   GstVideoCodecFrame *frame = NULL;
-  GstBuffer *out_buf = NULL;
   x265_picture pic_out;
   x265_nal *nal;
-  int i_size, i, offset;
   int encoder_return;
   GstFlowReturn ret = GST_FLOW_OK;
-  gboolean update_latency = FALSE;
+  gboolean reconfig;
 
   if (G_UNLIKELY (encoder->x265enc == NULL)) {
     if (input_frame)
@@ -1028,22 +1570,27 @@ gst_x265_enc_encode_frame (GstX265Enc * encoder, x265_picture * pic_in,
   }
 
   GST_OBJECT_LOCK (encoder);
-  if (encoder->reconfig) {
-    // x265_encoder_reconfig is not yet implemented thus we shut down and re-create encoder
-    gst_x265_enc_init_encoder (encoder);
-    update_latency = TRUE;
+  reconfig = encoder->reconfig;
+  encoder->reconfig = FALSE;
+  GST_OBJECT_UNLOCK (encoder);
+
+  if (G_UNLIKELY (reconfig)) {
+    if (!gst_x265_enc_reconfig_encoder (encoder)) {
+      if (input_frame)
+        gst_video_codec_frame_unref (input_frame);
+      return GST_FLOW_NOT_NEGOTIATED;
+    }
+    gst_x265_enc_set_latency (encoder);
   }
 
   if (pic_in && input_frame) {
     if (GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME (input_frame)) {
       GST_INFO_OBJECT (encoder, "Forcing key frame");
       pic_in->sliceType = X265_TYPE_IDR;
+      if (GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME_HEADERS (input_frame))
+        encoder->push_header_on_idr = TRUE;
     }
   }
-  GST_OBJECT_UNLOCK (encoder);
-
-  if (G_UNLIKELY (update_latency))
-    gst_x265_enc_set_latency (encoder);
 
   encoder_return = x265_encoder_encode (encoder->x265enc,
       &nal, i_nal, pic_in, &pic_out);
@@ -1074,6 +1621,16 @@ gst_x265_enc_encode_frame (GstX265Enc * encoder, x265_picture * pic_in,
       GPOINTER_TO_INT (pic_out.userData));
   g_assert (frame || !send);
 
+  /* the analysis of the picture is complete now */
+  if (encoder->n_active > 0) {
+    FrameData *fdata;
+
+    fdata = gst_x265_enc_find_frame (encoder,
+        GPOINTER_TO_INT (pic_out.userData));
+    if (fdata)
+      fdata->analysis_ready = TRUE;
+  }
+
   GST_DEBUG_OBJECT (encoder,
       "output picture ready POC=%d system=%d frame found %d", pic_out.poc,
       GPOINTER_TO_INT (pic_out.userData), frame != NULL);
@@ -1085,22 +1642,23 @@ gst_x265_enc_encode_frame (GstX265Enc * encoder, x265_picture * pic_in,
     goto out;
   }
 
-  i_size = 0;
-  offset = 0;
-  for (i = 0; i < *i_nal; i++)
-    i_size += nal[i].sizeBytes;
-  out_buf = gst_buffer_new_allocate (NULL, i_size, NULL);
-  for (i = 0; i < *i_nal; i++) {
-    gst_buffer_fill (out_buf, offset, nal[i].payload, nal[i].sizeBytes);
-    offset += nal[i].sizeBytes;
-  }
+  frame->output_buffer = gst_x265_enc_nals_to_buffer (nal, *i_nal);
+
+  /* open-GOP I frames can reference pictures before them */
+  if (pic_out.sliceType == X265_TYPE_IDR)
+    GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
+  else
+    GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
 
-  frame->output_buffer = out_buf;
+  if (pic_out.sliceType == X265_TYPE_IDR && encoder->push_header_on_idr) {
+    encoder->push_header = TRUE;
+    encoder->push_header_on_idr = FALSE;
+  }
 
   if (encoder->push_header) {
     GstBuffer *header;
 
-    header = gst_x265_enc_get_header_buffer (encoder);
+    header = gst_x265_enc_get_header_buffer (encoder, encoder->x265enc);
     frame->output_buffer = gst_buffer_append (header, frame->output_buffer);
     encoder->push_header = FALSE;
   }
@@ -1131,12 +1689,72 @@ gst_x265_enc_flush_frames (GstX265Enc * encoder, gboolean send)
     do {
       flow_ret = gst_x265_enc_encode_frame (encoder, NULL, NULL, &i_nal, send);
     } while (flow_ret == GST_FLOW_OK && i_nal > 0);
+
+  /* the main encoder analysed all remaining frames */
+  gst_x265_enc_feed_renditions (encoder, TRUE);
+  gst_x265_enc_flush_renditions (encoder, send);
+}
+
+static void
+gst_x265_enc_flush_renditions (GstX265Enc * encoder, gboolean send)
+{
+  GstFlowReturn flow_ret;
+  guint32 i_nal;
+  guint i;
+
+  for (i = 0; i < encoder->n_active; i++) {
+    do {
+      flow_ret =
+          gst_x265_enc_encode_rendition (encoder, i, NULL, &i_nal, send);
+    } while (flow_ret == GST_FLOW_OK && i_nal > 0);
+  }
+}
+
+static void
+gst_x265_enc_set_renditions (GstX265Enc * encoder, const gchar * renditions)
+{
+  gchar **bitrates;
+  guint i, n = 0;
+
+  g_free (encoder->renditions_prop);
+  encoder->renditions_prop = g_strdup (renditions);
+
+  if (renditions == NULL) {
+    encoder->n_renditions = 0;
+    return;
+  }
+
+  bitrates = g_strsplit (renditions, ",", -1);
+  for (i = 0; bitrates[i] != NULL; i++) {
+    gchar *end;
+    guint64 bitrate;
+
+    if (n == GST_X265_ENC_MAX_RENDITIONS) {
+      GST_WARNING_OBJECT (encoder, "only %d renditions supported",
+          GST_X265_ENC_MAX_RENDITIONS);
+      break;
+    }
+
+    bitrate = g_ascii_strtoull (bitrates[i], &end, 10);
+    if (end == bitrates[i] || *end != '\0' || bitrate == 0 ||
+        bitrate > 100 * 1024) {
+      GST_WARNING_OBJECT (encoder, "invalid rendition bitrate '%s'",
+          bitrates[i]);
+      continue;
+    }
+
+    encoder->renditions[n].bitrate = bitrate;
+    n++;
+  }
+  g_strfreev (bitrates);
+
+  encoder->n_renditions = n;
 }
 
 static void
 gst_x265_enc_reconfig (GstX265Enc * encoder)
 {
-  encoder->x265param.rc.bitrate = encoder->bitrate;
+  /* applied by the streaming thread before the next frame */
   encoder->reconfig = TRUE;
 }
 
@@ -1175,6 +1793,9 @@ gst_x265_enc_set_property (GObject * object, guint prop_id,
     case PROP_TUNE:
       encoder->tune = g_value_get_enum (value);
       break;
+    case PROP_RENDITIONS:
+      gst_x265_enc_set_renditions (encoder, g_value_get_string (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1219,6 +1840,9 @@ gst_x265_enc_get_property (GObject * object, guint prop_id,
     case PROP_TUNE:
       g_value_set_enum (value, encoder->tune);
       break;
+    case PROP_RENDITIONS:
+      g_value_set_string (value, encoder->renditions_prop);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
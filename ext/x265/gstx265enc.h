@@ -42,6 +42,25 @@ G_BEGIN_DECLS
 typedef struct _GstX265Enc GstX265Enc;
 typedef struct _GstX265EncClass GstX265EncClass;
 
+#define GST_X265_ENC_MAX_RENDITIONS 8
+
+/* An additional encode of the input at another bitrate, reusing the analysis
+ * of the main encode and output on the src_%u request pad */
+typedef struct
+{
+  guint bitrate;
+
+  x265_encoder *x265enc;
+  x265_param x265param;
+  gboolean push_header;
+
+  GstPad *srcpad;
+  GstCaps *caps;
+  gboolean need_stream_start;
+  gboolean need_caps;
+  gboolean need_segment;
+} GstX265EncRendition;
+
 struct _GstX265Enc
 {
   GstVideoEncoder element;
@@ -51,6 +70,8 @@ struct _GstX265Enc
   x265_param x265param;
   GstClockTime dts_offset;
   gboolean push_header;
+  /* resend the headers with the next IDR frame */
+  gboolean push_header_on_idr;
 
   /* List of frame/buffer mapping structs for
    * pending frames */
@@ -63,6 +84,7 @@ struct _GstX265Enc
   gint tune;
   gint speed_preset;
   GString *option_string_prop;  /* option-string property */
+  gchar *renditions_prop;       /* renditions property */
   /*GString *option_string; *//* used by set prop */
 
   /* input description */
@@ -71,6 +93,13 @@ struct _GstX265Enc
   /* configuration changed  while playing */
   gboolean reconfig;
 
+  /* renditions from the property, and how many are currently encoded */
+  GstX265EncRendition renditions[GST_X265_ENC_MAX_RENDITIONS];
+  guint n_renditions;
+  guint n_active;
+  /* input frames waiting to be encoded by the renditions, in input order */
+  GQueue rendition_frames;
+
   /* from the downstream caps */
   const gchar *peer_profile;
   gboolean peer_intra_profile;
@@ -1499,11 +1499,12 @@ gst_adaptive_demux_stream_data_received_default (GstAdaptiveDemux * demux,
   return gst_adaptive_demux_stream_push_buffer (stream, buffer);
 }
 
+/* Handles a buffer of the current download, from the source element or
+ * from the downloader */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_handle_buffer (GstAdaptiveDemuxStream * stream,
+    GstBuffer * buffer)
 {
-  GstPad *srcpad = (GstPad *) parent;
-  GstAdaptiveDemuxStream *stream = gst_pad_get_element_private (srcpad);
   GstAdaptiveDemux *demux = stream->demux;
   GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
@@ -1569,6 +1570,15 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   return ret;
 }
 
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstPad *srcpad = (GstPad *) parent;
+  GstAdaptiveDemuxStream *stream = gst_pad_get_element_private (srcpad);
+
+  return gst_adaptive_demux_stream_handle_buffer (stream, buffer);
+}
+
 static void
 gst_adaptive_demux_stream_fragment_download_finish (GstAdaptiveDemuxStream *
     stream, GstFlowReturn ret, GError * err)
@@ -1879,6 +1889,66 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
   return ret;
 }
 
+static gboolean
+gst_adaptive_demux_stream_downloader_data (GstUriDownloader * downloader,
+    GstBuffer * buffer, gpointer user_data)
+{
+  GstAdaptiveDemuxStream *stream = user_data;
+
+  return gst_adaptive_demux_stream_handle_buffer (stream, buffer) ==
+      GST_FLOW_OK;
+}
+
+/* Header fragments are small and usually shared by all fragments of a
+ * representation, so they are fetched with the downloader that can serve
+ * them from its cache instead of with the stream's source element */
+static GstFlowReturn
+gst_adaptive_demux_stream_download_cached_uri (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, const gchar * uri, gint64 start,
+    gint64 end)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstFragment *download;
+  GError *err = NULL;
+  GstFlowReturn ret;
+
+  GST_DEBUG_OBJECT (stream->pad, "Downloading uri: %s, range:%" G_GINT64_FORMAT
+      " - %" G_GINT64_FORMAT " with the downloader", uri, start, end);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->download_start_time = g_get_monotonic_time ();
+  stream->download_chunk_start_time = g_get_monotonic_time ();
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  download = gst_uri_downloader_fetch_uri_streaming (demux->downloader, uri,
+      NULL, FALSE, FALSE, TRUE, start, end,
+      gst_adaptive_demux_stream_downloader_data, stream, &err);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  ret = stream->last_ret;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (download != NULL) {
+    g_object_unref (download);
+    if (ret == GST_FLOW_OK) {
+      ret = klass->finish_fragment (demux, stream);
+      gst_adaptive_demux_stream_fragment_download_finish (stream, ret, NULL);
+    }
+  } else if (ret == GST_FLOW_OK) {
+    /* the download itself failed, not the handling of its data */
+    GST_WARNING_OBJECT (stream->pad, "Failed to download %s: %s", uri,
+        err ? err->message : "unknown error");
+    ret = GST_FLOW_CUSTOM_ERROR;
+    gst_adaptive_demux_stream_fragment_download_finish (stream, ret, err);
+  }
+  g_clear_error (&err);
+
+  GST_DEBUG_OBJECT (stream->pad, "Fragment download finished: %s", uri);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
     stream)
@@ -1892,7 +1962,7 @@ gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
         stream->fragment.header_range_start, stream->fragment.header_range_end);
 
     stream->downloading_header = TRUE;
-    ret = gst_adaptive_demux_stream_download_uri (demux, stream,
+    ret = gst_adaptive_demux_stream_download_cached_uri (demux, stream,
         stream->fragment.header_uri, stream->fragment.header_range_start,
         stream->fragment.header_range_end);
     stream->downloading_header = FALSE;
@@ -72,9 +72,45 @@ nal_reader_init (NalReader * nr, const guint8 * data, guint size)
 
   nr->byte = 0;
   nr->bits_in_cache = 0;
-  /* fill with something other than 0 to detect emulation prevention bytes */
-  nr->first_byte = 0xff;
-  nr->cache = 0xff;
+  nr->zeros = 0;
+  nr->cache = 0;
+}
+
+/* Non-zero if any of the bytes of @x is zero */
+#define HAS_ZERO_BYTE(x) \
+    (((x) - G_GUINT64_CONSTANT (0x0101010101010101)) & ~(x) & \
+        G_GUINT64_CONSTANT (0x8080808080808080))
+
+/* Loads as many whole bytes as fit in the cache at once, if none of them
+ * can be an emulation_prevention_three_byte */
+static inline gboolean
+nal_reader_read_word (NalReader * nr)
+{
+  guint n = (64 - nr->bits_in_cache) / 8;
+  guint64 word, mask;
+
+  if (nr->size - nr->byte < 8)
+    return FALSE;
+
+  word = GST_READ_UINT64_BE (nr->data + nr->byte);
+  /* only look at the bytes we take, the first ones */
+  mask = n < 8 ? ~(G_MAXUINT64 >> (n * 8)) : G_MAXUINT64;
+  if (HAS_ZERO_BYTE (word ^ G_GUINT64_CONSTANT (0x0303030303030303)) & mask)
+    return FALSE;
+
+  word >>= 64 - n * 8;
+  nr->cache = n < 8 ? (nr->cache << (n * 8)) | word : word;
+  nr->bits_in_cache += n * 8;
+  nr->byte += n;
+
+  if (word & 0xff)
+    nr->zeros = 0;
+  else if (n > 1)
+    nr->zeros = (word & 0xff00) ? 1 : 2;
+  else
+    nr->zeros = MIN (nr->zeros + 1, 2);
+
+  return TRUE;
 }
 
 inline gboolean
@@ -88,26 +124,29 @@ nal_reader_read (NalReader * nr, guint nbits)
 
   while (nr->bits_in_cache < nbits) {
     guint8 byte;
-    gboolean check_three_byte;
 
-    check_three_byte = TRUE;
-  next_byte:
+    if (G_LIKELY (nal_reader_read_word (nr)))
+      continue;
+
+    /* close to a 0x03 byte or the end, go byte by byte and only as far as
+     * needed, so that skipped emulation prevention bytes are always before
+     * the next bit to read */
     if (G_UNLIKELY (nr->byte >= nr->size))
       return FALSE;
 
     byte = nr->data[nr->byte++];
 
-    /* check if the byte is a emulation_prevention_three_byte */
-    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
-        ((nr->cache & 0xff) == 0)) {
-      /* next byte goes unconditionally to the cache, even if it's 0x03 */
-      check_three_byte = FALSE;
+    /* check if the byte is a emulation_prevention_three_byte, the next byte
+     * goes unconditionally to the cache, even if it's 0x03 */
+    if (byte == 0x03 && nr->zeros == 2) {
+      nr->zeros = 0;
       nr->n_epb++;
-      goto next_byte;
+      continue;
     }
-    nr->cache = (nr->cache << 8) | nr->first_byte;
-    nr->first_byte = byte;
+
+    nr->cache = (nr->cache << 8) | byte;
     nr->bits_in_cache += 8;
+    nr->zeros = byte ? 0 : MIN (nr->zeros + 1, 2);
   }
 
   return TRUE;
@@ -118,7 +157,7 @@ nal_reader_read (NalReader * nr, guint nbits)
 inline gboolean
 nal_reader_skip (NalReader * nr, guint nbits)
 {
-  g_assert (nbits <= 8 * sizeof (nr->cache));
+  g_assert (nbits <= NAL_READER_MAX_SKIP);
 
   if (G_UNLIKELY (!nal_reader_read (nr, nbits)))
     return FALSE;
@@ -170,17 +209,17 @@ nal_reader_get_bits_uint##bits (NalReader *nr, guint##bits *val, guint nbits) \
 { \
   guint shift; \
   \
+  if (G_UNLIKELY (nbits == 0)) { \
+    *val = 0; \
+    return TRUE; \
+  } \
+  \
   if (!nal_reader_read (nr, nbits)) \
     return FALSE; \
   \
   /* bring the required bits down and truncate */ \
   shift = nr->bits_in_cache - nbits; \
-  *val = nr->first_byte >> shift; \
-  \
-  *val |= nr->cache << (8 - shift); \
-  /* mask out required bits */ \
-  if (nbits < bits) \
-    *val &= ((guint##bits)1 << nbits) - 1; \
+  *val = (nr->cache >> shift) & ((G_GUINT64_CONSTANT (1) << nbits) - 1); \
   \
   nr->bits_in_cache = shift; \
   \
@@ -249,7 +288,7 @@ nal_reader_get_se (NalReader * nr, gint32 * val)
 gboolean
 nal_reader_is_byte_aligned (NalReader * nr)
 {
-  if (nr->bits_in_cache != 0)
+  if (nr->bits_in_cache % 8 != 0)
     return FALSE;
   return TRUE;
 }
@@ -300,10 +339,25 @@ nal_reader_has_more_data (NalReader * nr)
 inline gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
+  guint i = 0;
 
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  while (i + 4 <= size) {
+    /* no start code can begin in a word without any zero byte */
+    if (i + 8 <= size && !HAS_ZERO_BYTE (GST_READ_UINT64_LE (data + i))) {
+      i += 8;
+      continue;
+    }
+
+    if (data[i + 2] > 1) {
+      /* no start code can begin at i, i + 1 or i + 2 */
+      i += 3;
+    } else if (data[i + 2] == 1 && data[i] == 0 && data[i + 1] == 0) {
+      return i;
+    } else {
+      i++;
+    }
+  }
+
+  return -1;
 }
@@ -49,10 +49,13 @@ typedef struct
   guint n_epb;                  /* Number of emulation prevention bytes */
   guint byte;                   /* Byte position */
   guint bits_in_cache;          /* bitpos in the cache of next bit */
-  guint8 first_byte;
+  guint zeros;                  /* Number of trailing zero bytes read, up to 2 */
   guint64 cache;                /* cached bytes */
 } NalReader;
 
+/* Maximum number of bits nal_reader_skip() can skip */
+#define NAL_READER_MAX_SKIP 56
+
 void nal_reader_init (NalReader * nr, const guint8 * data, guint size);
 
 gboolean nal_reader_read (NalReader * nr, guint nbits);
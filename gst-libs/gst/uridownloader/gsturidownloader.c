@@ -20,6 +20,7 @@
  */
 
 #include <glib.h>
+#include <string.h>
 #include "gstfragment.h"
 #include "gsturidownloader.h"
 #include "gsturidownloader_debug.h"
@@ -31,10 +32,38 @@ GST_DEBUG_CATEGORY (uridownloader_debug);
    (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
     GST_TYPE_URI_DOWNLOADER, GstUriDownloaderPrivate))
 
+/* Maximum number of source elements (one per scheme://host) kept alive */
+#define MAX_SOURCES 4
+
+/* Limits of the in-memory cache of small, repeatedly fetched resources
+ * (keys, init segments, playlists) */
+#define CACHE_MAX_ENTRY_SIZE (256 * 1024)
+#define CACHE_MAX_SIZE (4 * 1024 * 1024)
+
+typedef struct _GstUriDownloaderSource GstUriDownloaderSource;
+typedef struct _GstUriDownloaderCacheEntry GstUriDownloaderCacheEntry;
+
+struct _GstUriDownloaderSource
+{
+  gchar *key;                   /* scheme://host[:port] */
+  GstElement *urisrc;
+};
+
+struct _GstUriDownloaderCacheEntry
+{
+  gchar *key;
+  GstBuffer *buffer;
+  gchar *uri;
+  gchar *redirect_uri;
+  gboolean redirect_permanent;
+  gint64 expires;               /* monotonic time, in microseconds */
+};
+
 struct _GstUriDownloaderPrivate
 {
   /* Fragments fetcher */
-  GstElement *urisrc;
+  GstElement *urisrc;           /* currently used source, owned by sources */
+  GQueue sources;               /* GstUriDownloaderSource, most recent first */
   GstBus *bus;
   GstPad *pad;
   GTimeVal *timeout;
@@ -46,6 +75,22 @@ struct _GstUriDownloaderPrivate
 
   GCond cond;
   gboolean cancelled;
+
+  /* Streaming delivery of the current download */
+  GstUriDownloaderDataFunc data_func;
+  gpointer data_func_user_data;
+  /* Streamed data kept for the cache, until it gets too big */
+  GstBuffer *cache_buffer;
+  gboolean cache_streamed;
+
+  /* Cache-Control of the current download */
+  gint64 cache_max_age;         /* in seconds, -1 if not given */
+  gboolean cache_forbidden;
+
+  /* Cache of small resources, protected by the download lock */
+  GHashTable *cache;            /* key -> GstUriDownloaderCacheEntry */
+  GQueue cache_lru;             /* GstUriDownloaderCacheEntry, most recent first */
+  gsize cache_size;
 };
 
 static void gst_uri_downloader_finalize (GObject * object);
@@ -105,6 +150,29 @@ gst_uri_downloader_init (GstUriDownloader * downloader)
 
   g_mutex_init (&downloader->priv->download_lock);
   g_cond_init (&downloader->priv->cond);
+
+  g_queue_init (&downloader->priv->sources);
+  g_queue_init (&downloader->priv->cache_lru);
+  downloader->priv->cache = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+static void
+gst_uri_downloader_source_free (GstUriDownloaderSource * source)
+{
+  gst_element_set_state (source->urisrc, GST_STATE_NULL);
+  gst_object_unref (source->urisrc);
+  g_free (source->key);
+  g_slice_free (GstUriDownloaderSource, source);
+}
+
+static void
+gst_uri_downloader_cache_entry_free (GstUriDownloaderCacheEntry * entry)
+{
+  gst_buffer_unref (entry->buffer);
+  g_free (entry->key);
+  g_free (entry->uri);
+  g_free (entry->redirect_uri);
+  g_slice_free (GstUriDownloaderCacheEntry, entry);
 }
 
 static void
@@ -112,10 +180,18 @@ gst_uri_downloader_dispose (GObject * object)
 {
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
 
-  if (downloader->priv->urisrc != NULL) {
-    gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
-    gst_object_unref (downloader->priv->urisrc);
-    downloader->priv->urisrc = NULL;
+  downloader->priv->urisrc = NULL;
+  g_queue_foreach (&downloader->priv->sources,
+      (GFunc) gst_uri_downloader_source_free, NULL);
+  g_queue_clear (&downloader->priv->sources);
+
+  if (downloader->priv->cache != NULL) {
+    g_hash_table_unref (downloader->priv->cache);
+    downloader->priv->cache = NULL;
+    g_queue_foreach (&downloader->priv->cache_lru,
+        (GFunc) gst_uri_downloader_cache_entry_free, NULL);
+    g_queue_clear (&downloader->priv->cache_lru);
+    downloader->priv->cache_size = 0;
   }
 
   if (downloader->priv->bus != NULL) {
@@ -153,6 +229,38 @@ gst_uri_downloader_new (void)
   return g_object_new (GST_TYPE_URI_DOWNLOADER, NULL);
 }
 
+static gboolean
+gst_uri_downloader_parse_header (GQuark field_id, const GValue * value,
+    gpointer user_data)
+{
+  GstUriDownloader *downloader = GST_URI_DOWNLOADER (user_data);
+  gchar **directives;
+  guint i;
+
+  if (g_ascii_strcasecmp (g_quark_to_string (field_id), "Cache-Control") != 0
+      || !G_VALUE_HOLDS_STRING (value))
+    return TRUE;
+
+  GST_DEBUG_OBJECT (downloader, "Cache-Control: %s",
+      g_value_get_string (value));
+
+  directives = g_strsplit (g_value_get_string (value), ",", -1);
+  for (i = 0; directives[i]; i++) {
+    gchar *directive = g_strstrip (directives[i]);
+
+    if (g_ascii_strcasecmp (directive, "no-store") == 0 ||
+        g_ascii_strcasecmp (directive, "no-cache") == 0) {
+      downloader->priv->cache_forbidden = TRUE;
+    } else if (g_ascii_strncasecmp (directive, "max-age=", 8) == 0) {
+      downloader->priv->cache_max_age =
+          MAX (g_ascii_strtoll (directive + 8, NULL, 10), 0);
+    }
+  }
+  g_strfreev (directives);
+
+  return TRUE;
+}
+
 static gboolean
 gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event)
@@ -178,6 +286,24 @@ gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
       gst_event_unref (event);
       break;
     }
+    case GST_EVENT_CUSTOM_DOWNSTREAM_STICKY:{
+      const GstStructure *s = gst_event_get_structure (event);
+      const GValue *headers;
+
+      /* Response headers of HTTP sources, used to honour Cache-Control */
+      if (gst_structure_has_name (s, "http-headers")) {
+        headers = gst_structure_get_value (s, "response-headers");
+        if (headers && GST_VALUE_HOLDS_STRUCTURE (headers)) {
+          GST_OBJECT_LOCK (downloader);
+          gst_structure_foreach (gst_value_get_structure (headers),
+              gst_uri_downloader_parse_header, downloader);
+          GST_OBJECT_UNLOCK (downloader);
+        }
+      }
+      gst_event_unref (event);
+      ret = TRUE;
+      break;
+    }
     default:
       ret = gst_pad_event_default (pad, parent, event);
       break;
@@ -269,7 +395,45 @@ gst_uri_downloader_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   GST_LOG_OBJECT (downloader, "The uri fetcher received a new buffer "
       "of size %" G_GSIZE_FORMAT, gst_buffer_get_size (buf));
   downloader->priv->got_buffer = TRUE;
-  if (!gst_fragment_add_buffer (downloader->priv->download, buf)) {
+
+  if (downloader->priv->data_func) {
+    GstUriDownloaderDataFunc func = downloader->priv->data_func;
+    gpointer user_data = downloader->priv->data_func_user_data;
+    gboolean cont;
+
+    if (downloader->priv->cache_streamed) {
+      GstBuffer *cache_buffer = downloader->priv->cache_buffer;
+      gsize size = gst_buffer_get_size (buf);
+
+      if (cache_buffer)
+        size += gst_buffer_get_size (cache_buffer);
+
+      if (size <= CACHE_MAX_ENTRY_SIZE) {
+        downloader->priv->cache_buffer = cache_buffer ?
+            gst_buffer_append (cache_buffer, gst_buffer_ref (buf)) :
+            gst_buffer_ref (buf);
+      } else {
+        gst_buffer_replace (&downloader->priv->cache_buffer, NULL);
+        downloader->priv->cache_streamed = FALSE;
+      }
+    }
+
+    /* Hand the data over as it arrives instead of accumulating it, without
+     * holding the lock so that the callback can cancel the download */
+    GST_OBJECT_UNLOCK (downloader);
+    cont = func (downloader, buf, user_data);
+    GST_OBJECT_LOCK (downloader);
+
+    if (!cont && downloader->priv->download != NULL) {
+      GST_DEBUG_OBJECT (downloader, "Download stopped by the data callback");
+      g_object_unref (downloader->priv->download);
+      downloader->priv->download = NULL;
+      downloader->priv->cancelled = TRUE;
+      g_cond_signal (&downloader->priv->cond);
+      GST_OBJECT_UNLOCK (downloader);
+      return GST_FLOW_FLUSHING;
+    }
+  } else if (!gst_fragment_add_buffer (downloader->priv->download, buf)) {
     GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
     gst_buffer_unref (buf);
   }
@@ -332,59 +496,207 @@ gst_uri_downloader_set_range (GstUriDownloader * downloader,
   return TRUE;
 }
 
-static gboolean
-gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
-    const gchar * referer, gboolean compress, gboolean refresh,
-    gboolean allow_cache)
+/* Sources are kept per scheme and host, so that connections to the servers
+ * we talk to (e.g. the playlist and the key server) stay alive */
+static gchar *
+gst_uri_downloader_get_source_key (const gchar * uri)
 {
-  GstPad *pad;
-  GObjectClass *gobject_class;
+  gchar *protocol, *location, *key;
+  gchar *host_end;
 
-  if (!gst_uri_is_valid (uri))
-    return FALSE;
+  protocol = gst_uri_get_protocol (uri);
+  location = gst_uri_get_location (uri);
+  if (location == NULL) {
+    key = protocol;
+  } else {
+    host_end = strchr (location, '/');
+    if (host_end)
+      *host_end = '\0';
+    key = g_strdup_printf ("%s://%s", protocol, location);
+    g_free (protocol);
+  }
+  g_free (location);
 
-  if (downloader->priv->urisrc) {
-    gchar *old_protocol, *new_protocol;
-    gchar *old_uri;
+  return key;
+}
 
-    old_uri =
-        gst_uri_handler_get_uri (GST_URI_HANDLER (downloader->priv->urisrc));
-    old_protocol = gst_uri_get_protocol (old_uri);
-    new_protocol = gst_uri_get_protocol (uri);
+static GstElement *
+gst_uri_downloader_get_source (GstUriDownloader * downloader, const gchar * uri)
+{
+  GstUriDownloaderSource *source = NULL;
+  gchar *key;
+  GList *l;
 
-    if (!g_str_equal (old_protocol, new_protocol)) {
-      gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
-      gst_object_unref (downloader->priv->urisrc);
-      downloader->priv->urisrc = NULL;
-      GST_DEBUG_OBJECT (downloader, "Can't re-use old source element");
-    } else {
-      GError *err = NULL;
-
-      GST_DEBUG_OBJECT (downloader, "Re-using old source element");
-      if (!gst_uri_handler_set_uri (GST_URI_HANDLER (downloader->priv->urisrc),
-              uri, &err)) {
-        GST_DEBUG_OBJECT (downloader, "Failed to re-use old source element: %s",
-            err->message);
-        g_clear_error (&err);
-        gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
-        gst_object_unref (downloader->priv->urisrc);
-        downloader->priv->urisrc = NULL;
-      }
+  key = gst_uri_downloader_get_source_key (uri);
+
+  for (l = downloader->priv->sources.head; l; l = l->next) {
+    GstUriDownloaderSource *tmp = l->data;
+
+    if (g_str_equal (tmp->key, key)) {
+      source = tmp;
+      break;
     }
-    g_free (old_uri);
-    g_free (old_protocol);
-    g_free (new_protocol);
   }
 
-  if (!downloader->priv->urisrc) {
+  if (source) {
+    GError *err = NULL;
+
+    g_queue_remove (&downloader->priv->sources, source);
+
+    GST_DEBUG_OBJECT (downloader, "Re-using source element for %s", key);
+    if (!gst_uri_handler_set_uri (GST_URI_HANDLER (source->urisrc), uri, &err)) {
+      GST_DEBUG_OBJECT (downloader, "Failed to re-use source element: %s",
+          err->message);
+      g_clear_error (&err);
+      gst_uri_downloader_source_free (source);
+      source = NULL;
+    }
+  }
+
+  if (!source) {
+    GstElement *urisrc;
+
     GST_DEBUG_OBJECT (downloader, "Creating source element for the URI:%s",
         uri);
-    downloader->priv->urisrc =
-        gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
-    if (!downloader->priv->urisrc)
-      return FALSE;
+    urisrc = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+    if (!urisrc) {
+      g_free (key);
+      return NULL;
+    }
+
+    source = g_slice_new (GstUriDownloaderSource);
+    source->key = key;
+    source->urisrc = urisrc;
+    key = NULL;
+
+    if (g_queue_get_length (&downloader->priv->sources) >= MAX_SOURCES) {
+      GstUriDownloaderSource *oldest =
+          g_queue_pop_tail (&downloader->priv->sources);
+
+      GST_DEBUG_OBJECT (downloader, "Dropping source element for %s",
+          oldest->key);
+      gst_uri_downloader_source_free (oldest);
+    }
+  }
+  g_free (key);
+
+  g_queue_push_head (&downloader->priv->sources, source);
+
+  return source->urisrc;
+}
+
+static gchar *
+gst_uri_downloader_get_cache_key (const gchar * uri, gint64 range_start,
+    gint64 range_end)
+{
+  if (range_start == 0 && range_end == -1)
+    return g_strdup (uri);
+
+  return g_strdup_printf ("%s#%" G_GINT64_FORMAT "-%" G_GINT64_FORMAT, uri,
+      range_start, range_end);
+}
+
+static void
+gst_uri_downloader_cache_remove (GstUriDownloader * downloader,
+    GstUriDownloaderCacheEntry * entry)
+{
+  g_hash_table_remove (downloader->priv->cache, entry->key);
+  g_queue_remove (&downloader->priv->cache_lru, entry);
+  downloader->priv->cache_size -= gst_buffer_get_size (entry->buffer);
+  gst_uri_downloader_cache_entry_free (entry);
+}
+
+/* Returns a completed fragment for a fresh cache entry, or NULL. If @buffer
+ * is not %NULL, the cached data is returned there instead of being added to
+ * the fragment */
+static GstFragment *
+gst_uri_downloader_cache_lookup (GstUriDownloader * downloader,
+    const gchar * key, GstBuffer ** buffer)
+{
+  GstUriDownloaderCacheEntry *entry;
+  GstFragment *download;
+
+  entry = g_hash_table_lookup (downloader->priv->cache, key);
+  if (entry == NULL)
+    return NULL;
+
+  if (entry->expires <= g_get_monotonic_time ()) {
+    GST_DEBUG_OBJECT (downloader, "Cache entry for %s expired", key);
+    gst_uri_downloader_cache_remove (downloader, entry);
+    return NULL;
   }
 
+  g_queue_remove (&downloader->priv->cache_lru, entry);
+  g_queue_push_head (&downloader->priv->cache_lru, entry);
+
+  download = gst_fragment_new ();
+  if (buffer)
+    *buffer = gst_buffer_ref (entry->buffer);
+  else
+    gst_fragment_add_buffer (download, gst_buffer_ref (entry->buffer));
+  download->uri = g_strdup (entry->uri);
+  download->redirect_uri = g_strdup (entry->redirect_uri);
+  download->redirect_permanent = entry->redirect_permanent;
+  download->completed = TRUE;
+  download->download_stop_time = download->download_start_time;
+
+  return download;
+}
+
+/* Takes ownership of @buffer, the data of @download */
+static void
+gst_uri_downloader_cache_store (GstUriDownloader * downloader,
+    const gchar * key, GstFragment * download, GstBuffer * buffer,
+    gint64 max_age)
+{
+  GstUriDownloaderCacheEntry *entry;
+  gsize size;
+
+  size = gst_buffer_get_size (buffer);
+  if (size > CACHE_MAX_ENTRY_SIZE) {
+    gst_buffer_unref (buffer);
+    return;
+  }
+
+  entry = g_hash_table_lookup (downloader->priv->cache, key);
+  if (entry)
+    gst_uri_downloader_cache_remove (downloader, entry);
+
+  while (downloader->priv->cache_size + size > CACHE_MAX_SIZE)
+    gst_uri_downloader_cache_remove (downloader,
+        g_queue_peek_tail (&downloader->priv->cache_lru));
+
+  GST_DEBUG_OBJECT (downloader, "Caching %s (%" G_GSIZE_FORMAT " bytes) for %"
+      G_GINT64_FORMAT " seconds", key, size, max_age);
+
+  entry = g_slice_new (GstUriDownloaderCacheEntry);
+  entry->key = g_strdup (key);
+  entry->buffer = buffer;
+  entry->uri = g_strdup (download->uri);
+  entry->redirect_uri = g_strdup (download->redirect_uri);
+  entry->redirect_permanent = download->redirect_permanent;
+  entry->expires = g_get_monotonic_time () + max_age * G_USEC_PER_SEC;
+
+  g_hash_table_insert (downloader->priv->cache, entry->key, entry);
+  g_queue_push_head (&downloader->priv->cache_lru, entry);
+  downloader->priv->cache_size += size;
+}
+
+static gboolean
+gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
+    const gchar * referer, gboolean compress, gboolean refresh,
+    gboolean allow_cache)
+{
+  GstPad *pad;
+  GObjectClass *gobject_class;
+
+  if (!gst_uri_is_valid (uri))
+    return FALSE;
+
+  downloader->priv->urisrc = gst_uri_downloader_get_source (downloader, uri);
+  if (!downloader->priv->urisrc)
+    return FALSE;
+
   gobject_class = G_OBJECT_GET_CLASS (downloader->priv->urisrc);
   if (g_object_class_find_property (gobject_class, "compress"))
     g_object_set (downloader->priv->urisrc, "compress", compress, NULL);
@@ -444,6 +756,10 @@ gst_uri_downloader_fetch_uri (GstUriDownloader * downloader,
  * @range_start: the starting byte index
  * @range_end: the final byte index, use -1 for unspecified
  *
+ * Small resources are served from an in-memory cache when @allow_cache is
+ * %TRUE, @refresh is %FALSE and the server allowed caching them with a
+ * Cache-Control max-age.
+ *
  * Returns the downloaded #GstFragment
  */
 GstFragment *
@@ -451,9 +767,38 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
     downloader, const gchar * uri, const gchar * referer, gboolean compress,
     gboolean refresh, gboolean allow_cache,
     gint64 range_start, gint64 range_end, GError ** err)
+{
+  return gst_uri_downloader_fetch_uri_streaming (downloader, uri, referer,
+      compress, refresh, allow_cache, range_start, range_end, NULL, NULL, err);
+}
+
+/**
+ * gst_uri_downloader_fetch_uri_streaming:
+ * @downloader: the #GstUriDownloader
+ * @uri: the uri
+ * @range_start: the starting byte index
+ * @range_end: the final byte index, use -1 for unspecified
+ * @func: (allow-none): function called with the data as it is received
+ * @user_data: user data passed to @func
+ *
+ * Like gst_uri_downloader_fetch_uri_with_range() but if @func is not %NULL
+ * the data is passed to it as it arrives instead of being accumulated in
+ * the returned #GstFragment, also when it is served from the cache. @func
+ * takes ownership of the buffer it is given. Returning %FALSE from @func
+ * cancels the download.
+ *
+ * Returns the downloaded #GstFragment
+ */
+GstFragment *
+gst_uri_downloader_fetch_uri_streaming (GstUriDownloader * downloader,
+    const gchar * uri, const gchar * referer, gboolean compress,
+    gboolean refresh, gboolean allow_cache, gint64 range_start,
+    gint64 range_end, GstUriDownloaderDataFunc func, gpointer user_data,
+    GError ** err)
 {
   GstStateChangeReturn ret;
   GstFragment *download = NULL;
+  gchar *cache_key;
 
   GST_DEBUG_OBJECT (downloader, "Fetching URI %s", uri);
 
@@ -461,12 +806,40 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
   downloader->priv->err = NULL;
   downloader->priv->got_buffer = FALSE;
 
+  cache_key = gst_uri_downloader_get_cache_key (uri, range_start, range_end);
+
   GST_OBJECT_LOCK (downloader);
   if (downloader->priv->cancelled) {
     GST_DEBUG_OBJECT (downloader, "Cancelled, aborting fetch");
     goto quit;
   }
 
+  if (allow_cache && !refresh) {
+    GstBuffer *buffer = NULL;
+
+    download = gst_uri_downloader_cache_lookup (downloader, cache_key,
+        func ? &buffer : NULL);
+    if (download) {
+      GST_INFO_OBJECT (downloader, "URI %s fetched from cache", uri);
+      GST_OBJECT_UNLOCK (downloader);
+      if (func && !func (downloader, buffer, user_data)) {
+        g_object_unref (download);
+        download = NULL;
+        g_set_error (err, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+            "Download of '%s' cancelled", uri);
+      }
+      g_free (cache_key);
+      g_mutex_unlock (&downloader->priv->download_lock);
+      return download;
+    }
+  }
+
+  downloader->priv->data_func = func;
+  downloader->priv->data_func_user_data = user_data;
+  downloader->priv->cache_streamed = func && allow_cache && !refresh;
+  downloader->priv->cache_max_age = -1;
+  downloader->priv->cache_forbidden = FALSE;
+
   if (!gst_uri_downloader_set_uri (downloader, uri, referer, compress, refresh,
           allow_cache)) {
     GST_WARNING_OBJECT (downloader, "Failed to set URI");
@@ -573,6 +946,24 @@ quit:
         }
         gst_query_unref (query);
         gst_element_set_state (urisrc, GST_STATE_READY);
+
+        /* Only cache what the server explicitly allows to be kept for a
+         * while, refreshing fetches are never served from the cache */
+        if (allow_cache && !refresh && !downloader->priv->cache_forbidden
+            && downloader->priv->cache_max_age > 0) {
+          GstBuffer *buffer;
+
+          if (func) {
+            buffer = downloader->priv->cache_buffer;
+            downloader->priv->cache_buffer = NULL;
+          } else {
+            buffer = gst_fragment_get_buffer (download);
+          }
+
+          if (buffer)
+            gst_uri_downloader_cache_store (downloader, cache_key, download,
+                buffer, downloader->priv->cache_max_age);
+        }
       }
       GST_OBJECT_LOCK (downloader);
       gst_element_set_bus (urisrc, NULL);
@@ -597,6 +988,11 @@ quit:
     }
 
     downloader->priv->cancelled = FALSE;
+    downloader->priv->data_func = NULL;
+    downloader->priv->data_func_user_data = NULL;
+    downloader->priv->cache_streamed = FALSE;
+    gst_buffer_replace (&downloader->priv->cache_buffer, NULL);
+    g_free (cache_key);
 
     g_mutex_unlock (&downloader->priv->download_lock);
     return download;
@@ -43,6 +43,8 @@ typedef struct _GstUriDownloader GstUriDownloader;
 typedef struct _GstUriDownloaderPrivate GstUriDownloaderPrivate;
 typedef struct _GstUriDownloaderClass GstUriDownloaderClass;
 
+typedef gboolean (*GstUriDownloaderDataFunc) (GstUriDownloader * downloader, GstBuffer * buffer, gpointer user_data);
+
 struct _GstUriDownloader
 {
   GstObject parent;
@@ -63,6 +65,7 @@ GType gst_uri_downloader_get_type (void);
 GstUriDownloader * gst_uri_downloader_new (void);
 GstFragment * gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, GError ** err);
 GstFragment * gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, gint64 range_start, gint64 range_end, GError ** err);
+GstFragment * gst_uri_downloader_fetch_uri_streaming (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, gint64 range_start, gint64 range_end, GstUriDownloaderDataFunc func, gpointer user_data, GError ** err);
 void gst_uri_downloader_reset (GstUriDownloader *downloader);
 void gst_uri_downloader_cancel (GstUriDownloader *downloader);
 void gst_uri_downloader_free (GstUriDownloader *downloader);
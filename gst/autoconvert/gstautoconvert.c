@@ -139,6 +139,21 @@ static GQuark internal_srcpad_quark = 0;
 static GQuark internal_sinkpad_quark = 0;
 static GQuark parent_quark = 0;
 
+/* Process-wide caches shared by all instances, protected by cache_lock and
+ * reset whenever the registry's feature list changes:
+ * - the sorted list of all usable factories
+ * - the factory that was selected for a given factory list, sink caps and
+ *   downstream caps */
+static GMutex cache_lock;
+static guint32 cache_cookie;
+static GList *cached_factories = NULL;
+static GHashTable *cached_decisions = NULL;
+
+/* Upper bound for the number of remembered decisions, the table is emptied
+ * when it is reached so that streams with ever changing caps don't grow it
+ * without limit */
+#define MAX_CACHED_DECISIONS 64
+
 G_DEFINE_TYPE (GstAutoConvert, gst_auto_convert, GST_TYPE_BIN);
 
 static void
@@ -692,6 +707,103 @@ gst_auto_convert_iterate_internal_links (GstPad * pad, GstObject * parent)
   return it;
 }
 
+/* Must be called with cache_lock held */
+static void
+gst_auto_convert_validate_cache (void)
+{
+  guint32 cookie = gst_registry_get_feature_list_cookie (gst_registry_get ());
+
+  if (cookie == cache_cookie && cached_decisions)
+    return;
+
+  if (cached_factories) {
+    gst_plugin_feature_list_free (cached_factories);
+    cached_factories = NULL;
+  }
+
+  if (cached_decisions)
+    g_hash_table_remove_all (cached_decisions);
+  else
+    cached_decisions = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, g_free);
+
+  cache_cookie = cookie;
+}
+
+static gchar *
+gst_auto_convert_make_cache_key (GList * factories, GstCaps * caps,
+    GstCaps * other_caps)
+{
+  GString *key = g_string_new (NULL);
+  GList *elem;
+  gchar *str;
+
+  for (elem = factories; elem; elem = g_list_next (elem)) {
+    g_string_append (key,
+        gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (elem->data)));
+    g_string_append_c (key, ',');
+  }
+
+  str = gst_caps_to_string (caps);
+  g_string_append_printf (key, "|%s|", str);
+  g_free (str);
+
+  if (other_caps) {
+    str = gst_caps_to_string (other_caps);
+    g_string_append (key, str);
+    g_free (str);
+  }
+
+  return g_string_free (key, FALSE);
+}
+
+static gchar *
+gst_auto_convert_lookup_decision (const gchar * key)
+{
+  gchar *name;
+
+  g_mutex_lock (&cache_lock);
+  gst_auto_convert_validate_cache ();
+  name = g_strdup (g_hash_table_lookup (cached_decisions, key));
+  g_mutex_unlock (&cache_lock);
+
+  return name;
+}
+
+static void
+gst_auto_convert_store_decision (const gchar * key, const gchar * name)
+{
+  g_mutex_lock (&cache_lock);
+  gst_auto_convert_validate_cache ();
+  if (name) {
+    if (g_hash_table_size (cached_decisions) >= MAX_CACHED_DECISIONS)
+      g_hash_table_remove_all (cached_decisions);
+    g_hash_table_insert (cached_decisions, g_strdup (key), g_strdup (name));
+  } else
+    g_hash_table_remove (cached_decisions, key);
+  g_mutex_unlock (&cache_lock);
+}
+
+/* Tries to make @factory the current child, returns TRUE on success */
+static gboolean
+gst_auto_convert_try_factory (GstAutoConvert * autoconvert,
+    GstElementFactory * factory, GstCaps * caps)
+{
+  GstElement *element;
+
+  element =
+      gst_auto_convert_get_or_make_element_from_factory (autoconvert, factory);
+  if (!element)
+    return FALSE;
+
+  /* And make it the current child */
+  if (gst_auto_convert_activate_element (autoconvert, element, caps))
+    return TRUE;
+
+  gst_object_unref (element);
+  return FALSE;
+}
+
 /*
  * If there is already an internal element, it will try to call set_caps on it
  *
@@ -707,6 +819,7 @@ gst_auto_convert_sink_setcaps (GstAutoConvert * autoconvert, GstCaps * caps)
   GstCaps *other_caps = NULL;
   GList *factories;
   GstCaps *current_caps;
+  gchar *key, *cached_name;
 
   g_return_val_if_fail (autoconvert != NULL, FALSE);
 
@@ -747,9 +860,35 @@ gst_auto_convert_sink_setcaps (GstAutoConvert * autoconvert, GstCaps * caps)
   if (!factories)
     factories = gst_auto_convert_load_factories (autoconvert);
 
+  /* Try the factory that won for the same caps before, in this or any other
+   * instance, to avoid the trial and error below */
+  key = gst_auto_convert_make_cache_key (factories, caps, other_caps);
+  cached_name = gst_auto_convert_lookup_decision (key);
+  if (cached_name) {
+    for (elem = factories; elem; elem = g_list_next (elem)) {
+      GstElementFactory *factory = GST_ELEMENT_FACTORY (elem->data);
+
+      if (strcmp (gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)),
+              cached_name) != 0)
+        continue;
+
+      if (gst_auto_convert_try_factory (autoconvert, factory, caps)) {
+        GST_DEBUG_OBJECT (autoconvert, "Using cached factory %s for caps %"
+            GST_PTR_FORMAT, cached_name, caps);
+        g_free (cached_name);
+        g_free (key);
+        goto get_out;
+      }
+      break;
+    }
+
+    GST_DEBUG_OBJECT (autoconvert, "Cached factory %s failed", cached_name);
+    gst_auto_convert_store_decision (key, NULL);
+    g_free (cached_name);
+  }
+
   for (elem = factories; elem; elem = g_list_next (elem)) {
     GstElementFactory *factory = GST_ELEMENT_FACTORY (elem->data);
-    GstElement *element;
 
     /* Lets first check if according to the static pad templates on the factory
      * these caps have any chance of success
@@ -772,18 +911,13 @@ gst_auto_convert_sink_setcaps (GstAutoConvert * autoconvert, GstCaps * caps)
     }
 
     /* The element had a chance of success, lets make it */
-    element =
-        gst_auto_convert_get_or_make_element_from_factory (autoconvert,
-        factory);
-    if (!element)
-      continue;
-
-    /* And make it the current child */
-    if (gst_auto_convert_activate_element (autoconvert, element, caps))
+    if (gst_auto_convert_try_factory (autoconvert, factory, caps)) {
+      gst_auto_convert_store_decision (key,
+          gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)));
       break;
-    else
-      gst_object_unref (element);
+    }
   }
+  g_free (key);
 
 get_out:
   if (other_caps)
@@ -880,15 +1014,23 @@ gst_auto_convert_load_factories (GstAutoConvert * autoconvert)
 {
   GList *all_factories;
 
-  all_factories =
-      gst_registry_feature_filter (gst_registry_get (),
-      gst_auto_convert_default_filter_func, FALSE, NULL);
+  /* Walking the registry is expensive, share the result between instances */
+  g_mutex_lock (&cache_lock);
+  gst_auto_convert_validate_cache ();
+  if (!cached_factories) {
+    cached_factories =
+        gst_registry_feature_filter (gst_registry_get (),
+        gst_auto_convert_default_filter_func, FALSE, NULL);
 
-  all_factories = g_list_sort (all_factories, (GCompareFunc) compare_ranks);
+    cached_factories =
+        g_list_sort (cached_factories, (GCompareFunc) compare_ranks);
+  }
+  all_factories = gst_plugin_feature_list_copy (cached_factories);
+  g_mutex_unlock (&cache_lock);
 
   g_assert (all_factories);
 
-  if (g_atomic_pointer_compare_and_exchange (&autoconvert->factories, NULL,
+  if (!g_atomic_pointer_compare_and_exchange (&autoconvert->factories, NULL,
           all_factories)) {
     gst_plugin_feature_list_free (all_factories);
   }
@@ -25,6 +25,24 @@
  * SECTION:element-bayer2rgb
  *
  * Decodes raw camera bayer (fourcc BA81) to RGB.
+ *
+ * Besides 8 bit bayer, 10, 12, 14 and 16 bit samples in either byte order
+ * are accepted (formats like bggr12le). Those can be output without losing
+ * precision as ARGB64, or as YUV when the output caps ask for it, which
+ * saves a conversion afterwards.
+ *
+ * The default bilinear demosaicing is the fastest. The malvar method uses
+ * the gradient-corrected 5x5 filters of Malvar, He and Cutler, which give
+ * visibly sharper edges with fewer color fringes.
+ *
+ * Frames are demosaiced in stripes on #GstBayer2RGB:n-threads threads.
+ *
+ * Sample pipeline:
+ * |[
+ * gst-launch-1.0 filesrc location=raw.bayer blocksize=16588800 ! \
+ *   video/x-bayer,format=rggb12le,width=3840,height=2160,framerate=60/1 ! \
+ *   bayer2rgb method=malvar ! video/x-raw,format=I420 ! fakesink
+ * ]| This pipeline demosaics 12 bit 4K bayer straight to I420.
  */
 
 /*
@@ -83,6 +101,10 @@
 #include <_stdint.h>
 #include "gstbayerorc.h"
 
+#if HAVE_CPU_X86_64
+#include <emmintrin.h>
+#endif
+
 #define GST_CAT_DEFAULT gst_bayer2rgb_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
@@ -94,6 +116,12 @@ enum
   GST_BAYER_2_RGB_FORMAT_RGGB
 };
 
+typedef enum
+{
+  GST_BAYER_2_RGB_METHOD_BILINEAR = 0,
+  GST_BAYER_2_RGB_METHOD_MALVAR
+} GstBayer2RGBMethod;
+
 
 #define GST_TYPE_BAYER2RGB            (gst_bayer2rgb_get_type())
 #define GST_BAYER2RGB(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_BAYER2RGB,GstBayer2RGB))
@@ -106,6 +134,10 @@ typedef struct _GstBayer2RGBClass GstBayer2RGBClass;
 
 typedef void (*GstBayer2RGBProcessFunc) (GstBayer2RGB *, guint8 *, guint);
 
+/* writes @n_rows demosaiced lines starting at line @y of the output */
+typedef void (*GstBayer2RGBWriteFunc) (GstBayer2RGB *, GstVideoFrame *,
+    gint y, guint16 ** r, guint16 ** g, guint16 ** b, gint n_rows);
+
 struct _GstBayer2RGB
 {
   GstBaseTransform basetransform;
@@ -118,6 +150,27 @@ struct _GstBayer2RGB
   int g_off;                    /* offset for green */
   int b_off;                    /* offset for blue */
   int format;
+  int bpp;                      /* bits per bayer sample */
+  gboolean big_endian;          /* byte order of samples above 8 bits */
+  int src_stride;
+  int x_red;                    /* column parity of the red samples */
+  int y_red;                    /* line parity of the red samples */
+  gint yuv_matrix[3][4];        /* RGB to YUV in 20 bit fixed point */
+  GstBayer2RGBWriteFunc write;
+
+  GstBayer2RGBMethod method;
+  guint n_threads;
+
+  /* stripe threading */
+  GThreadPool *pool;
+  GMutex stripe_lock;
+  GCond stripe_cond;
+  guint stripes_pending;
+  guint n_stripes;
+  gboolean use_orc;
+  GstBayer2RGBMethod frame_method;
+  const guint8 *src;
+  GstVideoFrame *frame;
 };
 
 struct _GstBayer2RGBClass
@@ -125,17 +178,58 @@ struct _GstBayer2RGBClass
   GstBaseTransformClass parent;
 };
 
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define HIGH_DEPTH_YUV "I420_10LE"
+#else
+#define HIGH_DEPTH_YUV "I420_10BE"
+#endif
+
 #define	SRC_CAPS                                 \
-  GST_VIDEO_CAPS_MAKE ("{ RGBx, xRGB, BGRx, xBGR, RGBA, ARGB, BGRA, ABGR }")
+  GST_VIDEO_CAPS_MAKE ("{ RGBx, xRGB, BGRx, xBGR, RGBA, ARGB, BGRA, ABGR, " \
+      "ARGB64, I420, YV12, NV12, NV21, Y444, " HIGH_DEPTH_YUV " }")
+
+#define HIGH_DEPTH_FORMATS(depth) \
+  "bggr" depth "le,grbg" depth "le,gbrg" depth "le,rggb" depth "le," \
+  "bggr" depth "be,grbg" depth "be,gbrg" depth "be,rggb" depth "be"
 
-#define SINK_CAPS "video/x-bayer,format=(string){bggr,grbg,gbrg,rggb}," \
+#define SINK_FORMATS "{bggr,grbg,gbrg,rggb," HIGH_DEPTH_FORMATS ("10") "," \
+  HIGH_DEPTH_FORMATS ("12") "," HIGH_DEPTH_FORMATS ("14") "," \
+  HIGH_DEPTH_FORMATS ("16") "}"
+
+#define SINK_CAPS "video/x-bayer,format=(string)" SINK_FORMATS "," \
   "width=(int)[1,MAX],height=(int)[1,MAX],framerate=(fraction)[0/1,MAX]"
 
+#define DEFAULT_METHOD GST_BAYER_2_RGB_METHOD_BILINEAR
+#define DEFAULT_N_THREADS 0
+
+/* stripes smaller than this are not worth a thread */
+#define MIN_STRIPE_HEIGHT 16
+
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_METHOD,
+  PROP_N_THREADS
 };
 
+#define GST_TYPE_BAYER_2_RGB_METHOD (gst_bayer2rgb_method_get_type ())
+static GType
+gst_bayer2rgb_method_get_type (void)
+{
+  static GType method_type = 0;
+  static const GEnumValue methods[] = {
+    {GST_BAYER_2_RGB_METHOD_BILINEAR, "Bilinear interpolation", "bilinear"},
+    {GST_BAYER_2_RGB_METHOD_MALVAR,
+        "Gradient-corrected interpolation (Malvar-He-Cutler)", "malvar"},
+    {0, NULL, NULL},
+  };
+
+  if (!method_type) {
+    method_type = g_enum_register_static ("GstBayer2RGBMethod", methods);
+  }
+  return method_type;
+}
+
 GType gst_bayer2rgb_get_type (void);
 
 #define gst_bayer2rgb_parent_class parent_class
@@ -145,11 +239,13 @@ static void gst_bayer2rgb_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_bayer2rgb_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static void gst_bayer2rgb_finalize (GObject * object);
 
 static gboolean gst_bayer2rgb_set_caps (GstBaseTransform * filter,
     GstCaps * incaps, GstCaps * outcaps);
 static GstFlowReturn gst_bayer2rgb_transform (GstBaseTransform * base,
     GstBuffer * inbuf, GstBuffer * outbuf);
+static gboolean gst_bayer2rgb_stop (GstBaseTransform * base);
 static void gst_bayer2rgb_reset (GstBayer2RGB * filter);
 static GstCaps *gst_bayer2rgb_transform_caps (GstBaseTransform * base,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter);
@@ -168,6 +264,17 @@ gst_bayer2rgb_class_init (GstBayer2RGBClass * klass)
 
   gobject_class->set_property = gst_bayer2rgb_set_property;
   gobject_class->get_property = gst_bayer2rgb_get_property;
+  gobject_class->finalize = gst_bayer2rgb_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_METHOD,
+      g_param_spec_enum ("method", "Method", "Demosaicing method",
+          GST_TYPE_BAYER_2_RGB_METHOD, DEFAULT_METHOD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to demosaic each frame with, "
+          "0 means one per CPU", 0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (gstelement_class,
       "Bayer to RGB decoder for cameras", "Filter/Converter/Video",
@@ -189,6 +296,8 @@ gst_bayer2rgb_class_init (GstBayer2RGBClass * klass)
       GST_DEBUG_FUNCPTR (gst_bayer2rgb_set_caps);
   GST_BASE_TRANSFORM_CLASS (klass)->transform =
       GST_DEBUG_FUNCPTR (gst_bayer2rgb_transform);
+  GST_BASE_TRANSFORM_CLASS (klass)->stop =
+      GST_DEBUG_FUNCPTR (gst_bayer2rgb_stop);
 
   GST_DEBUG_CATEGORY_INIT (gst_bayer2rgb_debug, "bayer2rgb", 0,
       "bayer2rgb element");
@@ -197,17 +306,43 @@ gst_bayer2rgb_class_init (GstBayer2RGBClass * klass)
 static void
 gst_bayer2rgb_init (GstBayer2RGB * filter)
 {
+  filter->method = DEFAULT_METHOD;
+  filter->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&filter->stripe_lock);
+  g_cond_init (&filter->stripe_cond);
+
   gst_bayer2rgb_reset (filter);
   gst_base_transform_set_in_place (GST_BASE_TRANSFORM (filter), TRUE);
 }
 
-/* No properties are implemented, so only a warning is produced */
+static void
+gst_bayer2rgb_finalize (GObject * object)
+{
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
+
+  g_mutex_clear (&filter->stripe_lock);
+  g_cond_clear (&filter->stripe_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_bayer2rgb_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
 
   switch (prop_id) {
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (filter);
+      filter->method = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (filter);
+      filter->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -218,14 +353,143 @@ static void
 gst_bayer2rgb_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
 
   switch (prop_id) {
+    case PROP_METHOD:
+      g_value_set_enum (value, filter->method);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* Parses a bayer format like bggr or rggb12le, @bpp is the sample depth */
+static gboolean
+gst_bayer2rgb_parse_format (const gchar * format, int *order, int *bpp,
+    gboolean * big_endian)
+{
+  const gchar *suffix;
+  gchar *end;
+
+  if (format == NULL || strlen (format) < 4)
+    return FALSE;
+
+  if (g_str_has_prefix (format, "bggr")) {
+    *order = GST_BAYER_2_RGB_FORMAT_BGGR;
+  } else if (g_str_has_prefix (format, "gbrg")) {
+    *order = GST_BAYER_2_RGB_FORMAT_GBRG;
+  } else if (g_str_has_prefix (format, "grbg")) {
+    *order = GST_BAYER_2_RGB_FORMAT_GRBG;
+  } else if (g_str_has_prefix (format, "rggb")) {
+    *order = GST_BAYER_2_RGB_FORMAT_RGGB;
+  } else {
+    return FALSE;
+  }
+
+  suffix = format + 4;
+  if (*suffix == '\0') {
+    *bpp = 8;
+    *big_endian = FALSE;
+    return TRUE;
+  }
+
+  *bpp = g_ascii_strtoull (suffix, &end, 10);
+  if (*bpp <= 8 || *bpp > 16)
+    return FALSE;
+
+  if (g_str_equal (end, "le"))
+    *big_endian = FALSE;
+  else if (g_str_equal (end, "be"))
+    *big_endian = TRUE;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+gst_bayer2rgb_get_Kr_Kb (GstVideoColorMatrix matrix, gdouble * Kr,
+    gdouble * Kb)
+{
+  switch (matrix) {
+    case GST_VIDEO_COLOR_MATRIX_FCC:
+      *Kr = 0.30;
+      *Kb = 0.11;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_BT709:
+      *Kr = 0.2126;
+      *Kb = 0.0722;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_SMPTE240M:
+      *Kr = 0.212;
+      *Kb = 0.087;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_BT601:
+    default:
+      *Kr = 0.299;
+      *Kb = 0.114;
+      break;
+  }
+}
+
+/* Sets up the conversion from full range RGB of the bayer depth to the YUV
+ * codes of the output, the results fit 31 bits for output up to 10 bits */
+static void
+gst_bayer2rgb_setup_yuv_matrix (GstBayer2RGB * bayer2rgb)
+{
+  GstVideoInfo *info = &bayer2rgb->info;
+  gint depth = GST_VIDEO_INFO_COMP_DEPTH (info, 0);
+  gdouble in_max = (1 << bayer2rgb->bpp) - 1;
+  gdouble scale = 1 << (depth - 8);
+  gdouble Kr, Kb, Kg, y_scale, c_scale, y_off;
+  gdouble m[3][3];
+  gint i, j;
+
+  gst_bayer2rgb_get_Kr_Kb (info->colorimetry.matrix, &Kr, &Kb);
+  Kg = 1.0 - Kr - Kb;
+
+  if (info->colorimetry.range == GST_VIDEO_COLOR_RANGE_0_255) {
+    y_scale = c_scale = ((1 << depth) - 1) / in_max;
+    y_off = 0;
+  } else {
+    y_scale = 219 * scale / in_max;
+    c_scale = 224 * scale / in_max;
+    y_off = 16 * scale;
+  }
+
+  m[0][0] = Kr * y_scale;
+  m[0][1] = Kg * y_scale;
+  m[0][2] = Kb * y_scale;
+  m[1][0] = -Kr / (2 * (1 - Kb)) * c_scale;
+  m[1][1] = -Kg / (2 * (1 - Kb)) * c_scale;
+  m[1][2] = 0.5 * c_scale;
+  m[2][0] = 0.5 * c_scale;
+  m[2][1] = -Kg / (2 * (1 - Kr)) * c_scale;
+  m[2][2] = -Kb / (2 * (1 - Kr)) * c_scale;
+
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++)
+      bayer2rgb->yuv_matrix[i][j] = m[i][j] * (1 << 20) + 0.5;
+    bayer2rgb->yuv_matrix[i][3] = (i == 0 ? y_off : 128 * scale) * (1 << 20)
+        + (1 << 19);
+  }
+}
+
+static void gst_bayer2rgb_write_rgb8 (GstBayer2RGB * bayer2rgb,
+    GstVideoFrame * frame, gint y, guint16 ** r, guint16 ** g, guint16 ** b,
+    gint n_rows);
+static void gst_bayer2rgb_write_rgb16 (GstBayer2RGB * bayer2rgb,
+    GstVideoFrame * frame, gint y, guint16 ** r, guint16 ** g, guint16 ** b,
+    gint n_rows);
+static void gst_bayer2rgb_write_yuv (GstBayer2RGB * bayer2rgb,
+    GstVideoFrame * frame, gint y, guint16 ** r, guint16 ** g, guint16 ** b,
+    gint n_rows);
+
 static gboolean
 gst_bayer2rgb_set_caps (GstBaseTransform * base, GstCaps * incaps,
     GstCaps * outcaps)
@@ -244,26 +508,35 @@ gst_bayer2rgb_set_caps (GstBaseTransform * base, GstCaps * incaps,
   gst_structure_get_int (structure, "height", &bayer2rgb->height);
 
   format = gst_structure_get_string (structure, "format");
-  if (g_str_equal (format, "bggr")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_BGGR;
-  } else if (g_str_equal (format, "gbrg")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_GBRG;
-  } else if (g_str_equal (format, "grbg")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_GRBG;
-  } else if (g_str_equal (format, "rggb")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_RGGB;
-  } else {
+  if (!gst_bayer2rgb_parse_format (format, &bayer2rgb->format,
+          &bayer2rgb->bpp, &bayer2rgb->big_endian))
     return FALSE;
-  }
+
+  bayer2rgb->src_stride =
+      GST_ROUND_UP_4 (bayer2rgb->width * (bayer2rgb->bpp > 8 ? 2 : 1));
+  bayer2rgb->x_red = (bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_BGGR ||
+      bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_GRBG);
+  bayer2rgb->y_red = (bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_BGGR ||
+      bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_GBRG);
 
   /* To cater for different RGB formats, we need to set params for later */
-  gst_video_info_from_caps (&info, outcaps);
+  if (!gst_video_info_from_caps (&info, outcaps))
+    return FALSE;
   bayer2rgb->r_off = GST_VIDEO_INFO_COMP_OFFSET (&info, 0);
   bayer2rgb->g_off = GST_VIDEO_INFO_COMP_OFFSET (&info, 1);
   bayer2rgb->b_off = GST_VIDEO_INFO_COMP_OFFSET (&info, 2);
 
   bayer2rgb->info = info;
 
+  if (GST_VIDEO_INFO_IS_YUV (&info)) {
+    gst_bayer2rgb_setup_yuv_matrix (bayer2rgb);
+    bayer2rgb->write = gst_bayer2rgb_write_yuv;
+  } else if (GST_VIDEO_INFO_COMP_DEPTH (&info, 0) > 8) {
+    bayer2rgb->write = gst_bayer2rgb_write_rgb16;
+  } else {
+    bayer2rgb->write = gst_bayer2rgb_write_rgb8;
+  }
+
   return TRUE;
 }
 
@@ -275,9 +548,26 @@ gst_bayer2rgb_reset (GstBayer2RGB * filter)
   filter->r_off = 0;
   filter->g_off = 0;
   filter->b_off = 0;
+  filter->bpp = 8;
+  filter->big_endian = FALSE;
+  filter->src_stride = 0;
+  filter->write = NULL;
   gst_video_info_init (&filter->info);
 }
 
+static gboolean
+gst_bayer2rgb_stop (GstBaseTransform * base)
+{
+  GstBayer2RGB *filter = GST_BAYER2RGB (base);
+
+  if (filter->pool) {
+    g_thread_pool_free (filter->pool, FALSE, TRUE);
+    filter->pool = NULL;
+  }
+
+  return TRUE;
+}
+
 static GstCaps *
 gst_bayer2rgb_transform_caps (GstBaseTransform * base,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter)
@@ -292,7 +582,7 @@ gst_bayer2rgb_transform_caps (GstBaseTransform * base,
 
   if (direction == GST_PAD_SRC) {
     newcaps = gst_caps_from_string ("video/x-bayer,"
-        "format=(string){bggr,grbg,gbrg,rggb}");
+        "format=(string)" SINK_FORMATS);
   } else {
     newcaps = gst_caps_new_empty_simple ("video/x-raw");
   }
@@ -336,12 +626,22 @@ gst_bayer2rgb_get_unit_size (GstBaseTransform * base, GstCaps * caps,
     name = gst_structure_get_name (structure);
     /* Our name must be either video/x-bayer video/x-raw */
     if (strcmp (name, "video/x-raw")) {
-      *size = GST_ROUND_UP_4 (width) * height;
+      int order, bpp;
+      gboolean big_endian;
+
+      if (!gst_bayer2rgb_parse_format (gst_structure_get_string (structure,
+                  "format"), &order, &bpp, &big_endian))
+        bpp = 8;
+      *size = GST_ROUND_UP_4 (width * (bpp > 8 ? 2 : 1)) * height;
       return TRUE;
     } else {
-      /* For output, calculate according to format (always 32 bits) */
-      *size = width * height * 4;
-      return TRUE;
+      GstVideoInfo info;
+
+      /* For output, calculate according to format */
+      if (gst_video_info_from_caps (&info, caps)) {
+        *size = GST_VIDEO_INFO_SIZE (&info);
+        return TRUE;
+      }
     }
 
   }
@@ -383,9 +683,12 @@ typedef void (*process_func) (guint8 * d0, const guint8 * s0, const guint8 * s1,
     const guint8 * s2, const guint8 * s3, const guint8 * s4, const guint8 * s5,
     int n);
 
+/* Bilinear demosaicing of 8 bit bayer to 8 bit RGB with the ORC kernels,
+ * for the lines @y_start to @y_end */
 static void
 gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
-    int dest_stride, uint8_t * src, int src_stride)
+    int dest_stride, const uint8_t * src, int src_stride, int y_start,
+    int y_end)
 {
   int j;
   guint8 *tmp;
@@ -428,17 +731,20 @@ gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
   tmp = g_malloc (2 * 4 * bayer2rgb->width);
 #define LINE(x) (tmp + ((x)&7) * bayer2rgb->width)
 
-  gst_bayer2rgb_split_and_upsample_horiz (LINE (3 * 2 + 0), LINE (3 * 2 + 1),
-      src + 1 * src_stride, bayer2rgb->width);
-  j = 0;
+  /* the line above the stripe, mirrored at the top of the frame */
+  j = y_start > 0 ? y_start - 1 : MIN (1, bayer2rgb->height - 1);
+  gst_bayer2rgb_split_and_upsample_horiz (LINE (y_start * 2 - 2),
+      LINE (y_start * 2 - 1), src + j * src_stride, bayer2rgb->width);
+  j = y_start;
   gst_bayer2rgb_split_and_upsample_horiz (LINE (j * 2 + 0), LINE (j * 2 + 1),
       src + j * src_stride, bayer2rgb->width);
 
-  for (j = 0; j < bayer2rgb->height; j++) {
-    if (j < bayer2rgb->height - 1) {
-      gst_bayer2rgb_split_and_upsample_horiz (LINE ((j + 1) * 2 + 0),
-          LINE ((j + 1) * 2 + 1), src + (j + 1) * src_stride, bayer2rgb->width);
-    }
+  for (j = y_start; j < y_end; j++) {
+    /* the line below, mirrored at the bottom of the frame */
+    int below = j < bayer2rgb->height - 1 ? j + 1 : MAX (j - 1, 0);
+
+    gst_bayer2rgb_split_and_upsample_horiz (LINE ((j + 1) * 2 + 0),
+        LINE ((j + 1) * 2 + 1), src + below * src_stride, bayer2rgb->width);
 
     merge[j & 1] (dest + j * dest_stride,
         LINE (j * 2 - 2), LINE (j * 2 - 1),
@@ -449,8 +755,431 @@ gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
   g_free (tmp);
 }
 
+static inline int
+gst_bayer2rgb_mirror (int i, int n)
+{
+  if (i < 0)
+    i = -i;
+  if (i >= n)
+    i = 2 * (n - 1) - i;
+  return CLAMP (i, 0, n - 1);
+}
+
+/* Returns line @y of the bayer image as native 16 bit samples, mirrored
+ * by 2 samples on either side so the filters need no edge cases. Lines are
+ * cached in a ring of 5, the most any filter looks at */
+static const guint16 *
+gst_bayer2rgb_get_line (GstBayer2RGB * bayer2rgb, const guint8 * src,
+    guint16 ** lines, int *line_y, int y)
+{
+  int slot = (y + 5) % 5;
+  int width = bayer2rgb->width;
+  int max = (1 << bayer2rgb->bpp) - 1;
+  const guint8 *s;
+  guint16 *d;
+  int x;
+
+  d = lines[slot] + 2;
+  if (line_y[slot] == y)
+    return d;
+
+  s = src + gst_bayer2rgb_mirror (y, bayer2rgb->height) * bayer2rgb->src_stride;
+  if (bayer2rgb->bpp == 8) {
+    for (x = 0; x < width; x++)
+      d[x] = s[x];
+  } else if (bayer2rgb->big_endian) {
+    for (x = 0; x < width; x++)
+      d[x] = MIN (GST_READ_UINT16_BE (s + 2 * x), max);
+  } else {
+    for (x = 0; x < width; x++)
+      d[x] = MIN (GST_READ_UINT16_LE (s + 2 * x), max);
+  }
+
+  d[-2] = d[gst_bayer2rgb_mirror (-2, width)];
+  d[-1] = d[gst_bayer2rgb_mirror (-1, width)];
+  d[width] = d[gst_bayer2rgb_mirror (width, width)];
+  d[width + 1] = d[gst_bayer2rgb_mirror (width + 1, width)];
+
+  line_y[slot] = y;
+
+  return d;
+}
+
+/* The filters below produce the color of the line (red on lines with red
+ * samples, blue otherwise) in @p, the other color in @q and green in @g.
+ * @l are the lines from 2 above to 2 below, the samples at odd/even
+ * (@cs) columns are red or blue */
+static void
+gst_bayer2rgb_bilinear_line (guint16 * p, guint16 * q, guint16 * g,
+    const guint16 ** l, int cs, int width)
+{
+  int x;
+
+  for (x = 0; x < width; x++) {
+    if ((x & 1) == cs) {
+      p[x] = l[2][x];
+      g[x] = (l[1][x] + l[3][x] + l[2][x - 1] + l[2][x + 1] + 2) >> 2;
+      q[x] = (l[1][x - 1] + l[1][x + 1] + l[3][x - 1] + l[3][x + 1] + 2) >> 2;
+    } else {
+      p[x] = (l[2][x - 1] + l[2][x + 1] + 1) >> 1;
+      q[x] = (l[1][x] + l[3][x] + 1) >> 1;
+      g[x] = l[2][x];
+    }
+  }
+}
+
+/* Malvar, He and Cutler, "High-quality linear interpolation for
+ * demosaicing of Bayer-patterned color images", ICASSP 2004: bilinear
+ * interpolation corrected by the laplacian of the known color. The filter
+ * weights are in 1/16 */
+static void
+gst_bayer2rgb_malvar_line_c (guint16 * p, guint16 * q, guint16 * g,
+    const guint16 ** l, int cs, int x_start, int width, int max)
+{
+  int x;
+
+  for (x = x_start; x < width; x++) {
+    int c = l[2][x];
+    int h = l[2][x - 1] + l[2][x + 1];
+    int v = l[1][x] + l[3][x];
+    int hh = l[2][x - 2] + l[2][x + 2];
+    int vv = l[0][x] + l[4][x];
+    int d = l[1][x - 1] + l[1][x + 1] + l[3][x - 1] + l[3][x + 1];
+
+    if ((x & 1) == cs) {
+      p[x] = c;
+      g[x] = CLAMP ((8 * c + 4 * (h + v) - 2 * (hh + vv) + 8) >> 4, 0, max);
+      q[x] = CLAMP ((12 * c + 4 * d - 3 * (hh + vv) + 8) >> 4, 0, max);
+    } else {
+      p[x] = CLAMP ((10 * c + 8 * h - 2 * hh - 2 * d + vv + 8) >> 4, 0, max);
+      q[x] = CLAMP ((10 * c + 8 * v - 2 * vv - 2 * d + hh + 8) >> 4, 0, max);
+      g[x] = c;
+    }
+  }
+}
+
+#if HAVE_CPU_X86_64
+static inline __m128i
+gst_bayer2rgb_load4 (const guint16 * s)
+{
+  return _mm_unpacklo_epi16 (_mm_loadl_epi64 ((const __m128i *) s),
+      _mm_setzero_si128 ());
+}
+
+static inline __m128i
+gst_bayer2rgb_select (__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b));
+}
+
+static inline __m128i
+gst_bayer2rgb_clamp (__m128i v, __m128i max)
+{
+  v = _mm_and_si128 (v, _mm_cmpgt_epi32 (v, _mm_setzero_si128 ()));
+  return gst_bayer2rgb_select (_mm_cmpgt_epi32 (v, max), max, v);
+}
+
+/* packs 8 values of up to 16 bits, SSE2 only has signed saturation */
+static inline __m128i
+gst_bayer2rgb_pack (__m128i a, __m128i b)
+{
+  const __m128i bias = _mm_set1_epi32 (32768);
+
+  return _mm_xor_si128 (_mm_packs_epi32 (_mm_sub_epi32 (a, bias),
+          _mm_sub_epi32 (b, bias)), _mm_set1_epi16 (-32768));
+}
+
+/* SSE2 version of gst_bayer2rgb_malvar_line_c() computing both the filters
+ * for red/blue and for green sites 4 samples at a time and selecting per
+ * column. Returns the number of samples done */
+static int
+gst_bayer2rgb_malvar_line_sse2 (guint16 * p, guint16 * q, guint16 * g,
+    const guint16 ** l, int cs, int width, int max)
+{
+  const __m128i vmax = _mm_set1_epi32 (max);
+  const __m128i round = _mm_set1_epi32 (8);
+  const __m128i chroma = cs ? _mm_set_epi32 (-1, 0, -1, 0) :
+      _mm_set_epi32 (0, -1, 0, -1);
+  __m128i vp[2], vq[2], vg[2];
+  int x, i;
+
+  for (x = 0; x + 8 <= width; x += 8) {
+    for (i = 0; i < 2; i++) {
+      int o = x + 4 * i;
+      __m128i c, h, v, hh, vv, d, far, c2, c8, t, cq, cg, gp, gq;
+
+      c = gst_bayer2rgb_load4 (l[2] + o);
+      h = _mm_add_epi32 (gst_bayer2rgb_load4 (l[2] + o - 1),
+          gst_bayer2rgb_load4 (l[2] + o + 1));
+      v = _mm_add_epi32 (gst_bayer2rgb_load4 (l[1] + o),
+          gst_bayer2rgb_load4 (l[3] + o));
+      hh = _mm_add_epi32 (gst_bayer2rgb_load4 (l[2] + o - 2),
+          gst_bayer2rgb_load4 (l[2] + o + 2));
+      vv = _mm_add_epi32 (gst_bayer2rgb_load4 (l[0] + o),
+          gst_bayer2rgb_load4 (l[4] + o));
+      d = _mm_add_epi32 (_mm_add_epi32 (gst_bayer2rgb_load4 (l[1] + o - 1),
+              gst_bayer2rgb_load4 (l[1] + o + 1)),
+          _mm_add_epi32 (gst_bayer2rgb_load4 (l[3] + o - 1),
+              gst_bayer2rgb_load4 (l[3] + o + 1)));
+      far = _mm_add_epi32 (hh, vv);
+      c2 = _mm_slli_epi32 (c, 1);
+      c8 = _mm_slli_epi32 (c, 3);
+
+      /* red/blue sites: 8c + 4(h + v) - 2far and 12c + 4d - 3far */
+      t = _mm_add_epi32 (c8, _mm_slli_epi32 (_mm_add_epi32 (h, v), 2));
+      t = _mm_sub_epi32 (t, _mm_slli_epi32 (far, 1));
+      cg = _mm_srai_epi32 (_mm_add_epi32 (t, round), 4);
+      t = _mm_add_epi32 (_mm_add_epi32 (c8, _mm_slli_epi32 (c, 2)),
+          _mm_slli_epi32 (d, 2));
+      t = _mm_sub_epi32 (t, _mm_add_epi32 (far, _mm_slli_epi32 (far, 1)));
+      cq = _mm_srai_epi32 (_mm_add_epi32 (t, round), 4);
+
+      /* green sites: 10c + 8h - 2hh - 2d + vv and the transposed */
+      t = _mm_add_epi32 (_mm_add_epi32 (c8, c2), _mm_slli_epi32 (h, 3));
+      t = _mm_sub_epi32 (t, _mm_slli_epi32 (_mm_add_epi32 (hh, d), 1));
+      gp = _mm_srai_epi32 (_mm_add_epi32 (_mm_add_epi32 (t, vv), round), 4);
+      t = _mm_add_epi32 (_mm_add_epi32 (c8, c2), _mm_slli_epi32 (v, 3));
+      t = _mm_sub_epi32 (t, _mm_slli_epi32 (_mm_add_epi32 (vv, d), 1));
+      gq = _mm_srai_epi32 (_mm_add_epi32 (_mm_add_epi32 (t, hh), round), 4);
+
+      vp[i] = gst_bayer2rgb_select (chroma, c,
+          gst_bayer2rgb_clamp (gp, vmax));
+      vq[i] = gst_bayer2rgb_clamp (gst_bayer2rgb_select (chroma, cq, gq),
+          vmax);
+      vg[i] = gst_bayer2rgb_select (chroma,
+          gst_bayer2rgb_clamp (cg, vmax), c);
+    }
+    _mm_storeu_si128 ((__m128i *) (p + x), gst_bayer2rgb_pack (vp[0], vp[1]));
+    _mm_storeu_si128 ((__m128i *) (q + x), gst_bayer2rgb_pack (vq[0], vq[1]));
+    _mm_storeu_si128 ((__m128i *) (g + x), gst_bayer2rgb_pack (vg[0], vg[1]));
+  }
+
+  return x;
+}
+#endif
+
+static void
+gst_bayer2rgb_demosaic_line (GstBayer2RGB * bayer2rgb,
+    GstBayer2RGBMethod method, const guint8 * src, guint16 ** lines,
+    int *line_y, int y, guint16 * r, guint16 * g, guint16 * b)
+{
+  gboolean red_line = (y & 1) == bayer2rgb->y_red;
+  int cs = red_line ? bayer2rgb->x_red : !bayer2rgb->x_red;
+  guint16 *p = red_line ? r : b;
+  guint16 *q = red_line ? b : r;
+  const guint16 *l[5];
+  int i, x = 0;
+
+  for (i = 0; i < 5; i++)
+    l[i] = gst_bayer2rgb_get_line (bayer2rgb, src, lines, line_y, y + i - 2);
+
+  if (method == GST_BAYER_2_RGB_METHOD_MALVAR) {
+#if HAVE_CPU_X86_64
+    x = gst_bayer2rgb_malvar_line_sse2 (p, q, g, l, cs, bayer2rgb->width,
+        (1 << bayer2rgb->bpp) - 1);
+#endif
+    gst_bayer2rgb_malvar_line_c (p, q, g, l, cs, x, bayer2rgb->width,
+        (1 << bayer2rgb->bpp) - 1);
+  } else {
+    gst_bayer2rgb_bilinear_line (p, q, g, l, cs, bayer2rgb->width);
+  }
+}
+
+static void
+gst_bayer2rgb_write_rgb8 (GstBayer2RGB * bayer2rgb, GstVideoFrame * frame,
+    gint y, guint16 ** r, guint16 ** g, guint16 ** b, gint n_rows)
+{
+  int shift = bayer2rgb->bpp - 8;
+  int r_off = bayer2rgb->r_off;
+  int g_off = bayer2rgb->g_off;
+  int b_off = bayer2rgb->b_off;
+  int a_off = 6 - r_off - g_off - b_off;
+  int i, x;
+
+  for (i = 0; i < n_rows; i++) {
+    guint8 *d = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+
+    d += (y + i) * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+    for (x = 0; x < bayer2rgb->width; x++) {
+      d[r_off] = r[i][x] >> shift;
+      d[g_off] = g[i][x] >> shift;
+      d[b_off] = b[i][x] >> shift;
+      d[a_off] = 0xff;
+      d += 4;
+    }
+  }
+}
+
+static void
+gst_bayer2rgb_write_rgb16 (GstBayer2RGB * bayer2rgb, GstVideoFrame * frame,
+    gint y, guint16 ** r, guint16 ** g, guint16 ** b, gint n_rows)
+{
+  /* scale to 16 bits by repeating the high bits in the low ones */
+  int shift = 16 - bayer2rgb->bpp;
+  int rshift = bayer2rgb->bpp - shift;
+  int r_off = bayer2rgb->r_off / 2;
+  int g_off = bayer2rgb->g_off / 2;
+  int b_off = bayer2rgb->b_off / 2;
+  int a_off = GST_VIDEO_FRAME_COMP_OFFSET (frame, 3) / 2;
+  int i, x;
+
+  for (i = 0; i < n_rows; i++) {
+    guint16 *d = (guint16 *) ((guint8 *) GST_VIDEO_FRAME_PLANE_DATA (frame,
+            0) + (y + i) * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0));
+
+    for (x = 0; x < bayer2rgb->width; x++) {
+      d[r_off] = (r[i][x] << shift) | (r[i][x] >> rshift);
+      d[g_off] = (g[i][x] << shift) | (g[i][x] >> rshift);
+      d[b_off] = (b[i][x] << shift) | (b[i][x] >> rshift);
+      d[a_off] = 0xffff;
+      d += 4;
+    }
+  }
+}
+
+static inline gint
+gst_bayer2rgb_yuv (const gint * m, gint r, gint g, gint b, gint max)
+{
+  return CLAMP ((m[0] * r + m[1] * g + m[2] * b + m[3]) >> 20, 0, max);
+}
+
+#define STORE_SAMPLE(data, pstride, x, depth, v) G_STMT_START { \
+  if ((depth) > 8) \
+    ((guint16 *) (data))[(x) * (pstride) / 2] = (v); \
+  else \
+    ((guint8 *) (data))[(x) * (pstride)] = (v); \
+} G_STMT_END
+
+/* Writes luma for every line and chroma from the average RGB of the
+ * samples it covers */
+static void
+gst_bayer2rgb_write_yuv (GstBayer2RGB * bayer2rgb, GstVideoFrame * frame,
+    gint y, guint16 ** r, guint16 ** g, guint16 ** b, gint n_rows)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  int wsub = GST_VIDEO_FORMAT_INFO_W_SUB (finfo, 1);
+  int hsub = GST_VIDEO_FORMAT_INFO_H_SUB (finfo, 1);
+  int depth = GST_VIDEO_FRAME_COMP_DEPTH (frame, 0);
+  int max = (1 << depth) - 1;
+  int width = bayer2rgb->width;
+  int pstride[3];
+  guint8 *d[3];
+  int i, c, x, cx, n;
+
+  for (i = 0; i < n_rows; i++) {
+    d[0] = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+    d[0] += (y + i) * GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+    pstride[0] = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 0);
+    for (x = 0; x < width; x++) {
+      STORE_SAMPLE (d[0], pstride[0], x, depth,
+          gst_bayer2rgb_yuv (bayer2rgb->yuv_matrix[0], r[i][x], g[i][x],
+              b[i][x], max));
+    }
+  }
+
+  for (c = 1; c < 3; c++) {
+    d[c] = GST_VIDEO_FRAME_COMP_DATA (frame, c);
+    d[c] += (y >> hsub) * GST_VIDEO_FRAME_COMP_STRIDE (frame, c);
+    pstride[c] = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, c);
+  }
+
+  for (cx = 0; cx < GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); cx++) {
+    int sr = 0, sg = 0, sb = 0;
+    int x_end = MIN ((cx + 1) << wsub, width);
+
+    n = 0;
+    for (i = 0; i < n_rows; i++) {
+      for (x = cx << wsub; x < x_end; x++) {
+        sr += r[i][x];
+        sg += g[i][x];
+        sb += b[i][x];
+        n++;
+      }
+    }
+    sr = (sr + n / 2) / n;
+    sg = (sg + n / 2) / n;
+    sb = (sb + n / 2) / n;
+
+    STORE_SAMPLE (d[1], pstride[1], cx, depth,
+        gst_bayer2rgb_yuv (bayer2rgb->yuv_matrix[1], sr, sg, sb, max));
+    STORE_SAMPLE (d[2], pstride[2], cx, depth,
+        gst_bayer2rgb_yuv (bayer2rgb->yuv_matrix[2], sr, sg, sb, max));
+  }
+}
+
+/* Demosaics the lines @y_start to @y_end with the C/SSE2 filters, a pair of
+ * lines at a time for vertically subsampled chroma */
+static void
+gst_bayer2rgb_process_generic (GstBayer2RGB * bayer2rgb,
+    GstBayer2RGBMethod method, GstVideoFrame * frame, const guint8 * src,
+    int y_start, int y_end)
+{
+  int width = bayer2rgb->width;
+  int n_rows = 1 << GST_VIDEO_FORMAT_INFO_H_SUB (frame->info.finfo, 1);
+  guint16 *tmp, *lines[5], *r[2], *g[2], *b[2];
+  int line_y[5];
+  int i, y;
+
+  tmp = g_malloc (sizeof (guint16) * (5 * (width + 4) + 6 * width));
+  for (i = 0; i < 5; i++) {
+    lines[i] = tmp + i * (width + 4);
+    line_y[i] = G_MININT;
+  }
+  for (i = 0; i < 2; i++) {
+    r[i] = tmp + 5 * (width + 4) + (3 * i + 0) * width;
+    g[i] = tmp + 5 * (width + 4) + (3 * i + 1) * width;
+    b[i] = tmp + 5 * (width + 4) + (3 * i + 2) * width;
+  }
+
+  for (y = y_start; y < y_end; y += n_rows) {
+    for (i = 0; i < n_rows && y + i < bayer2rgb->height; i++) {
+      gst_bayer2rgb_demosaic_line (bayer2rgb, method, src, lines, line_y,
+          y + i, r[i], g[i], b[i]);
+    }
+    bayer2rgb->write (bayer2rgb, frame, y, r, g, b, i);
+  }
+
+  g_free (tmp);
+}
+
+static void
+gst_bayer2rgb_process_stripe (GstBayer2RGB * bayer2rgb, guint stripe,
+    guint n_stripes)
+{
+  GstVideoFrame *frame = bayer2rgb->frame;
+  int height = bayer2rgb->height;
+  int y_start, y_end;
+
+  /* stripes start on even lines to keep subsampled chroma together */
+  y_start = (height * stripe / n_stripes) & ~1;
+  if (stripe + 1 == n_stripes)
+    y_end = height;
+  else
+    y_end = (height * (stripe + 1) / n_stripes) & ~1;
+
+  if (bayer2rgb->use_orc) {
+    gst_bayer2rgb_process (bayer2rgb, GST_VIDEO_FRAME_PLANE_DATA (frame, 0),
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0), bayer2rgb->src,
+        bayer2rgb->src_stride, y_start, y_end);
+  } else {
+    gst_bayer2rgb_process_generic (bayer2rgb, bayer2rgb->frame_method, frame,
+        bayer2rgb->src, y_start, y_end);
+  }
+}
+
+static void
+gst_bayer2rgb_stripe_func (gpointer data, gpointer user_data)
+{
+  GstBayer2RGB *bayer2rgb = user_data;
+  guint stripe = GPOINTER_TO_UINT (data) - 1;
 
+  gst_bayer2rgb_process_stripe (bayer2rgb, stripe, bayer2rgb->n_stripes);
 
+  g_mutex_lock (&bayer2rgb->stripe_lock);
+  if (--bayer2rgb->stripes_pending == 0)
+    g_cond_signal (&bayer2rgb->stripe_cond);
+  g_mutex_unlock (&bayer2rgb->stripe_lock);
+}
 
 static GstFlowReturn
 gst_bayer2rgb_transform (GstBaseTransform * base, GstBuffer * inbuf,
@@ -458,18 +1187,75 @@ gst_bayer2rgb_transform (GstBaseTransform * base, GstBuffer * inbuf,
 {
   GstBayer2RGB *filter = GST_BAYER2RGB (base);
   GstMapInfo map;
-  uint8_t *output;
   GstVideoFrame frame;
+  GstBayer2RGBMethod method;
+  guint n_threads, n_stripes, i;
 
   GST_DEBUG ("transforming buffer");
-  gst_buffer_map (inbuf, &map, GST_MAP_READ);
-  gst_video_frame_map (&frame, &filter->info, outbuf, GST_MAP_WRITE);
+  if (!gst_buffer_map (inbuf, &map, GST_MAP_READ))
+    goto map_failed;
+  if (!gst_video_frame_map (&frame, &filter->info, outbuf, GST_MAP_WRITE)) {
+    gst_buffer_unmap (inbuf, &map);
+    goto map_failed;
+  }
+
+  GST_OBJECT_LOCK (filter);
+  method = filter->method;
+  n_threads = filter->n_threads;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (n_threads == 0) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    n_threads = g_get_num_processors ();
+#else
+    n_threads = 1;
+#endif
+  }
+
+  filter->use_orc = filter->bpp == 8
+      && method == GST_BAYER_2_RGB_METHOD_BILINEAR
+      && filter->write == gst_bayer2rgb_write_rgb8;
+  filter->frame_method = method;
+  filter->src = map.data;
+  filter->frame = &frame;
+
+  n_stripes = MIN (n_threads, filter->height / MIN_STRIPE_HEIGHT);
+
+  if (n_stripes > 1 && filter->pool == NULL) {
+    filter->pool = g_thread_pool_new (gst_bayer2rgb_stripe_func, filter,
+        -1, FALSE, NULL);
+  }
+
+  if (n_stripes <= 1 || filter->pool == NULL) {
+    gst_bayer2rgb_process_stripe (filter, 0, 1);
+  } else {
+    filter->n_stripes = n_stripes;
+    filter->stripes_pending = n_stripes - 1;
+
+    /* stripe 0 is done here, pass the others + 1 to avoid NULL */
+    for (i = 1; i < n_stripes; i++)
+      g_thread_pool_push (filter->pool, GUINT_TO_POINTER (i + 1), NULL);
+
+    gst_bayer2rgb_process_stripe (filter, 0, n_stripes);
+
+    g_mutex_lock (&filter->stripe_lock);
+    while (filter->stripes_pending > 0)
+      g_cond_wait (&filter->stripe_cond, &filter->stripe_lock);
+    g_mutex_unlock (&filter->stripe_lock);
+  }
+
+  filter->src = NULL;
+  filter->frame = NULL;
 
-  output = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
-  gst_bayer2rgb_process (filter, output, filter->width * 4,
-      map.data, filter->width);
   gst_video_frame_unmap (&frame);
   gst_buffer_unmap (inbuf, &map);
 
   return GST_FLOW_OK;
+
+map_failed:
+  {
+    GST_ELEMENT_ERROR (base, STREAM, FAILED, (NULL),
+        ("Failed to map buffer"));
+    return GST_FLOW_ERROR;
+  }
 }
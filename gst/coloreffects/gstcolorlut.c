@@ -0,0 +1,1137 @@
+/* GStreamer
+ * Copyright (C) 2015 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-colorlut
+ *
+ * The colorlut element applies a 3D look-up table, as used for color
+ * grading, to the video. The table is loaded from a .cube (Adobe/Resolve)
+ * or .3dl (Autodesk) file and colors between its lattice points are
+ * interpolated, tetrahedrally by default.
+ *
+ * YUV input is graded without converting the frames to RGB: the RGB table
+ * is resampled into the YUV domain of the negotiated colorimetry when the
+ * caps are set. For subsampled formats the luma samples are mapped with
+ * their chroma sample and the chroma samples get the average of the
+ * mapped chroma of the luma samples they cover.
+ *
+ * Sample pipeline:
+ * |[
+ * gst-launch-1.0 videotestsrc ! colorlut location=grade.cube ! \
+ *   videoconvert ! autovideosink
+ * ]| This pipeline grades the test pattern with the LUT in grade.cube.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstcolorlut.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_color_lut_debug);
+#define GST_CAT_DEFAULT gst_color_lut_debug
+
+#define DEFAULT_LOCATION NULL
+#define DEFAULT_INTERPOLATION GST_COLOR_LUT_INTERPOLATION_TETRAHEDRAL
+#define DEFAULT_N_THREADS 0
+
+/* the largest LUT we accept, 65 points per axis is the biggest in use */
+#define MAX_LUT_SIZE 65
+/* RGB tables are resampled with at least this many points into YUV */
+#define MIN_YUV_LUT_SIZE 33
+/* stripes smaller than this are not worth a thread */
+#define MIN_STRIPE_HEIGHT 16
+
+#define FRAC_BITS 12
+#define FRAC_ONE (1 << FRAC_BITS)
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  PROP_INTERPOLATION,
+  PROP_N_THREADS
+};
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define COLOR_LUT_FORMATS "{ ARGB, BGRA, ABGR, RGBA, xRGB, BGRx, xBGR, RGBx, " \
+    "RGB, BGR, AYUV, I420, YV12, Y42B, Y444, I420_10LE, I422_10LE, " \
+    "Y444_10LE }"
+#else
+#define COLOR_LUT_FORMATS "{ ARGB, BGRA, ABGR, RGBA, xRGB, BGRx, xBGR, RGBx, " \
+    "RGB, BGR, AYUV, I420, YV12, Y42B, Y444, I420_10BE, I422_10BE, " \
+    "Y444_10BE }"
+#endif
+
+static GstStaticPadTemplate gst_color_lut_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (COLOR_LUT_FORMATS))
+    );
+
+static GstStaticPadTemplate gst_color_lut_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (COLOR_LUT_FORMATS))
+    );
+
+#define GST_COLOR_LUT_LOCK(self) G_STMT_START { \
+  GST_LOG_OBJECT (self, "Locking colorlut from thread %p", g_thread_self ()); \
+  g_mutex_lock (&self->lock); \
+  GST_LOG_OBJECT (self, "Locked colorlut from thread %p", g_thread_self ()); \
+} G_STMT_END
+
+#define GST_COLOR_LUT_UNLOCK(self) G_STMT_START { \
+  GST_LOG_OBJECT (self, "Unlocking colorlut from thread %p", \
+      g_thread_self ()); \
+  g_mutex_unlock (&self->lock); \
+} G_STMT_END
+
+#define GST_TYPE_COLOR_LUT_INTERPOLATION \
+  (gst_color_lut_interpolation_get_type ())
+static GType
+gst_color_lut_interpolation_get_type (void)
+{
+  static GType interpolation_type = 0;
+  static const GEnumValue interpolations[] = {
+    {GST_COLOR_LUT_INTERPOLATION_TRILINEAR, "Trilinear", "trilinear"},
+    {GST_COLOR_LUT_INTERPOLATION_TETRAHEDRAL, "Tetrahedral", "tetrahedral"},
+    {0, NULL, NULL},
+  };
+
+  if (!interpolation_type) {
+    interpolation_type =
+        g_enum_register_static ("GstColorLutInterpolation", interpolations);
+  }
+  return interpolation_type;
+}
+
+static gboolean gst_color_lut_start (GstBaseTransform * trans);
+static gboolean gst_color_lut_stop (GstBaseTransform * trans);
+static gboolean gst_color_lut_set_info (GstVideoFilter * vfilter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
+static GstFlowReturn gst_color_lut_transform_frame_ip (GstVideoFilter *
+    vfilter, GstVideoFrame * frame);
+
+static void gst_color_lut_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_color_lut_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static void gst_color_lut_finalize (GObject * object);
+
+#define gst_color_lut_parent_class parent_class
+G_DEFINE_TYPE (GstColorLut, gst_color_lut, GST_TYPE_VIDEO_FILTER);
+
+static void
+gst_color_lut_class_init (GstColorLutClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = (GstElementClass *) klass;
+  GstBaseTransformClass *btrans_class = (GstBaseTransformClass *) klass;
+  GstVideoFilterClass *vfilter_class = (GstVideoFilterClass *) klass;
+
+  gobject_class->set_property = gst_color_lut_set_property;
+  gobject_class->get_property = gst_color_lut_get_property;
+  gobject_class->finalize = gst_color_lut_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "Location of the .cube or .3dl LUT file to apply", DEFAULT_LOCATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_INTERPOLATION,
+      g_param_spec_enum ("interpolation", "Interpolation",
+          "Interpolation between the lattice points of the LUT",
+          GST_TYPE_COLOR_LUT_INTERPOLATION, DEFAULT_INTERPOLATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to process each frame with, 0 means one per CPU",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  btrans_class->start = GST_DEBUG_FUNCPTR (gst_color_lut_start);
+  btrans_class->stop = GST_DEBUG_FUNCPTR (gst_color_lut_stop);
+
+  vfilter_class->transform_frame_ip =
+      GST_DEBUG_FUNCPTR (gst_color_lut_transform_frame_ip);
+  vfilter_class->set_info = GST_DEBUG_FUNCPTR (gst_color_lut_set_info);
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "3D color look-up table filter", "Filter/Effect/Video",
+      "Applies a 3D color look-up table loaded from a .cube or .3dl file",
+      "The GStreamer developers <gstreamer-devel@lists.freedesktop.org>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&gst_color_lut_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&gst_color_lut_src_template));
+
+  GST_DEBUG_CATEGORY_INIT (gst_color_lut_debug, "colorlut", 0,
+      "colorlut - Applies a 3D color look-up table");
+}
+
+static void
+gst_color_lut_init (GstColorLut * self)
+{
+  self->location = g_strdup (DEFAULT_LOCATION);
+  self->interpolation = DEFAULT_INTERPOLATION;
+  self->n_threads = DEFAULT_N_THREADS;
+
+  g_mutex_init (&self->lock);
+  g_mutex_init (&self->stripe_lock);
+  g_cond_init (&self->stripe_cond);
+}
+
+static void
+gst_color_lut_free_lut (GstColorLut * self)
+{
+  gint i;
+
+  g_free (self->lut);
+  self->lut = NULL;
+  self->lut_size = 0;
+  for (i = 0; i < 3; i++) {
+    g_free (self->index[i]);
+    self->index[i] = NULL;
+  }
+  self->lut_dirty = TRUE;
+}
+
+static void
+gst_color_lut_finalize (GObject * object)
+{
+  GstColorLut *self = GST_COLOR_LUT (object);
+
+  gst_color_lut_free_lut (self);
+  g_free (self->table);
+  g_free (self->location);
+
+  g_mutex_clear (&self->lock);
+  g_mutex_clear (&self->stripe_lock);
+  g_cond_clear (&self->stripe_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_color_lut_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstColorLut *self = GST_COLOR_LUT (object);
+  gboolean passthrough;
+
+  switch (prop_id) {
+    case PROP_LOCATION:
+      GST_COLOR_LUT_LOCK (self);
+      g_free (self->location);
+      self->location = g_value_dup_string (value);
+      self->reload = TRUE;
+      passthrough = (self->location == NULL);
+      GST_COLOR_LUT_UNLOCK (self);
+      gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (self),
+          passthrough);
+      break;
+    case PROP_INTERPOLATION:
+      GST_COLOR_LUT_LOCK (self);
+      self->interpolation = g_value_get_enum (value);
+      GST_COLOR_LUT_UNLOCK (self);
+      break;
+    case PROP_N_THREADS:
+      GST_COLOR_LUT_LOCK (self);
+      self->n_threads = g_value_get_uint (value);
+      GST_COLOR_LUT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_color_lut_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstColorLut *self = GST_COLOR_LUT (object);
+
+  GST_COLOR_LUT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_value_set_string (value, self->location);
+      break;
+    case PROP_INTERPOLATION:
+      g_value_set_enum (value, self->interpolation);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, self->n_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_COLOR_LUT_UNLOCK (self);
+}
+
+/* Splits @line into at most @max_values numbers, returns how many were
+ * found or -1 if the line contains something else */
+static gint
+gst_color_lut_parse_values (const gchar * line, gdouble * values,
+    gint max_values)
+{
+  gint n = 0;
+  gchar *end;
+
+  while (TRUE) {
+    while (g_ascii_isspace (*line))
+      line++;
+    if (*line == '\0' || *line == '#')
+      break;
+    if (n == max_values)
+      return -1;
+    values[n] = g_ascii_strtod (line, &end);
+    if (end == line)
+      return -1;
+    line = end;
+    n++;
+  }
+
+  return n;
+}
+
+/* Adobe/Resolve .cube: keywords, then size^3 lines of normalized RGB with
+ * red changing fastest */
+static gboolean
+gst_color_lut_parse_cube (GstColorLut * self, gchar ** lines, gfloat ** table,
+    guint * table_size, gfloat * domain_min, gfloat * domain_max)
+{
+  gdouble values[3];
+  guint size = 0, n_points = 0, n = 0, i;
+  gfloat *data = NULL;
+
+  for (i = 0; lines[i]; i++) {
+    gchar *line = g_strstrip (lines[i]);
+
+    if (*line == '\0' || *line == '#')
+      continue;
+
+    if (g_ascii_isalpha (*line)) {
+      gchar *args = line;
+
+      while (*args && !g_ascii_isspace (*args))
+        args++;
+
+      if (g_str_has_prefix (line, "LUT_3D_SIZE")) {
+        if (data || gst_color_lut_parse_values (args, values, 1) != 1)
+          goto parse_error;
+        if (values[0] < 2 || values[0] > MAX_LUT_SIZE)
+          goto bad_size;
+        size = values[0];
+        n_points = size * size * size;
+        data = g_new (gfloat, 3 * n_points);
+      } else if (g_str_has_prefix (line, "DOMAIN_MIN")) {
+        if (gst_color_lut_parse_values (args, values, 3) != 3)
+          goto parse_error;
+        domain_min[0] = values[0];
+        domain_min[1] = values[1];
+        domain_min[2] = values[2];
+      } else if (g_str_has_prefix (line, "DOMAIN_MAX")) {
+        if (gst_color_lut_parse_values (args, values, 3) != 3)
+          goto parse_error;
+        domain_max[0] = values[0];
+        domain_max[1] = values[1];
+        domain_max[2] = values[2];
+      } else if (g_str_has_prefix (line, "LUT_3D_INPUT_RANGE")) {
+        if (gst_color_lut_parse_values (args, values, 2) != 2)
+          goto parse_error;
+        domain_min[0] = domain_min[1] = domain_min[2] = values[0];
+        domain_max[0] = domain_max[1] = domain_max[2] = values[1];
+      } else if (g_str_has_prefix (line, "LUT_1D_SIZE")) {
+        GST_WARNING_OBJECT (self, "1D LUTs are not supported");
+        goto error;
+      } else {
+        GST_DEBUG_OBJECT (self, "Ignoring line %u: %s", i + 1, line);
+      }
+      continue;
+    }
+
+    if (data == NULL || n == n_points)
+      goto parse_error;
+    if (gst_color_lut_parse_values (line, values, 3) != 3)
+      goto parse_error;
+
+    data[3 * n + 0] = values[0];
+    data[3 * n + 1] = values[1];
+    data[3 * n + 2] = values[2];
+    n++;
+  }
+
+  if (data == NULL || n != n_points) {
+    GST_WARNING_OBJECT (self, "Expected %u points, got %u", n_points, n);
+    goto error;
+  }
+
+  *table = data;
+  *table_size = size;
+
+  return TRUE;
+
+parse_error:
+  {
+    GST_WARNING_OBJECT (self, "Invalid line %u: %s", i + 1, lines[i]);
+    goto error;
+  }
+bad_size:
+  {
+    GST_WARNING_OBJECT (self, "Unsupported LUT size %g", values[0]);
+    goto error;
+  }
+error:
+  {
+    g_free (data);
+    return FALSE;
+  }
+}
+
+/* Autodesk .3dl: an optional line with the input mesh points, then size^3
+ * lines of integer RGB with blue changing fastest. The output depth is
+ * given by a "Mesh" line or guessed from the largest value */
+static gboolean
+gst_color_lut_parse_3dl (GstColorLut * self, gchar ** lines, gfloat ** table,
+    guint * table_size)
+{
+  gdouble values[MAX_LUT_SIZE];
+  guint size = 0, n_points, n = 0, i, r, g, b;
+  gdouble max = 0.0, out_max = 0.0;
+  GArray *points;
+  gfloat *data;
+  gint n_values;
+
+  points = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+  for (i = 0; lines[i]; i++) {
+    gchar *line = g_strstrip (lines[i]);
+
+    if (*line == '\0' || *line == '#')
+      continue;
+
+    if (g_ascii_isalpha (*line)) {
+      if (g_str_has_prefix (line, "Mesh")) {
+        if (gst_color_lut_parse_values (line + 4, values, 2) != 2)
+          goto parse_error;
+        if (values[1] < 8 || values[1] > 16)
+          goto parse_error;
+        out_max = (1 << (gint) values[1]) - 1;
+      } else {
+        GST_DEBUG_OBJECT (self, "Ignoring line %u: %s", i + 1, line);
+      }
+      continue;
+    }
+
+    n_values = gst_color_lut_parse_values (line, values, MAX_LUT_SIZE);
+    if (n_values == 3) {
+      g_array_append_vals (points, values, 3);
+      max = MAX (max, MAX (values[0], MAX (values[1], values[2])));
+    } else if (n_values >= 2 && size == 0 && points->len == 0) {
+      size = n_values;
+    } else {
+      goto parse_error;
+    }
+  }
+
+  n = points->len / 3;
+
+  /* without mesh line the size follows from the number of points */
+  if (size == 0) {
+    while ((size + 1) * (size + 1) * (size + 1) <= n)
+      size++;
+  }
+
+  n_points = size * size * size;
+  if (size < 2 || size > MAX_LUT_SIZE || n != n_points) {
+    GST_WARNING_OBJECT (self, "Got %u points, not a cube of 2 to %u", n,
+        MAX_LUT_SIZE);
+    goto error;
+  }
+
+  if (out_max == 0.0) {
+    if (max <= 1023)
+      out_max = 1023;
+    else if (max <= 4095)
+      out_max = 4095;
+    else
+      out_max = 65535;
+  }
+  GST_DEBUG_OBJECT (self, "%u points, output maximum %g", size, out_max);
+
+  data = g_new (gfloat, 3 * n_points);
+  n = 0;
+  for (r = 0; r < size; r++) {
+    for (g = 0; g < size; g++) {
+      for (b = 0; b < size; b++) {
+        const gdouble *p = &g_array_index (points, gdouble, 3 * n);
+        gfloat *d = data + 3 * ((b * size + g) * size + r);
+
+        d[0] = p[0] / out_max;
+        d[1] = p[1] / out_max;
+        d[2] = p[2] / out_max;
+        n++;
+      }
+    }
+  }
+  g_array_free (points, TRUE);
+
+  *table = data;
+  *table_size = size;
+
+  return TRUE;
+
+parse_error:
+  {
+    GST_WARNING_OBJECT (self, "Invalid line %u: %s", i + 1, lines[i]);
+    goto error;
+  }
+error:
+  {
+    g_array_free (points, TRUE);
+    return FALSE;
+  }
+}
+
+/* Protected with the colorlut lock */
+static gboolean
+gst_color_lut_load (GstColorLut * self)
+{
+  GError *err = NULL;
+  gchar *contents = NULL;
+  gchar **lines;
+  gfloat *table = NULL;
+  guint table_size = 0;
+  gfloat domain_min[3] = { 0.0, 0.0, 0.0 };
+  gfloat domain_max[3] = { 1.0, 1.0, 1.0 };
+  gboolean ret;
+  gint i;
+
+  self->reload = FALSE;
+
+  g_free (self->table);
+  self->table = NULL;
+  self->table_size = 0;
+  gst_color_lut_free_lut (self);
+
+  if (self->location == NULL)
+    return TRUE;
+
+  if (!g_file_get_contents (self->location, &contents, NULL, &err))
+    goto read_failed;
+
+  lines = g_strsplit_set (contents, "\r\n", -1);
+  g_free (contents);
+
+  if (g_str_has_suffix (self->location, ".3dl")
+      || g_str_has_suffix (self->location, ".3DL"))
+    ret = gst_color_lut_parse_3dl (self, lines, &table, &table_size);
+  else
+    ret = gst_color_lut_parse_cube (self, lines, &table, &table_size,
+        domain_min, domain_max);
+  g_strfreev (lines);
+
+  if (!ret)
+    goto parse_failed;
+
+  for (i = 0; i < 3; i++) {
+    if (domain_max[i] <= domain_min[i])
+      goto bad_domain;
+  }
+
+  GST_DEBUG_OBJECT (self, "Loaded %u point LUT from %s", table_size,
+      self->location);
+
+  self->table = table;
+  self->table_size = table_size;
+  memcpy (self->domain_min, domain_min, sizeof (domain_min));
+  memcpy (self->domain_max, domain_max, sizeof (domain_max));
+
+  return TRUE;
+
+read_failed:
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ, (NULL),
+        ("Could not read LUT file %s: %s", self->location, err->message));
+    g_error_free (err);
+    return FALSE;
+  }
+parse_failed:
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+        ("Could not parse LUT file %s", self->location));
+    return FALSE;
+  }
+bad_domain:
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+        ("Invalid domain in LUT file %s", self->location));
+    g_free (table);
+    return FALSE;
+  }
+}
+
+/* Samples the loaded table with trilinear interpolation, @rgb is in the
+ * unit cube and gets replaced by the result */
+static void
+gst_color_lut_sample_table (GstColorLut * self, gdouble * rgb)
+{
+  guint size = self->table_size;
+  gint idx[3], stride[3] = { 3, 3 * size, 3 * size * size };
+  gdouble frac[3], res[3] = { 0.0, 0.0, 0.0 };
+  const gfloat *base;
+  gint c, corner;
+
+  for (c = 0; c < 3; c++) {
+    gdouble x = (rgb[c] - self->domain_min[c]) /
+        (self->domain_max[c] - self->domain_min[c]);
+
+    x = CLAMP (x, 0.0, 1.0) * (size - 1);
+    idx[c] = MIN ((gint) x, (gint) size - 2);
+    frac[c] = x - idx[c];
+  }
+
+  base = self->table + idx[0] * stride[0] + idx[1] * stride[1] +
+      idx[2] * stride[2];
+
+  for (corner = 0; corner < 8; corner++) {
+    const gfloat *p = base;
+    gdouble w = 1.0;
+
+    for (c = 0; c < 3; c++) {
+      if (corner & (1 << c)) {
+        p += stride[c];
+        w *= frac[c];
+      } else {
+        w *= 1.0 - frac[c];
+      }
+    }
+    for (c = 0; c < 3; c++)
+      res[c] += w * p[c];
+  }
+
+  for (c = 0; c < 3; c++)
+    rgb[c] = res[c];
+}
+
+static inline guint16
+gst_color_lut_to_16 (gdouble v)
+{
+  return CLAMP (v, 0.0, 1.0) * 65535.0 + 0.5;
+}
+
+static void
+gst_color_lut_get_Kr_Kb (GstVideoColorMatrix matrix, gdouble * Kr,
+    gdouble * Kb)
+{
+  switch (matrix) {
+    case GST_VIDEO_COLOR_MATRIX_FCC:
+      *Kr = 0.30;
+      *Kb = 0.11;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_BT709:
+      *Kr = 0.2126;
+      *Kb = 0.0722;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_SMPTE240M:
+      *Kr = 0.212;
+      *Kb = 0.087;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_BT601:
+    default:
+      *Kr = 0.299;
+      *Kb = 0.114;
+      break;
+  }
+}
+
+/* Resamples the RGB table into a YUV -> YUV table for the negotiated
+ * colorimetry, lattice points are spread over the full code range */
+static void
+gst_color_lut_build_yuv (GstColorLut * self)
+{
+  const GstVideoInfo *info = &self->info;
+  guint size = MAX (self->table_size, MIN_YUV_LUT_SIZE);
+  gint depth = GST_VIDEO_INFO_COMP_DEPTH (info, 0);
+  gdouble max = (1 << depth) - 1, scale = 1 << (depth - 8);
+  gdouble Kr, Kb, Kg, y_off, y_range, c_range;
+  guint16 *lut;
+  guint y, u, v;
+  gint c;
+
+  gst_color_lut_get_Kr_Kb (info->colorimetry.matrix, &Kr, &Kb);
+  Kg = 1.0 - Kr - Kb;
+
+  if (info->colorimetry.range == GST_VIDEO_COLOR_RANGE_0_255) {
+    y_off = 0.0;
+    y_range = max;
+    c_range = max;
+  } else {
+    y_off = 16 * scale;
+    y_range = 219 * scale;
+    c_range = 224 * scale;
+  }
+
+  lut = g_new (guint16, 3 * size * size * size);
+
+  for (v = 0; v < size; v++) {
+    for (u = 0; u < size; u++) {
+      for (y = 0; y < size; y++) {
+        guint16 *d = lut + 3 * ((v * size + u) * size + y);
+        gdouble Y, Cb, Cr, rgb[3], excess[3];
+
+        Y = (y * max / (size - 1) - y_off) / y_range;
+        Cb = (u * max / (size - 1) - 128 * scale) / c_range;
+        Cr = (v * max / (size - 1) - 128 * scale) / c_range;
+
+        rgb[0] = Y + 2 * (1 - Kr) * Cr;
+        rgb[2] = Y + 2 * (1 - Kb) * Cb;
+        rgb[1] = (Y - Kr * rgb[0] - Kb * rgb[2]) / Kg;
+
+        /* most of the YUV cube is outside of the RGB gamut, offset those
+         * points by their distance to the gamut so that the colors
+         * interpolated near its edges stay right */
+        for (c = 0; c < 3; c++) {
+          excess[c] = rgb[c] - CLAMP (rgb[c], 0.0, 1.0);
+          rgb[c] -= excess[c];
+        }
+        gst_color_lut_sample_table (self, rgb);
+        for (c = 0; c < 3; c++)
+          rgb[c] += excess[c];
+
+        Y = Kr * rgb[0] + Kg * rgb[1] + Kb * rgb[2];
+        Cb = (rgb[2] - Y) / (2 * (1 - Kb));
+        Cr = (rgb[0] - Y) / (2 * (1 - Kr));
+
+        d[0] = gst_color_lut_to_16 ((Y * y_range + y_off) / max);
+        d[1] = gst_color_lut_to_16 ((Cb * c_range + 128 * scale) / max);
+        d[2] = gst_color_lut_to_16 ((Cr * c_range + 128 * scale) / max);
+      }
+    }
+  }
+
+  self->lut = lut;
+  self->lut_size = size;
+}
+
+/* Protected with the colorlut lock */
+static void
+gst_color_lut_prepare (GstColorLut * self)
+{
+  gint depth = GST_VIDEO_INFO_COMP_DEPTH (&self->info, 0);
+  guint max = (1 << depth) - 1;
+  gfloat domain_min[3] = { 0.0, 0.0, 0.0 };
+  gfloat domain_max[3] = { 1.0, 1.0, 1.0 };
+  guint i, n, stride;
+  gint c;
+
+  gst_color_lut_free_lut (self);
+
+  if (GST_VIDEO_INFO_IS_YUV (&self->info)) {
+    gst_color_lut_build_yuv (self);
+  } else {
+    n = 3 * self->table_size * self->table_size * self->table_size;
+    self->lut = g_new (guint16, n);
+    for (i = 0; i < n; i++)
+      self->lut[i] = gst_color_lut_to_16 (self->table[i]);
+    self->lut_size = self->table_size;
+    memcpy (domain_min, self->domain_min, sizeof (domain_min));
+    memcpy (domain_max, self->domain_max, sizeof (domain_max));
+  }
+
+  stride = 3;
+  for (c = 0; c < 3; c++) {
+    GstColorLutIndex *index = g_new (GstColorLutIndex, max + 1);
+
+    for (i = 0; i <= max; i++) {
+      gdouble x = ((gdouble) i / max - domain_min[c]) /
+          (domain_max[c] - domain_min[c]);
+      guint pos;
+
+      x = CLAMP (x, 0.0, 1.0);
+      pos = x * (self->lut_size - 1) * FRAC_ONE + 0.5;
+      if ((pos >> FRAC_BITS) >= self->lut_size - 1) {
+        index[i].offset = (self->lut_size - 2) * stride;
+        index[i].frac = FRAC_ONE;
+      } else {
+        index[i].offset = (pos >> FRAC_BITS) * stride;
+        index[i].frac = pos & (FRAC_ONE - 1);
+      }
+    }
+    self->index[c] = index;
+    stride *= self->lut_size;
+  }
+
+  self->lut_dirty = FALSE;
+}
+
+static inline void
+gst_color_lut_trilinear (const guint16 * lut, guint lut_size,
+    const GstColorLutIndex * i0, const GstColorLutIndex * i1,
+    const GstColorLutIndex * i2, guint * out)
+{
+  const guint16 *p = lut + i0->offset + i1->offset + i2->offset;
+  guint s1 = 3 * lut_size, s2 = 3 * lut_size * lut_size;
+  guint f0 = i0->frac, f1 = i1->frac, f2 = i2->frac;
+  gint c;
+
+  for (c = 0; c < 3; c++) {
+    guint c00, c01, c10, c11, c0, c1;
+
+    c00 = (p[c] * (FRAC_ONE - f0) + p[c + 3] * f0) >> FRAC_BITS;
+    c01 = (p[c + s1] * (FRAC_ONE - f0) + p[c + s1 + 3] * f0) >> FRAC_BITS;
+    c10 = (p[c + s2] * (FRAC_ONE - f0) + p[c + s2 + 3] * f0) >> FRAC_BITS;
+    c11 = (p[c + s2 + s1] * (FRAC_ONE - f0) +
+        p[c + s2 + s1 + 3] * f0) >> FRAC_BITS;
+    c0 = (c00 * (FRAC_ONE - f1) + c01 * f1) >> FRAC_BITS;
+    c1 = (c10 * (FRAC_ONE - f1) + c11 * f1) >> FRAC_BITS;
+    out[c] = (c0 * (FRAC_ONE - f2) + c1 * f2 + FRAC_ONE / 2) >> FRAC_BITS;
+  }
+}
+
+/* Splits the cell into 6 tetrahedra along its main diagonal and
+ * interpolates between the 4 corners of the one the color is in, which
+ * needs half the lookups of trilinear and keeps the grey axis exact */
+static inline void
+gst_color_lut_tetrahedral (const guint16 * lut, guint lut_size,
+    const GstColorLutIndex * i0, const GstColorLutIndex * i1,
+    const GstColorLutIndex * i2, guint * out)
+{
+  const guint16 *p = lut + i0->offset + i1->offset + i2->offset;
+  guint s0 = 3, s1 = 3 * lut_size, s2 = 3 * lut_size * lut_size;
+  guint f0 = i0->frac, f1 = i1->frac, f2 = i2->frac;
+  guint v1, v2, w0, w1, w2, w3;
+  gint c;
+
+  if (f0 > f1) {
+    if (f1 > f2) {
+      v1 = s0;
+      v2 = s0 + s1;
+      w0 = FRAC_ONE - f0;
+      w1 = f0 - f1;
+      w2 = f1 - f2;
+      w3 = f2;
+    } else if (f0 > f2) {
+      v1 = s0;
+      v2 = s0 + s2;
+      w0 = FRAC_ONE - f0;
+      w1 = f0 - f2;
+      w2 = f2 - f1;
+      w3 = f1;
+    } else {
+      v1 = s2;
+      v2 = s2 + s0;
+      w0 = FRAC_ONE - f2;
+      w1 = f2 - f0;
+      w2 = f0 - f1;
+      w3 = f1;
+    }
+  } else {
+    if (f2 > f1) {
+      v1 = s2;
+      v2 = s2 + s1;
+      w0 = FRAC_ONE - f2;
+      w1 = f2 - f1;
+      w2 = f1 - f0;
+      w3 = f0;
+    } else if (f2 > f0) {
+      v1 = s1;
+      v2 = s1 + s2;
+      w0 = FRAC_ONE - f1;
+      w1 = f1 - f2;
+      w2 = f2 - f0;
+      w3 = f0;
+    } else {
+      v1 = s1;
+      v2 = s1 + s0;
+      w0 = FRAC_ONE - f1;
+      w1 = f1 - f0;
+      w2 = f0 - f2;
+      w3 = f2;
+    }
+  }
+
+  for (c = 0; c < 3; c++) {
+    out[c] = (p[c] * w0 + p[c + v1] * w1 + p[c + v2] * w2 +
+        p[c + s0 + s1 + s2] * w3 + FRAC_ONE / 2) >> FRAC_BITS;
+  }
+}
+
+/* scales a 16 bit sample to @max */
+#define TO_DEPTH(v,max) (((v) * (max) + 32767) / 65535)
+
+/* Processes the chroma lines @y_start to @y_end. The luma samples of a
+ * chroma sample are mapped together with it and the chroma samples get the
+ * average of the mapped chroma, without subsampling this degenerates to
+ * mapping every pixel */
+#define DEFINE_PROCESS(name, type, interpolate) \
+static void \
+gst_color_lut_process_##name (GstColorLut * self, GstVideoFrame * frame, \
+    gint y_start, gint y_end) \
+{ \
+  const guint16 *lut = self->lut; \
+  guint lut_size = self->lut_size; \
+  const GstColorLutIndex *index0 = self->index[0]; \
+  const GstColorLutIndex *index1 = self->index[1]; \
+  const GstColorLutIndex *index2 = self->index[2]; \
+  gint width = GST_VIDEO_FRAME_WIDTH (frame); \
+  gint height = GST_VIDEO_FRAME_HEIGHT (frame); \
+  gint cwidth = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); \
+  gint wsub = GST_VIDEO_FORMAT_INFO_W_SUB (frame->info.finfo, 1); \
+  gint hsub = GST_VIDEO_FORMAT_INFO_H_SUB (frame->info.finfo, 1); \
+  guint max = (1 << GST_VIDEO_FRAME_COMP_DEPTH (frame, 0)) - 1; \
+  guint8 *data[3]; \
+  gint stride[3], pstride[3]; \
+  gint c, x, y, cx, cy; \
+  guint out[3]; \
+  \
+  for (c = 0; c < 3; c++) { \
+    data[c] = GST_VIDEO_FRAME_COMP_DATA (frame, c); \
+    stride[c] = GST_VIDEO_FRAME_COMP_STRIDE (frame, c); \
+    pstride[c] = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, c) / sizeof (type); \
+  } \
+  \
+  if (wsub == 0 && hsub == 0) { \
+    for (y = y_start; y < y_end; y++) { \
+      type *p0 = (type *) (data[0] + y * stride[0]); \
+      type *p1 = (type *) (data[1] + y * stride[1]); \
+      type *p2 = (type *) (data[2] + y * stride[2]); \
+      \
+      for (x = 0; x < width; x++) { \
+        interpolate (lut, lut_size, &index0[MIN (*p0, max)], \
+            &index1[MIN (*p1, max)], &index2[MIN (*p2, max)], out); \
+        *p0 = TO_DEPTH (out[0], max); \
+        *p1 = TO_DEPTH (out[1], max); \
+        *p2 = TO_DEPTH (out[2], max); \
+        p0 += pstride[0]; \
+        p1 += pstride[1]; \
+        p2 += pstride[2]; \
+      } \
+    } \
+    return; \
+  } \
+  \
+  for (cy = y_start; cy < y_end; cy++) { \
+    type *p1 = (type *) (data[1] + cy * stride[1]); \
+    type *p2 = (type *) (data[2] + cy * stride[2]); \
+    gint ly_end = MIN ((cy + 1) << hsub, height); \
+    \
+    for (cx = 0; cx < cwidth; cx++) { \
+      const GstColorLutIndex *i1 = &index1[MIN (*p1, max)]; \
+      const GstColorLutIndex *i2 = &index2[MIN (*p2, max)]; \
+      gint lx_end = MIN ((cx + 1) << wsub, width); \
+      guint sum1 = 0, sum2 = 0, n = 0; \
+      \
+      for (y = cy << hsub; y < ly_end; y++) { \
+        type *p0 = (type *) (data[0] + y * stride[0]); \
+        \
+        for (x = cx << wsub; x < lx_end; x++) { \
+          type *s = p0 + x * pstride[0]; \
+          \
+          interpolate (lut, lut_size, &index0[MIN (*s, max)], i1, i2, out); \
+          *s = TO_DEPTH (out[0], max); \
+          sum1 += out[1]; \
+          sum2 += out[2]; \
+          n++; \
+        } \
+      } \
+      *p1 = TO_DEPTH (sum1 / n, max); \
+      *p2 = TO_DEPTH (sum2 / n, max); \
+      p1 += pstride[1]; \
+      p2 += pstride[2]; \
+    } \
+  } \
+}
+
+DEFINE_PROCESS (trilinear_8, guint8, gst_color_lut_trilinear)
+DEFINE_PROCESS (trilinear_16, guint16, gst_color_lut_trilinear)
+DEFINE_PROCESS (tetrahedral_8, guint8, gst_color_lut_tetrahedral)
+DEFINE_PROCESS (tetrahedral_16, guint16, gst_color_lut_tetrahedral)
+
+static void
+gst_color_lut_process_stripe (GstColorLut * self, GstVideoFrame * frame,
+    guint stripe, guint n_stripes)
+{
+  gint height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 1);
+  gint y_start = height * stripe / n_stripes;
+  gint y_end = height * (stripe + 1) / n_stripes;
+  gboolean deep = GST_VIDEO_FRAME_COMP_DEPTH (frame, 0) > 8;
+
+  if (self->interpolation == GST_COLOR_LUT_INTERPOLATION_TRILINEAR) {
+    if (deep)
+      gst_color_lut_process_trilinear_16 (self, frame, y_start, y_end);
+    else
+      gst_color_lut_process_trilinear_8 (self, frame, y_start, y_end);
+  } else {
+    if (deep)
+      gst_color_lut_process_tetrahedral_16 (self, frame, y_start, y_end);
+    else
+      gst_color_lut_process_tetrahedral_8 (self, frame, y_start, y_end);
+  }
+}
+
+static void
+gst_color_lut_stripe_func (gpointer data, gpointer user_data)
+{
+  GstColorLut *self = user_data;
+  guint stripe = GPOINTER_TO_UINT (data) - 1;
+
+  gst_color_lut_process_stripe (self, self->frame, stripe, self->n_stripes);
+
+  g_mutex_lock (&self->stripe_lock);
+  if (--self->stripes_pending == 0)
+    g_cond_signal (&self->stripe_cond);
+  g_mutex_unlock (&self->stripe_lock);
+}
+
+/* Protected with the colorlut lock */
+static void
+gst_color_lut_process (GstColorLut * self, GstVideoFrame * frame)
+{
+  guint n_threads, n_stripes, i;
+
+  n_threads = self->n_threads;
+  if (n_threads == 0) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    n_threads = g_get_num_processors ();
+#else
+    n_threads = 1;
+#endif
+  }
+
+  n_stripes = MIN (n_threads,
+      GST_VIDEO_FRAME_HEIGHT (frame) / MIN_STRIPE_HEIGHT);
+
+  if (n_stripes > 1 && self->pool == NULL) {
+    self->pool = g_thread_pool_new (gst_color_lut_stripe_func, self,
+        -1, FALSE, NULL);
+  }
+
+  if (n_stripes <= 1 || self->pool == NULL) {
+    gst_color_lut_process_stripe (self, frame, 0, 1);
+    return;
+  }
+
+  self->frame = frame;
+  self->n_stripes = n_stripes;
+  self->stripes_pending = n_stripes - 1;
+
+  /* stripe 0 is processed here, pass the others + 1 to avoid NULL */
+  for (i = 1; i < n_stripes; i++)
+    g_thread_pool_push (self->pool, GUINT_TO_POINTER (i + 1), NULL);
+
+  gst_color_lut_process_stripe (self, frame, 0, n_stripes);
+
+  g_mutex_lock (&self->stripe_lock);
+  while (self->stripes_pending > 0)
+    g_cond_wait (&self->stripe_cond, &self->stripe_lock);
+  g_mutex_unlock (&self->stripe_lock);
+
+  self->frame = NULL;
+}
+
+static gboolean
+gst_color_lut_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  GstColorLut *self = GST_COLOR_LUT (vfilter);
+
+  GST_COLOR_LUT_LOCK (self);
+
+  GST_DEBUG_OBJECT (self,
+      "Setting caps %" GST_PTR_FORMAT " -> %" GST_PTR_FORMAT, incaps, outcaps);
+
+  self->info = *in_info;
+  self->lut_dirty = TRUE;
+
+  GST_COLOR_LUT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_color_lut_transform_frame_ip (GstVideoFilter * vfilter,
+    GstVideoFrame * frame)
+{
+  GstColorLut *self = GST_COLOR_LUT (vfilter);
+
+  GST_COLOR_LUT_LOCK (self);
+
+  if (G_UNLIKELY (self->reload) && !gst_color_lut_load (self)) {
+    GST_COLOR_LUT_UNLOCK (self);
+    return GST_FLOW_ERROR;
+  }
+
+  /* no LUT configured, the location was just unset */
+  if (G_UNLIKELY (self->table == NULL)) {
+    GST_COLOR_LUT_UNLOCK (self);
+    return GST_FLOW_OK;
+  }
+
+  if (G_UNLIKELY (self->lut_dirty))
+    gst_color_lut_prepare (self);
+
+  gst_color_lut_process (self, frame);
+
+  GST_COLOR_LUT_UNLOCK (self);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_color_lut_start (GstBaseTransform * btrans)
+{
+  GstColorLut *self = GST_COLOR_LUT (btrans);
+  gboolean ret;
+
+  GST_COLOR_LUT_LOCK (self);
+  gst_base_transform_set_passthrough (btrans, self->location == NULL);
+  ret = gst_color_lut_load (self);
+  GST_COLOR_LUT_UNLOCK (self);
+
+  return ret;
+}
+
+static gboolean
+gst_color_lut_stop (GstBaseTransform * btrans)
+{
+  GstColorLut *self = GST_COLOR_LUT (btrans);
+
+  GST_COLOR_LUT_LOCK (self);
+  if (self->pool) {
+    g_thread_pool_free (self->pool, FALSE, TRUE);
+    self->pool = NULL;
+  }
+  gst_color_lut_free_lut (self);
+  g_free (self->table);
+  self->table = NULL;
+  self->table_size = 0;
+  GST_COLOR_LUT_UNLOCK (self);
+
+  return TRUE;
+}
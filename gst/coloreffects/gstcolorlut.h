@@ -0,0 +1,111 @@
+/* GStreamer
+ * Copyright (C) 2015 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_COLOR_LUT_H__
+#define __GST_COLOR_LUT_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideofilter.h>
+
+G_BEGIN_DECLS
+#define GST_TYPE_COLOR_LUT \
+  (gst_color_lut_get_type())
+#define GST_COLOR_LUT(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_COLOR_LUT,GstColorLut))
+#define GST_COLOR_LUT_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_COLOR_LUT,GstColorLutClass))
+#define GST_IS_COLOR_LUT(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_COLOR_LUT))
+#define GST_IS_COLOR_LUT_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_COLOR_LUT))
+typedef struct _GstColorLut GstColorLut;
+typedef struct _GstColorLutClass GstColorLutClass;
+typedef struct _GstColorLutIndex GstColorLutIndex;
+
+/**
+ * GstColorLutInterpolation:
+ * @GST_COLOR_LUT_INTERPOLATION_TRILINEAR: interpolate between the 8 corners
+ *   of the lattice cell
+ * @GST_COLOR_LUT_INTERPOLATION_TETRAHEDRAL: interpolate between the 4 corners
+ *   of the tetrahedron of the lattice cell the color falls in
+ *
+ * How colors between the lattice points of the LUT are computed.
+ */
+typedef enum
+{
+  GST_COLOR_LUT_INTERPOLATION_TRILINEAR,
+  GST_COLOR_LUT_INTERPOLATION_TETRAHEDRAL
+} GstColorLutInterpolation;
+
+/* position of an input sample in the lattice: offset of the lower lattice
+ * point in the table and the 12 bit fraction towards the next one */
+struct _GstColorLutIndex
+{
+  guint32 offset;
+  guint16 frac;
+};
+
+struct _GstColorLut
+{
+  GstVideoFilter parent;
+
+  /* <private> */
+
+  GMutex lock;
+
+  gchar *location;
+  GstColorLutInterpolation interpolation;
+  guint n_threads;
+
+  /* the loaded LUT, normalized RGB triplets with red changing fastest */
+  gboolean reload;
+  gfloat *table;
+  guint table_size;
+  gfloat domain_min[3];
+  gfloat domain_max[3];
+
+  /* caps */
+  GstVideoInfo info;
+
+  /* the LUT in the domain of the negotiated format, 16 bit per sample, and
+   * the lattice position of every possible sample value per component */
+  gboolean lut_dirty;
+  guint16 *lut;
+  guint lut_size;
+  GstColorLutIndex *index[3];
+
+  /* stripe threading */
+  GThreadPool *pool;
+  GMutex stripe_lock;
+  GCond stripe_cond;
+  guint stripes_pending;
+  guint n_stripes;
+  GstVideoFrame *frame;
+};
+
+struct _GstColorLutClass
+{
+  GstVideoFilterClass parent_class;
+};
+
+GType gst_color_lut_get_type (void);
+
+G_END_DECLS
+#endif /* __GST_COLOR_LUT_H__ */
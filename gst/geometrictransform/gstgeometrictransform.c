@@ -24,6 +24,7 @@
 #include "gstgeometrictransform.h"
 #include "geometricmath.h"
 #include <string.h>
+#include <math.h>
 
 GST_DEBUG_CATEGORY_STATIC (geometric_transform_debug);
 #define GST_CAT_DEFAULT geometric_transform_debug
@@ -33,7 +34,8 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{ ARGB, BGR, BGRA, BGRx, RGB, "
-            "RGBA, RGBx, AYUV, xBGR, xRGB, GRAY8, GRAY16_BE, GRAY16_LE }"))
+            "RGBA, RGBx, AYUV, xBGR, xRGB, GRAY8, GRAY16_BE, GRAY16_LE, "
+            "I420, YV12, Y41B, Y42B, Y444 }"))
     );
 
 static GstStaticPadTemplate gst_geometric_transform_sink_template =
@@ -41,7 +43,8 @@ GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{ ARGB, BGR, BGRA, BGRx, RGB, "
-            "RGBA, RGBx, AYUV, xBGR, xRGB, GRAY8, GRAY16_BE, GRAY16_LE }"))
+            "RGBA, RGBx, AYUV, xBGR, xRGB, GRAY8, GRAY16_BE, GRAY16_LE, "
+            "I420, YV12, Y41B, Y42B, Y444 }"))
     );
 
 static GstVideoFilterClass *parent_class = NULL;
@@ -49,7 +52,8 @@ static GstVideoFilterClass *parent_class = NULL;
 enum
 {
   PROP_0,
-  PROP_OFF_EDGE_PIXELS
+  PROP_OFF_EDGE_PIXELS,
+  PROP_N_THREADS
 };
 
 #define GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE ( \
@@ -75,6 +79,50 @@ gst_geometric_transform_off_edges_pixels_method_get_type (void)
 }
 
 #define DEFAULT_OFF_EDGE_PIXELS GST_GT_OFF_EDGES_PIXELS_IGNORE
+#define DEFAULT_N_THREADS 1
+
+/* stripes smaller than this are not worth a thread */
+#define MIN_STRIPE_HEIGHT 16
+
+/* Converts an input position to a map entry, applying the off edge pixels
+ * method. Must be called with the object lock */
+static void
+gst_geometric_transform_make_entry (GstGeometricTransform * gt,
+    gdouble in_x, gdouble in_y, GstGeometricTransformMapEntry * entry)
+{
+  /* operate on out of edge pixels */
+  switch (gt->off_edge_pixels) {
+    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
+      in_x = CLAMP (in_x, 0, gt->width - 1);
+      in_y = CLAMP (in_y, 0, gt->height - 1);
+      break;
+
+    case GST_GT_OFF_EDGES_PIXELS_WRAP:
+      in_x = mod_float (in_x, gt->width);
+      in_y = mod_float (in_y, gt->height);
+      if (in_x < 0)
+        in_x += gt->width;
+      if (in_y < 0)
+        in_y += gt->height;
+      break;
+
+    default:
+      break;
+  }
+
+  /* only map the pixel if the values are valid, off edge pixels stay black */
+  if (in_x >= 0 && in_x < gt->width && in_y >= 0 && in_y < gt->height) {
+    entry->x = (gint16) in_x;
+    entry->y = (gint16) in_y;
+    entry->fx = (guint8) ((in_x - entry->x) * 256);
+    entry->fy = (guint8) ((in_y - entry->y) * 256);
+  } else {
+    entry->x = -1;
+    entry->y = -1;
+    entry->fx = 0;
+    entry->fy = 0;
+  }
+}
 
 /* must be called with the object lock */
 static gboolean
@@ -84,13 +132,9 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   gdouble in_x, in_y;
   gboolean ret = TRUE;
   GstGeometricTransformClass *klass;
-  gdouble *ptr;
+  GstGeometricTransformMapEntry *ptr;
 
-  GST_INFO_OBJECT (gt, "Generating new transform map");
-
-  /* cleanup old map */
-  g_free (gt->map);
-  gt->map = NULL;
+  GST_LOG_OBJECT (gt, "Generating new transform map");
 
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
@@ -98,9 +142,11 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   g_return_val_if_fail (klass->map_func, FALSE);
 
   /*
-   * (x,y) pairs of the inverse mapping
+   * fixed point input positions of the inverse mapping, the map is kept
+   * around if the size didn't change
    */
-  gt->map = g_malloc0 (sizeof (gdouble) * gt->width * gt->height * 2);
+  if (gt->map == NULL)
+    gt->map = g_new (GstGeometricTransformMapEntry, gt->width * gt->height);
   ptr = gt->map;
 
   for (y = 0; y < gt->height; y++) {
@@ -111,9 +157,8 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
         goto end;
       }
 
-      ptr[0] = in_x;
-      ptr[1] = in_y;
-      ptr += 2;
+      gst_geometric_transform_make_entry (gt, in_x, in_y, ptr);
+      ptr++;
     }
   }
 
@@ -140,6 +185,13 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
+  /* the map stores positions as 16 bit integers */
+  if (in_info->width > G_MAXINT16 || in_info->height > G_MAXINT16) {
+    GST_ERROR_OBJECT (gt, "Unsupported size %dx%d", in_info->width,
+        in_info->height);
+    return FALSE;
+  }
+
   old_width = gt->width;
   old_height = gt->height;
 
@@ -147,11 +199,15 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   gt->height = in_info->height;
   gt->row_stride = in_info->stride[0];
   gt->pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE (in_info, 0);
+  gt->format = GST_VIDEO_INFO_FORMAT (in_info);
 
   /* regenerate the map */
   GST_OBJECT_LOCK (gt);
   if (gt->map == NULL || old_width == 0 || old_height == 0
       || gt->width != old_width || gt->height != old_height) {
+    g_free (gt->map);
+    gt->map = NULL;
+
     if (klass->prepare_func)
       if (!klass->prepare_func (gt)) {
         GST_OBJECT_UNLOCK (gt);
@@ -164,46 +220,203 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   return ret;
 }
 
+/* Bilinear interpolation of @n_samples interleaved 8 bit samples at the fixed
+ * point position (@x + @fx / 256, @y + @fy / 256) */
+static inline void
+gst_geometric_transform_sample_8 (const guint8 * in, gint stride, gint width,
+    gint height, gint n_samples, gint x, gint y, guint fx, guint fy,
+    guint8 * out)
+{
+  const guint8 *p = in + y * stride + x * n_samples;
+  gint dx = x + 1 < width ? n_samples : 0;
+  gint dy = y + 1 < height ? stride : 0;
+  guint w00 = (256 - fx) * (256 - fy);
+  guint w10 = fx * (256 - fy);
+  guint w01 = (256 - fx) * fy;
+  guint w11 = fx * fy;
+  gint i;
+
+  for (i = 0; i < n_samples; i++) {
+    out[i] = (p[i] * w00 + p[i + dx] * w10 + p[i + dy] * w01 +
+        p[i + dx + dy] * w11 + 32768) >> 16;
+  }
+}
+
+static inline void
+gst_geometric_transform_sample_16 (const guint8 * in, gint stride, gint width,
+    gint height, gboolean le, gint x, gint y, guint fx, guint fy, guint8 * out)
+{
+  const guint8 *p = in + y * stride + x * 2;
+  gint dx = x + 1 < width ? 2 : 0;
+  gint dy = y + 1 < height ? stride : 0;
+  guint w00 = (256 - fx) * (256 - fy);
+  guint w10 = fx * (256 - fy);
+  guint w01 = (256 - fx) * fy;
+  guint w11 = fx * fy;
+  guint v;
+
+  if (le) {
+    v = (GST_READ_UINT16_LE (p) * w00 + GST_READ_UINT16_LE (p + dx) * w10 +
+        GST_READ_UINT16_LE (p + dy) * w01 +
+        GST_READ_UINT16_LE (p + dx + dy) * w11 + 32768) >> 16;
+    GST_WRITE_UINT16_LE (out, v);
+  } else {
+    v = (GST_READ_UINT16_BE (p) * w00 + GST_READ_UINT16_BE (p + dx) * w10 +
+        GST_READ_UINT16_BE (p + dy) * w01 +
+        GST_READ_UINT16_BE (p + dx + dy) * w11 + 32768) >> 16;
+    GST_WRITE_UINT16_BE (out, v);
+  }
+}
+
+/* Maps the lines of stripe @stripe out of @n_stripes of every plane */
 static void
-gst_geometric_transform_do_map (GstGeometricTransform * gt, guint8 * in_data,
-    guint8 * out_data, gint x, gint y, gdouble in_x, gdouble in_y)
+gst_geometric_transform_map_stripe (GstGeometricTransform * gt,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame, guint stripe,
+    guint n_stripes)
 {
-  gint in_offset;
-  gint out_offset;
+  const GstVideoFormatInfo *finfo = in_frame->info.finfo;
+  gint n_planes = GST_VIDEO_FRAME_N_PLANES (in_frame);
+  gint plane;
+
+  for (plane = 0; plane < n_planes; plane++) {
+    const GstGeometricTransformMapEntry *entry;
+    const guint8 *in_data;
+    guint8 *out_data, *out;
+    gint in_stride, out_stride;
+    gint width, height;
+    gint pstride;
+    gint wsub, hsub;
+    gint x, y, y_start, y_end;
+    guint8 black[4] = { 0, 0, 0, 0 };
+    gboolean is_16bit;
+
+    if (n_planes == 1) {
+      /* packed formats, map whole pixels */
+      in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
+      out_data = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
+      in_stride = GST_VIDEO_FRAME_PLANE_STRIDE (in_frame, 0);
+      out_stride = GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0);
+      pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (in_frame, 0);
+      width = gt->width;
+      height = gt->height;
+      wsub = hsub = 0;
+
+      /* in AYUV black is not just all zeros:
+       * 0x10 is black for Y,
+       * 0x80 is black for Cr and Cb */
+      if (GST_VIDEO_FRAME_FORMAT (out_frame) == GST_VIDEO_FORMAT_AYUV)
+        GST_WRITE_UINT32_BE (black, 0xff108080);
+    } else {
+      /* planar YUV formats, one component per plane */
+      in_data = GST_VIDEO_FRAME_COMP_DATA (in_frame, plane);
+      out_data = GST_VIDEO_FRAME_COMP_DATA (out_frame, plane);
+      in_stride = GST_VIDEO_FRAME_COMP_STRIDE (in_frame, plane);
+      out_stride = GST_VIDEO_FRAME_COMP_STRIDE (out_frame, plane);
+      pstride = 1;
+      width = GST_VIDEO_FRAME_COMP_WIDTH (in_frame, plane);
+      height = GST_VIDEO_FRAME_COMP_HEIGHT (in_frame, plane);
+      wsub = GST_VIDEO_FORMAT_INFO_W_SUB (finfo, plane);
+      hsub = GST_VIDEO_FORMAT_INFO_H_SUB (finfo, plane);
+
+      black[0] = plane == 0 ? 0x10 : 0x80;
+    }
+    is_16bit = GST_VIDEO_FORMAT_INFO_DEPTH (finfo, 0) > 8;
 
-  out_offset = y * gt->row_stride + x * gt->pixel_stride;
+    y_start = height * stripe / n_stripes;
+    y_end = height * (stripe + 1) / n_stripes;
 
-  /* operate on out of edge pixels */
-  switch (gt->off_edge_pixels) {
-    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
-      in_x = CLAMP (in_x, 0, gt->width - 1);
-      in_y = CLAMP (in_y, 0, gt->height - 1);
-      break;
+    for (y = y_start; y < y_end; y++) {
+      /* subsampled planes use the map entries of the corresponding luma
+       * pixels, scaled down to the plane */
+      entry = gt->map + (y << hsub) * gt->width;
+      out = out_data + y * out_stride;
 
-    case GST_GT_OFF_EDGES_PIXELS_WRAP:
-      in_x = mod_float (in_x, gt->width);
-      in_y = mod_float (in_y, gt->height);
-      if (in_x < 0)
-        in_x += gt->width;
-      if (in_y < 0)
-        in_y += gt->height;
-      break;
+      for (x = 0; x < width; x++, out += pstride) {
+        const GstGeometricTransformMapEntry *e = entry + (x << wsub);
+        gint in_x, in_y;
 
-    default:
-      break;
+        if (e->x < 0) {
+          memcpy (out, black, pstride);
+          continue;
+        }
+
+        in_x = ((e->x << 8) | e->fx) >> wsub;
+        in_y = ((e->y << 8) | e->fy) >> hsub;
+
+        if (is_16bit)
+          gst_geometric_transform_sample_16 (in_data, in_stride, width,
+              height, GST_VIDEO_FORMAT_INFO_IS_LE (finfo), in_x >> 8,
+              in_y >> 8, in_x & 0xff, in_y & 0xff, out);
+        else
+          gst_geometric_transform_sample_8 (in_data, in_stride, width,
+              height, pstride, in_x >> 8, in_y >> 8, in_x & 0xff,
+              in_y & 0xff, out);
+      }
+    }
   }
+}
 
-  {
-    gint trunc_x = (gint) in_x;
-    gint trunc_y = (gint) in_y;
-    /* only set the values if the values are valid */
-    if (trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
-        trunc_y < gt->height) {
-      in_offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+static void
+gst_geometric_transform_stripe_func (gpointer data, gpointer user_data)
+{
+  GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (user_data);
+  guint stripe = GPOINTER_TO_UINT (data) - 1;
 
-      memcpy (out_data + out_offset, in_data + in_offset, gt->pixel_stride);
-    }
+  gst_geometric_transform_map_stripe (gt, gt->in_frame, gt->out_frame, stripe,
+      gt->n_stripes);
+
+  g_mutex_lock (&gt->stripe_lock);
+  if (--gt->stripes_pending == 0)
+    g_cond_signal (&gt->stripe_cond);
+  g_mutex_unlock (&gt->stripe_lock);
+}
+
+/* must be called with the object lock */
+static void
+gst_geometric_transform_map_frame (GstGeometricTransform * gt,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+{
+  guint n_threads, n_stripes, i;
+
+  n_threads = gt->n_threads;
+  if (n_threads == 0) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    n_threads = g_get_num_processors ();
+#else
+    n_threads = 1;
+#endif
+  }
+
+  n_stripes = MIN (n_threads, gt->height / MIN_STRIPE_HEIGHT);
+
+  if (n_stripes > 1 && gt->pool == NULL) {
+    gt->pool = g_thread_pool_new (gst_geometric_transform_stripe_func, gt,
+        -1, FALSE, NULL);
+  }
+
+  if (n_stripes <= 1 || gt->pool == NULL) {
+    gst_geometric_transform_map_stripe (gt, in_frame, out_frame, 0, 1);
+    return;
   }
+
+  gt->in_frame = in_frame;
+  gt->out_frame = out_frame;
+  gt->n_stripes = n_stripes;
+  gt->stripes_pending = n_stripes - 1;
+
+  /* stripe 0 is mapped here, pass the others + 1 to avoid NULL */
+  for (i = 1; i < n_stripes; i++)
+    g_thread_pool_push (gt->pool, GUINT_TO_POINTER (i + 1), NULL);
+
+  gst_geometric_transform_map_stripe (gt, in_frame, out_frame, 0, n_stripes);
+
+  g_mutex_lock (&gt->stripe_lock);
+  while (gt->stripes_pending > 0)
+    g_cond_wait (&gt->stripe_cond, &gt->stripe_lock);
+  g_mutex_unlock (&gt->stripe_lock);
+
+  gt->in_frame = NULL;
+  gt->out_frame = NULL;
 }
 
 static void
@@ -229,64 +442,31 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
 {
   GstGeometricTransform *gt;
   GstGeometricTransformClass *klass;
-  gint x, y, i;
   GstFlowReturn ret = GST_FLOW_OK;
-  gdouble *ptr;
-  guint8 *in_data;
-  guint8 *out_data;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
-  in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
-  out_data = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
-
-  if (GST_VIDEO_FRAME_FORMAT (out_frame) == GST_VIDEO_FORMAT_AYUV) {
-    /* in AYUV black is not just all zeros:
-     * 0x10 is black for Y,
-     * 0x80 is black for Cr and Cb */
-    for (i = 0; i < out_frame->map[0].size; i += 4)
-      GST_WRITE_UINT32_BE (out_data + i, 0xff108080);
-  } else {
-    memset (out_data, 0, out_frame->map[0].size);
-  }
-
   GST_OBJECT_LOCK (gt);
-  if (gt->precalc_map) {
-    if (gt->needs_remap) {
-      if (klass->prepare_func)
-        if (!klass->prepare_func (gt)) {
-          ret = FALSE;
-          goto end;
-        }
-      gst_geometric_transform_generate_map (gt);
-    }
-    g_return_val_if_fail (gt->map, GST_FLOW_ERROR);
-    ptr = gt->map;
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        /* do the mapping */
-        gst_geometric_transform_do_map (gt, in_data, out_data, x, y, ptr[0],
-            ptr[1]);
-        ptr += 2;
-      }
-    }
-  } else {
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        gdouble in_x, in_y;
-
-        if (klass->map_func (gt, x, y, &in_x, &in_y)) {
-          gst_geometric_transform_do_map (gt, in_data, out_data, x, y, in_x,
-              in_y);
-        } else {
-          GST_WARNING_OBJECT (gt, "Failed to do mapping for %d %d", x, y);
-          ret = GST_FLOW_ERROR;
-          goto end;
-        }
+  /* without a precalculated map the positions can change for every frame */
+  if (gt->needs_remap || !gt->precalc_map) {
+    if (gt->needs_remap && klass->prepare_func)
+      if (!klass->prepare_func (gt)) {
+        ret = GST_FLOW_ERROR;
+        goto end;
       }
+    if (!gst_geometric_transform_generate_map (gt)) {
+      ret = GST_FLOW_ERROR;
+      goto end;
     }
   }
+  if (G_UNLIKELY (gt->map == NULL)) {
+    ret = GST_FLOW_ERROR;
+    goto end;
+  }
+
+  gst_geometric_transform_map_frame (gt, in_frame, out_frame);
+
 end:
   GST_OBJECT_UNLOCK (gt);
   return ret;
@@ -304,6 +484,13 @@ gst_geometric_transform_set_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       GST_OBJECT_LOCK (gt);
       gt->off_edge_pixels = g_value_get_enum (value);
+      /* the off edge pixels are handled when generating the map */
+      gst_geometric_transform_set_need_remap (gt);
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (gt);
+      gt->n_threads = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (gt);
       break;
     default:
@@ -324,6 +511,9 @@ gst_geometric_transform_get_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       g_value_set_enum (value, gt->off_edge_pixels);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, gt->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -344,9 +534,25 @@ gst_geometric_transform_stop (GstBaseTransform * trans)
   g_free (gt->map);
   gt->map = NULL;
 
+  if (gt->pool) {
+    g_thread_pool_free (gt->pool, FALSE, TRUE);
+    gt->pool = NULL;
+  }
+
   return TRUE;
 }
 
+static void
+gst_geometric_transform_finalize (GObject * object)
+{
+  GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (object);
+
+  g_mutex_clear (&gt->stripe_lock);
+  g_cond_clear (&gt->stripe_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_geometric_transform_base_init (gpointer g_class)
 {
@@ -373,6 +579,7 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
 
   obj_class->set_property = gst_geometric_transform_set_property;
   obj_class->get_property = gst_geometric_transform_get_property;
+  obj_class->finalize = gst_geometric_transform_finalize;
 
   trans_class->stop = GST_DEBUG_FUNCPTR (gst_geometric_transform_stop);
   trans_class->before_transform =
@@ -388,6 +595,12 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
           "What to do with off edge pixels",
           GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE, DEFAULT_OFF_EDGE_PIXELS,
           GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (obj_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to map each frame with, 0 means one per CPU",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -396,8 +609,12 @@ gst_geometric_transform_init (GTypeInstance * instance, gpointer g_class)
   GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (instance);
 
   gt->off_edge_pixels = DEFAULT_OFF_EDGE_PIXELS;
+  gt->n_threads = DEFAULT_N_THREADS;
   gt->precalc_map = TRUE;
   gt->needs_remap = TRUE;
+
+  g_mutex_init (&gt->stripe_lock);
+  g_cond_init (&gt->stripe_cond);
 }
 
 GType
@@ -49,6 +49,23 @@ enum
 typedef struct _GstGeometricTransform GstGeometricTransform;
 typedef struct _GstGeometricTransformClass GstGeometricTransformClass;
 
+/**
+ * GstGeometricTransformMapEntry:
+ *
+ * Input position of an output pixel in fixed point with 8 fractional bits,
+ * with the off edge pixels method already applied. @x is -1 if the pixel is
+ * not mapped.
+ *
+ * @x: integer part of the input pixel x coordinate
+ * @y: integer part of the input pixel y coordinate
+ * @fx: fractional part of the x coordinate, in 1/256 pixels
+ * @fy: fractional part of the y coordinate, in 1/256 pixels
+ */
+typedef struct {
+  gint16 x, y;
+  guint8 fx, fy;
+} GstGeometricTransformMapEntry;
+
 /**
  * GstGeometricTransformMapFunc:
  *
@@ -99,8 +116,18 @@ struct _GstGeometricTransform {
 
   /* properties */
   gint off_edge_pixels;
-
-  gdouble *map;
+  guint n_threads;
+
+  GstGeometricTransformMapEntry *map;
+
+  /* stripe threading */
+  GThreadPool *pool;
+  GMutex stripe_lock;
+  GCond stripe_cond;
+  guint stripes_pending;
+  guint n_stripes;
+  GstVideoFrame *in_frame;
+  GstVideoFrame *out_frame;
 };
 
 struct _GstGeometricTransformClass {
@@ -37,6 +37,10 @@
  * stream is inversed telecine'd back to 24 fps, yielding approximately
  * the original videotestsrc content.
  * </refsect2>
+ *
+ * Frames that are reconstructed from two fields of the same input buffer
+ * share the memory of that buffer instead of being copied.  For large
+ * frames, only a subset of the lines is used to compute comb scores.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -67,13 +71,18 @@ static gboolean gst_ivtc_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     GstCaps * outcaps);
 static gboolean gst_ivtc_sink_event (GstBaseTransform * trans,
     GstEvent * event);
+static GstFlowReturn gst_ivtc_prepare_output_buffer (GstBaseTransform * trans,
+    GstBuffer * inbuf, GstBuffer ** outbuf);
 static GstFlowReturn gst_ivtc_transform (GstBaseTransform * trans,
     GstBuffer * inbuf, GstBuffer * outbuf);
+static gboolean gst_ivtc_stop (GstBaseTransform * trans);
 static void gst_ivtc_flush (GstIvtc * ivtc);
 static void gst_ivtc_retire_fields (GstIvtc * ivtc, int n_fields);
+static void gst_ivtc_choose_pair (GstIvtc * ivtc);
 static void gst_ivtc_construct_frame (GstIvtc * itvc, GstBuffer * outbuf);
 
-static int get_comb_score (GstVideoFrame * top, GstVideoFrame * bottom);
+static int get_comb_score (GstIvtc * ivtc, GstVideoFrame * top,
+    GstVideoFrame * bottom);
 
 enum
 {
@@ -82,11 +91,13 @@ enum
 
 /* pad templates */
 
-#define MAX_WIDTH 2048
+/* number of lines above which comb scores are computed on a subset of the
+ * lines */
+#define COMB_MAX_LINES 1088
 #define VIDEO_CAPS \
   "video/x-raw, " \
   "format = (string) { I420, Y444, Y42B }, " \
-  "width = [1, 2048], " \
+  "width = " GST_VIDEO_SIZE_RANGE ", " \
   "height = " GST_VIDEO_SIZE_RANGE ", " \
   "framerate = " GST_VIDEO_FPS_RANGE
 
@@ -133,7 +144,10 @@ gst_ivtc_class_init (GstIvtcClass * klass)
   base_transform_class->fixate_caps = GST_DEBUG_FUNCPTR (gst_ivtc_fixate_caps);
   base_transform_class->set_caps = GST_DEBUG_FUNCPTR (gst_ivtc_set_caps);
   base_transform_class->sink_event = GST_DEBUG_FUNCPTR (gst_ivtc_sink_event);
+  base_transform_class->prepare_output_buffer =
+      GST_DEBUG_FUNCPTR (gst_ivtc_prepare_output_buffer);
   base_transform_class->transform = GST_DEBUG_FUNCPTR (gst_ivtc_transform);
+  base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_ivtc_stop);
 }
 
 static void
@@ -236,6 +250,27 @@ gst_ivtc_set_caps (GstBaseTransform * trans, GstCaps * incaps,
   GST_DEBUG_OBJECT (trans, "field duration %" GST_TIME_FORMAT,
       GST_TIME_ARGS (ivtc->field_duration));
 
+  g_free (ivtc->comb_line);
+  g_free (ivtc->comb_mask);
+  ivtc->comb_line = g_new0 (int, GST_VIDEO_INFO_WIDTH (&ivtc->sink_video_info));
+  ivtc->comb_mask = g_new0 (guint8,
+      GST_VIDEO_INFO_WIDTH (&ivtc->sink_video_info));
+
+  return TRUE;
+}
+
+static gboolean
+gst_ivtc_stop (GstBaseTransform * trans)
+{
+  GstIvtc *ivtc = GST_IVTC (trans);
+
+  gst_ivtc_retire_fields (ivtc, ivtc->n_fields);
+
+  g_free (ivtc->comb_line);
+  ivtc->comb_line = NULL;
+  g_free (ivtc->comb_mask);
+  ivtc->comb_mask = NULL;
+
   return TRUE;
 }
 
@@ -271,6 +306,7 @@ gst_ivtc_flush (GstIvtc * ivtc)
   }
 
   gst_ivtc_retire_fields (ivtc, ivtc->n_fields);
+  ivtc->have_pair = FALSE;
 }
 
 enum
@@ -319,9 +355,9 @@ similarity (GstIvtc * ivtc, int i1, int i2)
   f2 = &ivtc->fields[i2];
 
   if (f1->parity == TOP_FIELD) {
-    score = get_comb_score (&f1->frame, &f2->frame);
+    score = get_comb_score (ivtc, &f1->frame, &f2->frame);
   } else {
-    score = get_comb_score (&f2->frame, &f1->frame);
+    score = get_comb_score (ivtc, &f2->frame, &f1->frame);
   }
 
   GST_DEBUG ("score %d", score);
@@ -335,6 +371,20 @@ similarity (GstIvtc * ivtc, int i1, int i2)
   (((unsigned char *)(((line)&1)?(bottom):(top))->data[k]) + \
       (line) * GST_VIDEO_FRAME_COMP_STRIDE((top), (comp)))
 
+/* Both fields of the chosen pair come from the same input buffer, so the
+ * reconstructed frame is that buffer and its memory can be shared instead of
+ * copying the lines.  Only done when the input has the default layout of the
+ * output. */
+static gboolean
+can_share (GstIvtc * ivtc)
+{
+  int i1 = 1;
+  int i2 = ivtc->pair_index;
+
+  return i2 >= 0 && ivtc->fields[i1].buffer == ivtc->fields[i2].buffer &&
+      gst_buffer_get_video_meta (ivtc->fields[i1].buffer) == NULL;
+}
+
 static void
 reconstruct (GstIvtc * ivtc, GstVideoFrame * dest_frame, int i1, int i2)
 {
@@ -506,15 +556,9 @@ gst_ivtc_retire_fields (GstIvtc * ivtc, int n_fields)
   ivtc->n_fields -= n_fields;
 }
 
-static GstFlowReturn
-gst_ivtc_transform (GstBaseTransform * trans, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static void
+gst_ivtc_add_fields (GstIvtc * ivtc, GstBuffer * inbuf)
 {
-  GstIvtc *ivtc = GST_IVTC (trans);
-  GstFlowReturn ret;
-
-  GST_DEBUG_OBJECT (ivtc, "transform");
-
   if (GST_BUFFER_FLAG_IS_SET (inbuf, GST_VIDEO_BUFFER_FLAG_TFF)) {
     add_field (ivtc, inbuf, TOP_FIELD, 0);
     if (!GST_BUFFER_FLAG_IS_SET (inbuf, GST_VIDEO_BUFFER_FLAG_ONEFIELD)) {
@@ -538,6 +582,47 @@ gst_ivtc_transform (GstBaseTransform * trans, GstBuffer * inbuf,
     GST_DEBUG ("retiring early field");
     gst_ivtc_retire_fields (ivtc, 1);
   }
+}
+
+/* The fields are collected here already, so that a frame made of both fields
+ * of one input buffer can be output as that buffer instead of a buffer
+ * from the pool that the fields would be copied to */
+static GstFlowReturn
+gst_ivtc_prepare_output_buffer (GstBaseTransform * trans, GstBuffer * inbuf,
+    GstBuffer ** outbuf)
+{
+  GstIvtc *ivtc = GST_IVTC (trans);
+
+  gst_ivtc_add_fields (ivtc, inbuf);
+
+  ivtc->output_shared = FALSE;
+  if (ivtc->n_fields >= 4) {
+    gst_ivtc_choose_pair (ivtc);
+
+    if (can_share (ivtc)) {
+      GST_LOG_OBJECT (ivtc, "reusing input buffer %p", ivtc->fields[1].buffer);
+
+      *outbuf = gst_buffer_new ();
+      gst_buffer_copy_into (*outbuf, ivtc->fields[1].buffer,
+          GST_BUFFER_COPY_MEMORY, 0, -1);
+      ivtc->output_shared = TRUE;
+
+      return GST_FLOW_OK;
+    }
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (gst_ivtc_parent_class)->
+      prepare_output_buffer (trans, inbuf, outbuf);
+}
+
+static GstFlowReturn
+gst_ivtc_transform (GstBaseTransform * trans, GstBuffer * inbuf,
+    GstBuffer * outbuf)
+{
+  GstIvtc *ivtc = GST_IVTC (trans);
+  GstFlowReturn ret;
+
+  GST_DEBUG_OBJECT (ivtc, "transform");
 
   GST_DEBUG ("n_fields %d", ivtc->n_fields);
   if (ivtc->n_fields < 4) {
@@ -560,13 +645,15 @@ gst_ivtc_transform (GstBaseTransform * trans, GstBuffer * inbuf,
   return GST_FLOW_OK;
 }
 
+/* Picks the field that goes with the anchor field in the next frame, -1 for
+ * none, and the number of fields to retire after it */
 static void
-gst_ivtc_construct_frame (GstIvtc * ivtc, GstBuffer * outbuf)
+gst_ivtc_choose_pair (GstIvtc * ivtc)
 {
   int anchor_index;
   int prev_score, next_score;
-  GstVideoFrame dest_frame;
   int n_retire;
+  int pair_index;
   gboolean forward_ok;
 
   anchor_index = 1;
@@ -579,26 +666,23 @@ gst_ivtc_construct_frame (GstIvtc * ivtc, GstBuffer * outbuf)
   prev_score = similarity (ivtc, anchor_index - 1, anchor_index);
   next_score = similarity (ivtc, anchor_index, anchor_index + 1);
 
-  gst_video_frame_map (&dest_frame, &ivtc->src_video_info, outbuf,
-      GST_MAP_WRITE);
-
 #define THRESHOLD 100
   if (prev_score < THRESHOLD) {
     if (forward_ok && next_score < prev_score) {
-      reconstruct (ivtc, &dest_frame, anchor_index, anchor_index + 1);
+      pair_index = anchor_index + 1;
       n_retire = anchor_index + 2;
     } else {
       if (prev_score >= THRESHOLD / 2) {
         GST_INFO ("borderline prev (%d, %d)", prev_score, next_score);
       }
-      reconstruct (ivtc, &dest_frame, anchor_index, anchor_index - 1);
+      pair_index = anchor_index - 1;
       n_retire = anchor_index + 1;
     }
   } else if (next_score < THRESHOLD) {
     if (next_score >= THRESHOLD / 2) {
       GST_INFO ("borderline prev (%d, %d)", prev_score, next_score);
     }
-    reconstruct (ivtc, &dest_frame, anchor_index, anchor_index + 1);
+    pair_index = anchor_index + 1;
     if (forward_ok) {
       n_retire = anchor_index + 2;
     } else {
@@ -608,15 +692,47 @@ gst_ivtc_construct_frame (GstIvtc * ivtc, GstBuffer * outbuf)
     if (prev_score < THRESHOLD * 2 || next_score < THRESHOLD * 2) {
       GST_INFO ("borderline single (%d, %d)", prev_score, next_score);
     }
-    reconstruct_single (ivtc, &dest_frame, anchor_index);
+    pair_index = -1;
     n_retire = anchor_index + 1;
   }
 
+  ivtc->pair_index = pair_index;
+  ivtc->n_retire = n_retire;
+  ivtc->have_pair = TRUE;
+}
+
+static void
+gst_ivtc_construct_frame (GstIvtc * ivtc, GstBuffer * outbuf)
+{
+  int anchor_index = 1;
+  GstVideoFrame dest_frame;
+  int n_retire;
+  int pair_index;
+
+  if (!ivtc->have_pair)
+    gst_ivtc_choose_pair (ivtc);
+  pair_index = ivtc->pair_index;
+  n_retire = ivtc->n_retire;
+  ivtc->have_pair = FALSE;
+
+  if (ivtc->output_shared) {
+    GST_DEBUG ("frame matches input buffer");
+  } else {
+    gst_video_frame_map (&dest_frame, &ivtc->src_video_info, outbuf,
+        GST_MAP_WRITE);
+    if (pair_index >= 0) {
+      reconstruct (ivtc, &dest_frame, anchor_index, pair_index);
+    } else {
+      reconstruct_single (ivtc, &dest_frame, anchor_index);
+    }
+    gst_video_frame_unmap (&dest_frame);
+  }
+  /* further frames from the same input are copied */
+  ivtc->output_shared = FALSE;
+
   GST_DEBUG ("retiring %d", n_retire);
   gst_ivtc_retire_fields (ivtc, n_retire);
 
-  gst_video_frame_unmap (&dest_frame);
-
   GST_BUFFER_PTS (outbuf) = ivtc->current_ts;
   GST_BUFFER_DTS (outbuf) = ivtc->current_ts;
   /* FIXME this is not how to produce durations */
@@ -629,33 +745,59 @@ gst_ivtc_construct_frame (GstIvtc * ivtc, GstBuffer * outbuf)
 
 }
 
+/* Marks the pixels of line @src2 that lie outside the range of the lines
+ * above and below it.  There is no dependency between iterations here, so
+ * the compiler can vectorize this loop. */
+static void
+get_comb_mask (guint8 * mask, const guint8 * src1, const guint8 * src2,
+    const guint8 * src3, int width)
+{
+  int i;
+
+  for (i = 0; i < width; i++) {
+    int lo = MIN (src1[i], src3[i]) - 5;
+    int hi = MAX (src1[i], src3[i]) + 5;
+
+    mask[i] = (src2[i] < lo) | (src2[i] > hi);
+  }
+}
+
 static int
-get_comb_score (GstVideoFrame * top, GstVideoFrame * bottom)
+get_comb_score (GstIvtc * ivtc, GstVideoFrame * top, GstVideoFrame * bottom)
 {
   int j;
-  int thisline[MAX_WIDTH];
+  int *thisline = ivtc->comb_line;
+  guint8 *mask = ivtc->comb_mask;
   int score = 0;
   int height;
   int width;
+  int step;
   int k;
 
   height = GST_VIDEO_FRAME_COMP_HEIGHT (top, 0);
   width = GST_VIDEO_FRAME_COMP_WIDTH (top, 0);
 
-  memset (thisline, 0, sizeof (thisline));
+  memset (thisline, 0, sizeof (int) * width);
+
+  /* for large frames, only look at every step-th line, an odd step so that
+   * lines of both fields are compared */
+  step = (height + COMB_MAX_LINES - 1) / COMB_MAX_LINES;
+  if (step % 2 == 0)
+    step++;
 
   k = 0;
   /* remove a few lines from top and bottom, as they sometimes contain
    * artifacts */
-  for (j = 2; j < height - 2; j++) {
+  for (j = 2; j < height - 2; j += step) {
     guint8 *src1 = GET_LINE_IL (top, bottom, 0, j - 1);
     guint8 *src2 = GET_LINE_IL (top, bottom, 0, j);
     guint8 *src3 = GET_LINE_IL (top, bottom, 0, j + 1);
     int i;
 
+    get_comb_mask (mask, src1, src2, src3, width);
+
     for (i = 0; i < width; i++) {
-      if (src2[i] < MIN (src1[i], src3[i]) - 5 ||
-          src2[i] > MAX (src1[i], src3[i]) + 5) {
+      if (mask[i]) {
         if (i > 0) {
           thisline[i] += thisline[i - 1];
         }
@@ -58,6 +58,17 @@ struct _GstIvtc
 
   int n_fields;
   GstIvtcField fields[GST_IVTC_MAX_FIELDS];
+
+  /* field pair of the next frame, chosen when preparing the output buffer */
+  gboolean have_pair;
+  int pair_index;
+  int n_retire;
+  /* the output buffer shares the memory of the input */
+  gboolean output_shared;
+
+  /* per-column comb run lengths and comb mask of the current line */
+  int *comb_line;
+  guint8 *comb_mask;
 };
 
 struct _GstIvtcClass
@@ -54,7 +54,7 @@
 #include "psmux.h"
 #include "crc.h"
 
-static gboolean psmux_packet_out (PsMux * mux);
+static gboolean psmux_packet_out (PsMux * mux, GstBuffer * buf);
 static gboolean psmux_write_pack_header (PsMux * mux);
 static gboolean psmux_write_system_header (PsMux * mux);
 static gboolean psmux_write_program_stream_map (PsMux * mux);
@@ -114,11 +114,25 @@ psmux_set_write_func (PsMux * mux, PsMuxWriteFunc func, void *user_data)
 gboolean
 psmux_write_end_code (PsMux * mux)
 {
-  guint8 end_code[4] = { 0, 0, 1, PSMUX_PROGRAM_END };
-  return mux->write_func (end_code, 4, mux->write_func_data);
+  static const guint8 end_code[4] = { 0, 0, 1, PSMUX_PROGRAM_END };
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (gpointer) end_code, sizeof (end_code), 0, sizeof (end_code), NULL, NULL);
+
+  return mux->write_func (buf, mux->write_func_data);
 }
 
 
+/* Drop the cached system header and PSM, they are regenerated with the
+ * current stream configuration the next time they are needed */
+static void
+psmux_clear_stream_headers (PsMux * mux)
+{
+  gst_buffer_replace (&mux->sys_header, NULL);
+  gst_buffer_replace (&mux->psm, NULL);
+}
+
 /**
  * psmux_free:
  * @mux: a #PsMux
@@ -141,11 +155,7 @@ psmux_free (PsMux * mux)
   }
   g_list_free (mux->streams);
 
-  if (mux->sys_header != NULL)
-    gst_buffer_unref (mux->sys_header);
-
-  if (mux->psm != NULL)
-    gst_buffer_unref (mux->psm);
+  psmux_clear_stream_headers (mux);
 
   g_slice_free (PsMux, mux);
 }
@@ -199,23 +209,29 @@ psmux_create_stream (PsMux * mux, PsMuxStreamType stream_type)
       g_critical ("Number of audio es exceeds upper limit");
   }
 
+  psmux_clear_stream_headers (mux);
+
   return stream;
 }
 
+/* Takes ownership of @buf */
 static gboolean
-psmux_packet_out (PsMux * mux)
+psmux_packet_out (PsMux * mux, GstBuffer * buf)
 {
   gboolean res;
-  if (G_UNLIKELY (mux->write_func == NULL))
+  gsize size;
+
+  if (G_UNLIKELY (mux->write_func == NULL)) {
+    gst_buffer_unref (buf);
     return TRUE;
+  }
 
-  res = mux->write_func (mux->packet_buf, mux->packet_bytes_written,
-      mux->write_func_data);
+  size = gst_buffer_get_size (buf);
+  res = mux->write_func (buf, mux->write_func_data);
 
   if (res) {
-    mux->bit_size += mux->packet_bytes_written;
+    mux->bit_size += size;
   }
-  mux->packet_bytes_written = 0;
   return res;
 }
 
@@ -231,6 +247,7 @@ psmux_packet_out (PsMux * mux)
 gboolean
 psmux_write_stream_packet (PsMux * mux, PsMuxStream * stream)
 {
+  GstBuffer *buf;
   gboolean res;
 
   g_return_val_if_fail (mux != NULL, FALSE);
@@ -280,13 +297,12 @@ psmux_write_stream_packet (PsMux * mux, PsMuxStream * stream)
   }
 
   /* Write the packet */
-  if (!(mux->packet_bytes_written =
-          psmux_stream_get_data (stream, mux->packet_buf,
-              mux->pes_max_payload + PSMUX_PES_MAX_HDR_LEN))) {
+  buf = psmux_stream_get_data (stream,
+      mux->pes_max_payload + PSMUX_PES_MAX_HDR_LEN);
+  if (buf == NULL)
     return FALSE;
-  }
 
-  res = psmux_packet_out (mux);
+  res = psmux_packet_out (mux, buf);
   if (!res) {
     GST_DEBUG_OBJECT (mux, "packet write false");
     return FALSE;
@@ -301,12 +317,13 @@ static gboolean
 psmux_write_pack_header (PsMux * mux)
 {
   bits_buffer_t bw;
+  guint8 data[14];
   guint64 scr = mux->pts;       /* XXX: is this correct? necessary to put any offset? */
   if (mux->pts == -1)
     scr = 0;
 
   /* pack_start_code */
-  bits_initwrite (&bw, 14, mux->packet_buf);
+  bits_initwrite (&bw, 14, data);
   bits_write (&bw, 24, PSMUX_START_CODE_PREFIX);
   bits_write (&bw, 8, PSMUX_PACK_HEADER);
 
@@ -325,8 +342,11 @@ psmux_write_pack_header (PsMux * mux)
     /* Scale to get the mux_rate, rounding up */
     guint mux_rate =
         gst_util_uint64_scale (mux->bit_rate + 8 * 50 - 1, 1, 8 * 50);
-    if (mux_rate > mux->rate_bound / 2)
+    if (mux_rate > mux->rate_bound / 2) {
       mux->rate_bound = mux_rate * 2;
+      /* the system header carries the rate_bound */
+      gst_buffer_replace (&mux->sys_header, NULL);
+    }
     bits_write (&bw, 22, mux_rate);     /* program_mux_rate */
     bits_write (&bw, 2, 3);
   }
@@ -334,8 +354,8 @@ psmux_write_pack_header (PsMux * mux)
   bits_write (&bw, 5, 0x1f);
   bits_write (&bw, 3, 0);       /* pack_stuffing_length */
 
-  mux->packet_bytes_written = 14;
-  return psmux_packet_out (mux);
+  return psmux_packet_out (mux,
+      gst_buffer_new_wrapped (g_memdup (data, sizeof (data)), sizeof (data)));
 }
 
 static void
@@ -396,16 +416,9 @@ psmux_ensure_system_header (PsMux * mux)
 static gboolean
 psmux_write_system_header (PsMux * mux)
 {
-  GstMapInfo map;
-
   psmux_ensure_system_header (mux);
 
-  gst_buffer_map (mux->sys_header, &map, GST_MAP_READ);
-  memcpy (mux->packet_buf, map.data, map.size);
-  mux->packet_bytes_written = map.size;
-  gst_buffer_unmap (mux->sys_header, &map);
-
-  return psmux_packet_out (mux);
+  return psmux_packet_out (mux, gst_buffer_ref (mux->sys_header));
 }
 
 static void
@@ -480,16 +493,9 @@ psmux_ensure_program_stream_map (PsMux * mux)
 static gboolean
 psmux_write_program_stream_map (PsMux * mux)
 {
-  GstMapInfo map;
-
   psmux_ensure_program_stream_map (mux);
 
-  gst_buffer_map (mux->psm, &map, GST_MAP_READ);
-  memcpy (mux->packet_buf, map.data, map.size);
-  mux->packet_bytes_written = map.size;
-  gst_buffer_unmap (mux->psm, &map);
-
-  return psmux_packet_out (mux);
+  return psmux_packet_out (mux, gst_buffer_ref (mux->psm));
 }
 
 GList *
@@ -220,7 +220,7 @@ static void
 psmux_stream_consume (PsMuxStream * stream, guint len)
 {
   g_assert (stream->cur_buffer != NULL);
-  g_assert (len <= stream->cur_buffer->map.size - stream->cur_buffer_consumed);
+  g_assert (len <= stream->cur_buffer->size - stream->cur_buffer_consumed);
 
   stream->cur_buffer_consumed += len;
   stream->bytes_avail -= len;
@@ -231,11 +231,10 @@ psmux_stream_consume (PsMuxStream * stream, guint len)
   if (stream->cur_buffer->pts != -1)
     stream->last_pts = stream->cur_buffer->pts;
 
-  if (stream->cur_buffer_consumed == stream->cur_buffer->map.size) {
+  if (stream->cur_buffer_consumed == stream->cur_buffer->size) {
     /* Current packet is completed, move along */
     stream->buffers = g_list_delete_link (stream->buffers, stream->buffers);
 
-    gst_buffer_unmap (stream->cur_buffer->buf, &stream->cur_buffer->map);
     gst_buffer_unref (stream->cur_buffer->buf);
     g_slice_free (PsMuxStreamBuffer, stream->cur_buffer);
     stream->cur_buffer = NULL;
@@ -262,22 +261,24 @@ psmux_stream_bytes_in_buffer (PsMuxStream * stream)
 /**
  * psmux_stream_get_data:
  * @stream: a #PsMuxStream
- * @buf: a buffer to hold the result
- * @len: the length of @buf
+ * @len: the maximum length of the PES packet
  *
- * Write a PES packet to @buf, up to @len bytes
+ * Create a PES packet of up to @len bytes. The returned buffer holds a newly
+ * allocated memory with the PES header, followed by the memories of the
+ * queued input buffers that make up the payload. No payload data is copied.
  *
- * Returns: number of bytes having been written, 0 if error
+ * Returns: (transfer full): a new #GstBuffer, or %NULL on error
  */
-guint
-psmux_stream_get_data (PsMuxStream * stream, guint8 * buf, guint len)
+GstBuffer *
+psmux_stream_get_data (PsMuxStream * stream, guint len)
 {
+  GstBuffer *buf;
+  GstMapInfo map;
   guint8 pes_hdr_length;
   guint w;
 
-  g_return_val_if_fail (stream != NULL, FALSE);
-  g_return_val_if_fail (buf != NULL, FALSE);
-  g_return_val_if_fail (len >= PSMUX_PES_MAX_HDR_LEN, FALSE);
+  g_return_val_if_fail (stream != NULL, NULL);
+  g_return_val_if_fail (len >= PSMUX_PES_MAX_HDR_LEN, NULL);
 
   stream->cur_pes_payload_size =
       MIN (psmux_stream_bytes_in_buffer (stream), len - PSMUX_PES_MAX_HDR_LEN);
@@ -306,41 +307,42 @@ psmux_stream_get_data (PsMuxStream * stream, guint8 * buf, guint len)
   /* write pes header */
   GST_LOG ("Writing PES header of length %u and payload %d",
       pes_hdr_length, stream->cur_pes_payload_size);
-  psmux_stream_write_pes_header (stream, buf);
+  buf = gst_buffer_new_allocate (NULL, pes_hdr_length, NULL);
+  if (buf == NULL)
+    return NULL;
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  psmux_stream_write_pes_header (stream, map.data);
+  gst_buffer_unmap (buf, &map);
 
-  buf += pes_hdr_length;
   w = stream->cur_pes_payload_size;     /* number of bytes of payload to write */
 
   while (w > 0) {
+    GstBuffer *sub;
     guint32 avail;
-    guint8 *cur;
 
     if (stream->cur_buffer == NULL) {
       /* Start next packet */
-      if (stream->buffers == NULL)
-        return FALSE;
+      if (stream->buffers == NULL) {
+        gst_buffer_unref (buf);
+        return NULL;
+      }
       stream->cur_buffer = (PsMuxStreamBuffer *) (stream->buffers->data);
       stream->cur_buffer_consumed = 0;
     }
 
-    /* Take as much as we can from the current buffer */
-    avail = stream->cur_buffer->map.size - stream->cur_buffer_consumed;
-    cur = stream->cur_buffer->map.data + stream->cur_buffer_consumed;
-    if (avail < w) {
-      memcpy (buf, cur, avail);
-      psmux_stream_consume (stream, avail);
+    /* Take as much as we can from the current buffer, sharing its memory */
+    avail = stream->cur_buffer->size - stream->cur_buffer_consumed;
+    avail = MIN (avail, w);
 
-      buf += avail;
-      w -= avail;
-    } else {
-      memcpy (buf, cur, w);
-      psmux_stream_consume (stream, w);
+    sub = gst_buffer_copy_region (stream->cur_buffer->buf,
+        GST_BUFFER_COPY_MEMORY, stream->cur_buffer_consumed, avail);
+    buf = gst_buffer_append (buf, sub);
+    psmux_stream_consume (stream, avail);
 
-      w = 0;
-    }
+    w -= avail;
   }
 
-  return pes_hdr_length + stream->cur_pes_payload_size;
+  return buf;
 }
 
 static guint8
@@ -395,7 +397,7 @@ psmux_stream_find_pts_dts_within (PsMuxStream * stream, guint bound,
     /* FIXME: This isn't quite correct - if the 'bound' is within this
      * buffer, we don't know if the timestamp is before or after the split
      * so we shouldn't return it */
-    if (bound <= curbuf->map.size) {
+    if (bound <= curbuf->size) {
       *pts = curbuf->pts;
       *dts = curbuf->dts;
       return;
@@ -408,7 +410,7 @@ psmux_stream_find_pts_dts_within (PsMuxStream * stream, guint bound,
       return;
     }
 
-    bound -= curbuf->map.size;
+    bound -= curbuf->size;
   }
 }
 
@@ -496,13 +498,7 @@ psmux_stream_add_data (PsMuxStream * stream, GstBuffer * buffer,
 
   packet = g_slice_new (PsMuxStreamBuffer);
   packet->buf = buffer;
-
-  if (!gst_buffer_map (packet->buf, &packet->map, GST_MAP_READ)) {
-    GST_ERROR ("Failed to map buffer for reading");
-    gst_buffer_unref (packet->buf);
-    g_slice_free (PsMuxStreamBuffer, packet);
-    return;
-  }
+  packet->size = gst_buffer_get_size (buffer);
 
   packet->keyunit = keyunit;
   packet->pts = pts;
@@ -511,7 +507,7 @@ psmux_stream_add_data (PsMuxStream * stream, GstBuffer * buffer,
   if (stream->bytes_avail == 0)
     stream->last_pts = pts;
 
-  stream->bytes_avail += packet->map.size;
+  stream->bytes_avail += packet->size;
   /* FIXME: perhaps use GstQueueArray instead? */
   stream->buffers = g_list_append (stream->buffers, packet);
 
@@ -75,8 +75,12 @@ static GstFlowReturn
 gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
     GstBuffer ** outbuf, guint * read);
 static GstFlowReturn
+gst_mxf_demux_peek_klv_packet (GstMXFDemux * demux, guint64 offset,
+    MXFUL * key, guint * data_offset, guint64 * length);
+static GstFlowReturn
 gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, guint64 offset);
+static void collect_index_table_segments (GstMXFDemux * demux);
 
 GType gst_mxf_demux_pad_get_type (void);
 G_DEFINE_TYPE (GstMXFDemuxPad, gst_mxf_demux_pad, GST_TYPE_PAD);
@@ -150,6 +154,20 @@ gst_mxf_demux_partition_free (GstMXFDemuxPartition * partition)
   g_free (partition);
 }
 
+static void
+gst_mxf_demux_index_table_free (GstMXFDemuxIndexTable * table)
+{
+  guint i;
+
+  for (i = 0; i < table->segments->len; i++)
+    mxf_index_table_segment_reset (&g_array_index (table->segments,
+            MXFIndexTableSegment, i));
+
+  g_array_free (table->segments, TRUE);
+  g_array_free (table->keyframes, TRUE);
+  g_free (table);
+}
+
 static void
 gst_mxf_demux_reset_mxf_state (GstMXFDemux * demux)
 {
@@ -170,6 +188,8 @@ gst_mxf_demux_reset_mxf_state (GstMXFDemux * demux)
 
     if (t->offsets)
       g_array_free (t->offsets, TRUE);
+    if (t->keyframes)
+      g_array_free (t->keyframes, TRUE);
 
     g_free (t->mapping_data);
 
@@ -265,17 +285,10 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
     demux->random_index_pack = NULL;
   }
 
-  if (demux->pending_index_table_segments) {
-    GList *l;
-
-    for (l = demux->pending_index_table_segments; l; l = l->next) {
-      MXFIndexTableSegment *s = l->data;
-      mxf_index_table_segment_reset (s);
-      g_free (s);
-    }
-    g_list_free (demux->pending_index_table_segments);
-    demux->pending_index_table_segments = NULL;
-  }
+  g_list_foreach (demux->index_tables,
+      (GFunc) gst_mxf_demux_index_table_free, NULL);
+  g_list_free (demux->index_tables);
+  demux->index_tables = NULL;
 
   demux->index_table_segments_collected = FALSE;
 
@@ -363,6 +376,309 @@ gst_mxf_demux_partition_compare (GstMXFDemuxPartition * a,
   return (a->partition.this_partition - b->partition.this_partition);
 }
 
+/* Returns the index of the last element of the sorted gint64 array
+ * @positions that is smaller or equal to @position, or -1 */
+static gint
+gst_mxf_demux_find_position (GArray * positions, gint64 position)
+{
+  guint lo = 0, hi = positions->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (g_array_index (positions, gint64, mid) <= position)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return ((gint) lo) - 1;
+}
+
+#define SEGMENT_IS_CBE(s) ((s)->edit_unit_byte_count != 0 && \
+    (s)->n_index_entries == 0)
+
+static GstMXFDemuxIndexTable *
+gst_mxf_demux_get_index_table (GstMXFDemux * demux, guint32 body_sid)
+{
+  GList *l;
+
+  for (l = demux->index_tables; l; l = l->next) {
+    GstMXFDemuxIndexTable *t = l->data;
+
+    if (t->body_sid == body_sid)
+      return t;
+  }
+
+  return NULL;
+}
+
+/* Returns the index of the last segment starting at or before @position,
+ * or -1 */
+static gint
+gst_mxf_demux_index_table_find_segment_index (GstMXFDemuxIndexTable * table,
+    gint64 position)
+{
+  guint lo = 0, hi = table->segments->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    MXFIndexTableSegment *s =
+        &g_array_index (table->segments, MXFIndexTableSegment, mid);
+
+    if (s->index_start_position <= position)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return ((gint) lo) - 1;
+}
+
+static MXFIndexTableSegment *
+gst_mxf_demux_index_table_find_segment (GstMXFDemuxIndexTable * table,
+    gint64 position)
+{
+  MXFIndexTableSegment *segment;
+  gint i;
+
+  i = gst_mxf_demux_index_table_find_segment_index (table, position);
+  if (i < 0)
+    return NULL;
+
+  segment = &g_array_index (table->segments, MXFIndexTableSegment, i);
+
+  if (SEGMENT_IS_CBE (segment)) {
+    /* A CBE segment without duration covers the complete container */
+    if (segment->index_duration == 0
+        || position < segment->index_start_position + segment->index_duration)
+      return segment;
+  } else if (position - segment->index_start_position <
+      segment->n_index_entries) {
+    return segment;
+  }
+
+  return NULL;
+}
+
+/* Gets the offset of the edit unit at @position inside the essence
+ * container and whether it can be decoded on its own */
+static gboolean
+gst_mxf_demux_index_table_get_entry (GstMXFDemuxIndexTable * table,
+    gint64 position, guint64 * stream_offset, gboolean * keyframe)
+{
+  MXFIndexTableSegment *segment;
+  MXFIndexEntry *entry;
+
+  segment = gst_mxf_demux_index_table_find_segment (table, position);
+  if (!segment)
+    return FALSE;
+
+  if (SEGMENT_IS_CBE (segment)) {
+    *stream_offset = position * segment->edit_unit_byte_count;
+    *keyframe = TRUE;
+    return TRUE;
+  }
+
+  entry = &segment->index_entries[position - segment->index_start_position];
+  *stream_offset = entry->stream_offset;
+  /* Without any random access flags all edit units are keyframes */
+  *keyframe = table->keyframes->len == 0 || (entry->flags & 0x80);
+
+  return TRUE;
+}
+
+/* Returns the position of the last keyframe at or before @position, or -1 */
+static gint64
+gst_mxf_demux_index_table_find_keyframe (GstMXFDemuxIndexTable * table,
+    gint64 position)
+{
+  MXFIndexTableSegment *segment;
+  gint i;
+
+  segment = gst_mxf_demux_index_table_find_segment (table, position);
+  if (!segment)
+    return -1;
+
+  if (SEGMENT_IS_CBE (segment) || table->keyframes->len == 0)
+    return position;
+
+  i = gst_mxf_demux_find_position (table->keyframes, position);
+
+  return i >= 0 ? g_array_index (table->keyframes, gint64, i) : -1;
+}
+
+/* Returns the number of edit units covered by @table, or 0 if unknown */
+static gint64
+gst_mxf_demux_index_table_get_duration (GstMXFDemuxIndexTable * table)
+{
+  MXFIndexTableSegment *last;
+
+  if (table->segments->len == 0)
+    return 0;
+
+  last = &g_array_index (table->segments, MXFIndexTableSegment,
+      table->segments->len - 1);
+
+  if (SEGMENT_IS_CBE (last))
+    return last->index_duration ==
+        0 ? 0 : last->index_start_position + last->index_duration;
+
+  return last->index_start_position + last->n_index_entries;
+}
+
+static guint64
+gst_mxf_demux_index_table_segment_stream_offset (MXFIndexTableSegment * s)
+{
+  if (SEGMENT_IS_CBE (s))
+    return s->index_start_position * s->edit_unit_byte_count;
+  else if (s->n_index_entries > 0)
+    return s->index_entries[0].stream_offset;
+  else
+    return G_MAXUINT64;
+}
+
+/* Returns the position of the edit unit containing @stream_offset and
+ * stores the offset where this edit unit starts in @unit_offset, or
+ * returns -1 */
+static gint64
+gst_mxf_demux_index_table_find_position (GstMXFDemuxIndexTable * table,
+    guint64 stream_offset, guint64 * unit_offset)
+{
+  MXFIndexTableSegment *segment;
+  guint lo = 0, hi = table->segments->len;
+  gint64 position;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    MXFIndexTableSegment *s =
+        &g_array_index (table->segments, MXFIndexTableSegment, mid);
+
+    if (gst_mxf_demux_index_table_segment_stream_offset (s) <= stream_offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == 0)
+    return -1;
+
+  segment = &g_array_index (table->segments, MXFIndexTableSegment, lo - 1);
+
+  if (SEGMENT_IS_CBE (segment)) {
+    position = stream_offset / segment->edit_unit_byte_count;
+    if (segment->index_duration != 0 &&
+        position >= segment->index_start_position + segment->index_duration)
+      return -1;
+    *unit_offset = position * segment->edit_unit_byte_count;
+    return position;
+  }
+
+  lo = 0;
+  hi = segment->n_index_entries;
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (segment->index_entries[mid].stream_offset <= stream_offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  *unit_offset = segment->index_entries[lo - 1].stream_offset;
+
+  return segment->index_start_position + lo - 1;
+}
+
+/* Adds @segment to @table and takes ownership of its content. A segment
+ * with the same start position only replaces the old one if it grew, which
+ * happens for the open partitions of files that are still being written */
+static void
+gst_mxf_demux_index_table_add_segment (GstMXFDemuxIndexTable * table,
+    MXFIndexTableSegment * segment)
+{
+  GArray *keyframes;
+  gint i;
+  guint j;
+
+  i = gst_mxf_demux_index_table_find_segment_index (table,
+      segment->index_start_position);
+
+  if (i >= 0) {
+    MXFIndexTableSegment *old =
+        &g_array_index (table->segments, MXFIndexTableSegment, i);
+
+    if (old->index_start_position == segment->index_start_position) {
+      gint first, last;
+
+      if (segment->index_duration <= old->index_duration &&
+          segment->n_index_entries <= old->n_index_entries) {
+        mxf_index_table_segment_reset (segment);
+        return;
+      }
+
+      first = gst_mxf_demux_find_position (table->keyframes,
+          old->index_start_position - 1) + 1;
+      last = gst_mxf_demux_find_position (table->keyframes,
+          old->index_start_position + old->n_index_entries - 1) + 1;
+      if (last > first)
+        g_array_remove_range (table->keyframes, first, last - first);
+
+      mxf_index_table_segment_reset (old);
+      g_array_remove_index (table->segments, i);
+      i--;
+    }
+  }
+
+  g_array_insert_val (table->segments, i + 1, *segment);
+
+  keyframes = g_array_new (FALSE, FALSE, sizeof (gint64));
+  for (j = 0; j < segment->n_index_entries; j++) {
+    if (segment->index_entries[j].flags & 0x80) {
+      gint64 position = segment->index_start_position + j;
+
+      g_array_append_val (keyframes, position);
+    }
+  }
+
+  if (keyframes->len > 0) {
+    gint k = gst_mxf_demux_find_position (table->keyframes,
+        segment->index_start_position - 1) + 1;
+
+    g_array_insert_vals (table->keyframes, k, keyframes->data, keyframes->len);
+  }
+  g_array_free (keyframes, TRUE);
+}
+
+static void
+gst_mxf_demux_essence_track_add_index (GstMXFDemuxEssenceTrack * etrack,
+    gint64 position, guint64 offset, gboolean keyframe)
+{
+  GstMXFDemuxIndex *index;
+  gint i;
+
+  if (!etrack->offsets)
+    etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
+  if (!etrack->keyframes)
+    etrack->keyframes = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  if (etrack->offsets->len <= position)
+    g_array_set_size (etrack->offsets, position + 1);
+
+  index = &g_array_index (etrack->offsets, GstMXFDemuxIndex, position);
+  index->offset = offset;
+  index->keyframe = keyframe;
+
+  /* Keep the keyframe positions sorted for lookups during seeking */
+  i = gst_mxf_demux_find_position (etrack->keyframes, position);
+  if (i >= 0 && g_array_index (etrack->keyframes, gint64, i) == position) {
+    if (!keyframe)
+      g_array_remove_index (etrack->keyframes, i);
+  } else if (keyframe) {
+    g_array_insert_val (etrack->keyframes, i + 1, position);
+  }
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_partition_pack (GstMXFDemux * demux, const MXFUL * key,
     GstBuffer * buffer)
@@ -719,6 +1035,7 @@ gst_mxf_demux_update_essence_tracks (GstMXFDemux * demux)
         tmp.track_number = track->parent.track_number;
         tmp.track_id = track->parent.track_id;
         memcpy (&tmp.source_package_uid, &package->parent.package_uid, 32);
+        tmp.delta_id = -1;
 
         if (demux->current_partition->partition.body_sid == edata->body_sid &&
             demux->current_partition->partition.body_offset == 0)
@@ -749,6 +1066,16 @@ gst_mxf_demux_update_essence_tracks (GstMXFDemux * demux)
       if (track->parent.sequence->duration > etrack->duration)
         etrack->duration = track->parent.sequence->duration;
 
+      /* The metadata of files that are still written is outdated */
+      if (etrack->duration > 0) {
+        GstMXFDemuxIndexTable *table =
+            gst_mxf_demux_get_index_table (demux, etrack->body_sid);
+
+        if (table)
+          etrack->duration = MAX (etrack->duration,
+              gst_mxf_demux_index_table_get_duration (table));
+      }
+
       g_free (etrack->mapping_data);
       etrack->mapping_data = NULL;
       etrack->handler = NULL;
@@ -1592,6 +1919,71 @@ gst_mxf_demux_pad_set_component (GstMXFDemux * demux, GstMXFDemuxPad * pad,
   return ret;
 }
 
+/* Returns the offset of the element described by the delta entry @delta_id
+ * relative to the start of the edit unit at @position */
+static guint64
+gst_mxf_demux_index_table_segment_element_delta (MXFIndexTableSegment *
+    segment, gint64 position, guint delta_id)
+{
+  MXFDeltaEntry *delta = &segment->delta_entries[delta_id];
+  guint64 offset = delta->element_delta;
+
+  if (delta->slice > 0 && delta->slice <= segment->slice_count
+      && !SEGMENT_IS_CBE (segment)) {
+    MXFIndexEntry *entry =
+        &segment->index_entries[position - segment->index_start_position];
+
+    offset += entry->slice_offset[delta->slice - 1];
+  }
+
+  return offset;
+}
+
+/* Looks up the essence element at the current offset in the index table of
+ * its essence container and returns the position of its edit unit, or -1 */
+static gint64
+gst_mxf_demux_find_index_entry (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, gboolean * keyframe)
+{
+  GstMXFDemuxPartition *p = demux->current_partition;
+  GstMXFDemuxIndexTable *table;
+  MXFIndexTableSegment *segment;
+  guint64 stream_offset, unit_offset;
+  gint64 position;
+  guint i;
+
+  table = gst_mxf_demux_get_index_table (demux, p->partition.body_sid);
+  if (!table || p->essence_container_offset == 0)
+    return -1;
+
+  stream_offset =
+      p->partition.body_offset + demux->offset - demux->run_in -
+      p->partition.this_partition - p->essence_container_offset;
+
+  position =
+      gst_mxf_demux_index_table_find_position (table, stream_offset,
+      &unit_offset);
+  if (position == -1
+      || !gst_mxf_demux_index_table_get_entry (table, position, &unit_offset,
+          keyframe))
+    return -1;
+
+  /* Remember which delta entry describes the elements of this track to
+   * find them without reading the complete edit unit when seeking */
+  segment = gst_mxf_demux_index_table_find_segment (table, position);
+  if (etrack->delta_id == -1) {
+    for (i = 0; i < segment->n_delta_entries; i++) {
+      if (gst_mxf_demux_index_table_segment_element_delta (segment, position,
+              i) == stream_offset - unit_offset) {
+        etrack->delta_id = i;
+        break;
+      }
+    }
+  }
+
+  return position;
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, gboolean peek)
@@ -1603,6 +1995,7 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
   GstBuffer *outbuf = NULL;
   GstMXFDemuxEssenceTrack *etrack = NULL;
   gboolean keyframe = TRUE;
+  gint64 index_position;
 
   GST_DEBUG_OBJECT (demux,
       "Handling generic container essence element of size %" G_GSIZE_FORMAT
@@ -1653,7 +2046,13 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     return GST_FLOW_OK;
   }
 
-  if (etrack->position == -1) {
+  index_position = gst_mxf_demux_find_index_entry (demux, etrack, &keyframe);
+
+  if (etrack->position == -1 && index_position != -1) {
+    GST_DEBUG_OBJECT (demux, "Essence track position %" G_GINT64_FORMAT
+        " from index table", index_position);
+    etrack->position = index_position;
+  } else if (etrack->position == -1) {
     GST_DEBUG_OBJECT (demux,
         "Unknown essence track position, looking into index");
     if (etrack->offsets) {
@@ -1713,26 +2112,8 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
   if (outbuf)
     keyframe = !GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
 
-  if (!etrack->offsets)
-    etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
-
-  {
-    if (etrack->offsets->len > etrack->position) {
-      GstMXFDemuxIndex *index =
-          &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
-
-      index->offset = demux->offset - demux->run_in;
-      index->keyframe = keyframe;
-    } else {
-      GstMXFDemuxIndex index;
-
-      index.offset = demux->offset - demux->run_in;
-      index.keyframe = keyframe;
-      if (etrack->offsets->len < etrack->position)
-        g_array_set_size (etrack->offsets, etrack->position);
-      g_array_insert_val (etrack->offsets, etrack->position, index);
-    }
-  }
+  gst_mxf_demux_essence_track_add_index (etrack, etrack->position,
+      demux->offset - demux->run_in, keyframe);
 
   if (peek)
     goto out;
@@ -1895,37 +2276,102 @@ out:
   return ret;
 }
 
+/* Reads the partition at @offset up to the start of its essence and
+ * handles the index table segments on the way. The previous partition as
+ * written in the partition pack is stored in @prev_partition */
 static void
-read_partition_header (GstMXFDemux * demux, guint64 offset)
+gst_mxf_demux_scan_partition (GstMXFDemux * demux, guint64 offset,
+    guint64 * prev_partition)
 {
-  GstBuffer *buf;
+  guint64 old_offset = demux->offset;
+  GstMXFDemuxPartition *old_partition = demux->current_partition;
+  GstMXFDemuxPartition *p;
+  MXFPartitionPack partition;
+  GstBuffer *buffer = NULL;
+  GstMapInfo map;
   MXFUL key;
-  guint read;
+  guint read, data_offset;
+  guint64 length;
+  gboolean ret;
 
-  if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buf, &read)
-      != GST_FLOW_OK)
-    return;
-  offset += read;
+  *prev_partition = 0;
 
-  if (!mxf_is_partition_pack (&key)) {
-    gst_buffer_unref (buf);
-    return;
-  }
+  demux->offset = demux->run_in + offset;
+  if (gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+          &read) != GST_FLOW_OK)
+    goto out;
 
-  do {
-    gst_buffer_unref (buf);
-    if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buf, &read)
-        != GST_FLOW_OK)
-      return;
-    offset += read;
-  }
-  while (mxf_is_fill (&key));
+  if (!mxf_is_partition_pack (&key))
+    goto out;
+
+  /* The partition list links all partitions we know about, but we want
+   * to follow the partitions that are really in the file */
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  ret = mxf_partition_pack_parse (&key, &partition, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  if (!ret)
+    goto out;
+
+  *prev_partition = partition.prev_partition;
+  mxf_partition_pack_reset (&partition);
+
+  if (gst_mxf_demux_handle_partition_pack (demux, &key, buffer) != GST_FLOW_OK)
+    goto out;
+
+  gst_buffer_unref (buffer);
+  buffer = NULL;
+
+  p = demux->current_partition;
+  if (p->scanned)
+    goto out;
+
+  demux->offset += read;
+
+  while (gst_mxf_demux_peek_klv_packet (demux, demux->offset, &key,
+          &data_offset, &length) == GST_FLOW_OK) {
+    if (mxf_is_partition_pack (&key) || mxf_is_random_index_pack (&key))
+      break;
+
+    if (mxf_is_generic_container_system_item (&key) ||
+        mxf_is_generic_container_essence_element (&key) ||
+        mxf_is_avid_essence_container_essence_element (&key)) {
+      if (p->essence_container_offset == 0)
+        p->essence_container_offset =
+            demux->offset - demux->run_in - p->partition.this_partition;
+      break;
+    }
+
+    if (mxf_is_primer_pack (&key) || mxf_is_index_table_segment (&key)) {
+      if (gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+              &read) != GST_FLOW_OK)
+        break;
+
+      if (mxf_is_primer_pack (&key))
+        gst_mxf_demux_handle_primer_pack (demux, &key, buffer);
+      else
+        gst_mxf_demux_handle_index_table_segment (demux, &key, buffer,
+            demux->offset);
 
-  if (mxf_is_index_table_segment (&key)) {
-    gst_mxf_demux_handle_index_table_segment (demux, &key, buf, offset);
+      gst_buffer_unref (buffer);
+      buffer = NULL;
+    }
+
+    /* The header byte count includes the primer pack, skip all of the
+     * header metadata at once */
+    if (mxf_is_primer_pack (&key) && p->partition.header_byte_count != 0)
+      demux->offset += p->partition.header_byte_count;
+    else
+      demux->offset += data_offset + length;
   }
 
-  gst_buffer_unref (buf);
+  p->scanned = TRUE;
+
+out:
+  if (buffer)
+    gst_buffer_unref (buffer);
+
+  demux->offset = old_offset;
+  demux->current_partition = old_partition;
 }
 
 static GstFlowReturn
@@ -2001,26 +2447,16 @@ gst_mxf_demux_handle_random_index_pack (GstMXFDemux * demux, const MXFUL * key,
   return GST_FLOW_OK;
 }
 
-static gint
-compare_index_table_segments (gconstpointer comparee, gconstpointer compared)
-{
-  MXFIndexTableSegment *comparee_segment, *compared_segment;
-
-  comparee_segment = (MXFIndexTableSegment *) comparee;
-  compared_segment = (MXFIndexTableSegment *) compared;
-
-  /* FIXME : is that the correct comparison ? */
-  return comparee_segment->index_start_position -
-      compared_segment->index_start_position;
-}
-
 static GstFlowReturn
 gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, guint64 offset)
 {
-  MXFIndexTableSegment *segment;
+  MXFIndexTableSegment segment;
+  GstMXFDemuxIndexTable *table = NULL;
   GstMapInfo map;
   gboolean ret;
+  gint64 duration;
+  guint i;
   GList *l;
 
   GST_DEBUG_OBJECT (demux,
@@ -2031,10 +2467,10 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     GST_WARNING_OBJECT (demux, "Invalid primer pack");
   }
 
-  segment = g_new0 (MXFIndexTableSegment, 1);
+  memset (&segment, 0, sizeof (segment));
 
   gst_buffer_map (buffer, &map, GST_MAP_READ);
-  ret = mxf_index_table_segment_parse (key, segment,
+  ret = mxf_index_table_segment_parse (key, &segment,
       &demux->current_partition->primer, map.data, map.size);
   gst_buffer_unmap (buffer, &map);
 
@@ -2043,30 +2479,58 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     return GST_FLOW_ERROR;
   }
 
-  segment->stream_offset = offset;
-  l = g_list_find_custom (demux->pending_index_table_segments, segment,
-      (GCompareFunc) compare_index_table_segments);
+  segment.stream_offset = offset;
 
-  /* Prevent duplicates */
-  if (l == NULL) {
-    demux->pending_index_table_segments =
-        g_list_prepend (demux->pending_index_table_segments, segment);
-  } else {
-    mxf_index_table_segment_reset (segment);
-    g_free (segment);
+  /* Some writers don't set the body SID in the segments */
+  if (segment.body_sid == 0)
+    segment.body_sid = demux->current_partition->partition.body_sid;
+
+  for (l = demux->index_tables; l; l = l->next) {
+    GstMXFDemuxIndexTable *tmp = l->data;
+
+    if (tmp->body_sid == segment.body_sid &&
+        tmp->index_sid == segment.index_sid) {
+      table = tmp;
+      break;
+    }
+  }
+
+  if (!table) {
+    table = g_new0 (GstMXFDemuxIndexTable, 1);
+    table->body_sid = segment.body_sid;
+    table->index_sid = segment.index_sid;
+    table->segments = g_array_new (FALSE, FALSE, sizeof (MXFIndexTableSegment));
+    table->keyframes = g_array_new (FALSE, FALSE, sizeof (gint64));
+    demux->index_tables = g_list_append (demux->index_tables, table);
+  }
+
+  gst_mxf_demux_index_table_add_segment (table, &segment);
+
+  /* Follow files that are still growing */
+  duration = gst_mxf_demux_index_table_get_duration (table);
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *etrack =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (etrack->body_sid == table->body_sid && etrack->duration > 0
+        && etrack->duration < duration) {
+      GST_DEBUG_OBJECT (demux, "Essence track %u grew to %" G_GINT64_FORMAT
+          " edit units", etrack->track_number, duration);
+      etrack->duration = duration;
+    }
   }
 
   return GST_FLOW_OK;
 }
 
+/* Pulls only the key and the BER encoded length of the KLV packet at
+ * @offset */
 static GstFlowReturn
-gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
-    GstBuffer ** outbuf, guint * read)
+gst_mxf_demux_peek_klv_packet (GstMXFDemux * demux, guint64 offset,
+    MXFUL * key, guint * data_offset, guint64 * length)
 {
   GstBuffer *buffer = NULL;
   const guint8 *data;
-  guint64 data_offset = 0;
-  guint64 length;
   GstFlowReturn ret = GST_FLOW_OK;
   GstMapInfo map;
 #ifndef GST_DISABLE_GST_DEBUG
@@ -2089,12 +2553,12 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
 
   /* Decode BER encoded packet length */
   if ((map.data[16] & 0x80) == 0) {
-    length = map.data[16];
-    data_offset = 17;
+    *length = map.data[16];
+    *data_offset = 17;
   } else {
     guint slen = map.data[16] & 0x7f;
 
-    data_offset = 16 + 1 + slen;
+    *data_offset = 16 + 1 + slen;
 
     gst_buffer_unmap (buffer, &map);
     gst_buffer_unref (buffer);
@@ -2115,9 +2579,9 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
     gst_buffer_map (buffer, &map, GST_MAP_READ);
 
     data = map.data;
-    length = 0;
+    *length = 0;
     while (slen) {
-      length = (length << 8) | *data;
+      *length = (*length << 8) | *data;
       data++;
       slen--;
     }
@@ -2127,32 +2591,47 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
   gst_buffer_unref (buffer);
   buffer = NULL;
 
+  GST_DEBUG_OBJECT (demux, "KLV packet with key %s has length "
+      "%" G_GUINT64_FORMAT, mxf_ul_to_string (key, str), *length);
+
+beach:
+  if (buffer)
+    gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
+    GstBuffer ** outbuf, guint * read)
+{
+  GstBuffer *buffer = NULL;
+  guint data_offset = 0;
+  guint64 length = 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  ret = gst_mxf_demux_peek_klv_packet (demux, offset, key, &data_offset,
+      &length);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
   /* GStreamer's buffer sizes are stored in a guint so we
    * limit ourself to G_MAXUINT large buffers */
   if (length > G_MAXUINT) {
     GST_ERROR_OBJECT (demux,
         "Unsupported KLV packet length: %" G_GUINT64_FORMAT, length);
-    ret = GST_FLOW_ERROR;
-    goto beach;
+    return GST_FLOW_ERROR;
   }
 
-  GST_DEBUG_OBJECT (demux, "KLV packet with key %s has length "
-      "%" G_GUINT64_FORMAT, mxf_ul_to_string (key, str), length);
-
   /* Pull the complete KLV packet */
   if ((ret = gst_mxf_demux_pull_range (demux, offset + data_offset, length,
               &buffer)) != GST_FLOW_OK)
-    goto beach;
+    return ret;
 
   *outbuf = buffer;
-  buffer = NULL;
   if (read)
     *read = data_offset + length;
 
-beach:
-  if (buffer)
-    gst_buffer_unref (buffer);
-
   return ret;
 }
 
@@ -2504,6 +2983,16 @@ gst_mxf_demux_handle_klv_packet (GstMXFDemux * demux, const MXFUL * key,
     }
   }
 
+  /* In pull mode build the index tables of all partitions before starting */
+  if (mxf_is_partition_pack (key) && ret == GST_FLOW_OK
+      && demux->random_access && !demux->index_table_segments_collected
+      && demux->current_partition
+      && demux->current_partition->partition.type ==
+      MXF_PARTITION_PACK_HEADER) {
+    collect_index_table_segments (demux);
+    demux->index_table_segments_collected = TRUE;
+  }
+
 beach:
   return ret;
 }
@@ -2523,29 +3012,71 @@ gst_mxf_demux_set_partition_for_offset (GstMXFDemux * demux, guint64 offset)
   }
 }
 
+/* Converts an offset inside the essence container @body_sid to a file
+ * offset relative to the run-in, or returns -1 if no known partition
+ * contains it */
 static guint64
-get_offset_from_index_table_segments (GstMXFDemux * demux, gint64 position,
-    gint64 * index_start_position)
+gst_mxf_demux_find_essence_offset (GstMXFDemux * demux, guint32 body_sid,
+    guint64 stream_offset)
 {
+  GstMXFDemuxPartition *partition = NULL;
   GList *l;
-  gint64 start, end;
-  gboolean return_offset = FALSE;
 
-  for (l = demux->pending_index_table_segments; l != NULL; l = l->next) {
-    MXFIndexTableSegment *segment = (MXFIndexTableSegment *) l->data;
-    start = segment->index_start_position;
-    end = start + segment->index_duration;
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *p = l->data;
 
-    if (return_offset)
-      return segment->stream_offset;
+    if (p->partition.body_sid != body_sid || p->essence_container_offset == 0
+        || p->partition.body_offset > stream_offset)
+      continue;
 
-    if (start <= position && position < end) {
-      *index_start_position = segment->index_start_position;
-      return_offset = TRUE;
-    }
+    if (!partition || p->partition.body_offset >= partition->partition.body_offset)
+      partition = p;
   }
 
-  return 0;
+  if (!partition)
+    return -1;
+
+  return partition->partition.this_partition +
+      partition->essence_container_offset + stream_offset -
+      partition->partition.body_offset;
+}
+
+/* Finds the element of @etrack in the edit unit at @position, which starts
+ * at @offset, by using the delta entries of the index table */
+static guint64
+gst_mxf_demux_find_essence_element_in_edit_unit (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, GstMXFDemuxIndexTable * table,
+    gint64 position, guint64 offset)
+{
+  MXFIndexTableSegment *segment;
+  guint64 element_offset;
+  guint data_offset;
+  guint64 length;
+  MXFUL key;
+
+  segment = gst_mxf_demux_index_table_find_segment (table, position);
+  if (etrack->delta_id == -1
+      || (guint) etrack->delta_id >= segment->n_delta_entries)
+    return -1;
+
+  element_offset = offset +
+      gst_mxf_demux_index_table_segment_element_delta (segment, position,
+      etrack->delta_id);
+
+  /* Make sure the delta entries are not lying */
+  if (gst_mxf_demux_peek_klv_packet (demux, demux->run_in + element_offset,
+          &key, &data_offset, &length) != GST_FLOW_OK)
+    return -1;
+
+  if (!mxf_is_generic_container_essence_element (&key) &&
+      !mxf_is_avid_essence_container_essence_element (&key))
+    return -1;
+
+  if (etrack->track_number != 0 &&
+      GST_READ_UINT32_BE (&key.u[12]) != etrack->track_number)
+    return -1;
+
+  return element_offset;
 }
 
 static guint64
@@ -2555,6 +3086,9 @@ gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
   GstFlowReturn ret = GST_FLOW_OK;
   guint64 old_offset = demux->offset;
   GstMXFDemuxPartition *old_partition = demux->current_partition;
+  GstMXFDemuxIndexTable *table;
+  gint64 target = *position;
+  gint64 start_position = 0;
   gint i;
 
   GST_DEBUG_OBJECT (demux, "Trying to find essence element %" G_GINT64_FORMAT
@@ -2563,7 +3097,13 @@ gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
 
 from_index:
 
-  if (etrack->duration > 0 && *position >= etrack->duration) {
+  table = gst_mxf_demux_get_index_table (demux, etrack->body_sid);
+  if (table && !gst_mxf_demux_index_table_find_segment (table, *position))
+    table = NULL;
+
+  /* The duration of files that are still growing is outdated, trust the
+   * index table instead */
+  if (etrack->duration > 0 && *position >= etrack->duration && !table) {
     GST_WARNING_OBJECT (demux, "Position after end of essence track");
     return -1;
   }
@@ -2572,34 +3112,96 @@ from_index:
   if (etrack->offsets && etrack->offsets->len > *position) {
     GstMXFDemuxIndex *idx =
         &g_array_index (etrack->offsets, GstMXFDemuxIndex, *position);
-    guint64 current_offset = -1;
-    gint64 current_position = *position;
 
     if (idx->offset != 0 && (!keyframe || idx->keyframe)) {
-      current_offset = idx->offset;
-    } else if (idx->offset != 0) {
-      current_position--;
-      while (current_position >= 0) {
-        idx =
-            &g_array_index (etrack->offsets, GstMXFDemuxIndex,
-            current_position);
-        if (idx->offset == 0) {
-          break;
-        } else if (!idx->keyframe) {
-          current_position--;
-          continue;
-        } else {
-          current_offset = idx->offset;
-          break;
-        }
-      }
+      GST_DEBUG_OBJECT (demux, "Found in index at offset %" G_GUINT64_FORMAT,
+          idx->offset);
+      return idx->offset;
     }
+  }
+
+  /* Then look up the edit unit in the index table segments */
+  if (table) {
+    gint64 unit_position = *position;
+    guint64 stream_offset, offset;
+    gboolean unit_keyframe;
 
-    if (current_offset != -1) {
+    if (keyframe)
+      unit_position =
+          gst_mxf_demux_index_table_find_keyframe (table, *position);
+
+    if (unit_position != -1 && etrack->offsets
+        && etrack->offsets->len > unit_position
+        && g_array_index (etrack->offsets, GstMXFDemuxIndex,
+            unit_position).offset != 0) {
+      *position = unit_position;
       GST_DEBUG_OBJECT (demux, "Found in index at offset %" G_GUINT64_FORMAT,
-          current_offset);
-      *position = current_position;
-      return current_offset;
+          g_array_index (etrack->offsets, GstMXFDemuxIndex,
+              unit_position).offset);
+      return g_array_index (etrack->offsets, GstMXFDemuxIndex,
+          unit_position).offset;
+    }
+
+    if (unit_position != -1
+        && gst_mxf_demux_index_table_get_entry (table, unit_position,
+            &stream_offset, &unit_keyframe)
+        && (offset = gst_mxf_demux_find_essence_offset (demux,
+                etrack->body_sid, stream_offset)) != -1) {
+      guint64 element_offset = -1;
+
+      GST_DEBUG_OBJECT (demux, "Edit unit %" G_GINT64_FORMAT " at offset %"
+          G_GUINT64_FORMAT " according to the index table", unit_position,
+          offset);
+
+      if (!demux->random_access) {
+        /* The positions are recovered from the index table once the
+         * data arrives */
+        *position = unit_position;
+        return offset;
+      }
+
+      element_offset =
+          gst_mxf_demux_find_essence_element_in_edit_unit (demux, etrack,
+          table, unit_position, offset);
+      if (element_offset != -1) {
+        GST_DEBUG_OBJECT (demux, "Found at offset %" G_GUINT64_FORMAT,
+            element_offset);
+        gst_mxf_demux_essence_track_add_index (etrack, unit_position,
+            element_offset, unit_keyframe);
+        *position = unit_position;
+        return element_offset;
+      }
+
+      /* Otherwise peek at the elements of this edit unit below */
+      target = unit_position;
+      demux->offset = offset + demux->run_in;
+      gst_mxf_demux_set_partition_for_offset (demux, demux->offset);
+
+      for (i = 0; i < demux->essence_tracks->len; i++) {
+        GstMXFDemuxEssenceTrack *t =
+            &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+        t->position = (t->body_sid == etrack->body_sid) ? unit_position : -1;
+      }
+
+      goto scan;
+    }
+  }
+
+  /* Then use the keyframes we already know about */
+  if (keyframe && etrack->keyframes && etrack->keyframes->len) {
+    i = gst_mxf_demux_find_position (etrack->keyframes, *position);
+
+    if (i >= 0) {
+      gint64 keyframe_position = g_array_index (etrack->keyframes, gint64, i);
+      GstMXFDemuxIndex *idx = &g_array_index (etrack->offsets,
+          GstMXFDemuxIndex, keyframe_position);
+
+      GST_DEBUG_OBJECT (demux, "Found keyframe %" G_GINT64_FORMAT
+          " in index at offset %" G_GUINT64_FORMAT, keyframe_position,
+          idx->offset);
+      *position = keyframe_position;
+      return idx->offset;
     }
   }
 
@@ -2609,11 +3211,11 @@ from_index:
     gint64 new_position = -1;
 
     if (etrack->offsets && etrack->offsets->len) {
-      for (i = etrack->offsets->len - 1; i >= 0; i--) {
+      for (i = MIN (etrack->offsets->len - 1, *position); i >= 0; i--) {
         GstMXFDemuxIndex *idx =
             &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
 
-        if (idx->offset != 0 && i <= *position && (!keyframe || idx->keyframe)) {
+        if (idx->offset != 0 && (!keyframe || idx->keyframe)) {
           new_offset = idx->offset;
           new_position = i;
           break;
@@ -2625,109 +3227,106 @@ from_index:
       *position = new_position;
       return new_offset;
     }
-  } else if (demux->random_access) {
-    gint64 index_start_position = -1;
-    guint64 offset;
 
-    demux->offset = demux->run_in;
-    if (etrack->offsets && etrack->offsets->len) {
-      for (i = etrack->offsets->len - 1; i >= 0; i--) {
-        GstMXFDemuxIndex *idx =
-            &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
+    return -1;
+  }
 
-        if (idx->offset != 0 && i <= *position) {
-          demux->offset = idx->offset + demux->run_in;
-          break;
-        }
+  /* Start from the last element of the track we know about before the
+   * requested one */
+  demux->offset = demux->run_in;
+  if (etrack->offsets && etrack->offsets->len) {
+    for (i = MIN (etrack->offsets->len - 1, *position); i >= 0; i--) {
+      GstMXFDemuxIndex *idx =
+          &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
+
+      if (idx->offset != 0) {
+        demux->offset = idx->offset + demux->run_in;
+        start_position = i;
+        break;
       }
     }
+  }
 
-    offset =
-        get_offset_from_index_table_segments (demux, *position,
-        &index_start_position);
-
-    demux->offset = offset;
+  gst_mxf_demux_set_partition_for_offset (demux, demux->offset);
 
-    gst_mxf_demux_set_partition_for_offset (demux, demux->offset);
-
-    for (i = 0; i < demux->essence_tracks->len; i++) {
-      GstMXFDemuxEssenceTrack *t =
-          &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *t =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
 
-      if (index_start_position != -1)
-        t->position = index_start_position;
-      else
-        t->position = (demux->offset == demux->run_in) ? 0 : -1;
-    }
+    if (t == etrack)
+      t->position = start_position;
+    else
+      t->position = (demux->offset == demux->run_in) ? 0 : -1;
+  }
 
-    /* Else peek at all essence elements and complete our
-     * index until we find the requested element
-     */
-    while (ret == GST_FLOW_OK) {
-      GstBuffer *buffer = NULL;
-      MXFUL key;
-      guint read = 0;
+scan:
+  /* Else peek at all essence elements and complete our
+   * index until we find the requested element
+   */
+  while (ret == GST_FLOW_OK) {
+    GstBuffer *buffer = NULL;
+    MXFUL key;
+    guint read = 0;
 
-      ret =
-          gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
-          &read);
+    ret =
+        gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+        &read);
 
-      if (ret == GST_FLOW_EOS) {
-        for (i = 0; i < demux->essence_tracks->len; i++) {
-          GstMXFDemuxEssenceTrack *t =
-              &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
-              i);
+    if (ret == GST_FLOW_EOS) {
+      for (i = 0; i < demux->essence_tracks->len; i++) {
+        GstMXFDemuxEssenceTrack *t =
+            &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
+            i);
 
-          if (t->position > 0)
-            t->duration = t->position;
-        }
-        /* For the searched track this is really our position */
-        etrack->duration = etrack->position;
+        if (t->position > 0)
+          t->duration = t->position;
+      }
+      /* For the searched track this is really our position */
+      etrack->duration = etrack->position;
 
-        for (i = 0; i < demux->src->len; i++) {
-          GstMXFDemuxPad *p = g_ptr_array_index (demux->src, i);
+      for (i = 0; i < demux->src->len; i++) {
+        GstMXFDemuxPad *p = g_ptr_array_index (demux->src, i);
 
-          if (!p->eos
-              && p->current_essence_track_position >=
-              p->current_essence_track->duration) {
-            GstEvent *e;
+        if (!p->eos
+            && p->current_essence_track_position >=
+            p->current_essence_track->duration) {
+          GstEvent *e;
 
-            p->eos = TRUE;
-            e = gst_event_new_eos ();
-            gst_event_set_seqnum (e, demux->seqnum);
-            gst_pad_push_event (GST_PAD_CAST (p), e);
-          }
+          p->eos = TRUE;
+          e = gst_event_new_eos ();
+          gst_event_set_seqnum (e, demux->seqnum);
+          gst_pad_push_event (GST_PAD_CAST (p), e);
         }
       }
+    }
 
-      if (G_UNLIKELY (ret != GST_FLOW_OK) && etrack->position <= *position) {
-        demux->offset = old_offset;
-        demux->current_partition = old_partition;
-        break;
-      } else if (G_UNLIKELY (ret == GST_FLOW_OK)) {
-        ret = gst_mxf_demux_handle_klv_packet (demux, &key, buffer, TRUE);
-        gst_buffer_unref (buffer);
-      }
-
-      /* If we found the position read it from the index again */
-      if (((ret == GST_FLOW_OK && etrack->position == *position + 2) ||
-              (ret == GST_FLOW_EOS && etrack->position == *position + 1))
-          && etrack->offsets && etrack->offsets->len > *position
-          && g_array_index (etrack->offsets, GstMXFDemuxIndex,
-              *position).offset != 0) {
-        GST_DEBUG_OBJECT (demux, "Found at offset %" G_GUINT64_FORMAT,
-            demux->offset);
-        demux->offset = old_offset;
-        demux->current_partition = old_partition;
-        goto from_index;
-      }
-      demux->offset += read;
+    if (G_UNLIKELY (ret != GST_FLOW_OK) && etrack->position <= target) {
+      demux->offset = old_offset;
+      demux->current_partition = old_partition;
+      break;
+    } else if (G_UNLIKELY (ret == GST_FLOW_OK)) {
+      ret = gst_mxf_demux_handle_klv_packet (demux, &key, buffer, TRUE);
+      gst_buffer_unref (buffer);
     }
-    demux->offset = old_offset;
-    demux->current_partition = old_partition;
 
-    GST_DEBUG_OBJECT (demux, "Not found in this file");
+    /* If we found the position read it from the index again */
+    if (((ret == GST_FLOW_OK && etrack->position == target + 2) ||
+            (ret == GST_FLOW_EOS && etrack->position == target + 1))
+        && etrack->offsets && etrack->offsets->len > target
+        && g_array_index (etrack->offsets, GstMXFDemuxIndex,
+            target).offset != 0) {
+      GST_DEBUG_OBJECT (demux, "Found at offset %" G_GUINT64_FORMAT,
+          demux->offset);
+      demux->offset = old_offset;
+      demux->current_partition = old_partition;
+      goto from_index;
+    }
+    demux->offset += read;
   }
+  demux->offset = old_offset;
+  demux->current_partition = old_partition;
+
+  GST_DEBUG_OBJECT (demux, "Not found in this file");
 
   return -1;
 }
@@ -3400,35 +3999,43 @@ no_new_offset:
 static void
 collect_index_table_segments (GstMXFDemux * demux)
 {
+  guint64 offset, prev_partition;
   guint i;
-  GList *l;
 
-  if (!demux->random_index_pack)
-    return;
-
-  for (i = 0; i < demux->random_index_pack->len; i++) {
-    GstMXFDemuxPartition *p = NULL;
-    MXFRandomIndexPackEntry *e =
-        &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry, i);
+  if (demux->random_index_pack) {
+    for (i = 0; i < demux->random_index_pack->len; i++) {
+      MXFRandomIndexPackEntry *e =
+          &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry,
+          i);
+
+      if (e->offset < demux->run_in) {
+        GST_ERROR_OBJECT (demux, "Invalid random index pack entry");
+        return;
+      }
 
-    if (e->offset < demux->run_in) {
-      GST_ERROR_OBJECT (demux, "Invalid random index pack entry");
-      return;
+      gst_mxf_demux_scan_partition (demux, e->offset - demux->run_in,
+          &prev_partition);
     }
 
-    for (l = demux->partitions; l; l = l->next) {
-      GstMXFDemuxPartition *tmp = l->data;
+    return;
+  }
 
-      if (tmp->partition.this_partition + demux->run_in == e->offset) {
-        p = tmp;
-        break;
-      }
-    }
+  /* Without random index pack walk backwards from the footer partition.
+   * Files that are still being written have none yet and we pick up the
+   * new partitions while reading them */
+  offset = demux->footer_partition_pack_offset;
+  while (offset != 0) {
+    gst_mxf_demux_scan_partition (demux, offset, &prev_partition);
 
-    if (p) {
-      read_partition_header (demux, p->partition.this_partition);
+    if (prev_partition >= offset) {
+      GST_WARNING_OBJECT (demux, "Invalid previous partition offset");
+      break;
     }
+
+    offset = prev_partition;
   }
+
+  gst_mxf_demux_scan_partition (demux, 0, &prev_partition);
 }
 
 static gboolean
@@ -54,6 +54,9 @@ typedef struct
   MXFPrimerPack primer;
   gboolean parsed_metadata;
   guint64 essence_container_offset;
+
+  /* partition was read up to its essence, including the index segments */
+  gboolean scanned;
 } GstMXFDemuxPartition;
 
 typedef struct
@@ -62,6 +65,18 @@ typedef struct
   gboolean keyframe;
 } GstMXFDemuxIndex;
 
+typedef struct
+{
+  guint32 body_sid;
+  guint32 index_sid;
+
+  /* MXFIndexTableSegment, sorted by index start position */
+  GArray *segments;
+
+  /* positions of the edit units with random access, sorted */
+  GArray *keyframes;
+} GstMXFDemuxIndexTable;
+
 typedef struct
 {
   guint32 body_sid;
@@ -74,6 +89,10 @@ typedef struct
   gint64 duration;
 
   GArray *offsets;
+  /* positions of the keyframes in offsets, sorted */
+  GArray *keyframes;
+  /* index of the track's element in the delta entries, or -1 */
+  gint delta_id;
 
   MXFMetadataSourcePackage *source_package;
   MXFMetadataTimelineTrack *source_track;
@@ -153,7 +172,9 @@ struct _GstMXFDemux
   GstMXFDemuxPartition *current_partition;
 
   GArray *essence_tracks;
-  GList *pending_index_table_segments;
+
+  /* GstMXFDemuxIndexTable, one per index SID */
+  GList *index_tables;
 
   gboolean index_table_segments_collected;
 
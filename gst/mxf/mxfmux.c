@@ -52,9 +52,12 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("application/mxf")
     );
 
+#define DEFAULT_BODY_PARTITION_INTERVAL (10 * GST_SECOND)
+
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_BODY_PARTITION_INTERVAL
 };
 
 #define gst_mxf_mux_parent_class parent_class
@@ -110,6 +113,14 @@ gst_mxf_mux_class_init (GstMXFMuxClass * klass)
   gobject_class->set_property = gst_mxf_mux_set_property;
   gobject_class->get_property = gst_mxf_mux_get_property;
 
+  g_object_class_install_property (gobject_class, PROP_BODY_PARTITION_INTERVAL,
+      g_param_spec_uint64 ("body-partition-interval", "Body partition interval",
+          "Interval in nanoseconds after which a new body partition with the "
+          "index table of the previous one is started (0 = single body "
+          "partition, index table in the footer)", 0, G_MAXUINT64,
+          DEFAULT_BODY_PARTITION_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_mxf_mux_change_state);
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_mxf_mux_request_new_pad);
@@ -149,6 +160,15 @@ gst_mxf_mux_init (GstMXFMux * mux)
   gst_collect_pads_set_function (mux->collect,
       GST_DEBUG_FUNCPTR (gst_mxf_mux_collected), mux);
 
+  mux->body_partition_interval = DEFAULT_BODY_PARTITION_INTERVAL;
+
+  mux->partitions =
+      g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+  mux->index_entries = g_array_new (FALSE, TRUE, sizeof (MXFIndexEntry));
+  mux->index_tracks = g_array_new (FALSE, FALSE, sizeof (guint32));
+  mux->index_element_offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+  mux->index_layout = g_array_new (FALSE, FALSE, sizeof (guint32));
+
   gst_mxf_mux_reset (mux);
 }
 
@@ -168,6 +188,12 @@ gst_mxf_mux_finalize (GObject * object)
 
   gst_object_unref (mux->collect);
 
+  g_array_free (mux->partitions, TRUE);
+  g_array_free (mux->index_entries, TRUE);
+  g_array_free (mux->index_tracks, TRUE);
+  g_array_free (mux->index_element_offsets, TRUE);
+  g_array_free (mux->index_layout, TRUE);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -175,9 +201,12 @@ static void
 gst_mxf_mux_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_BODY_PARTITION_INTERVAL:
+      mux->body_partition_interval = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -188,15 +217,32 @@ static void
 gst_mxf_mux_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_BODY_PARTITION_INTERVAL:
+      g_value_set_uint64 (value, mux->body_partition_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_mxf_mux_clear_index_entries (GstMXFMux * mux)
+{
+  guint i;
+
+  for (i = 0; i < mux->index_entries->len; i++)
+    g_free (g_array_index (mux->index_entries, MXFIndexEntry,
+            i).slice_offset);
+
+  g_array_set_size (mux->index_entries, 0);
+  g_array_set_size (mux->index_layout, 0);
+  mux->index_layout_valid = TRUE;
+}
+
 static void
 gst_mxf_mux_reset (GstMXFMux * mux)
 {
@@ -228,6 +274,18 @@ gst_mxf_mux_reset (GstMXFMux * mux)
   mux->last_gc_timestamp = 0;
   mux->last_gc_position = 0;
   mux->offset = 0;
+
+  g_array_set_size (mux->partitions, 0);
+  mux->body_partition_position = 0;
+  mux->body_offset = 0;
+
+  gst_mxf_mux_clear_index_entries (mux);
+  g_array_set_size (mux->index_tracks, 0);
+  g_array_set_size (mux->index_element_offsets, 0);
+  mux->index_start_position = 0;
+  mux->last_keyframe_position = 0;
+  mux->index_cbe = TRUE;
+  mux->edit_unit_byte_count = 0;
 }
 
 static gboolean
@@ -949,7 +1007,7 @@ gst_mxf_mux_create_metadata (GstMXFMux * mux)
 
     cstorage->essence_container_data[0]->linked_package =
         MXF_METADATA_SOURCE_PACKAGE (cstorage->packages[1]);
-    cstorage->essence_container_data[0]->index_sid = 0;
+    cstorage->essence_container_data[0]->index_sid = 2;
     cstorage->essence_container_data[0]->body_sid = 1;
   }
 
@@ -1100,6 +1158,234 @@ static const guint8 _gc_essence_element_ul[] = {
   0x0d, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00
 };
 
+/* Stores the layout of the edit unit that was written last in its index
+ * entry */
+static void
+gst_mxf_mux_finish_edit_unit (GstMXFMux * mux)
+{
+  MXFIndexEntry *entry;
+  guint n = mux->index_tracks->len;
+
+  if (n == 0)
+    return;
+
+  entry = &g_array_index (mux->index_entries, MXFIndexEntry,
+      mux->index_entries->len - 1);
+
+  if (mux->index_entries->len == 1)
+    g_array_append_vals (mux->index_layout, mux->index_tracks->data, n);
+  else if (mux->index_layout->len != n
+      || memcmp (mux->index_layout->data, mux->index_tracks->data,
+          n * sizeof (guint32)) != 0)
+    mux->index_layout_valid = FALSE;
+
+  if (n > 1)
+    entry->slice_offset =
+        g_memdup (((guint32 *) mux->index_element_offsets->data) + 1,
+        (n - 1) * sizeof (guint32));
+
+  g_array_set_size (mux->index_tracks, 0);
+  g_array_set_size (mux->index_element_offsets, 0);
+}
+
+/* Creates the index table segments for all edit units written since the
+ * last call. Returns NULL if there are none */
+static GstBuffer *
+gst_mxf_mux_create_index_table_segments (GstMXFMux * mux)
+{
+  MXFMetadataEssenceContainerData *cdata =
+      mux->preface->content_storage->essence_container_data[0];
+  MXFIndexTableSegment segment;
+  MXFIndexEntry *entries;
+  GstBuffer *ret = NULL;
+  guint n_entries, n_elements, i;
+
+  gst_mxf_mux_finish_edit_unit (mux);
+
+  n_entries = mux->index_entries->len;
+  if (n_entries == 0)
+    return NULL;
+
+  entries = (MXFIndexEntry *) mux->index_entries->data;
+  n_elements = mux->index_layout_valid ? mux->index_layout->len : 0;
+
+  /* Offsets can only be calculated from the edit unit byte count if all
+   * edit units of the essence container look the same */
+  for (i = 0; mux->index_cbe && i < n_entries; i++) {
+    guint64 end =
+        (i + 1 < n_entries) ? entries[i + 1].stream_offset : mux->body_offset;
+    guint64 size = end - entries[i].stream_offset;
+
+    if (n_elements == 0 || !(entries[i].flags & 0x80) || size == 0
+        || size > G_MAXUINT32 || (mux->edit_unit_byte_count != 0
+            && size != mux->edit_unit_byte_count)
+        || (n_elements > 1 && memcmp (entries[i].slice_offset,
+                entries[0].slice_offset,
+                (n_elements - 1) * sizeof (guint32)) != 0))
+      mux->index_cbe = FALSE;
+    else
+      mux->edit_unit_byte_count = size;
+  }
+
+  memset (&segment, 0, sizeof (segment));
+  memcpy (&segment.index_edit_rate, &mux->min_edit_rate, sizeof (MXFFraction));
+  segment.index_sid = cdata->index_sid;
+  segment.body_sid = cdata->body_sid;
+
+  /* With constant edit units the delta entries point directly at the
+   * elements, otherwise every element starts its own slice */
+  if (n_elements > 1) {
+    segment.n_delta_entries = n_elements;
+    segment.delta_entries = g_new0 (MXFDeltaEntry, n_elements);
+    for (i = 1; i < n_elements; i++) {
+      if (mux->index_cbe) {
+        segment.delta_entries[i].element_delta = entries[0].slice_offset[i - 1];
+      } else {
+        segment.delta_entries[i].slice = i;
+      }
+    }
+  }
+
+  if (mux->index_cbe) {
+    mxf_uuid_init (&segment.instance_id, NULL);
+    segment.index_start_position = mux->index_start_position;
+    segment.index_duration = n_entries;
+    segment.edit_unit_byte_count = mux->edit_unit_byte_count;
+
+    ret = mxf_index_table_segment_to_buffer (&segment);
+  } else {
+    guint entry_size, max_entries;
+
+    segment.slice_count = n_elements > 1 ? n_elements - 1 : 0;
+
+    /* Local tags are limited to 64kB, split into multiple segments */
+    entry_size = 11 + 4 * segment.slice_count;
+    max_entries = (G_MAXUINT16 - 8) / entry_size;
+
+    for (i = 0; i < n_entries; i += max_entries) {
+      GstBuffer *buf;
+
+      mxf_uuid_init (&segment.instance_id, NULL);
+      segment.index_start_position = mux->index_start_position + i;
+      segment.index_duration = MIN (max_entries, n_entries - i);
+      segment.n_index_entries = segment.index_duration;
+      segment.index_entries = entries + i;
+
+      buf = mxf_index_table_segment_to_buffer (&segment);
+      ret = ret ? gst_buffer_append (ret, buf) : buf;
+    }
+  }
+
+  GST_DEBUG_OBJECT (mux, "Created %s index table for %u edit units starting "
+      "at %" G_GUINT64_FORMAT, mux->index_cbe ? "CBE" : "VBE", n_entries,
+      mux->index_start_position);
+
+  g_free (segment.delta_entries);
+
+  mux->index_start_position += n_entries;
+  gst_mxf_mux_clear_index_entries (mux);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_mxf_mux_write_body_partition (GstMXFMux * mux)
+{
+  MXFMetadataEssenceContainerData *cdata =
+      mux->preface->content_storage->essence_container_data[0];
+  MXFRandomIndexPackEntry entry;
+  GstBuffer *buf, *index;
+  GstFlowReturn ret;
+
+  /* The index table of the previous body partition goes before the
+   * essence of the new one, nothing has to be rewritten later */
+  index = gst_mxf_mux_create_index_table_segments (mux);
+
+  mux->partition.type = MXF_PARTITION_PACK_BODY;
+  mux->partition.prev_partition = mux->partition.this_partition;
+  mux->partition.this_partition = mux->offset;
+  mux->partition.footer_partition = 0;
+  mux->partition.header_byte_count = 0;
+  mux->partition.index_byte_count = index ? gst_buffer_get_size (index) : 0;
+  mux->partition.index_sid = index ? cdata->index_sid : 0;
+  mux->partition.body_offset = mux->body_offset;
+  mux->partition.body_sid = cdata->body_sid;
+
+  entry.offset = mux->partition.this_partition;
+  entry.body_sid = mux->partition.body_sid;
+  g_array_append_val (mux->partitions, entry);
+
+  buf = mxf_partition_pack_to_buffer (&mux->partition);
+  if ((ret = gst_mxf_mux_push (mux, buf)) != GST_FLOW_OK) {
+    GST_ERROR_OBJECT (mux, "Failed pushing body partition: %s",
+        gst_flow_get_name (ret));
+    if (index)
+      gst_buffer_unref (index);
+    return ret;
+  }
+
+  if (index && (ret = gst_mxf_mux_push (mux, index)) != GST_FLOW_OK) {
+    GST_ERROR_OBJECT (mux, "Failed pushing index table segments: %s",
+        gst_flow_get_name (ret));
+  }
+
+  return ret;
+}
+
+/* Adds the essence element of @cpad that is written next to the index.
+ * Before the first element of an edit unit a new body partition is started
+ * if the interval has passed */
+static GstFlowReturn
+gst_mxf_mux_index_element (GstMXFMux * mux, GstMXFMuxPad * cpad,
+    gboolean keyframe)
+{
+  guint64 position = mux->last_gc_position;
+  guint32 track_number = cpad->source_track->parent.track_number;
+  guint32 element_offset;
+  GstFlowReturn ret;
+
+  if (position >= mux->index_start_position + mux->index_entries->len) {
+    gst_mxf_mux_finish_edit_unit (mux);
+
+    if (mux->body_partition_interval > 0
+        && position > mux->body_partition_position
+        && gst_util_uint64_scale ((position -
+                mux->body_partition_position) * GST_SECOND,
+            mux->min_edit_rate.d,
+            mux->min_edit_rate.n) >= mux->body_partition_interval) {
+      if ((ret = gst_mxf_mux_write_body_partition (mux)) != GST_FLOW_OK)
+        return ret;
+      mux->body_partition_position = position;
+    }
+
+    while (mux->index_start_position + mux->index_entries->len <= position) {
+      gint64 p = mux->index_start_position + mux->index_entries->len;
+      MXFIndexEntry entry = { 0, };
+
+      entry.stream_offset = mux->body_offset;
+      if (p == position && keyframe) {
+        entry.flags = 0x80;
+        mux->last_keyframe_position = p;
+      }
+      entry.key_frame_offset =
+          MAX (((gint64) mux->last_keyframe_position) - p, -128);
+      /* Skipped edit units contain no elements and have no slice offsets,
+       * so the index can't describe the element layout anymore */
+      if (p != position)
+        mux->index_layout_valid = FALSE;
+      g_array_append_val (mux->index_entries, entry);
+    }
+  }
+
+  element_offset = mux->body_offset -
+      g_array_index (mux->index_entries, MXFIndexEntry,
+      mux->index_entries->len - 1).stream_offset;
+  g_array_append_val (mux->index_tracks, track_number);
+  g_array_append_val (mux->index_element_offsets, element_offset);
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
 {
@@ -1110,6 +1396,8 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   GstMapInfo readmap;
   GstFlowReturn ret = GST_FLOW_OK;
   guint8 slen, ber[9];
+  gboolean keyframe;
+  gsize size;
   gboolean flush = ((cpad->collect.state & GST_COLLECT_PADS_STATE_EOS)
       && !cpad->have_complete_edit_unit && cpad->collect.buffer == NULL);
 
@@ -1154,6 +1442,8 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   if (buf == NULL)
     return ret;
 
+  keyframe = !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
   gst_buffer_map (buf, &readmap, GST_MAP_READ);
   slen = mxf_ber_encode_size (readmap.size, ber);
   packet = gst_buffer_new_and_alloc (16 + slen + readmap.size);
@@ -1172,12 +1462,19 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
       cpad->source_track->parent.track_id);
   gst_buffer_unmap (packet, &map);
 
+  if ((ret = gst_mxf_mux_index_element (mux, cpad, keyframe)) != GST_FLOW_OK) {
+    gst_buffer_unref (packet);
+    return ret;
+  }
+
+  size = gst_buffer_get_size (packet);
   if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
     GST_ERROR_OBJECT (cpad->collect.pad,
         "Failed pushing buffer for track %u, reason %s",
         cpad->source_track->parent.track_id, gst_flow_get_name (ret));
     return ret;
   }
+  mux->body_offset += size;
 
   cpad->pos++;
   cpad->last_timestamp =
@@ -1187,26 +1484,6 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   return ret;
 }
 
-static GstFlowReturn
-gst_mxf_mux_write_body_partition (GstMXFMux * mux)
-{
-  GstBuffer *buf;
-
-  mux->partition.type = MXF_PARTITION_PACK_BODY;
-  mux->partition.this_partition = mux->offset;
-  mux->partition.prev_partition = 0;
-  mux->partition.footer_partition = 0;
-  mux->partition.header_byte_count = 0;
-  mux->partition.index_byte_count = 0;
-  mux->partition.index_sid = 0;
-  mux->partition.body_offset = 0;
-  mux->partition.body_sid =
-      mux->preface->content_storage->essence_container_data[0]->body_sid;
-
-  buf = mxf_partition_pack_to_buffer (&mux->partition);
-  return gst_mxf_mux_push (mux, buf);
-}
-
 static GstFlowReturn
 gst_mxf_mux_handle_eos (GstMXFMux * mux)
 {
@@ -1301,12 +1578,14 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
 
   {
     guint64 body_partition = mux->partition.this_partition;
-    guint32 body_sid = mux->partition.body_sid;
     guint64 footer_partition = mux->offset;
-    GArray *rip;
     GstFlowReturn ret;
     GstSegment segment;
     MXFRandomIndexPackEntry entry;
+    GstBuffer *index;
+
+    /* The index table of the last body partition goes into the footer */
+    index = gst_mxf_mux_create_index_table_segments (mux);
 
     mux->partition.type = MXF_PARTITION_PACK_FOOTER;
     mux->partition.closed = TRUE;
@@ -1315,29 +1594,26 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     mux->partition.prev_partition = body_partition;
     mux->partition.footer_partition = mux->offset;
     mux->partition.header_byte_count = 0;
-    mux->partition.index_byte_count = 0;
-    mux->partition.index_sid = 0;
+    mux->partition.index_byte_count = index ? gst_buffer_get_size (index) : 0;
+    mux->partition.index_sid = index ?
+        mux->preface->content_storage->essence_container_data[0]->index_sid : 0;
     mux->partition.body_offset = 0;
     mux->partition.body_sid = 0;
 
     gst_mxf_mux_write_header_metadata (mux);
 
-    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry), 3);
-    entry.offset = 0;
-    entry.body_sid = 0;
-    g_array_append_val (rip, entry);
-    entry.offset = body_partition;
-    entry.body_sid = body_sid;
-    g_array_append_val (rip, entry);
+    if (index && (ret = gst_mxf_mux_push (mux, index)) != GST_FLOW_OK) {
+      GST_ERROR_OBJECT (mux, "Failed pushing index table segments");
+    }
+
     entry.offset = footer_partition;
     entry.body_sid = 0;
-    g_array_append_val (rip, entry);
+    g_array_append_val (mux->partitions, entry);
 
-    packet = mxf_random_index_pack_to_buffer (rip);
+    packet = mxf_random_index_pack_to_buffer (mux->partitions);
     if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
       GST_ERROR_OBJECT (mux, "Failed pushing random index pack");
     }
-    g_array_free (rip, TRUE);
 
     /* Rewrite header partition with updated values */
     gst_segment_init (&segment, GST_FORMAT_BYTES);
@@ -1426,6 +1702,12 @@ gst_mxf_mux_collected (GstCollectPads * pads, gpointer user_data)
     if (ret != GST_FLOW_OK)
       goto error;
 
+    {
+      MXFRandomIndexPackEntry entry = { 0, 0 };
+
+      g_array_append_val (mux->partitions, entry);
+    }
+
     /* Sort pads, we will always write in that order */
     mux->collect->data = g_slist_sort (mux->collect->data, _sort_mux_pads);
 
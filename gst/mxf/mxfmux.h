@@ -92,6 +92,29 @@ typedef struct _GstMXFMux {
   guint64 last_gc_position;
   GstClockTime last_gc_timestamp;
 
+  /* MXFRandomIndexPackEntry for all partitions written so far */
+  GArray *partitions;
+  GstClockTime body_partition_interval;
+  guint64 body_partition_position;
+
+  /* Number of essence bytes written to the body */
+  guint64 body_offset;
+
+  /* MXFIndexEntry for the edit units since the last index table segment */
+  GArray *index_entries;
+  guint64 index_start_position;
+  guint64 last_keyframe_position;
+  /* track numbers and offsets of the elements of the current edit unit */
+  GArray *index_tracks;
+  GArray *index_element_offsets;
+  /* track numbers of the elements in each edit unit of the pending
+   * segment, invalid if the edit units differ */
+  GArray *index_layout;
+  gboolean index_layout_valid;
+  /* all edit units so far are keyframes of edit_unit_byte_count bytes */
+  gboolean index_cbe;
+  guint32 edit_unit_byte_count;
+
   gchar *application;
 } GstMXFMux;
 
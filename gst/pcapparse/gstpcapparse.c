@@ -20,11 +20,21 @@
 /**
  * SECTION:element-pcapparse
  *
- * Extracts payloads from Ethernet-encapsulated IP packets.
+ * Extracts payloads from Ethernet-encapsulated IP packets of pcap and
+ * pcapng files.
  * Use #GstPcapParse:src-ip, #GstPcapParse:dst-ip,
  * #GstPcapParse:src-port and #GstPcapParse:dst-port to restrict which packets
  * should be included.
  *
+ * With #GstPcapParse:split-flows, the payloads of each UDP or TCP flow are
+ * output on their own src_%u pad instead, so that all flows are extracted in
+ * a single pass. The always src pad is kept in that mode so that existing
+ * links stay valid, but it only receives the stream-start, flush and EOS
+ * events and never any buffers.
+ *
+ * When operating in pull mode, seeking in time is supported using an index
+ * of packet offsets built while reading the capture.
+ *
  * <refsect2>
  * <title>Example pipelines</title>
  * |[
@@ -32,11 +42,15 @@
  * ! ffdec_h264 ! fakesink
  * ]| Read from a pcap dump file using filesrc, extract the raw UDP packets,
  * depayload and decode them.
+ * |[
+ * gst-launch-1.0 filesrc location=call.pcapng ! pcapparse split-flows=true
+ * caps="application/x-rtp" name=p p.src_0 ! queue ! fakesink p.src_1 ! queue
+ * ! fakesink
+ * ]| Extract the first two flows of a pcapng capture.
  * </refsect2>
  */
 
 /* TODO:
- * - React on state-change and update state accordingly.
  * - Implement support for timestamping the buffers.
  */
 
@@ -64,7 +78,8 @@ enum
   PROP_SRC_PORT,
   PROP_DST_PORT,
   PROP_CAPS,
-  PROP_TS_OFFSET
+  PROP_TS_OFFSET,
+  PROP_SPLIT_FLOWS
 };
 
 GST_DEBUG_CATEGORY_STATIC (gst_pcap_parse_debug);
@@ -80,18 +95,114 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate flow_src_template =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS_ANY);
+
 static void gst_pcap_parse_finalize (GObject * object);
 static void gst_pcap_parse_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_pcap_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 
+static GstStateChangeReturn gst_pcap_parse_change_state (GstElement *
+    element, GstStateChange transition);
+
 static void gst_pcap_parse_reset (GstPcapParse * self);
+static void gst_pcap_parse_remove_flows (GstPcapParse * self);
 
 static GstFlowReturn gst_pcap_parse_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
 static gboolean gst_pcap_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
+static gboolean gst_pcap_parse_sink_activate (GstPad * pad,
+    GstObject * parent);
+static gboolean gst_pcap_parse_sink_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+static gboolean gst_pcap_parse_src_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static void gst_pcap_parse_loop (GstPad * pad);
+
+/* pcapng block types */
+#define PCAPNG_BLOCK_SHB        0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB        0x00000001
+#define PCAPNG_BLOCK_PB         0x00000002
+#define PCAPNG_BLOCK_SPB        0x00000003
+#define PCAPNG_BLOCK_EPB        0x00000006
+
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPT_IF_TSRESOL   9
+
+typedef struct
+{
+  GstPcapParseLinktype linktype;
+  /* timestamp units per second */
+  guint64 ts_units;
+} GstPcapParseInterface;
+
+typedef struct
+{
+  GstClockTime ts;
+  guint64 offset;
+} GstPcapParseIndexEntry;
+
+/* where the captured packet is in a record or block, and its properties */
+typedef struct
+{
+  gsize offset;
+  gsize size;
+  GstClockTime ts;
+  GstPcapParseLinktype linktype;
+} GstPcapParsePacket;
+
+typedef struct
+{
+  guint32 src_ip;
+  guint32 dst_ip;
+  guint16 src_port;
+  guint16 dst_port;
+  guint8 protocol;
+} GstPcapParseFlowKey;
+
+typedef struct
+{
+  /* first, it's also the hash table key */
+  GstPcapParseFlowKey key;
+
+  GstPad *pad;
+  gboolean newsegment_sent;
+  GstBufferList *list;
+} GstPcapParseFlow;
+
+static guint
+gst_pcap_parse_flow_key_hash (gconstpointer v)
+{
+  const GstPcapParseFlowKey *key = v;
+
+  return key->src_ip ^ (key->dst_ip * 31) ^
+      ((key->src_port << 16) | key->dst_port) ^ key->protocol;
+}
+
+static gboolean
+gst_pcap_parse_flow_key_equal (gconstpointer v1, gconstpointer v2)
+{
+  const GstPcapParseFlowKey *key1 = v1;
+  const GstPcapParseFlowKey *key2 = v2;
+
+  return key1->src_ip == key2->src_ip && key1->dst_ip == key2->dst_ip &&
+      key1->src_port == key2->src_port && key1->dst_port == key2->dst_port &&
+      key1->protocol == key2->protocol;
+}
+
+static void
+gst_pcap_parse_flow_free (GstPcapParseFlow * flow)
+{
+  if (flow->list)
+    gst_buffer_list_unref (flow->list);
+  g_slice_free (GstPcapParseFlow, flow);
+}
 
 #define parent_class gst_pcap_parse_parent_class
 G_DEFINE_TYPE (GstPcapParse, gst_pcap_parse, GST_TYPE_ELEMENT);
@@ -106,6 +217,8 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
   gobject_class->get_property = gst_pcap_parse_get_property;
   gobject_class->set_property = gst_pcap_parse_set_property;
 
+  element_class->change_state = GST_DEBUG_FUNCPTR (gst_pcap_parse_change_state);
+
   g_object_class_install_property (gobject_class,
       PROP_SRC_IP, g_param_spec_string ("src-ip", "Source IP",
           "Source IP to restrict to", "",
@@ -136,10 +249,17 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
           "Relative timestamp offset (ns) to apply (-1 = use absolute packet time)",
           -1, G_MAXINT64, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_SPLIT_FLOWS,
+      g_param_spec_boolean ("split-flows", "Split flows",
+          "Output each UDP or TCP flow on its own src_%u pad",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&sink_template));
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&src_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&flow_src_template));
 
   gst_element_class_set_static_metadata (element_class, "PCapParse",
       "Raw/Parser",
@@ -158,10 +278,16 @@ gst_pcap_parse_init (GstPcapParse * self)
   gst_pad_use_fixed_caps (self->sink_pad);
   gst_pad_set_event_function (self->sink_pad,
       GST_DEBUG_FUNCPTR (gst_pcap_sink_event));
+  gst_pad_set_activate_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activate));
+  gst_pad_set_activatemode_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activate_mode));
   gst_element_add_pad (GST_ELEMENT (self), self->sink_pad);
 
   self->src_pad = gst_pad_new_from_static_template (&src_template, "src");
   gst_pad_use_fixed_caps (self->src_pad);
+  gst_pad_set_event_function (self->src_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_src_event));
   gst_element_add_pad (GST_ELEMENT (self), self->src_pad);
 
   self->src_ip = -1;
@@ -169,8 +295,15 @@ gst_pcap_parse_init (GstPcapParse * self)
   self->src_port = -1;
   self->dst_port = -1;
   self->offset = -1;
+  self->split_flows = FALSE;
 
   self->adapter = gst_adapter_new ();
+  self->interfaces = g_array_new (FALSE, FALSE, sizeof (GstPcapParseInterface));
+  self->index = g_array_new (FALSE, FALSE, sizeof (GstPcapParseIndexEntry));
+  self->flows = g_hash_table_new_full (gst_pcap_parse_flow_key_hash,
+      gst_pcap_parse_flow_key_equal, NULL,
+      (GDestroyNotify) gst_pcap_parse_flow_free);
+  self->flowcombiner = gst_flow_combiner_new ();
 
   gst_pcap_parse_reset (self);
 }
@@ -183,6 +316,13 @@ gst_pcap_parse_finalize (GObject * object)
   g_object_unref (self->adapter);
   if (self->caps)
     gst_caps_unref (self->caps);
+  if (self->list)
+    gst_buffer_list_unref (self->list);
+
+  g_array_free (self->interfaces, TRUE);
+  g_array_free (self->index, TRUE);
+  g_hash_table_destroy (self->flows);
+  gst_flow_combiner_free (self->flowcombiner);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -242,6 +382,10 @@ gst_pcap_parse_get_property (GObject * object, guint prop_id,
       g_value_set_int64 (value, self->offset);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      g_value_set_boolean (value, self->split_flows);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,6 +440,10 @@ gst_pcap_parse_set_property (GObject * object, guint prop_id,
       self->offset = g_value_get_int64 (value);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      self->split_flows = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -306,15 +454,67 @@ static void
 gst_pcap_parse_reset (GstPcapParse * self)
 {
   self->initialized = FALSE;
+  self->is_pcapng = FALSE;
   self->swap_endian = FALSE;
-  self->cur_packet_size = -1;
   self->cur_ts = GST_CLOCK_TIME_NONE;
   self->base_ts = GST_CLOCK_TIME_NONE;
+  self->ts_units = GST_SECOND / GST_USECOND;
+  self->parse_offset = 0;
   self->newsegment_sent = FALSE;
+  self->have_segment = FALSE;
+  gst_segment_init (&self->segment, GST_FORMAT_TIME);
 
+  self->pull_offset = 0;
+  self->need_seek = FALSE;
+  self->skip_until = GST_CLOCK_TIME_NONE;
+  self->index_end = 0;
+
+  if (self->list) {
+    gst_buffer_list_unref (self->list);
+    self->list = NULL;
+  }
+
+  g_array_set_size (self->interfaces, 0);
+  g_array_set_size (self->index, 0);
   gst_adapter_clear (self->adapter);
 }
 
+static void
+gst_pcap_parse_remove_flows (GstPcapParse * self)
+{
+  GHashTableIter iter;
+  GstPcapParseFlow *flow;
+
+  g_hash_table_iter_init (&iter, self->flows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & flow)) {
+    gst_flow_combiner_remove_pad (self->flowcombiner, flow->pad);
+    gst_pad_set_active (flow->pad, FALSE);
+    gst_element_remove_pad (GST_ELEMENT (self), flow->pad);
+  }
+  g_hash_table_remove_all (self->flows);
+  self->n_flows = 0;
+}
+
+static GstStateChangeReturn
+gst_pcap_parse_change_state (GstElement * element, GstStateChange transition)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_pcap_parse_reset (self);
+      gst_pcap_parse_remove_flows (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
 static guint32
 gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 {
@@ -331,6 +531,22 @@ gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
   }
 }
 
+static guint16
+gst_pcap_parse_read_uint16 (GstPcapParse * self, const guint8 * p)
+{
+  guint16 val = *((guint16 *) p);
+
+  if (self->swap_endian) {
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    return GUINT16_FROM_BE (val);
+#else
+    return GUINT16_FROM_LE (val);
+#endif
+  } else {
+    return val;
+  }
+}
+
 #define ETH_HEADER_LEN    14
 #define SLL_HEADER_LEN    16
 #define IP_HEADER_MIN_LEN 20
@@ -339,11 +555,28 @@ gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 #define IP_PROTO_UDP      17
 #define IP_PROTO_TCP      6
 
+#define PCAP_HEADER_LEN         24
+#define PCAP_RECORD_HEADER_LEN  16
+#define PCAPNG_BLOCK_MIN_LEN    12
+/* up to the packet data of (enhanced) packet blocks */
+#define PCAPNG_PB_HEADER_LEN    28
+#define PCAPNG_SPB_HEADER_LEN   12
+
+/* larger than the maximum snapshot length of libpcap */
+#define PCAP_MAX_PACKET_LEN     (1024 * 1024)
+#define PCAPNG_MAX_BLOCK_LEN    (16 * 1024 * 1024)
+
+#define PULL_SIZE               (64 * 1024)
+#define INDEX_INTERVAL          GST_SECOND
+
+/* returned while parsing when more data is needed */
+#define GST_PCAP_PARSE_NEED_DATA GST_FLOW_CUSTOM_SUCCESS
 
 static gboolean
 gst_pcap_parse_scan_frame (GstPcapParse * self,
-    const guint8 * buf,
-    gint buf_size, const guint8 ** payload, gint * payload_size)
+    GstPcapParseLinktype linktype, const guint8 * buf,
+    gint buf_size, const guint8 ** payload, gint * payload_size,
+    GstPcapParseFlowKey * flow)
 {
   const guint8 *buf_ip = 0;
   const guint8 *buf_proto;
@@ -357,7 +590,7 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   guint16 dst_port;
   guint16 len;
 
-  switch (self->linktype) {
+  switch (linktype) {
     case LINKTYPE_ETHER:
       if (buf_size < ETH_HEADER_LEN + IP_HEADER_MIN_LEN + UDP_HEADER_LEN)
         return FALSE;
@@ -427,7 +660,7 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
 
     /* all remaining data following tcp header is payload */
     *payload = buf_proto + len;
-    *payload_size = self->cur_packet_size - (buf_proto - buf) - len;
+    *payload_size = buf_size - (buf_proto - buf) - len;
   }
 
   /* but still filter as configured */
@@ -443,166 +676,566 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   if (self->dst_port >= 0 && dst_port != self->dst_port)
     return FALSE;
 
+  flow->src_ip = ip_src_addr;
+  flow->dst_ip = ip_dst_addr;
+  flow->src_port = src_port;
+  flow->dst_port = dst_port;
+  flow->protocol = ip_protocol;
+
   return TRUE;
 }
 
+/* Parses the file header at the start of @data. For pcapng the section
+ * header block is parsed like all other blocks, so nothing is consumed */
 static GstFlowReturn
-gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_pcap_parse_read_file_header (GstPcapParse * self, const guint8 * data,
+    gsize size, gsize * consumed)
 {
-  GstPcapParse *self = GST_PCAP_PARSE (parent);
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstBufferList *list = NULL;
+  guint32 magic;
+  guint32 linktype;
+  guint16 major_version;
 
-  gst_adapter_push (self->adapter, buffer);
+  if (size < 4)
+    return GST_PCAP_PARSE_NEED_DATA;
 
-  while (ret == GST_FLOW_OK) {
-    gint avail;
-    const guint8 *data;
-
-    avail = gst_adapter_available (self->adapter);
-
-    if (self->initialized) {
-      if (self->cur_packet_size >= 0) {
-        if (avail < self->cur_packet_size)
-          break;
-
-        if (self->cur_packet_size > 0) {
-          const guint8 *payload_data;
-          gint payload_size;
-
-          data = gst_adapter_map (self->adapter, self->cur_packet_size);
-
-          GST_LOG_OBJECT (self, "examining packet size %" G_GINT64_FORMAT,
-              self->cur_packet_size);
-
-          if (gst_pcap_parse_scan_frame (self, data, self->cur_packet_size,
-                  &payload_data, &payload_size)) {
-            GstBuffer *out_buf;
-            guintptr offset = payload_data - data;
-
-            gst_adapter_unmap (self->adapter);
-            gst_adapter_flush (self->adapter, offset);
-            /* we don't use _take_buffer_fast() on purpose here, we need a
-             * buffer with a single memory, since the RTP depayloaders expect
-             * the complete RTP header to be in the first memory if there are
-             * multiple ones and we can't guarantee that with _fast() */
-            out_buf = gst_adapter_take_buffer (self->adapter, payload_size);
-            gst_adapter_flush (self->adapter,
-                self->cur_packet_size - offset - payload_size);
-
-            if (GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-              if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
-                self->base_ts = self->cur_ts;
-              if (self->offset >= 0) {
-                self->cur_ts -= self->base_ts;
-                self->cur_ts += self->offset;
-              }
-            }
-            GST_BUFFER_TIMESTAMP (out_buf) = self->cur_ts;
-
-
-            if (list == NULL)
-              list = gst_buffer_list_new ();
-            gst_buffer_list_add (list, out_buf);
-          } else {
-            gst_adapter_unmap (self->adapter);
-            gst_adapter_flush (self->adapter, self->cur_packet_size);
-          }
-        }
-
-        self->cur_packet_size = -1;
-      } else {
-        guint32 ts_sec;
-        guint32 ts_usec;
-        guint32 incl_len;
+  magic = *((guint32 *) data);
 
-        if (avail < 16)
-          break;
+  if (magic == PCAPNG_BLOCK_SHB) {
+    GST_DEBUG_OBJECT (self, "pcapng file");
+    self->is_pcapng = TRUE;
+    self->initialized = TRUE;
+    *consumed = 0;
+    return GST_FLOW_OK;
+  }
 
-        data = gst_adapter_map (self->adapter, 16);
+  if (size < PCAP_HEADER_LEN)
+    return GST_PCAP_PARSE_NEED_DATA;
+
+  major_version = *((guint16 *) (data + 4));
+
+  if (magic == 0xa1b2c3d4) {
+    self->swap_endian = FALSE;
+    self->ts_units = GST_SECOND / GST_USECOND;
+  } else if (magic == 0xd4c3b2a1) {
+    self->swap_endian = TRUE;
+    self->ts_units = GST_SECOND / GST_USECOND;
+  } else if (magic == 0xa1b23c4d) {
+    self->swap_endian = FALSE;
+    self->ts_units = GST_SECOND;
+  } else if (magic == 0x4d3cb2a1) {
+    self->swap_endian = TRUE;
+    self->ts_units = GST_SECOND;
+  } else {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("File is not a libpcap file, magic is %X", magic));
+    return GST_FLOW_ERROR;
+  }
 
-        ts_sec = gst_pcap_parse_read_uint32 (self, data + 0);
-        ts_usec = gst_pcap_parse_read_uint32 (self, data + 4);
-        incl_len = gst_pcap_parse_read_uint32 (self, data + 8);
-        /* orig_len = gst_pcap_parse_read_uint32 (self, data + 12); */
+  if (self->swap_endian)
+    major_version = major_version << 8 | major_version >> 8;
+  linktype = gst_pcap_parse_read_uint32 (self, data + 20);
 
-        gst_adapter_unmap (self->adapter);
-        gst_adapter_flush (self->adapter, 16);
+  if (major_version != 2) {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("File is not a libpcap major version 2, but %u", major_version));
+    return GST_FLOW_ERROR;
+  }
 
-        self->cur_ts = ts_sec * GST_SECOND + ts_usec * GST_USECOND;
-        self->cur_packet_size = incl_len;
-      }
+  if (linktype != LINKTYPE_ETHER && linktype != LINKTYPE_SLL &&
+      linktype != LINKTYPE_RAW) {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("Only dumps of type Ethernet, raw IP or Linux Cooked (SLL) "
+            "understood; type %d unknown", linktype));
+    return GST_FLOW_ERROR;
+  }
+
+  GST_DEBUG_OBJECT (self, "linktype %u", linktype);
+  self->linktype = linktype;
+  self->initialized = TRUE;
+  *consumed = PCAP_HEADER_LEN;
+
+  return GST_FLOW_OK;
+}
+
+/* Reads the incl_len and timestamp of the classic pcap record header at
+ * @data */
+static void
+gst_pcap_parse_read_record_header (GstPcapParse * self, const guint8 * data,
+    GstPcapParsePacket * packet)
+{
+  guint32 ts_sec;
+  guint32 ts_frac;
+
+  ts_sec = gst_pcap_parse_read_uint32 (self, data + 0);
+  ts_frac = gst_pcap_parse_read_uint32 (self, data + 4);
+  packet->size = gst_pcap_parse_read_uint32 (self, data + 8);
+  /* orig_len = gst_pcap_parse_read_uint32 (self, data + 12); */
+
+  packet->offset = PCAP_RECORD_HEADER_LEN;
+  packet->ts = ts_sec * GST_SECOND + ts_frac * (GST_SECOND / self->ts_units);
+  packet->linktype = self->linktype;
+}
+
+/* Reads the type and total length from the first 12 bytes of a pcapng
+ * block, the byte order is set by section header blocks */
+static GstFlowReturn
+gst_pcap_parse_read_block_header (GstPcapParse * self, const guint8 * data,
+    guint32 * type, guint32 * length)
+{
+  *type = gst_pcap_parse_read_uint32 (self, data);
+
+  if (*type == PCAPNG_BLOCK_SHB) {
+    guint32 magic = *((guint32 *) (data + 8));
+
+    if (magic == PCAPNG_BYTE_ORDER_MAGIC) {
+      self->swap_endian = FALSE;
+    } else if (magic == GUINT32_SWAP_LE_BE (PCAPNG_BYTE_ORDER_MAGIC)) {
+      self->swap_endian = TRUE;
     } else {
-      guint32 magic;
-      guint32 linktype;
-      guint16 major_version;
+      GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+          ("Invalid pcapng byte order magic %X", magic));
+      return GST_FLOW_ERROR;
+    }
+  }
 
-      if (avail < 24)
-        break;
+  *length = gst_pcap_parse_read_uint32 (self, data + 4);
+  if (*length < PCAPNG_BLOCK_MIN_LEN || *length % 4 != 0 ||
+      *length > PCAPNG_MAX_BLOCK_LEN) {
+    GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+        ("Invalid pcapng block length %u", *length));
+    return GST_FLOW_ERROR;
+  }
 
-      data = gst_adapter_map (self->adapter, 24);
+  return GST_FLOW_OK;
+}
 
-      magic = *((guint32 *) data);
-      major_version = *((guint16 *) (data + 4));
-      linktype = gst_pcap_parse_read_uint32 (self, data + 20);
-      gst_adapter_unmap (self->adapter);
+static void
+gst_pcap_parse_read_interface (GstPcapParse * self, const guint8 * data,
+    guint32 length)
+{
+  GstPcapParseInterface iface;
+  guint32 pos;
+
+  if (length < 20)
+    return;
+
+  iface.linktype = gst_pcap_parse_read_uint16 (self, data + 8);
+  iface.ts_units = GST_SECOND / GST_USECOND;
 
-      if (magic == 0xa1b2c3d4) {
-        self->swap_endian = FALSE;
-      } else if (magic == 0xd4c3b2a1) {
-        self->swap_endian = TRUE;
-        major_version = major_version << 8 | major_version >> 8;
+  /* options follow the snaplen, up to the trailing block length */
+  pos = 16;
+  while (pos + 4 <= length - 4) {
+    guint16 code = gst_pcap_parse_read_uint16 (self, data + pos);
+    guint16 len = gst_pcap_parse_read_uint16 (self, data + pos + 2);
+
+    if (code == 0 || pos + 4 + len > length - 4)
+      break;
+
+    if (code == PCAPNG_OPT_IF_TSRESOL && len == 1) {
+      guint8 tsresol = data[pos + 4];
+
+      /* negative powers of 2 or 10 */
+      if (tsresol & 0x80) {
+        iface.ts_units = G_GUINT64_CONSTANT (1) << MIN (tsresol & 0x7f, 63);
       } else {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("File is not a libpcap file, magic is %X", magic));
-        ret = GST_FLOW_ERROR;
-        goto out;
-      }
+        guint i;
 
-      if (major_version != 2) {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("File is not a libpcap major version 2, but %u", major_version));
-        ret = GST_FLOW_ERROR;
-        goto out;
+        iface.ts_units = 1;
+        for (i = 0; i < MIN (tsresol, 19); i++)
+          iface.ts_units *= 10;
       }
+    }
 
-      if (linktype != LINKTYPE_ETHER && linktype != LINKTYPE_SLL &&
-          linktype != LINKTYPE_RAW) {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("Only dumps of type Ethernet, raw IP or Linux Cooked (SLL) "
-                "understood; type %d unknown", linktype));
-        ret = GST_FLOW_ERROR;
-        goto out;
-      }
+    pos += 4 + GST_ROUND_UP_4 (len);
+  }
+
+  GST_DEBUG_OBJECT (self, "interface %u linktype %u, %" G_GUINT64_FORMAT
+      " timestamp units per second", self->interfaces->len, iface.linktype,
+      iface.ts_units);
+  g_array_append_val (self->interfaces, iface);
+}
+
+/* Parses the pcapng block at @offset of @type and @length. For section
+ * header and interface description blocks @data must contain the whole
+ * block, for packet blocks only their header up to the packet data. Returns
+ * TRUE and fills @packet if the block contains a packet. */
+static gboolean
+gst_pcap_parse_read_block (GstPcapParse * self, const guint8 * data,
+    guint32 type, guint32 length, guint64 offset, GstPcapParsePacket * packet)
+{
+  GstPcapParseInterface *iface;
+  guint32 if_id;
+  guint64 ts;
+
+  /* blocks changing the state are only handled the first time they are
+   * read, not again after seeking back */
+  switch (type) {
+    case PCAPNG_BLOCK_SHB:
+      if (offset >= self->index_end)
+        g_array_set_size (self->interfaces, 0);
+      return FALSE;
+    case PCAPNG_BLOCK_IDB:
+      if (offset >= self->index_end)
+        gst_pcap_parse_read_interface (self, data, length);
+      return FALSE;
+    case PCAPNG_BLOCK_EPB:
+    case PCAPNG_BLOCK_PB:
+      if (length < PCAPNG_PB_HEADER_LEN + 4)
+        return FALSE;
+
+      if (type == PCAPNG_BLOCK_EPB)
+        if_id = gst_pcap_parse_read_uint32 (self, data + 8);
+      else
+        if_id = gst_pcap_parse_read_uint16 (self, data + 8);
+      ts = ((guint64) gst_pcap_parse_read_uint32 (self, data + 12) << 32) |
+          gst_pcap_parse_read_uint32 (self, data + 16);
+
+      packet->offset = PCAPNG_PB_HEADER_LEN;
+      packet->size = gst_pcap_parse_read_uint32 (self, data + 20);
+      break;
+    case PCAPNG_BLOCK_SPB:
+      if (length < PCAPNG_SPB_HEADER_LEN + 4)
+        return FALSE;
+
+      if_id = 0;
+      ts = GST_CLOCK_TIME_NONE;
+
+      /* the captured length is only known from the block length */
+      packet->offset = PCAPNG_SPB_HEADER_LEN;
+      packet->size = MIN (gst_pcap_parse_read_uint32 (self, data + 8),
+          length - PCAPNG_SPB_HEADER_LEN - 4);
+      break;
+    default:
+      GST_LOG_OBJECT (self, "skipping block type 0x%08x", type);
+      return FALSE;
+  }
+
+  if (if_id >= self->interfaces->len ||
+      packet->offset + packet->size > length - 4) {
+    GST_WARNING_OBJECT (self, "invalid packet block at offset %"
+        G_GUINT64_FORMAT, offset);
+    return FALSE;
+  }
+
+  iface = &g_array_index (self->interfaces, GstPcapParseInterface, if_id);
+  packet->linktype = iface->linktype;
+  if (ts != GST_CLOCK_TIME_NONE)
+    packet->ts = gst_util_uint64_scale (ts, GST_SECOND, iface->ts_units);
+  else
+    packet->ts = GST_CLOCK_TIME_NONE;
+
+  return TRUE;
+}
+
+static void
+gst_pcap_parse_add_index_entry (GstPcapParse * self, GstClockTime ts,
+    guint64 offset)
+{
+  GstPcapParseIndexEntry entry;
 
-      GST_DEBUG_OBJECT (self, "linktype %u", linktype);
-      self->linktype = linktype;
+  if (offset < self->index_end || !GST_CLOCK_TIME_IS_VALID (ts))
+    return;
+
+  if (self->index->len > 0) {
+    GstPcapParseIndexEntry *last = &g_array_index (self->index,
+        GstPcapParseIndexEntry, self->index->len - 1);
+
+    if (ts < last->ts + INDEX_INTERVAL)
+      return;
+  }
+
+  entry.ts = ts;
+  entry.offset = offset;
+  g_array_append_val (self->index, entry);
+}
+
+static void
+gst_pcap_parse_skip (GstPcapParse * self, gsize size)
+{
+  gst_adapter_flush (self->adapter, size);
+  self->parse_offset += size;
+  self->index_end = MAX (self->index_end, self->parse_offset);
+}
+
+static GstPcapParseFlow *
+gst_pcap_parse_get_flow (GstPcapParse * self, GstPcapParseFlowKey * key)
+{
+  GstPcapParseFlow *flow;
+  const guint8 *src = (const guint8 *) &key->src_ip;
+  const guint8 *dst = (const guint8 *) &key->dst_ip;
+  gchar *name, *stream_id;
+
+  flow = g_hash_table_lookup (self->flows, key);
+  if (flow)
+    return flow;
+
+  flow = g_slice_new0 (GstPcapParseFlow);
+  flow->key = *key;
+
+  name = g_strdup_printf ("src_%u", self->n_flows++);
+  flow->pad = gst_pad_new_from_static_template (&flow_src_template, name);
+  g_free (name);
+  gst_pad_use_fixed_caps (flow->pad);
+  gst_pad_set_event_function (flow->pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_src_event));
+  gst_pad_set_active (flow->pad, TRUE);
+
+  /* addresses are in network byte order */
+  stream_id = gst_pad_create_stream_id_printf (flow->pad, GST_ELEMENT (self),
+      "%u.%u.%u.%u:%u-%u.%u.%u.%u:%u-%u", src[0], src[1], src[2], src[3],
+      key->src_port, dst[0], dst[1], dst[2], dst[3], key->dst_port,
+      key->protocol);
+  GST_DEBUG_OBJECT (self, "new flow %s on %s", stream_id,
+      GST_PAD_NAME (flow->pad));
+  gst_pad_push_event (flow->pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
 
-      gst_adapter_flush (self->adapter, 24);
-      self->initialized = TRUE;
+  if (self->caps)
+    gst_pad_set_caps (flow->pad, self->caps);
+
+  g_hash_table_insert (self->flows, &flow->key, flow);
+  gst_flow_combiner_add_pad (self->flowcombiner, flow->pad);
+  gst_element_add_pad (GST_ELEMENT (self), flow->pad);
+
+  return flow;
+}
+
+/* Takes the packet out of the record of @record_size bytes at the start of
+ * the adapter and queues its payload */
+static GstFlowReturn
+gst_pcap_parse_take_packet (GstPcapParse * self, gsize record_size,
+    GstPcapParsePacket * packet)
+{
+  GstPcapParseFlowKey key;
+  GstBufferList **list;
+  GstBuffer *out_buf;
+  const guint8 *data;
+  const guint8 *payload_data;
+  gint payload_size;
+  guintptr offset;
+  GstClockTime ts = packet->ts;
+
+  gst_pcap_parse_add_index_entry (self, ts, self->parse_offset);
+
+  /* after seeking, from the indexed packet before the seek position */
+  if (GST_CLOCK_TIME_IS_VALID (self->skip_until)) {
+    if (GST_CLOCK_TIME_IS_VALID (ts) && ts < self->skip_until) {
+      gst_pcap_parse_skip (self, record_size);
+      return GST_FLOW_OK;
     }
+    self->skip_until = GST_CLOCK_TIME_NONE;
+  }
+
+  data = gst_adapter_map (self->adapter, record_size);
+
+  GST_LOG_OBJECT (self, "examining packet size %" G_GSIZE_FORMAT,
+      packet->size);
+
+  if (!gst_pcap_parse_scan_frame (self, packet->linktype,
+          data + packet->offset, packet->size, &payload_data, &payload_size,
+          &key) || payload_size <= 0) {
+    gst_adapter_unmap (self->adapter);
+    gst_pcap_parse_skip (self, record_size);
+    return GST_FLOW_OK;
   }
 
-  if (list) {
-    if (!self->newsegment_sent && GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-      GstSegment segment;
+  offset = payload_data - data;
+
+  gst_adapter_unmap (self->adapter);
+  gst_adapter_flush (self->adapter, offset);
+  /* we don't use _take_buffer_fast() on purpose here, we need a
+   * buffer with a single memory, since the RTP depayloaders expect
+   * the complete RTP header to be in the first memory if there are
+   * multiple ones and we can't guarantee that with _fast() */
+  out_buf = gst_adapter_take_buffer (self->adapter, payload_size);
+  gst_adapter_flush (self->adapter, record_size - offset - payload_size);
+  self->parse_offset += record_size;
+  self->index_end = MAX (self->index_end, self->parse_offset);
+
+  if (GST_CLOCK_TIME_IS_VALID (ts)) {
+    if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
+      self->base_ts = ts;
+    if (self->offset >= 0) {
+      ts = ts > self->base_ts ? ts - self->base_ts : 0;
+      ts += self->offset;
+    }
+    self->cur_ts = ts;
 
-      if (self->caps)
-        gst_pad_set_caps (self->src_pad, self->caps);
-      gst_segment_init (&segment, GST_FORMAT_TIME);
-      segment.start = self->cur_ts;
-      gst_pad_push_event (self->src_pad, gst_event_new_segment (&segment));
-      self->newsegment_sent = TRUE;
+    if (!self->have_segment) {
+      self->segment.start = ts;
+      self->have_segment = TRUE;
     }
 
-    ret = gst_pad_push_list (self->src_pad, list);
-    list = NULL;
+    if (GST_CLOCK_TIME_IS_VALID (self->segment.stop) &&
+        ts > self->segment.stop) {
+      GST_DEBUG_OBJECT (self, "reached segment stop");
+      gst_buffer_unref (out_buf);
+      return GST_FLOW_EOS;
+    }
   }
+  GST_BUFFER_TIMESTAMP (out_buf) = ts;
+
+  if (self->split_flows)
+    list = &gst_pcap_parse_get_flow (self, &key)->list;
+  else
+    list = &self->list;
 
-out:
+  if (*list == NULL)
+    *list = gst_buffer_list_new ();
+  gst_buffer_list_add (*list, out_buf);
 
-  if (list)
-    gst_buffer_list_unref (list);
+  return GST_FLOW_OK;
+}
+
+/* Parses the next header, record or block in the adapter */
+static GstFlowReturn
+gst_pcap_parse_parse_next (GstPcapParse * self)
+{
+  GstPcapParsePacket packet;
+  GstFlowReturn ret;
+  const guint8 *data;
+  gsize avail;
+
+  avail = gst_adapter_available (self->adapter);
+
+  if (!self->initialized) {
+    gsize consumed = 0;
+
+    data = gst_adapter_map (self->adapter, MIN (avail, PCAP_HEADER_LEN));
+    ret = gst_pcap_parse_read_file_header (self, data, avail, &consumed);
+    gst_adapter_unmap (self->adapter);
+
+    if (ret == GST_FLOW_OK)
+      gst_pcap_parse_skip (self, consumed);
+  } else if (self->is_pcapng) {
+    guint32 type, length;
+    gboolean have_packet;
+
+    if (avail < PCAPNG_BLOCK_MIN_LEN)
+      return GST_PCAP_PARSE_NEED_DATA;
+
+    data = gst_adapter_map (self->adapter, PCAPNG_BLOCK_MIN_LEN);
+    ret = gst_pcap_parse_read_block_header (self, data, &type, &length);
+    gst_adapter_unmap (self->adapter);
+    if (ret != GST_FLOW_OK)
+      return ret;
+
+    if (avail < length)
+      return GST_PCAP_PARSE_NEED_DATA;
+
+    data = gst_adapter_map (self->adapter, length);
+    have_packet = gst_pcap_parse_read_block (self, data, type, length,
+        self->parse_offset, &packet);
+    gst_adapter_unmap (self->adapter);
+
+    if (have_packet)
+      ret = gst_pcap_parse_take_packet (self, length, &packet);
+    else
+      gst_pcap_parse_skip (self, length);
+  } else {
+    if (avail < PCAP_RECORD_HEADER_LEN)
+      return GST_PCAP_PARSE_NEED_DATA;
+
+    data = gst_adapter_map (self->adapter, PCAP_RECORD_HEADER_LEN);
+    gst_pcap_parse_read_record_header (self, data, &packet);
+    gst_adapter_unmap (self->adapter);
+
+    if (packet.size > PCAP_MAX_PACKET_LEN) {
+      GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+          ("Invalid packet length %" G_GSIZE_FORMAT, packet.size));
+      return GST_FLOW_ERROR;
+    }
+
+    if (avail < PCAP_RECORD_HEADER_LEN + packet.size)
+      return GST_PCAP_PARSE_NEED_DATA;
+
+    if (packet.size > 0)
+      ret = gst_pcap_parse_take_packet (self,
+          PCAP_RECORD_HEADER_LEN + packet.size, &packet);
+    else
+      gst_pcap_parse_skip (self, PCAP_RECORD_HEADER_LEN);
+  }
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_pcap_parse_push_list (GstPcapParse * self, GstPad * pad,
+    gboolean * newsegment_sent, GstBufferList * list)
+{
+  if (!*newsegment_sent) {
+    if (pad == self->src_pad && self->caps)
+      gst_pad_set_caps (self->src_pad, self->caps);
+    gst_pad_push_event (pad, gst_event_new_segment (&self->segment));
+    *newsegment_sent = TRUE;
+  }
+
+  return gst_pad_push_list (pad, list);
+}
+
+/* Pushes the payloads queued while parsing */
+static GstFlowReturn
+gst_pcap_parse_push_pending (GstPcapParse * self)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GHashTableIter iter;
+  GstPcapParseFlow *flow;
+
+  if (self->list) {
+    ret = gst_pcap_parse_push_list (self, self->src_pad,
+        &self->newsegment_sent, self->list);
+    self->list = NULL;
+  }
+
+  g_hash_table_iter_init (&iter, self->flows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & flow)) {
+    GstFlowReturn flow_ret;
+
+    if (flow->list == NULL)
+      continue;
+
+    flow_ret = gst_pcap_parse_push_list (self, flow->pad,
+        &flow->newsegment_sent, flow->list);
+    flow->list = NULL;
+
+    flow_ret = gst_flow_combiner_update_pad_flow (self->flowcombiner,
+        flow->pad, flow_ret);
+    if (flow_ret != GST_FLOW_OK)
+      ret = flow_ret;
+  }
+
+  return ret;
+}
+
+/* Parses everything available in the adapter and pushes the payloads */
+static GstFlowReturn
+gst_pcap_parse_process (GstPcapParse * self)
+{
+  GstFlowReturn ret, push_ret;
+
+  do {
+    ret = gst_pcap_parse_parse_next (self);
+  } while (ret == GST_FLOW_OK);
+
+  if (ret == GST_PCAP_PARSE_NEED_DATA)
+    ret = GST_FLOW_OK;
+
+  push_ret = gst_pcap_parse_push_pending (self);
+  if (ret == GST_FLOW_OK)
+    ret = push_ret;
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  GstFlowReturn ret;
+
+  gst_adapter_push (self->adapter, buffer);
+
+  ret = gst_pcap_parse_process (self);
 
   if (ret != GST_FLOW_OK)
     gst_pcap_parse_reset (self);
@@ -610,6 +1243,33 @@ out:
   return ret;
 }
 
+static void
+gst_pcap_parse_push_event (GstPcapParse * self, GstEvent * event)
+{
+  GHashTableIter iter;
+  GstPcapParseFlow *flow;
+
+  g_hash_table_iter_init (&iter, self->flows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & flow))
+    gst_pad_push_event (flow->pad, gst_event_ref (event));
+
+  gst_pad_push_event (self->src_pad, event);
+}
+
+static void
+gst_pcap_parse_mark_discont (GstPcapParse * self)
+{
+  GHashTableIter iter;
+  GstPcapParseFlow *flow;
+
+  g_hash_table_iter_init (&iter, self->flows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & flow))
+    flow->newsegment_sent = FALSE;
+  self->newsegment_sent = FALSE;
+
+  gst_flow_combiner_reset (self->flowcombiner);
+}
+
 static gboolean
 gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -621,6 +1281,17 @@ gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       /* Drop it, we'll replace it with our own */
       gst_event_unref (event);
       break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_flow_combiner_reset (self->flowcombiner);
+      /* fall through */
+    case GST_EVENT_FLUSH_START:
+      gst_pcap_parse_push_event (self, event);
+      break;
+    case GST_EVENT_EOS:
+      if (self->split_flows)
+        gst_element_no_more_pads (GST_ELEMENT (self));
+      gst_pcap_parse_push_event (self, event);
+      break;
     default:
       ret = gst_pad_push_event (self->src_pad, event);
       break;
@@ -628,3 +1299,363 @@ gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 
   return ret;
 }
+
+static gboolean
+gst_pcap_parse_sink_activate (GstPad * sinkpad, GstObject * parent)
+{
+  GstQuery *query;
+  gboolean pull_mode;
+
+  query = gst_query_new_scheduling ();
+
+  if (!gst_pad_peer_query (sinkpad, query)) {
+    gst_query_unref (query);
+    goto activate_push;
+  }
+
+  pull_mode = gst_query_has_scheduling_mode_with_flags (query,
+      GST_PAD_MODE_PULL, GST_SCHEDULING_FLAG_SEEKABLE);
+  gst_query_unref (query);
+
+  if (!pull_mode)
+    goto activate_push;
+
+  GST_DEBUG_OBJECT (sinkpad, "activating pull");
+  return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PULL, TRUE);
+
+activate_push:
+  {
+    GST_DEBUG_OBJECT (sinkpad, "activating push");
+    return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PUSH, TRUE);
+  }
+}
+
+static gboolean
+gst_pcap_parse_sink_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      self->pull_mode = FALSE;
+      res = TRUE;
+      break;
+    case GST_PAD_MODE_PULL:
+      if (active) {
+        gst_pcap_parse_reset (self);
+        self->pull_mode = TRUE;
+        self->need_stream_start = TRUE;
+        res = gst_pad_start_task (pad, (GstTaskFunction) gst_pcap_parse_loop,
+            pad, NULL);
+      } else {
+        res = gst_pad_stop_task (pad);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+  return res;
+}
+
+/* Reads the headers of records or blocks from the end of the index on,
+ * without taking the packets, until the index has an entry at or after
+ * @target or the end of the file is reached */
+static GstFlowReturn
+gst_pcap_parse_scan_index (GstPcapParse * self, GstClockTime target)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  while (self->index->len == 0 || g_array_index (self->index,
+          GstPcapParseIndexEntry, self->index->len - 1).ts < target) {
+    guint64 offset = self->index_end;
+    GstPcapParsePacket packet;
+    GstBuffer *buffer = NULL;
+    GstMapInfo map;
+    gsize consumed = 0;
+
+    if (!self->initialized) {
+      ret = gst_pad_pull_range (self->sink_pad, offset, PCAP_HEADER_LEN,
+          &buffer);
+      if (ret != GST_FLOW_OK)
+        break;
+
+      gst_buffer_map (buffer, &map, GST_MAP_READ);
+      ret = gst_pcap_parse_read_file_header (self, map.data, map.size,
+          &consumed);
+      gst_buffer_unmap (buffer, &map);
+      gst_buffer_unref (buffer);
+
+      if (ret == GST_PCAP_PARSE_NEED_DATA)
+        ret = GST_FLOW_EOS;
+      if (ret != GST_FLOW_OK)
+        break;
+    } else if (self->is_pcapng) {
+      guint32 type = 0, length = 0;
+
+      ret = gst_pad_pull_range (self->sink_pad, offset, PCAPNG_PB_HEADER_LEN,
+          &buffer);
+      if (ret != GST_FLOW_OK)
+        break;
+
+      gst_buffer_map (buffer, &map, GST_MAP_READ);
+      if (map.size < PCAPNG_BLOCK_MIN_LEN) {
+        ret = GST_FLOW_EOS;
+      } else {
+        ret = gst_pcap_parse_read_block_header (self, map.data, &type,
+            &length);
+      }
+      gst_buffer_unmap (buffer, &map);
+
+      if (ret == GST_FLOW_OK && (type == PCAPNG_BLOCK_SHB ||
+              type == PCAPNG_BLOCK_IDB || map.size < PCAPNG_PB_HEADER_LEN)) {
+        /* these need the whole block */
+        gst_buffer_unref (buffer);
+        buffer = NULL;
+        ret = gst_pad_pull_range (self->sink_pad, offset, length, &buffer);
+        if (ret == GST_FLOW_OK && gst_buffer_get_size (buffer) < length)
+          ret = GST_FLOW_EOS;
+      }
+
+      if (ret == GST_FLOW_OK) {
+        gst_buffer_map (buffer, &map, GST_MAP_READ);
+        if (gst_pcap_parse_read_block (self, map.data, type, length, offset,
+                &packet))
+          gst_pcap_parse_add_index_entry (self, packet.ts, offset);
+        gst_buffer_unmap (buffer, &map);
+        consumed = length;
+      }
+      if (buffer)
+        gst_buffer_unref (buffer);
+      if (ret != GST_FLOW_OK)
+        break;
+    } else {
+      ret = gst_pad_pull_range (self->sink_pad, offset,
+          PCAP_RECORD_HEADER_LEN, &buffer);
+      if (ret != GST_FLOW_OK)
+        break;
+
+      gst_buffer_map (buffer, &map, GST_MAP_READ);
+      if (map.size < PCAP_RECORD_HEADER_LEN) {
+        ret = GST_FLOW_EOS;
+      } else {
+        gst_pcap_parse_read_record_header (self, map.data, &packet);
+        gst_pcap_parse_add_index_entry (self, packet.ts, offset);
+        consumed = PCAP_RECORD_HEADER_LEN + packet.size;
+      }
+      gst_buffer_unmap (buffer, &map);
+      gst_buffer_unref (buffer);
+      if (ret != GST_FLOW_OK)
+        break;
+    }
+
+    self->index_end = offset + consumed;
+  }
+
+  return ret;
+}
+
+/* Called from the streaming thread to restart parsing at the position of
+ * the configured segment */
+static GstFlowReturn
+gst_pcap_parse_handle_seek (GstPcapParse * self)
+{
+  GstPcapParseIndexEntry *entry = NULL;
+  GstClockTime target;
+  GstFlowReturn ret;
+  guint i;
+
+  /* the first packet gives the base timestamp */
+  ret = gst_pcap_parse_scan_index (self, 0);
+  if (ret != GST_FLOW_OK && ret != GST_FLOW_EOS)
+    return ret;
+
+  if (self->index->len > 0 && !GST_CLOCK_TIME_IS_VALID (self->base_ts))
+    self->base_ts = g_array_index (self->index, GstPcapParseIndexEntry, 0).ts;
+
+  /* convert to capture time */
+  target = self->segment.start;
+  if (self->offset >= 0 && GST_CLOCK_TIME_IS_VALID (self->base_ts)) {
+    if (target > self->offset)
+      target = target - self->offset + self->base_ts;
+    else
+      target = self->base_ts;
+  }
+
+  ret = gst_pcap_parse_scan_index (self, target);
+  if (ret != GST_FLOW_OK && ret != GST_FLOW_EOS)
+    return ret;
+
+  for (i = 0; i < self->index->len; i++) {
+    GstPcapParseIndexEntry *e = &g_array_index (self->index,
+        GstPcapParseIndexEntry, i);
+
+    if (e->ts > target)
+      break;
+    entry = e;
+  }
+  if (entry == NULL && self->index->len > 0)
+    entry = &g_array_index (self->index, GstPcapParseIndexEntry, 0);
+
+  gst_adapter_clear (self->adapter);
+  if (self->list) {
+    gst_buffer_list_unref (self->list);
+    self->list = NULL;
+  }
+
+  self->parse_offset = entry ? entry->offset : self->index_end;
+  self->pull_offset = self->parse_offset;
+  self->skip_until = target;
+  self->have_segment = TRUE;
+  self->need_seek = FALSE;
+  gst_pcap_parse_mark_discont (self);
+
+  GST_DEBUG_OBJECT (self, "seeking to %" GST_TIME_FORMAT " from offset %"
+      G_GUINT64_FORMAT, GST_TIME_ARGS (target), self->parse_offset);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_pcap_parse_perform_seek (GstPcapParse * self, GstEvent * event)
+{
+  gdouble rate;
+  GstFormat format;
+  GstSeekFlags flags;
+  GstSeekType start_type, stop_type;
+  gint64 start, stop;
+  gboolean flush;
+  gboolean update;
+  GstSegment seeksegment;
+  guint32 seqnum;
+  GstEvent *tevent;
+
+  gst_event_parse_seek (event, &rate, &format, &flags, &start_type,
+      &start, &stop_type, &stop);
+
+  if (format != GST_FORMAT_TIME || rate <= 0.0) {
+    GST_DEBUG_OBJECT (self, "only forward seeks in TIME are supported");
+    return FALSE;
+  }
+
+  flush = flags & GST_SEEK_FLAG_FLUSH;
+  seqnum = gst_event_get_seqnum (event);
+
+  if (flush) {
+    tevent = gst_event_new_flush_start ();
+    gst_event_set_seqnum (tevent, seqnum);
+    gst_pcap_parse_push_event (self, tevent);
+  } else {
+    gst_pad_pause_task (self->sink_pad);
+  }
+
+  GST_PAD_STREAM_LOCK (self->sink_pad);
+
+  seeksegment = self->segment;
+  gst_segment_do_seek (&seeksegment, rate, format, flags, start_type, start,
+      stop_type, stop, &update);
+
+  GST_DEBUG_OBJECT (self, "seek segment %" GST_SEGMENT_FORMAT, &seeksegment);
+
+  if (flush) {
+    tevent = gst_event_new_flush_stop (TRUE);
+    gst_event_set_seqnum (tevent, seqnum);
+    gst_pcap_parse_push_event (self, tevent);
+  }
+
+  self->segment = seeksegment;
+  self->need_seek = TRUE;
+
+  gst_pad_start_task (self->sink_pad, (GstTaskFunction) gst_pcap_parse_loop,
+      self->sink_pad, NULL);
+
+  GST_PAD_STREAM_UNLOCK (self->sink_pad);
+
+  return TRUE;
+}
+
+static gboolean
+gst_pcap_parse_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  gboolean res;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEEK:
+      if (self->pull_mode) {
+        res = gst_pcap_parse_perform_seek (self, event);
+        gst_event_unref (event);
+      } else {
+        res = gst_pad_event_default (pad, parent, event);
+      }
+      break;
+    default:
+      res = gst_pad_event_default (pad, parent, event);
+      break;
+  }
+
+  return res;
+}
+
+static void
+gst_pcap_parse_loop (GstPad * pad)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (GST_PAD_PARENT (pad));
+  GstFlowReturn ret;
+  GstBuffer *buffer = NULL;
+
+  if (self->need_stream_start) {
+    gchar *stream_id;
+
+    stream_id = gst_pad_create_stream_id (self->src_pad,
+        GST_ELEMENT_CAST (self), NULL);
+    gst_pad_push_event (self->src_pad, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+    self->need_stream_start = FALSE;
+  }
+
+  if (self->need_seek) {
+    ret = gst_pcap_parse_handle_seek (self);
+    if (ret != GST_FLOW_OK)
+      goto pause;
+  }
+
+  ret = gst_pad_pull_range (pad, self->pull_offset, PULL_SIZE, &buffer);
+  if (ret != GST_FLOW_OK)
+    goto pause;
+
+  if (gst_buffer_get_size (buffer) == 0) {
+    gst_buffer_unref (buffer);
+    ret = GST_FLOW_EOS;
+    goto pause;
+  }
+
+  self->pull_offset += gst_buffer_get_size (buffer);
+  gst_adapter_push (self->adapter, buffer);
+
+  ret = gst_pcap_parse_process (self);
+  if (ret != GST_FLOW_OK)
+    goto pause;
+
+  return;
+
+pause:
+  {
+    const gchar *reason = gst_flow_get_name (ret);
+
+    GST_DEBUG_OBJECT (self, "pausing task, reason %s", reason);
+    gst_pad_pause_task (pad);
+    if (ret == GST_FLOW_EOS) {
+      if (self->split_flows)
+        gst_element_no_more_pads (GST_ELEMENT (self));
+      gst_pcap_parse_push_event (self, gst_event_new_eos ());
+    } else if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          ("Internal data stream error."),
+          ("streaming task paused, reason %s (%d)", reason, ret));
+      gst_pcap_parse_push_event (self, gst_event_new_eos ());
+    }
+  }
+}
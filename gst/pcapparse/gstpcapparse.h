@@ -22,6 +22,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
+#include <gst/base/gstflowcombiner.h>
 
 G_BEGIN_DECLS
 
@@ -73,17 +74,43 @@ struct _GstPcapParse
   gint32 dst_port;
   GstCaps *caps;
   gint64 offset;
+  gboolean split_flows;
 
   /* state */
   GstAdapter * adapter;
   gboolean initialized;
+  gboolean is_pcapng;
   gboolean swap_endian;
-  gint64 cur_packet_size;
   GstClockTime cur_ts;
   GstClockTime base_ts;
   GstPcapParseLinktype linktype;
-
+  /* timestamp units per second of classic pcap */
+  guint64 ts_units;
+  /* interfaces of the current pcapng section */
+  GArray *interfaces;
+  /* byte offset of the data at the start of the adapter */
+  guint64 parse_offset;
+
+  GstSegment segment;
+  gboolean have_segment;
   gboolean newsegment_sent;
+  GstBufferList *list;
+
+  /* flows with their own pad, when splitting */
+  GHashTable *flows;
+  guint n_flows;
+  GstFlowCombiner *flowcombiner;
+
+  /* pull mode */
+  gboolean pull_mode;
+  guint64 pull_offset;
+  gboolean need_stream_start;
+  gboolean need_seek;
+  GstClockTime skip_until;
+  /* capture time and offset of packets, at most one per second */
+  GArray *index;
+  /* offset up to which the file was parsed at least once */
+  guint64 index_end;
 };
 
 struct _GstPcapParseClass
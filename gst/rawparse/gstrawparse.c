@@ -59,6 +59,10 @@ static gboolean gst_raw_parse_handle_seek_pull (GstRawParse * rp,
 
 static void gst_raw_parse_reset (GstRawParse * rp);
 
+/* upper bound for the chunks pulled from upstream in pull mode, frames
+ * smaller than this are pulled several at a time */
+#define RAW_PARSE_PULL_CHUNK_SIZE (4 * 1024 * 1024)
+
 static GstStaticPadTemplate gst_raw_parse_sink_pad_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -166,6 +170,8 @@ gst_raw_parse_dispose (GObject * object)
     rp->adapter = NULL;
   }
 
+  gst_buffer_replace (&rp->pull_buffer, NULL);
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -202,6 +208,7 @@ gst_raw_parse_reset (GstRawParse * rp)
 
   gst_segment_init (&rp->segment, GST_FORMAT_TIME);
   gst_adapter_clear (rp->adapter);
+  gst_buffer_replace (&rp->pull_buffer, NULL);
 }
 
 static gboolean
@@ -232,11 +239,21 @@ gst_raw_parse_push_buffer (GstRawParse * rp, GstBuffer * buffer)
 {
   GstFlowReturn ret;
   gint nframes;
+  gsize size;
   GstRawParseClass *rpclass;
 
   rpclass = GST_RAW_PARSE_GET_CLASS (rp);
 
-  nframes = gst_buffer_get_size (buffer) / rp->framesize;
+  size = gst_buffer_get_size (buffer);
+  nframes = size / rp->framesize;
+
+  if (rpclass->process_buffer) {
+    buffer = rpclass->process_buffer (rp, buffer);
+    if (buffer == NULL) {
+      GST_ERROR_OBJECT (rp, "failed to process buffer");
+      return GST_FLOW_ERROR;
+    }
+  }
 
   if (rp->segment.rate < 0) {
     rp->n_frames -= nframes;
@@ -267,7 +284,7 @@ gst_raw_parse_push_buffer (GstRawParse * rp, GstBuffer * buffer)
   }
 
   if (rp->segment.rate >= 0) {
-    rp->offset += gst_buffer_get_size (buffer);
+    rp->offset += size;
     rp->n_frames += nframes;
   }
 
@@ -315,7 +332,9 @@ gst_raw_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   }
 
   while (buffersize > 0 && gst_adapter_available (rp->adapter) >= buffersize) {
-    buffer = gst_adapter_take_buffer (rp->adapter, buffersize);
+    /* frames spanning several input buffers are pushed as multi-memory
+     * buffers, downstream only merges them if it has to */
+    buffer = gst_adapter_take_buffer_fast (rp->adapter, buffersize);
 
     ret = gst_raw_parse_push_buffer (rp, buffer);
     if (ret != GST_FLOW_OK)
@@ -334,6 +353,70 @@ no_caps:
   }
 }
 
+/* Pulls @size bytes at @offset. Upstream is asked for whole chunks of
+ * frames and the frames are returned as sub-buffers of the last chunk, so
+ * small frames don't each cost a pull and no data is copied. */
+static GstFlowReturn
+gst_raw_parse_pull_range (GstRawParse * rp, gint64 offset, guint size,
+    GstBuffer ** buffer)
+{
+  GstFlowReturn ret;
+  GstBuffer *chunk = NULL;
+  gint64 start, end;
+  guint chunk_size;
+  gsize avail;
+
+  if (rp->pull_buffer) {
+    avail = gst_buffer_get_size (rp->pull_buffer);
+
+    if (offset >= rp->pull_offset && offset + size <= rp->pull_offset + avail) {
+      *buffer = gst_buffer_copy_region (rp->pull_buffer,
+          GST_BUFFER_COPY_MEMORY, offset - rp->pull_offset, size);
+      return GST_FLOW_OK;
+    }
+    gst_buffer_replace (&rp->pull_buffer, NULL);
+  }
+
+  if (size >= RAW_PARSE_PULL_CHUNK_SIZE)
+    return gst_pad_pull_range (rp->sinkpad, offset, size, buffer);
+
+  chunk_size = RAW_PARSE_PULL_CHUNK_SIZE;
+  chunk_size -= chunk_size % rp->framesize;
+  chunk_size = MAX (chunk_size, size);
+
+  if (rp->segment.rate >= 0) {
+    start = offset;
+    end = offset + chunk_size;
+    if (rp->upstream_length != -1 && end > rp->upstream_length)
+      end = MAX (rp->upstream_length, offset + size);
+  } else {
+    end = offset + size;
+    start = MAX (end - chunk_size, 0);
+  }
+
+  ret = gst_pad_pull_range (rp->sinkpad, start, end - start, &chunk);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  GST_LOG_OBJECT (rp, "pulled chunk of %" G_GSIZE_FORMAT " bytes at offset %"
+      G_GINT64_FORMAT, gst_buffer_get_size (chunk), start);
+
+  avail = gst_buffer_get_size (chunk);
+  if (offset - start >= avail) {
+    gst_buffer_unref (chunk);
+    return GST_FLOW_EOS;
+  }
+
+  rp->pull_buffer = chunk;
+  rp->pull_offset = start;
+
+  /* a short chunk ends up as a short read, which the caller handles */
+  *buffer = gst_buffer_copy_region (chunk, GST_BUFFER_COPY_MEMORY,
+      offset - start, MIN (size, avail - (offset - start)));
+
+  return GST_FLOW_OK;
+}
+
 static void
 gst_raw_parse_loop (GstElement * element)
 {
@@ -400,7 +483,7 @@ gst_raw_parse_loop (GstElement * element)
   }
 
   buffer = NULL;
-  ret = gst_pad_pull_range (rp->sinkpad, rp->offset, size, &buffer);
+  ret = gst_raw_parse_pull_range (rp, rp->offset, size, &buffer);
 
   if (ret != GST_FLOW_OK) {
     GST_DEBUG_OBJECT (rp, "pull_range (%" G_GINT64_FORMAT ", %u) "
@@ -569,6 +652,23 @@ gst_raw_parse_change_state (GstElement * element, GstStateChange transition)
   return ret;
 }
 
+/* Returns the frame that is displayed at @time. Frame timestamps are rounded
+ * down, so converting one back with a plain scale can land on the frame
+ * before it. */
+static guint64
+gst_raw_parse_time_to_frames (GstRawParse * rp, guint64 time)
+{
+  guint64 frames;
+
+  frames = gst_util_uint64_scale (time, rp->fps_n, GST_SECOND * rp->fps_d);
+
+  if (rp->fps_n != 0 && gst_util_uint64_scale (frames + 1,
+          GST_SECOND * rp->fps_d, rp->fps_n) <= time)
+    frames++;
+
+  return frames;
+}
+
 static gboolean
 gst_raw_parse_convert (GstRawParse * rp,
     GstFormat src_format, gint64 src_value,
@@ -614,8 +714,7 @@ gst_raw_parse_convert (GstRawParse * rp,
   /* time to frames */
   if (src_format == GST_FORMAT_TIME && dest_format == GST_FORMAT_DEFAULT) {
     if (rp->fps_d != 0) {
-      *dest_value = gst_util_uint64_scale (src_value,
-          rp->fps_n, GST_SECOND * rp->fps_d);
+      *dest_value = gst_raw_parse_time_to_frames (rp, src_value);
     } else {
       GST_ERROR ("framerate denominator is 0");
       *dest_value = 0;
@@ -640,8 +739,8 @@ gst_raw_parse_convert (GstRawParse * rp,
   /* time to bytes */
   if (src_format == GST_FORMAT_TIME && dest_format == GST_FORMAT_BYTES) {
     if (rp->fps_d != 0) {
-      *dest_value = gst_util_uint64_scale (src_value,
-          rp->fps_n * rp->framesize, GST_SECOND * rp->fps_d);
+      *dest_value = gst_raw_parse_time_to_frames (rp, src_value) *
+          rp->framesize;
     } else {
       GST_ERROR ("framerate denominator is 0");
       *dest_value = 0;
@@ -654,7 +753,7 @@ gst_raw_parse_convert (GstRawParse * rp,
   if (src_format == GST_FORMAT_BYTES && dest_format == GST_FORMAT_TIME) {
     if (rp->fps_n != 0 && rp->framesize != 0) {
       *dest_value = gst_util_uint64_scale (src_value,
-          GST_SECOND * rp->fps_d, rp->fps_n * rp->framesize);
+          GST_SECOND * rp->fps_d, (guint64) rp->fps_n * rp->framesize);
     } else {
       GST_ERROR ("framerate denominator and/or framesize is 0");
       *dest_value = 0;
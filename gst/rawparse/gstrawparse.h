@@ -65,6 +65,10 @@ struct _GstRawParse
   gint64 upstream_length;
   gint64 offset;
 
+  /* last chunk pulled from upstream, frames are handed out as sub-buffers */
+  GstBuffer *pull_buffer;
+  gint64 pull_offset;
+
   GstSegment segment;
   GstEvent *start_segment;
 
@@ -78,6 +82,7 @@ struct _GstRawParseClass
 
   GstCaps * (*get_caps) (GstRawParse *rp);
   void (*set_buffer_flags) (GstRawParse *rp, GstBuffer *buffer);
+  GstBuffer * (*process_buffer) (GstRawParse *rp, GstBuffer *buffer);
 
   gboolean multiple_frames_per_buffer;
 };
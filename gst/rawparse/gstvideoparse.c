@@ -23,6 +23,21 @@
  * SECTION:element-videoparse
  *
  * Converts a byte stream into video frames.
+ *
+ * Frames are expected in the default layout GStreamer uses for the format.
+ * Dumps with padded rows or planes, as written by many capture cards, can be
+ * described with the #GstVideoParse:strides, #GstVideoParse:offsets and
+ * #GstVideoParse:framesize properties. Such frames are pushed with a
+ * #GstVideoMeta describing their layout, or copied to the default layout
+ * when downstream doesn't support the meta.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 filesrc location=capture.yuv ! videoparse format=nv12 width=1920 height=1080 strides=2048,2048 offsets=0,2228224 framesize=3342336 ! videoconvert ! autovideosink
+ * ]| Plays an NV12 dump with rows padded to 2048 bytes and planes padded to
+ * 1088 rows.
+ * </refsect2>
  */
 
 #ifdef HAVE_CONFIG_H
@@ -39,6 +54,8 @@ static void gst_video_parse_get_property (GObject * object, guint prop_id,
 static GstCaps *gst_video_parse_get_caps (GstRawParse * rp);
 static void gst_video_parse_set_buffer_flags (GstRawParse * rp,
     GstBuffer * buffer);
+static GstBuffer *gst_video_parse_process_buffer (GstRawParse * rp,
+    GstBuffer * buffer);
 
 static void gst_video_parse_update_frame_size (GstVideoParse * vp);
 
@@ -54,7 +71,10 @@ enum
   PROP_PAR,
   PROP_FRAMERATE,
   PROP_INTERLACED,
-  PROP_TOP_FIELD_FIRST
+  PROP_TOP_FIELD_FIRST,
+  PROP_STRIDES,
+  PROP_OFFSETS,
+  PROP_FRAMESIZE
 };
 
 #define gst_video_parse_parent_class parent_class
@@ -73,6 +93,7 @@ gst_video_parse_class_init (GstVideoParseClass * klass)
 
   rp_class->get_caps = gst_video_parse_get_caps;
   rp_class->set_buffer_flags = gst_video_parse_set_buffer_flags;
+  rp_class->process_buffer = gst_video_parse_process_buffer;
 
   g_object_class_install_property (gobject_class, PROP_FORMAT,
       g_param_spec_enum ("format", "Format", "Format of images in raw stream",
@@ -100,6 +121,21 @@ gst_video_parse_class_init (GstVideoParseClass * klass)
       g_param_spec_boolean ("top-field-first", "Top field first",
           "True if top field is earlier than bottom field", TRUE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_STRIDES,
+      g_param_spec_string ("strides", "Strides",
+          "Stride of each plane in bytes using string format: 's0,s1,s2,s3' "
+          "(NULL = default strides)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_OFFSETS,
+      g_param_spec_string ("offsets", "Offsets",
+          "Offset of each plane in bytes using string format: 'o0,o1,o2,o3' "
+          "(NULL = planes follow each other)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FRAMESIZE,
+      g_param_spec_uint ("framesize", "Framesize",
+          "Size of an image in raw stream, including padding "
+          "(0 = size of the planes)", 0, G_MAXINT, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (gstelement_class, "Video Parse",
       "Filter/Video",
@@ -130,6 +166,41 @@ gst_video_parse_init (GstVideoParse * vp)
   gst_raw_parse_set_fps (GST_RAW_PARSE (vp), 25, 1);
 }
 
+/* Parses a comma separated list of at most GST_VIDEO_MAX_PLANES unsigned
+ * integers. An empty or NULL string gives an empty list. */
+static gboolean
+gst_video_parse_parse_int_list (const gchar * str, guint64 * values,
+    guint * n_values)
+{
+  gchar **tokens;
+  guint i, n;
+  gboolean ret = TRUE;
+
+  *n_values = 0;
+  if (str == NULL || *str == '\0')
+    return TRUE;
+
+  tokens = g_strsplit (str, ",", -1);
+  n = g_strv_length (tokens);
+  if (n > GST_VIDEO_MAX_PLANES)
+    ret = FALSE;
+
+  for (i = 0; ret && i < n; i++) {
+    gchar *token = g_strstrip (tokens[i]);
+    gchar *end;
+
+    values[i] = g_ascii_strtoull (token, &end, 10);
+    if (end == token || *end != '\0')
+      ret = FALSE;
+  }
+  g_strfreev (tokens);
+
+  if (ret)
+    *n_values = n;
+
+  return ret;
+}
+
 static void
 gst_video_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -163,6 +234,46 @@ gst_video_parse_set_property (GObject * object, guint prop_id,
     case PROP_TOP_FIELD_FIRST:
       vp->top_field_first = g_value_get_boolean (value);
       break;
+    case PROP_STRIDES:{
+      guint64 values[GST_VIDEO_MAX_PLANES];
+      gboolean valid;
+      guint i, n;
+
+      valid = gst_video_parse_parse_int_list (g_value_get_string (value),
+          values, &n);
+      for (i = 0; valid && i < n; i++)
+        valid = values[i] > 0 && values[i] <= G_MAXINT;
+
+      if (!valid) {
+        GST_WARNING_OBJECT (vp, "invalid strides '%s'",
+            g_value_get_string (value));
+        break;
+      }
+
+      for (i = 0; i < n; i++)
+        vp->stride[i] = values[i];
+      vp->n_strides = n;
+      break;
+    }
+    case PROP_OFFSETS:{
+      guint64 values[GST_VIDEO_MAX_PLANES];
+      guint i, n;
+
+      if (!gst_video_parse_parse_int_list (g_value_get_string (value),
+              values, &n)) {
+        GST_WARNING_OBJECT (vp, "invalid offsets '%s'",
+            g_value_get_string (value));
+        break;
+      }
+
+      for (i = 0; i < n; i++)
+        vp->offset[i] = values[i];
+      vp->n_offsets = n;
+      break;
+    }
+    case PROP_FRAMESIZE:
+      vp->framesize = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -203,21 +314,133 @@ gst_video_parse_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_TOP_FIELD_FIRST:
       g_value_set_boolean (value, vp->top_field_first);
       break;
+    case PROP_STRIDES:{
+      GString *str;
+      guint i;
+
+      if (vp->n_strides == 0) {
+        g_value_set_string (value, NULL);
+        break;
+      }
+
+      str = g_string_new (NULL);
+      for (i = 0; i < vp->n_strides; i++)
+        g_string_append_printf (str, "%s%d", i > 0 ? "," : "", vp->stride[i]);
+      g_value_take_string (value, g_string_free (str, FALSE));
+      break;
+    }
+    case PROP_OFFSETS:{
+      GString *str;
+      guint i;
+
+      if (vp->n_offsets == 0) {
+        g_value_set_string (value, NULL);
+        break;
+      }
+
+      str = g_string_new (NULL);
+      for (i = 0; i < vp->n_offsets; i++)
+        g_string_append_printf (str, "%s%" G_GSIZE_FORMAT, i > 0 ? "," : "",
+            vp->offset[i]);
+      g_value_take_string (value, g_string_free (str, FALSE));
+      break;
+    }
+    case PROP_FRAMESIZE:
+      g_value_set_uint (value, vp->framesize);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* Size in bytes of a plane in the layout described by @info */
+static gsize
+gst_video_parse_plane_size (const GstVideoInfo * info, guint plane)
+{
+  guint comp;
+
+  for (comp = 0; comp < GST_VIDEO_INFO_N_COMPONENTS (info); comp++) {
+    if (GST_VIDEO_INFO_COMP_PLANE (info, comp) == plane)
+      return (gsize) GST_VIDEO_INFO_PLANE_STRIDE (info, plane) *
+          GST_VIDEO_INFO_COMP_HEIGHT (info, comp);
+  }
+
+  /* the palette of paletted formats, 256 entries */
+  return (gsize) GST_VIDEO_INFO_PLANE_STRIDE (info, plane) * 256;
+}
+
+/* Whether the strides and offsets properties describe a layout that can be
+ * used with the format */
+static gboolean
+gst_video_parse_has_custom_layout (GstVideoParse * vp,
+    const GstVideoInfo * info)
+{
+  guint n_planes = GST_VIDEO_INFO_N_PLANES (info);
+
+  if (vp->n_strides == 0 && vp->n_offsets == 0)
+    return FALSE;
+
+  if (GST_VIDEO_FORMAT_INFO_IS_TILED (info->finfo))
+    return FALSE;
+
+  if (vp->n_strides != 0 && vp->n_strides != n_planes)
+    return FALSE;
+
+  if (vp->n_offsets != 0 && vp->n_offsets != n_planes)
+    return FALSE;
+
+  return TRUE;
+}
+
 void
 gst_video_parse_update_frame_size (GstVideoParse * vp)
 {
-  gint framesize;
-  GstVideoInfo info;
+  GstVideoInfo *info = &vp->info;
+  GstVideoInfo default_info;
+  gsize framesize;
+  guint i, n_planes;
+
+  gst_video_info_init (&default_info);
+  gst_video_info_set_format (&default_info, vp->format, vp->width, vp->height);
+  *info = default_info;
+  n_planes = GST_VIDEO_INFO_N_PLANES (info);
+
+  if (gst_video_parse_has_custom_layout (vp, info)) {
+    if (vp->n_strides != 0) {
+      for (i = 0; i < n_planes; i++)
+        info->stride[i] = vp->stride[i];
+    }
+
+    if (vp->n_offsets != 0) {
+      for (i = 0; i < n_planes; i++)
+        info->offset[i] = vp->offset[i];
+    } else {
+      /* planes follow each other without padding */
+      for (i = 1; i < n_planes; i++)
+        info->offset[i] = info->offset[i - 1] +
+            gst_video_parse_plane_size (info, i - 1);
+    }
+
+    framesize = 0;
+    for (i = 0; i < n_planes; i++)
+      framesize = MAX (framesize,
+          info->offset[i] + gst_video_parse_plane_size (info, i));
+  } else {
+    framesize = GST_VIDEO_INFO_SIZE (info);
+  }
+
+  /* padding after the last plane */
+  if (vp->framesize > framesize)
+    framesize = vp->framesize;
+  info->size = framesize;
 
-  gst_video_info_init (&info);
-  gst_video_info_set_format (&info, vp->format, vp->width, vp->height);
-  framesize = GST_VIDEO_INFO_SIZE (&info);
+  vp->need_videometa = FALSE;
+  for (i = 0; i < n_planes; i++) {
+    if (info->stride[i] != default_info.stride[i] ||
+        info->offset[i] != default_info.offset[i])
+      vp->need_videometa = TRUE;
+  }
 
   gst_raw_parse_set_framesize (GST_RAW_PARSE (vp), framesize);
 }
@@ -232,8 +455,7 @@ gst_video_parse_get_caps (GstRawParse * rp)
 
   gst_raw_parse_get_fps (rp, &fps_n, &fps_d);
 
-  gst_video_info_init (&info);
-  gst_video_info_set_format (&info, vp->format, vp->width, vp->height);
+  info = vp->info;
   info.fps_n = fps_n;
   info.fps_d = fps_d;
   info.par_n = vp->par_n;
@@ -242,11 +464,115 @@ gst_video_parse_get_caps (GstRawParse * rp)
       GST_VIDEO_INTERLACE_MODE_INTERLEAVED :
       GST_VIDEO_INTERLACE_MODE_PROGRESSIVE;
 
+  if ((vp->n_strides != 0 || vp->n_offsets != 0) &&
+      !gst_video_parse_has_custom_layout (vp, &info)) {
+    GST_ELEMENT_WARNING (vp, STREAM, FORMAT, (NULL),
+        ("Strides and offsets don't match format %s, using default layout",
+            gst_video_format_to_string (vp->format)));
+  }
+
+  if (vp->framesize != 0 && vp->framesize < GST_VIDEO_INFO_SIZE (&info)) {
+    GST_ELEMENT_WARNING (vp, STREAM, FORMAT, (NULL),
+        ("Framesize %u is smaller than the frame layout, using %"
+            G_GSIZE_FORMAT, vp->framesize, GST_VIDEO_INFO_SIZE (&info)));
+  }
+
+  /* decide how to push frames with a custom layout once the caps are set */
+  vp->check_allocation = TRUE;
+
   caps = gst_video_info_to_caps (&info);
 
   return caps;
 }
 
+/* Checks whether downstream can handle frames with a custom layout described
+ * by a GstVideoMeta. */
+static gboolean
+gst_video_parse_downstream_supports_videometa (GstVideoParse * vp)
+{
+  GstRawParse *rp = GST_RAW_PARSE (vp);
+  GstCaps *caps;
+  GstQuery *query;
+  gboolean ret = FALSE;
+
+  caps = gst_pad_get_current_caps (rp->srcpad);
+  if (caps == NULL)
+    return FALSE;
+
+  query = gst_query_new_allocation (caps, FALSE);
+  if (gst_pad_peer_query (rp->srcpad, query))
+    ret = gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE,
+        NULL);
+
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  return ret;
+}
+
+static GstBuffer *
+gst_video_parse_process_buffer (GstRawParse * rp, GstBuffer * buffer)
+{
+  GstVideoParse *vp = GST_VIDEO_PARSE (rp);
+  GstVideoInfo *info = &vp->info;
+  GstVideoInfo default_info;
+  GstVideoFrame in_frame, out_frame;
+  GstBuffer *outbuf;
+
+  if (!vp->need_videometa)
+    return buffer;
+
+  if (vp->check_allocation) {
+    vp->copy_frames = !gst_video_parse_downstream_supports_videometa (vp);
+    vp->check_allocation = FALSE;
+
+    GST_DEBUG_OBJECT (vp, "downstream %s GstVideoMeta, %s frames",
+        vp->copy_frames ? "doesn't support" : "supports",
+        vp->copy_frames ? "copying" : "not copying");
+  }
+
+  if (!vp->copy_frames) {
+    buffer = gst_buffer_make_writable (buffer);
+    gst_buffer_add_video_meta_full (buffer, GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_INFO_FORMAT (info), GST_VIDEO_INFO_WIDTH (info),
+        GST_VIDEO_INFO_HEIGHT (info), GST_VIDEO_INFO_N_PLANES (info),
+        info->offset, info->stride);
+    return buffer;
+  }
+
+  /* downstream expects the default layout */
+  gst_video_info_init (&default_info);
+  gst_video_info_set_format (&default_info, GST_VIDEO_INFO_FORMAT (info),
+      GST_VIDEO_INFO_WIDTH (info), GST_VIDEO_INFO_HEIGHT (info));
+
+  outbuf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&default_info),
+      NULL);
+
+  if (!gst_video_frame_map (&in_frame, info, buffer, GST_MAP_READ))
+    goto map_failed;
+  if (!gst_video_frame_map (&out_frame, &default_info, outbuf, GST_MAP_WRITE)) {
+    gst_video_frame_unmap (&in_frame);
+    goto map_failed;
+  }
+
+  gst_video_frame_copy (&out_frame, &in_frame);
+
+  gst_video_frame_unmap (&out_frame);
+  gst_video_frame_unmap (&in_frame);
+  gst_buffer_unref (buffer);
+
+  return outbuf;
+
+  /* ERRORS */
+map_failed:
+  {
+    GST_ERROR_OBJECT (vp, "failed to map frame");
+    gst_buffer_unref (outbuf);
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+}
+
 static void
 gst_video_parse_set_buffer_flags (GstRawParse * rp, GstBuffer * buffer)
 {
@@ -55,6 +55,17 @@ struct _GstVideoParse
   gint par_n, par_d;
   gboolean interlaced;
   gboolean top_field_first;
+  gint stride[GST_VIDEO_MAX_PLANES];
+  guint n_strides;
+  gsize offset[GST_VIDEO_MAX_PLANES];
+  guint n_offsets;
+  guint framesize;
+
+  /* frame layout derived from the properties */
+  GstVideoInfo info;
+  gboolean need_videometa;
+  gboolean check_allocation;
+  gboolean copy_frames;
 };
 
 struct _GstVideoParseClass
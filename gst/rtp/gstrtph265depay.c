@@ -804,17 +804,85 @@ incomplete_caps:
   }
 }
 
+/* Takes all buffers queued in @adapter as one buffer. The queued memory is
+ * referenced instead of copied, unless there are more memories than a buffer
+ * can hold, in which case they are merged with a single copy */
+static GstBuffer *
+gst_rtp_h265_depay_take_all (GstAdapter * adapter)
+{
+  GList *list, *walk;
+  GstBuffer *outbuf;
+  guint n_mem = 0;
+  gsize size;
+
+  size = gst_adapter_available (adapter);
+  if (size == 0)
+    return NULL;
+
+  list = gst_adapter_take_list (adapter, size);
+  for (walk = list; walk; walk = walk->next)
+    n_mem += gst_buffer_n_memory (walk->data);
+
+  if (n_mem <= gst_buffer_get_max_memory ()) {
+    outbuf = list->data;
+    for (walk = list->next; walk; walk = walk->next)
+      outbuf = gst_buffer_append (outbuf, walk->data);
+  } else {
+    GstMapInfo map;
+    gsize offset = 0;
+
+    GST_LOG ("merging %u memories of %" G_GSIZE_FORMAT " bytes", n_mem, size);
+
+    outbuf = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+    for (walk = list; walk; walk = walk->next) {
+      offset += gst_buffer_extract (walk->data, 0, map.data + offset,
+          size - offset);
+      gst_buffer_unref (walk->data);
+    }
+    gst_buffer_unmap (outbuf, &map);
+  }
+  g_list_free (list);
+
+  return outbuf;
+}
+
+/* Returns @size bytes of the mapped RTP payload at @data, sharing the
+ * memory of the RTP packet */
+static GstBuffer *
+gst_rtp_h265_depay_payload_subbuffer (GstRTPBuffer * rtp, const guint8 * data,
+    guint size)
+{
+  guint offset = data - (const guint8 *) gst_rtp_buffer_get_payload (rtp);
+
+  return gst_rtp_buffer_get_payload_subbuffer (rtp, offset, size);
+}
+
+/* Returns a buffer with the start code followed by @size bytes of the RTP
+ * payload at @data, the payload is not copied */
+static GstBuffer *
+gst_rtp_h265_depay_wrap_nal (GstRTPBuffer * rtp, const guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (gpointer) sync_bytes, sizeof (sync_bytes), 0, sizeof (sync_bytes),
+      NULL, NULL);
+
+  return gst_buffer_append (buf,
+      gst_rtp_h265_depay_payload_subbuffer (rtp, data, size));
+}
+
 static GstBuffer *
 gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
     GstClockTime * out_timestamp, gboolean * out_keyframe)
 {
-  guint outsize;
   GstBuffer *outbuf;
 
   /* we had a picture in the adapter and we completed it */
   GST_DEBUG_OBJECT (rtph265depay, "taking completed AU");
-  outsize = gst_adapter_available (rtph265depay->picture_adapter);
-  outbuf = gst_adapter_take_buffer (rtph265depay->picture_adapter, outsize);
+  outbuf = gst_rtp_h265_depay_take_all (rtph265depay->picture_adapter);
 
   *out_timestamp = rtph265depay->last_ts;
   *out_keyframe = rtph265depay->last_keyframe;
@@ -855,16 +923,17 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
 {
   GstRTPBaseDepayload *depayload = GST_RTP_BASE_DEPAYLOAD (rtph265depay);
   gint nal_type;
-  GstMapInfo map;
+  guint8 header[7] = { 0, };
   GstBuffer *outbuf = NULL;
   GstClockTime out_timestamp;
   gboolean keyframe, out_keyframe;
 
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  if (G_UNLIKELY (map.size < 5))
+  /* the NAL usually spans several memories, only extract the start code, NAL
+   * header and first slice byte instead of mapping (and merging) it all */
+  if (G_UNLIKELY (gst_buffer_extract (nal, 0, header, sizeof (header)) < 5))
     goto short_nal;
 
-  nal_type = (map.data[4] >> 1) & 0x3f;
+  nal_type = (header[4] >> 1) & 0x3f;
   GST_DEBUG_OBJECT (rtph265depay, "handle NAL type %d (RTP marker bit %d)",
       nal_type, marker);
 
@@ -878,7 +947,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       gst_rtp_h265_depay_add_vps_sps_pps (rtph265depay,
           gst_buffer_copy_region (nal, GST_BUFFER_COPY_ALL,
               4, gst_buffer_get_size (nal) - 4));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return NULL;
     } else if (rtph265depay->sps->len == 0 || rtph265depay->pps->len == 0) {
@@ -889,7 +957,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
           gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
               gst_structure_new ("GstForceKeyUnit",
                   "all-headers", G_TYPE_BOOLEAN, TRUE, NULL)));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return NULL;
     }
@@ -909,7 +976,7 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       if (NAL_TYPE_IS_CODED_SLICE_SEGMENT (nal_type)) {
         /* A NAL unit (X) ends an access unit if the next-occurring VCL NAL unit (Y) has the high-order bit of the first byte after its NAL unit header equal to 1 */
         start = TRUE;
-        if (((map.data[6] >> 7) & 0x01) == 1) {
+        if (((header[6] >> 7) & 0x01) == 1) {
           complete = TRUE;
         }
         complete = TRUE;
@@ -926,8 +993,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
             &out_keyframe);
     }
     /* add to adapter */
-    gst_buffer_unmap (nal, &map);
-
     GST_DEBUG_OBJECT (depayload, "adding NAL to picture adapter");
     gst_adapter_push (rtph265depay->picture_adapter, nal);
     rtph265depay->last_ts = in_timestamp;
@@ -941,7 +1006,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
     /* no merge, output is input nal */
     GST_DEBUG_OBJECT (depayload, "using NAL as output");
     outbuf = nal;
-    gst_buffer_unmap (nal, &map);
   }
 
   if (outbuf) {
@@ -968,7 +1032,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
 short_nal:
   {
     GST_WARNING_OBJECT (depayload, "dropping short NAL");
-    gst_buffer_unmap (nal, &map);
     gst_buffer_unref (nal);
     return NULL;
   }
@@ -978,25 +1041,22 @@ static GstBuffer *
 gst_rtp_h265_push_fragmentation_unit (GstRtpH265Depay * rtph265depay,
     gboolean send)
 {
-  guint outsize;
-  GstMapInfo map;
   GstBuffer *outbuf;
 
-  outsize = gst_adapter_available (rtph265depay->adapter);
-  outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
-
-  gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-  GST_DEBUG_OBJECT (rtph265depay, "output %d bytes", outsize);
-
-  if (rtph265depay->byte_stream) {
-    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-  } else {
+  if (!rtph265depay->byte_stream)
     goto not_implemented;
-  }
-  gst_buffer_unmap (outbuf, &map);
 
+  /* the start code and NAL header were queued with the first fragment, the
+   * fragments themselves still reference the RTP packets */
+  outbuf = gst_rtp_h265_depay_take_all (rtph265depay->adapter);
   rtph265depay->current_fu_type = 0;
 
+  if (outbuf == NULL)
+    return NULL;
+
+  GST_DEBUG_OBJECT (rtph265depay, "output %" G_GSIZE_FORMAT " bytes",
+      gst_buffer_get_size (outbuf));
+
   outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf,
       rtph265depay->fu_timestamp, rtph265depay->fu_marker);
 
@@ -1010,7 +1070,8 @@ not_implemented:
   {
     GST_ERROR_OBJECT (rtph265depay,
         ("Only bytestream format is currently supported."));
-    gst_buffer_unmap (outbuf, &map);
+    gst_adapter_clear (rtph265depay->adapter);
+    rtph265depay->current_fu_type = 0;
     return NULL;
   }
 }
@@ -1037,7 +1098,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
     guint8 *payload;
     guint header_len;
     GstMapInfo map;
-    guint outsize, nalu_size;
+    guint nalu_size;
     GstClockTime timestamp;
     gboolean marker;
     guint8 nuh_layer_id, nuh_temporal_id_plus1;
@@ -1071,7 +1132,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
      */
     nal_unit_type = (payload[0] >> 1) & 0x3f;
     nuh_layer_id = ((payload[0] & 0x01) << 5) | (payload[1] >> 3);      /* should be zero for now but this could change in future HEVC extensions */
-    nuh_temporal_id_plus1 = payload[1] & 0x03;
+    nuh_temporal_id_plus1 = payload[1] & 0x07;
 
     /* At least two byte header with type */
     header_len = 2;
@@ -1135,7 +1196,9 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           goto not_implemented_donl_present;
 #endif
 
+        outbuf = NULL;
         while (payload_len > 2) {
+          gboolean last;
 
           nalu_size = (payload[0] << 8) | payload[1];
 
@@ -1143,34 +1206,30 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           if (nalu_size > (payload_len - 2))
             nalu_size = payload_len - 2;
 
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
+          /* anything still waiting was not the last NAL of the packet */
+          if (outbuf) {
+            gst_rtp_base_depayload_push (depayload, outbuf);
+            outbuf = NULL;
+          }
 
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          if (rtph265depay->byte_stream) {
-            memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-          } else {
+          if (!rtph265depay->byte_stream)
             goto not_implemented;
-          }
 
           /* strip NALU size */
           payload += 2;
           payload_len -= 2;
 
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          gst_buffer_unmap (outbuf, &map);
-
-          gst_adapter_push (rtph265depay->adapter, outbuf);
+          outbuf = gst_rtp_h265_depay_wrap_nal (&rtp, payload, nalu_size);
 
           payload += nalu_size;
           payload_len -= nalu_size;
-        }
-
-        outsize = gst_adapter_available (rtph265depay->adapter);
-        outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
+          last = payload_len <= 2;
 
-        outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf, timestamp,
-            marker);
+          /* every aggregated NAL is handled on its own, only the last one of
+           * the packet can carry the marker */
+          outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf,
+              timestamp, marker && last);
+        }
         break;
       }
       case 49:
@@ -1236,26 +1295,30 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
               ((payload[0] & 0x3f) << 9) | (nuh_layer_id << 3) |
               nuh_temporal_id_plus1;
 
-          /* go back one byte so we can copy the payload + two bytes more in the front which
-           * will be overwritten by the nal_header
-           */
-          payload -= 1;
-          payload_len += 1;
-
-          nalu_size = payload_len;
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
+          if (!rtph265depay->byte_stream)
+            goto not_implemented;
 
+          /* only the start code and NAL header are written, the fragment
+           * itself is referenced */
+          outbuf =
+              gst_buffer_new_allocate (NULL, sizeof (sync_bytes) + 2, NULL);
           gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
+          memcpy (map.data, sync_bytes, sizeof (sync_bytes));
           map.data[sizeof (sync_bytes)] = nal_header >> 8;
           map.data[sizeof (sync_bytes) + 1] = nal_header & 0xff;
           gst_buffer_unmap (outbuf, &map);
+          gst_adapter_push (rtph265depay->adapter, outbuf);
+
+          /* strip off FU header byte */
+          payload += 1;
+          payload_len -= 1;
 
-          GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", outsize);
+          GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", payload_len);
 
           /* and assemble in the adapter */
-          gst_adapter_push (rtph265depay->adapter, outbuf);
+          gst_adapter_push (rtph265depay->adapter,
+              gst_rtp_h265_depay_payload_subbuffer (&rtp, payload,
+                  payload_len));
         } else {
 
           GST_DEBUG_OBJECT (rtph265depay,
@@ -1265,14 +1328,12 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           payload += 1;
           payload_len -= 1;
 
-          outsize = payload_len;
-          outbuf = gst_buffer_new_and_alloc (outsize);
-          gst_buffer_fill (outbuf, 0, payload, outsize);
-
-          GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", outsize);
+          GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", payload_len);
 
           /* and assemble in the adapter */
-          gst_adapter_push (rtph265depay->adapter, outbuf);
+          gst_adapter_push (rtph265depay->adapter,
+              gst_rtp_h265_depay_payload_subbuffer (&rtp, payload,
+                  payload_len));
         }
 
         outbuf = NULL;
@@ -1299,18 +1360,10 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstBuffer * buf)
           goto not_implemented_donl_present;
 #endif
 
-        nalu_size = payload_len;
-        outsize = nalu_size + sizeof (sync_bytes);
-        outbuf = gst_buffer_new_and_alloc (outsize);
-
-        gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-        if (rtph265depay->byte_stream) {
-          memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-        } else {
+        if (!rtph265depay->byte_stream)
           goto not_implemented;
-        }
-        memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-        gst_buffer_unmap (outbuf, &map);
+
+        outbuf = gst_rtp_h265_depay_wrap_nal (&rtp, payload, payload_len);
 
         outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf, timestamp,
             marker);
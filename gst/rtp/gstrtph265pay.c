@@ -103,14 +103,40 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 #define DEFAULT_SPROP_PARAMETER_SETS    NULL
 #define DEFAULT_CONFIG_INTERVAL		      0
+#define DEFAULT_AGGREGATE_MODE          GST_RTP_H265_AGGREGATE_NONE
 
 enum
 {
   PROP_0,
   PROP_SPROP_PARAMETER_SETS,
-  PROP_CONFIG_INTERVAL
+  PROP_CONFIG_INTERVAL,
+  PROP_AGGREGATE_MODE
 };
 
+#define GST_TYPE_RTP_H265_AGGREGATE_MODE \
+  (gst_rtp_h265_aggregate_mode_get_type ())
+
+static GType
+gst_rtp_h265_aggregate_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_RTP_H265_AGGREGATE_NONE, "Do not aggregate NAL units", "none"},
+    {GST_RTP_H265_AGGREGATE_ZERO_LATENCY,
+        "Aggregate NAL units of the same input buffer, never wait for more",
+        "zero-latency"},
+    {GST_RTP_H265_AGGREGATE_MAX,
+        "Aggregate as many NAL units of the same access unit as fit",
+        "max"},
+    {0, NULL, NULL},
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstRtpH265AggregateMode", values);
+  }
+  return type;
+}
+
 #define IS_ACCESS_UNIT(x) (((x) > 0x00) && ((x) < 0x06))
 
 static void gst_rtp_h265_pay_finalize (GObject * object);
@@ -166,6 +192,24 @@ gst_rtp_h265_pay_class_init (GstRtpH265PayClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
 
+  /**
+   * GstRtpH265Pay:aggregate-mode
+   *
+   * Whether to pack consecutive small NAL units of an access unit into
+   * aggregation packets (AP), up to the MTU.
+   *
+   * Since: 1.6
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_AGGREGATE_MODE,
+      g_param_spec_enum ("aggregate-mode",
+          "Attempt to use aggregate packets",
+          "Bundle suitable VPS/SPS/PPS/SEI and small slice NAL units into "
+          "aggregation packets",
+          GST_TYPE_RTP_H265_AGGREGATE_MODE,
+          DEFAULT_AGGREGATE_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_rtp_h265_pay_finalize;
 
   gst_element_class_add_pad_template (gstelement_class,
@@ -203,10 +247,21 @@ gst_rtp_h265_pay_init (GstRtpH265Pay * rtph265pay)
       (GDestroyNotify) gst_buffer_unref);
   rtph265pay->last_vps_sps_pps = -1;
   rtph265pay->vps_sps_pps_interval = DEFAULT_CONFIG_INTERVAL;
+  rtph265pay->aggregate_mode = DEFAULT_AGGREGATE_MODE;
 
   rtph265pay->adapter = gst_adapter_new ();
 }
 
+static void
+gst_rtp_h265_pay_reset_bundle (GstRtpH265Pay * rtph265pay)
+{
+  if (rtph265pay->bundle) {
+    gst_buffer_list_unref (rtph265pay->bundle);
+    rtph265pay->bundle = NULL;
+  }
+  rtph265pay->bundle_size = 0;
+}
+
 static void
 gst_rtp_h265_pay_clear_vps_sps_pps (GstRtpH265Pay * rtph265pay)
 {
@@ -232,6 +287,8 @@ gst_rtp_h265_pay_finalize (GObject * object)
 
   g_object_unref (rtph265pay->adapter);
 
+  gst_rtp_h265_pay_reset_bundle (rtph265pay);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -854,6 +911,17 @@ gst_rtp_h265_pay_decode_nal (GstRtpH265Pay * payloader,
 static GstFlowReturn
 gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
     GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au);
+static GstFlowReturn
+gst_rtp_h265_pay_payload_nal_single (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au);
+static GstFlowReturn
+gst_rtp_h265_pay_payload_nal_fragment (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au,
+    const guint8 nalHeader[2]);
+static GstFlowReturn
+gst_rtp_h265_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au);
+static GstFlowReturn gst_rtp_h265_pay_send_bundle (GstRtpH265Pay * rtph265pay);
 
 static GstFlowReturn
 gst_rtp_h265_pay_send_vps_sps_pps (GstRTPBasePayload * basepayload,
@@ -920,12 +988,8 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
   GstFlowReturn ret;
   guint8 nalHeader[2];
   guint8 nalType;
-  guint packet_len, payload_len, mtu;
-  GstBuffer *outbuf;
-  guint8 *payload;
-  GstBufferList *list = NULL;
+  guint packet_len, mtu;
   gboolean send_vps_sps_pps;
-  GstRTPBuffer rtp = { NULL };
   guint size = gst_buffer_get_size (paybuf);
 
   rtph265pay = GST_RTP_H265_PAY (basepayload);
@@ -1001,114 +1065,287 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
 
   packet_len = gst_rtp_buffer_calc_packet_len (size, 0, 0);
 
-  GST_FIXME_OBJECT (rtph265pay, "Set RTP marker bit appropriately");
+  if (packet_len < mtu && rtph265pay->aggregate_mode !=
+      GST_RTP_H265_AGGREGATE_NONE)
+    return gst_rtp_h265_pay_payload_nal_bundle (basepayload, paybuf, dts, pts,
+        end_of_au);
+
+  /* whatever was aggregated so far has to go out first */
+  ret = gst_rtp_h265_pay_send_bundle (rtph265pay);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (paybuf);
+    return ret;
+  }
 
   if (packet_len < mtu) {
     GST_DEBUG_OBJECT (rtph265pay,
         "NAL Unit fit in one packet datasize=%d mtu=%d", size, mtu);
     /* will fit in one packet */
+    return gst_rtp_h265_pay_payload_nal_single (basepayload, paybuf, dts, pts,
+        end_of_au);
+  }
+
+  return gst_rtp_h265_pay_payload_nal_fragment (basepayload, paybuf, dts, pts,
+      end_of_au, nalHeader);
+}
+
+static GstFlowReturn
+gst_rtp_h265_pay_payload_nal_single (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au)
+{
+  GstBuffer *outbuf;
+  GstBufferList *list;
+  GstRTPBuffer rtp = { NULL };
+
+  GST_FIXME_OBJECT (basepayload, "Set RTP marker bit appropriately");
+
+  /* use buffer lists
+   * create buffer without payload containing only the RTP header
+   * (memory block at index 0) */
+  outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+
+  gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+
+  /* FIXME : only set the marker bit on packets containing access units */
+  /* if (IS_ACCESS_UNIT (nalType) && end_of_au) {
+     gst_rtp_buffer_set_marker (&rtp, 1);
+     } */
+
+  /* timestamp the outbuffer */
+  GST_BUFFER_PTS (outbuf) = pts;
+  GST_BUFFER_DTS (outbuf) = dts;
+
+  /* insert payload memory block */
+  outbuf = gst_buffer_append (outbuf, paybuf);
+
+  list = gst_buffer_list_new ();
+
+  /* add the buffer to the buffer list */
+  gst_buffer_list_add (list, outbuf);
+
+  gst_rtp_buffer_unmap (&rtp);
+
+  /* push the list to the next element in the pipe */
+  return gst_rtp_base_payload_push_list (basepayload, list);
+}
+
+static GstFlowReturn
+gst_rtp_h265_pay_payload_nal_fragment (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au,
+    const guint8 nalHeader[2])
+{
+  GstFlowReturn ret;
+  guint8 nalType = (nalHeader[0] >> 1) & 0x3f;
+  guint payload_len, mtu;
+  GstBuffer *outbuf;
+  guint8 *payload;
+  GstBufferList *list;
+  GstRTPBuffer rtp = { NULL };
+  guint size = gst_buffer_get_size (paybuf);
+  guint limitedSize;
+  int ii = 0, start = 1, end = 0, pos = 0;
+
+  mtu = GST_RTP_BASE_PAYLOAD_MTU (basepayload);
+
+  GST_DEBUG_OBJECT (basepayload,
+      "NAL Unit DOES NOT fit in one packet datasize=%d mtu=%d", size, mtu);
+
+  /* fragmentation Units */
+  pos += 2;
+  size -= 2;
+
+  GST_DEBUG_OBJECT (basepayload, "Using FU fragmentation for data size=%d",
+      size);
+
+  /* We keep 3 bytes for PayloadHdr and FU Header */
+  payload_len = gst_rtp_buffer_calc_payload_len (mtu - 3, 0, 0);
+
+  list = gst_buffer_list_new ();
+
+  while (end == 0) {
+    limitedSize = size < payload_len ? size : payload_len;
+    GST_DEBUG_OBJECT (basepayload,
+        "Inside  FU fragmentation limitedSize=%d iteration=%d", limitedSize,
+        ii);
 
     /* use buffer lists
      * create buffer without payload containing only the RTP header
-     * (memory block at index 0) */
-    outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+     * (memory block at index 0), and with space for PayloadHdr and FU header */
+    outbuf = gst_rtp_buffer_new_allocate (3, 0, 0);
 
     gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
 
-    /* FIXME : only set the marker bit on packets containing access units */
-    /* if (IS_ACCESS_UNIT (nalType) && end_of_au) {
-       gst_rtp_buffer_set_marker (&rtp, 1);
+    GST_BUFFER_DTS (outbuf) = dts;
+    GST_BUFFER_PTS (outbuf) = pts;
+    payload = gst_rtp_buffer_get_payload (&rtp);
+
+    if (limitedSize == size) {
+      GST_DEBUG_OBJECT (basepayload, "end size=%d iteration=%d", size, ii);
+      end = 1;
+    }
+
+    /* PayloadHdr (type = 49) */
+    payload[0] = (nalHeader[0] & 0x81) | (49 << 1);
+    payload[1] = nalHeader[1];
+
+    /* FIXME - set RTP marker bit appropriately */
+    /* if (IS_ACCESS_UNIT (nalType)) {
+       gst_rtp_buffer_set_marker (&rtp, end && end_of_au);
        } */
 
-    /* timestamp the outbuffer */
-    GST_BUFFER_PTS (outbuf) = pts;
-    GST_BUFFER_DTS (outbuf) = dts;
+    /* FU Header */
+    payload[2] = (start << 7) | (end << 6) | (nalType & 0x3f);
 
-    /* insert payload memory block */
-    outbuf = gst_buffer_append (outbuf, paybuf);
+    gst_rtp_buffer_unmap (&rtp);
 
-    list = gst_buffer_list_new ();
+    /* insert payload memory block */
+    gst_buffer_append (outbuf,
+        gst_buffer_copy_region (paybuf, GST_BUFFER_COPY_MEMORY, pos,
+            limitedSize));
 
     /* add the buffer to the buffer list */
     gst_buffer_list_add (list, outbuf);
 
-    gst_rtp_buffer_unmap (&rtp);
 
-    /* push the list to the next element in the pipe */
-    ret = gst_rtp_base_payload_push_list (basepayload, list);
-  } else {
-    /* fragmentation Units */
-    guint limitedSize;
-    int ii = 0, start = 1, end = 0, pos = 0;
+    size -= limitedSize;
+    pos += limitedSize;
+    ii++;
+    start = 0;
+  }
 
-    GST_DEBUG_OBJECT (basepayload,
-        "NAL Unit DOES NOT fit in one packet datasize=%d mtu=%d", size, mtu);
+  ret = gst_rtp_base_payload_push_list (basepayload, list);
+  gst_buffer_unref (paybuf);
 
-    pos += 2;
-    size -= 2;
+  return ret;
+}
 
-    GST_DEBUG_OBJECT (basepayload, "Using FU fragmentation for data size=%d",
-        size);
+/* Sends the aggregated NALs, in an aggregation packet if there is more than
+ * one */
+static GstFlowReturn
+gst_rtp_h265_pay_send_bundle (GstRtpH265Pay * rtph265pay)
+{
+  GstRTPBasePayload *basepayload = GST_RTP_BASE_PAYLOAD_CAST (rtph265pay);
+  GstBufferList *bundle = rtph265pay->bundle;
+  GstBufferList *list;
+  GstBuffer *outbuf;
+  GstRTPBuffer rtp = { NULL };
+  guint8 *payload;
+  guint8 f = 0, layer_id = 0x3f, tid = 0x07;
+  guint i, length;
 
-    /* We keep 3 bytes for PayloadHdr and FU Header */
-    payload_len = gst_rtp_buffer_calc_payload_len (mtu - 3, 0, 0);
+  if (bundle == NULL)
+    return GST_FLOW_OK;
 
-    list = gst_buffer_list_new ();
+  rtph265pay->bundle = NULL;
+  length = gst_buffer_list_length (bundle);
 
-    while (end == 0) {
-      limitedSize = size < payload_len ? size : payload_len;
-      GST_DEBUG_OBJECT (basepayload,
-          "Inside  FU fragmentation limitedSize=%d iteration=%d", limitedSize,
-          ii);
+  /* a single NAL unit is better sent as is */
+  if (length == 1) {
+    GstBuffer *paybuf = gst_buffer_ref (gst_buffer_list_get (bundle, 0));
 
-      /* use buffer lists
-       * create buffer without payload containing only the RTP header
-       * (memory block at index 0), and with space for PayloadHdr and FU header */
-      outbuf = gst_rtp_buffer_new_allocate (3, 0, 0);
+    gst_buffer_list_unref (bundle);
+    rtph265pay->bundle_size = 0;
 
-      gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+    return gst_rtp_h265_pay_payload_nal_single (basepayload, paybuf,
+        rtph265pay->bundle_dts, rtph265pay->bundle_pts, FALSE);
+  }
 
-      GST_BUFFER_DTS (outbuf) = dts;
-      GST_BUFFER_PTS (outbuf) = pts;
-      payload = gst_rtp_buffer_get_payload (&rtp);
+  GST_DEBUG_OBJECT (rtph265pay, "sending AP with %u NAL units of %u bytes",
+      length, rtph265pay->bundle_size);
 
-      if (limitedSize == size) {
-        GST_DEBUG_OBJECT (basepayload, "end size=%d iteration=%d", size, ii);
-        end = 1;
-      }
+  /* the PayloadHdr has the highest F bit, and the lowest LayerId and TID of
+   * the aggregated NAL units */
+  for (i = 0; i < length; i++) {
+    GstBuffer *paybuf = gst_buffer_list_get (bundle, i);
+    guint8 nal_header[2];
+
+    gst_buffer_extract (paybuf, 0, nal_header, 2);
+    f |= nal_header[0] & 0x80;
+    layer_id = MIN (layer_id,
+        ((nal_header[0] & 0x01) << 5) | (nal_header[1] >> 3));
+    tid = MIN (tid, nal_header[1] & 0x07);
+  }
+
+  outbuf = gst_rtp_buffer_new_allocate (2, 0, 0);
+
+  gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+
+  GST_BUFFER_DTS (outbuf) = rtph265pay->bundle_dts;
+  GST_BUFFER_PTS (outbuf) = rtph265pay->bundle_pts;
+  payload = gst_rtp_buffer_get_payload (&rtp);
 
-      /* PayloadHdr (type = 49) */
-      payload[0] = (nalHeader[0] & 0x81) | (49 << 1);
-      payload[1] = nalHeader[1];
+  /* PayloadHdr (type = 48) */
+  payload[0] = f | (48 << 1) | (layer_id >> 5);
+  payload[1] = ((layer_id & 0x1f) << 3) | tid;
 
-      /* FIXME - set RTP marker bit appropriately */
-      /* if (IS_ACCESS_UNIT (nalType)) {
-         gst_rtp_buffer_set_marker (&rtp, end && end_of_au);
-         } */
+  gst_rtp_buffer_unmap (&rtp);
 
-      /* FU Header */
-      payload[2] = (start << 7) | (end << 6) | (nalType & 0x3f);
+  /* each NAL unit is preceded by its 16 bit size */
+  for (i = 0; i < length; i++) {
+    GstBuffer *paybuf = gst_buffer_list_get (bundle, i);
+    GstBuffer *sizebuf;
+    guint8 nal_size[2];
 
-      gst_rtp_buffer_unmap (&rtp);
+    GST_WRITE_UINT16_BE (nal_size, gst_buffer_get_size (paybuf));
+    sizebuf = gst_buffer_new_allocate (NULL, 2, NULL);
+    gst_buffer_fill (sizebuf, 0, nal_size, 2);
 
-      /* insert payload memory block */
-      gst_buffer_append (outbuf,
-          gst_buffer_copy_region (paybuf, GST_BUFFER_COPY_MEMORY, pos,
-              limitedSize));
+    outbuf = gst_buffer_append (outbuf, sizebuf);
+    outbuf = gst_buffer_append (outbuf, gst_buffer_ref (paybuf));
+  }
+
+  gst_buffer_list_unref (bundle);
+  rtph265pay->bundle_size = 0;
 
-      /* add the buffer to the buffer list */
-      gst_buffer_list_add (list, outbuf);
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, outbuf);
 
+  return gst_rtp_base_payload_push_list (basepayload, list);
+}
 
-      size -= limitedSize;
-      pos += limitedSize;
-      ii++;
-      start = 0;
+/* Adds a NAL that fits in a packet to the aggregation packet, sending it
+ * first if the NAL doesn't fit anymore or belongs to another access unit */
+static GstFlowReturn
+gst_rtp_h265_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
+    GstBuffer * paybuf, GstClockTime dts, GstClockTime pts, gboolean end_of_au)
+{
+  GstRtpH265Pay *rtph265pay = GST_RTP_H265_PAY (basepayload);
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint size = gst_buffer_get_size (paybuf);
+  guint mtu = GST_RTP_BASE_PAYLOAD_MTU (rtph265pay);
+
+  if (rtph265pay->bundle) {
+    /* PayloadHdr, and the size of every NAL unit in front of it */
+    guint bundle_len = 2 + rtph265pay->bundle_size + 2 + size;
+
+    if (rtph265pay->bundle_pts != pts || rtph265pay->bundle_dts != dts) {
+      GST_DEBUG_OBJECT (rtph265pay, "new access unit, sending bundle");
+      ret = gst_rtp_h265_pay_send_bundle (rtph265pay);
+    } else if (gst_rtp_buffer_calc_packet_len (bundle_len, 0, 0) > mtu) {
+      GST_DEBUG_OBJECT (rtph265pay, "NAL Unit does not fit, sending bundle");
+      ret = gst_rtp_h265_pay_send_bundle (rtph265pay);
     }
 
-    ret = gst_rtp_base_payload_push_list (basepayload, list);
-    gst_buffer_unref (paybuf);
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (paybuf);
+      return ret;
+    }
+  }
+
+  if (rtph265pay->bundle == NULL) {
+    rtph265pay->bundle = gst_buffer_list_new ();
+    rtph265pay->bundle_size = 0;
+    rtph265pay->bundle_dts = dts;
+    rtph265pay->bundle_pts = pts;
   }
+
+  GST_DEBUG_OBJECT (rtph265pay, "adding NAL Unit of size %u to bundle", size);
+  gst_buffer_list_add (rtph265pay->bundle, paybuf);
+  rtph265pay->bundle_size += 2 + size;
+
+  if (end_of_au)
+    ret = gst_rtp_h265_pay_send_bundle (rtph265pay);
+
   return ret;
 }
 
@@ -1168,10 +1405,8 @@ gst_rtp_h265_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
   ret = GST_FLOW_OK;
 
-  /* now loop over all NAL units and put them in a packet
-   * FIXME, we should really try to pack multiple NAL units into one RTP packet
-   * if we can, especially for the config packets that wont't cause decoder
-   * latency. */
+  /* now loop over all NAL units and put them in a packet, small NAL units
+   * are aggregated into AP packets depending on the aggregate-mode */
   if (hevc) {
     guint nal_length_size;
     gsize offset = 0;
@@ -1356,6 +1591,11 @@ gst_rtp_h265_pay_handle_buffer (GstRTPBasePayload * basepayload,
     g_array_set_size (nal_queue, 0);
   }
 
+  /* in zero-latency mode, never keep NAL units around for the next buffer */
+  if (ret == GST_FLOW_OK
+      && rtph265pay->aggregate_mode == GST_RTP_H265_AGGREGATE_ZERO_LATENCY)
+    ret = gst_rtp_h265_pay_send_bundle (rtph265pay);
+
 done:
   if (hevc) {
     gst_buffer_unmap (buffer, &map);
@@ -1385,6 +1625,7 @@ gst_rtp_h265_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       gst_adapter_clear (rtph265pay->adapter);
+      gst_rtp_h265_pay_reset_bundle (rtph265pay);
       break;
     case GST_EVENT_CUSTOM_DOWNSTREAM:
       s = gst_event_get_structure (event);
@@ -1402,6 +1643,7 @@ gst_rtp_h265_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
        * in byte-stream mode
        */
       gst_rtp_h265_pay_handle_buffer (payload, NULL);
+      gst_rtp_h265_pay_send_bundle (rtph265pay);
       break;
     }
     case GST_EVENT_STREAM_START:
@@ -1428,6 +1670,7 @@ gst_rtp_h265_pay_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       rtph265pay->send_vps_sps_pps = FALSE;
       gst_adapter_clear (rtph265pay->adapter);
+      gst_rtp_h265_pay_reset_bundle (rtph265pay);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       rtph265pay->last_vps_sps_pps = -1;
@@ -1459,6 +1702,9 @@ gst_rtp_h265_pay_set_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       rtph265pay->vps_sps_pps_interval = g_value_get_uint (value);
       break;
+    case PROP_AGGREGATE_MODE:
+      rtph265pay->aggregate_mode = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1480,6 +1726,9 @@ gst_rtp_h265_pay_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, rtph265pay->vps_sps_pps_interval);
       break;
+    case PROP_AGGREGATE_MODE:
+      g_value_set_enum (value, rtph265pay->aggregate_mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
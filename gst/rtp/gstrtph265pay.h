@@ -47,6 +47,13 @@ typedef enum
   GST_H265_ALIGNMENT_AU
 } GstH265Alignment;
 
+typedef enum
+{
+  GST_RTP_H265_AGGREGATE_NONE,
+  GST_RTP_H265_AGGREGATE_ZERO_LATENCY,
+  GST_RTP_H265_AGGREGATE_MAX
+} GstRTPH265AggregateMode;
+
 struct _GstRtpH265Pay
 {
   GstRTPBasePayload payload;
@@ -67,6 +74,12 @@ struct _GstRtpH265Pay
   guint vps_sps_pps_interval;
   gboolean send_vps_sps_pps;
   GstClockTime last_vps_sps_pps;
+
+  /* NALs waiting to be sent in an aggregation packet */
+  GstRTPH265AggregateMode aggregate_mode;
+  GstBufferList *bundle;
+  guint bundle_size;
+  GstClockTime bundle_dts, bundle_pts;
 };
 
 struct _GstRtpH265PayClass
@@ -27,6 +27,9 @@
  * gst-launch -v filesrc location=file.y4m ! y4mdec ! xvimagesink
  * ]|
  * </refsect2>
+ *
+ * When upstream supports pull mode, frames are read directly at their offset
+ * in the stream and seeking is frame accurate.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -41,6 +44,9 @@
 #include <string.h>
 
 #define MAX_SIZE 32768
+#define MAX_HEADER_LENGTH 80
+/* "FRAME\n", frame headers with parameters are only supported in push mode */
+#define FRAME_HEADER_SIZE 6
 
 GST_DEBUG_CATEGORY (y4mdec_debug);
 #define GST_CAT_DEFAULT y4mdec_debug
@@ -57,6 +63,10 @@ static void gst_y4m_dec_finalize (GObject * object);
 
 static GstFlowReturn gst_y4m_dec_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buffer);
+static gboolean gst_y4m_dec_sink_activate (GstPad * pad, GstObject * parent);
+static gboolean gst_y4m_dec_sink_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+static void gst_y4m_dec_loop (GstPad * pad);
 static gboolean gst_y4m_dec_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 
@@ -127,6 +137,10 @@ gst_y4m_dec_init (GstY4mDec * y4mdec)
       GST_DEBUG_FUNCPTR (gst_y4m_dec_sink_event));
   gst_pad_set_chain_function (y4mdec->sinkpad,
       GST_DEBUG_FUNCPTR (gst_y4m_dec_chain));
+  gst_pad_set_activate_function (y4mdec->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_y4m_dec_sink_activate));
+  gst_pad_set_activatemode_function (y4mdec->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_y4m_dec_sink_activate_mode));
   gst_element_add_pad (GST_ELEMENT (y4mdec), y4mdec->sinkpad);
 
   y4mdec->srcpad = gst_pad_new_from_static_template (&gst_y4m_dec_src_template,
@@ -225,6 +239,8 @@ gst_y4m_dec_change_state (GstElement * element, GstStateChange transition)
         gst_object_unref (y4mdec->pool);
       }
       y4mdec->pool = NULL;
+      y4mdec->have_header = FALSE;
+      gst_adapter_clear (y4mdec->adapter);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -248,11 +264,20 @@ gst_y4m_dec_frames_to_timestamp (GstY4mDec * y4mdec, gint64 frame_index)
 static gint64
 gst_y4m_dec_timestamp_to_frames (GstY4mDec * y4mdec, GstClockTime timestamp)
 {
+  gint64 frames;
+
   if (timestamp == -1)
     return -1;
 
-  return gst_util_uint64_scale (timestamp, y4mdec->info.fps_n,
+  frames = gst_util_uint64_scale (timestamp, y4mdec->info.fps_n,
       GST_SECOND * y4mdec->info.fps_d);
+
+  /* frame timestamps are rounded down, so the timestamp of a frame can
+   * convert back to the frame before it */
+  if (gst_y4m_dec_frames_to_timestamp (y4mdec, frames + 1) <= timestamp)
+    frames++;
+
+  return frames;
 }
 
 static gint64
@@ -263,7 +288,8 @@ gst_y4m_dec_bytes_to_frames (GstY4mDec * y4mdec, gint64 bytes)
 
   if (bytes < y4mdec->header_size)
     return 0;
-  return (bytes - y4mdec->header_size) / (y4mdec->info.size + 6);
+  return (bytes - y4mdec->header_size) / (y4mdec->info.size +
+      FRAME_HEADER_SIZE);
 }
 
 static guint64
@@ -272,7 +298,8 @@ gst_y4m_dec_frames_to_bytes (GstY4mDec * y4mdec, gint64 frame_index)
   if (frame_index == -1)
     return -1;
 
-  return y4mdec->header_size + (y4mdec->info.size + 6) * frame_index;
+  return y4mdec->header_size + (y4mdec->info.size + FRAME_HEADER_SIZE) *
+      frame_index;
 }
 
 static GstClockTime
@@ -481,15 +508,192 @@ error:
   return FALSE;
 }
 
+static void
+gst_y4m_dec_terminate_header (char *header)
+{
+  int i;
+
+  header[MAX_HEADER_LENGTH - 1] = 0;
+  for (i = 0; i < MAX_HEADER_LENGTH; i++) {
+    if (header[i] == 0x0a)
+      header[i] = 0;
+  }
+}
+
+/* Parses the stream header and configures caps and, if needed for stride
+ * conversion, a buffer pool */
+static GstFlowReturn
+gst_y4m_dec_handle_header (GstY4mDec * y4mdec, char *header)
+{
+  gboolean ret;
+  GstCaps *caps;
+  GstQuery *query;
+
+  ret = gst_y4m_dec_parse_header (y4mdec, header);
+  if (!ret) {
+    GST_ELEMENT_ERROR (y4mdec, STREAM, DECODE,
+        ("Failed to parse YUV4MPEG header"), (NULL));
+    return GST_FLOW_ERROR;
+  }
+
+  y4mdec->header_size = strlen (header) + 1;
+
+  caps = gst_video_info_to_caps (&y4mdec->info);
+  ret = gst_pad_set_caps (y4mdec->srcpad, caps);
+
+  query = gst_query_new_allocation (caps, FALSE);
+  y4mdec->video_meta = FALSE;
+
+  if (y4mdec->pool) {
+    gst_buffer_pool_set_active (y4mdec->pool, FALSE);
+    gst_object_unref (y4mdec->pool);
+  }
+  y4mdec->pool = NULL;
+
+  if (gst_pad_peer_query (y4mdec->srcpad, query)) {
+    y4mdec->video_meta =
+        gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+    /* We only need a pool if we need to do stride conversion for downstream */
+    if (!y4mdec->video_meta && memcmp (&y4mdec->info, &y4mdec->out_info,
+            sizeof (y4mdec->info)) != 0) {
+      GstBufferPool *pool = NULL;
+      GstAllocator *allocator = NULL;
+      GstAllocationParams params;
+      GstStructure *config;
+      guint size, min, max;
+
+      if (gst_query_get_n_allocation_params (query) > 0) {
+        gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+      } else {
+        allocator = NULL;
+        gst_allocation_params_init (&params);
+      }
+
+      if (gst_query_get_n_allocation_pools (query) > 0) {
+        gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min,
+            &max);
+        size = MAX (size, y4mdec->out_info.size);
+      } else {
+        pool = NULL;
+        size = y4mdec->out_info.size;
+        min = max = 0;
+      }
+
+      if (pool == NULL) {
+        pool = gst_video_buffer_pool_new ();
+      }
+
+      config = gst_buffer_pool_get_config (pool);
+      gst_buffer_pool_config_set_params (config, caps, size, min, max);
+      gst_buffer_pool_config_set_allocator (config, allocator, &params);
+      gst_buffer_pool_set_config (pool, config);
+
+      if (allocator)
+        gst_object_unref (allocator);
+
+      y4mdec->pool = pool;
+    }
+  } else if (memcmp (&y4mdec->info, &y4mdec->out_info,
+          sizeof (y4mdec->info)) != 0) {
+    GstBufferPool *pool;
+    GstStructure *config;
+
+    /* No pool, create our own if we need to do stride conversion */
+    pool = gst_video_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, y4mdec->out_info.size, 0,
+        0);
+    gst_buffer_pool_set_config (pool, config);
+    y4mdec->pool = pool;
+  }
+  if (y4mdec->pool) {
+    gst_buffer_pool_set_active (y4mdec->pool, TRUE);
+  }
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+  if (!ret) {
+    GST_DEBUG_OBJECT (y4mdec, "Couldn't set caps on src pad");
+    return GST_FLOW_ERROR;
+  }
+
+  y4mdec->have_header = TRUE;
+
+  return GST_FLOW_OK;
+}
+
+/* Timestamps and pushes the frame data in @buffer, which is only copied if
+ * downstream can't handle our strides */
+static GstFlowReturn
+gst_y4m_dec_push_frame (GstY4mDec * y4mdec, GstBuffer * buffer)
+{
+  GstFlowReturn flow_ret;
+
+  GST_BUFFER_TIMESTAMP (buffer) =
+      gst_y4m_dec_frames_to_timestamp (y4mdec, y4mdec->frame_index);
+  GST_BUFFER_DURATION (buffer) =
+      gst_y4m_dec_frames_to_timestamp (y4mdec, y4mdec->frame_index + 1) -
+      GST_BUFFER_TIMESTAMP (buffer);
+
+  y4mdec->frame_index++;
+
+  if (y4mdec->video_meta) {
+    gst_buffer_add_video_meta_full (buffer, 0, y4mdec->info.finfo->format,
+        y4mdec->info.width, y4mdec->info.height, y4mdec->info.finfo->n_planes,
+        y4mdec->info.offset, y4mdec->info.stride);
+  } else if (memcmp (&y4mdec->info, &y4mdec->out_info,
+          sizeof (y4mdec->info)) != 0) {
+    GstBuffer *outbuf;
+    GstVideoFrame iframe, oframe;
+    gint i, j;
+    gint w, h, istride, ostride;
+    guint8 *src, *dest;
+
+    /* Allocate a new buffer and do stride conversion */
+    g_assert (y4mdec->pool != NULL);
+
+    flow_ret = gst_buffer_pool_acquire_buffer (y4mdec->pool, &outbuf, NULL);
+    if (flow_ret != GST_FLOW_OK) {
+      gst_buffer_unref (buffer);
+      return flow_ret;
+    }
+
+    gst_video_frame_map (&iframe, &y4mdec->info, buffer, GST_MAP_READ);
+    gst_video_frame_map (&oframe, &y4mdec->out_info, outbuf, GST_MAP_WRITE);
+
+    for (i = 0; i < 3; i++) {
+      w = GST_VIDEO_FRAME_COMP_WIDTH (&iframe, i);
+      h = GST_VIDEO_FRAME_COMP_HEIGHT (&iframe, i);
+      istride = GST_VIDEO_FRAME_COMP_STRIDE (&iframe, i);
+      ostride = GST_VIDEO_FRAME_COMP_STRIDE (&oframe, i);
+      src = GST_VIDEO_FRAME_COMP_DATA (&iframe, i);
+      dest = GST_VIDEO_FRAME_COMP_DATA (&oframe, i);
+
+      for (j = 0; j < h; j++) {
+        memcpy (dest, src, w);
+
+        dest += ostride;
+        src += istride;
+      }
+    }
+
+    gst_video_frame_unmap (&iframe);
+    gst_video_frame_unmap (&oframe);
+    gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+    gst_buffer_unref (buffer);
+    buffer = outbuf;
+  }
+
+  return gst_pad_push (y4mdec->srcpad, buffer);
+}
+
 static GstFlowReturn
 gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
   GstY4mDec *y4mdec;
   int n_avail;
   GstFlowReturn flow_ret = GST_FLOW_OK;
-#define MAX_HEADER_LENGTH 80
   char header[MAX_HEADER_LENGTH];
-  int i;
   int len;
 
   y4mdec = GST_Y4M_DEC (parent);
@@ -505,111 +709,17 @@ gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   n_avail = gst_adapter_available (y4mdec->adapter);
 
   if (!y4mdec->have_header) {
-    gboolean ret;
-    GstCaps *caps;
-    GstQuery *query;
-
     if (n_avail < MAX_HEADER_LENGTH)
       return GST_FLOW_OK;
 
     gst_adapter_copy (y4mdec->adapter, (guint8 *) header, 0, MAX_HEADER_LENGTH);
+    gst_y4m_dec_terminate_header (header);
 
-    header[MAX_HEADER_LENGTH - 1] = 0;
-    for (i = 0; i < MAX_HEADER_LENGTH; i++) {
-      if (header[i] == 0x0a)
-        header[i] = 0;
-    }
-
-    ret = gst_y4m_dec_parse_header (y4mdec, header);
-    if (!ret) {
-      GST_ELEMENT_ERROR (y4mdec, STREAM, DECODE,
-          ("Failed to parse YUV4MPEG header"), (NULL));
-      return GST_FLOW_ERROR;
-    }
+    flow_ret = gst_y4m_dec_handle_header (y4mdec, header);
+    if (flow_ret != GST_FLOW_OK)
+      return flow_ret;
 
-    y4mdec->header_size = strlen (header) + 1;
     gst_adapter_flush (y4mdec->adapter, y4mdec->header_size);
-
-    caps = gst_video_info_to_caps (&y4mdec->info);
-    ret = gst_pad_set_caps (y4mdec->srcpad, caps);
-
-    query = gst_query_new_allocation (caps, FALSE);
-    y4mdec->video_meta = FALSE;
-
-    if (y4mdec->pool) {
-      gst_buffer_pool_set_active (y4mdec->pool, FALSE);
-      gst_object_unref (y4mdec->pool);
-    }
-    y4mdec->pool = NULL;
-
-    if (gst_pad_peer_query (y4mdec->srcpad, query)) {
-      y4mdec->video_meta =
-          gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
-
-      /* We only need a pool if we need to do stride conversion for downstream */
-      if (!y4mdec->video_meta && memcmp (&y4mdec->info, &y4mdec->out_info,
-              sizeof (y4mdec->info)) != 0) {
-        GstBufferPool *pool = NULL;
-        GstAllocator *allocator = NULL;
-        GstAllocationParams params;
-        GstStructure *config;
-        guint size, min, max;
-
-        if (gst_query_get_n_allocation_params (query) > 0) {
-          gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
-        } else {
-          allocator = NULL;
-          gst_allocation_params_init (&params);
-        }
-
-        if (gst_query_get_n_allocation_pools (query) > 0) {
-          gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min,
-              &max);
-          size = MAX (size, y4mdec->out_info.size);
-        } else {
-          pool = NULL;
-          size = y4mdec->out_info.size;
-          min = max = 0;
-        }
-
-        if (pool == NULL) {
-          pool = gst_video_buffer_pool_new ();
-        }
-
-        config = gst_buffer_pool_get_config (pool);
-        gst_buffer_pool_config_set_params (config, caps, size, min, max);
-        gst_buffer_pool_config_set_allocator (config, allocator, &params);
-        gst_buffer_pool_set_config (pool, config);
-
-        if (allocator)
-          gst_object_unref (allocator);
-
-        y4mdec->pool = pool;
-      }
-    } else if (memcmp (&y4mdec->info, &y4mdec->out_info,
-            sizeof (y4mdec->info)) != 0) {
-      GstBufferPool *pool;
-      GstStructure *config;
-
-      /* No pool, create our own if we need to do stride conversion */
-      pool = gst_video_buffer_pool_new ();
-      config = gst_buffer_pool_get_config (pool);
-      gst_buffer_pool_config_set_params (config, caps, y4mdec->out_info.size, 0,
-          0);
-      gst_buffer_pool_set_config (pool, config);
-      y4mdec->pool = pool;
-    }
-    if (y4mdec->pool) {
-      gst_buffer_pool_set_active (y4mdec->pool, TRUE);
-    }
-    gst_query_unref (query);
-    gst_caps_unref (caps);
-    if (!ret) {
-      GST_DEBUG_OBJECT (y4mdec, "Couldn't set caps on src pad");
-      return GST_FLOW_ERROR;
-    }
-
-    y4mdec->have_header = TRUE;
   }
 
   if (y4mdec->have_new_segment) {
@@ -644,11 +754,7 @@ gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       break;
 
     gst_adapter_copy (y4mdec->adapter, (guint8 *) header, 0, MAX_HEADER_LENGTH);
-    header[MAX_HEADER_LENGTH - 1] = 0;
-    for (i = 0; i < MAX_HEADER_LENGTH; i++) {
-      if (header[i] == 0x0a)
-        header[i] = 0;
-    }
+    gst_y4m_dec_terminate_header (header);
     if (memcmp (header, "FRAME", 5) != 0) {
       GST_ELEMENT_ERROR (y4mdec, STREAM, DECODE,
           ("Failed to parse YUV4MPEG frame"), (NULL));
@@ -668,69 +774,236 @@ gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
     buffer = gst_adapter_take_buffer (y4mdec->adapter, y4mdec->info.size);
 
-    GST_BUFFER_TIMESTAMP (buffer) =
-        gst_y4m_dec_frames_to_timestamp (y4mdec, y4mdec->frame_index);
-    GST_BUFFER_DURATION (buffer) =
-        gst_y4m_dec_frames_to_timestamp (y4mdec, y4mdec->frame_index + 1) -
-        GST_BUFFER_TIMESTAMP (buffer);
+    flow_ret = gst_y4m_dec_push_frame (y4mdec, buffer);
+    if (flow_ret != GST_FLOW_OK)
+      break;
+  }
 
-    y4mdec->frame_index++;
+  GST_DEBUG ("returning %d", flow_ret);
 
-    if (y4mdec->video_meta) {
-      gst_buffer_add_video_meta_full (buffer, 0, y4mdec->info.finfo->format,
-          y4mdec->info.width, y4mdec->info.height, y4mdec->info.finfo->n_planes,
-          y4mdec->info.offset, y4mdec->info.stride);
-    } else if (memcmp (&y4mdec->info, &y4mdec->out_info,
-            sizeof (y4mdec->info)) != 0) {
-      GstBuffer *outbuf;
-      GstVideoFrame iframe, oframe;
-      gint i, j;
-      gint w, h, istride, ostride;
-      guint8 *src, *dest;
-
-      /* Allocate a new buffer and do stride conversion */
-      g_assert (y4mdec->pool != NULL);
-
-      flow_ret = gst_buffer_pool_acquire_buffer (y4mdec->pool, &outbuf, NULL);
-      if (flow_ret != GST_FLOW_OK) {
-        gst_buffer_unref (buffer);
-        break;
-      }
+  return flow_ret;
+}
 
-      gst_video_frame_map (&iframe, &y4mdec->info, buffer, GST_MAP_READ);
-      gst_video_frame_map (&oframe, &y4mdec->out_info, outbuf, GST_MAP_WRITE);
+static gboolean
+gst_y4m_dec_sink_activate (GstPad * sinkpad, GstObject * parent)
+{
+  GstQuery *query;
+  gboolean pull_mode;
 
-      for (i = 0; i < 3; i++) {
-        w = GST_VIDEO_FRAME_COMP_WIDTH (&iframe, i);
-        h = GST_VIDEO_FRAME_COMP_HEIGHT (&iframe, i);
-        istride = GST_VIDEO_FRAME_COMP_STRIDE (&iframe, i);
-        ostride = GST_VIDEO_FRAME_COMP_STRIDE (&oframe, i);
-        src = GST_VIDEO_FRAME_COMP_DATA (&iframe, i);
-        dest = GST_VIDEO_FRAME_COMP_DATA (&oframe, i);
+  query = gst_query_new_scheduling ();
 
-        for (j = 0; j < h; j++) {
-          memcpy (dest, src, w);
+  if (!gst_pad_peer_query (sinkpad, query)) {
+    gst_query_unref (query);
+    goto activate_push;
+  }
 
-          dest += ostride;
-          src += istride;
-        }
+  pull_mode = gst_query_has_scheduling_mode_with_flags (query,
+      GST_PAD_MODE_PULL, GST_SCHEDULING_FLAG_SEEKABLE);
+  gst_query_unref (query);
+
+  if (!pull_mode)
+    goto activate_push;
+
+  GST_DEBUG_OBJECT (sinkpad, "activating pull");
+  return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PULL, TRUE);
+
+activate_push:
+  {
+    GST_DEBUG_OBJECT (sinkpad, "activating push");
+    return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PUSH, TRUE);
+  }
+}
+
+static gboolean
+gst_y4m_dec_sink_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstY4mDec *y4mdec = GST_Y4M_DEC (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      y4mdec->pull_mode = FALSE;
+      res = TRUE;
+      break;
+    case GST_PAD_MODE_PULL:
+      if (active) {
+        y4mdec->pull_mode = TRUE;
+        y4mdec->have_header = FALSE;
+        gst_segment_init (&y4mdec->segment, GST_FORMAT_TIME);
+        y4mdec->have_new_segment = TRUE;
+        res = gst_pad_start_task (pad, (GstTaskFunction) gst_y4m_dec_loop,
+            pad, NULL);
+      } else {
+        res = gst_pad_stop_task (pad);
       }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+  return res;
+}
 
-      gst_video_frame_unmap (&iframe);
-      gst_video_frame_unmap (&oframe);
-      gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
-      gst_buffer_unref (buffer);
-      buffer = outbuf;
-    }
+/* In pull mode the segment is in TIME and frame offsets are computed
+ * directly from the frame index, so seeking needs no byte seek upstream */
+static gboolean
+gst_y4m_dec_perform_seek (GstY4mDec * y4mdec, GstEvent * event)
+{
+  gdouble rate;
+  GstFormat format;
+  GstSeekFlags flags;
+  GstSeekType start_type, stop_type;
+  gint64 start, stop;
+  gboolean flush;
+  gboolean update;
+  GstSegment seeksegment;
+  guint32 seqnum;
+  GstEvent *tevent;
+
+  gst_event_parse_seek (event, &rate, &format, &flags, &start_type,
+      &start, &stop_type, &stop);
+
+  if (format != GST_FORMAT_TIME || rate <= 0.0) {
+    GST_DEBUG_OBJECT (y4mdec, "only forward seeks in TIME are supported");
+    return FALSE;
+  }
+
+  flush = flags & GST_SEEK_FLAG_FLUSH;
+  seqnum = gst_event_get_seqnum (event);
+
+  if (flush) {
+    tevent = gst_event_new_flush_start ();
+    gst_event_set_seqnum (tevent, seqnum);
+    gst_pad_push_event (y4mdec->srcpad, tevent);
+  } else {
+    gst_pad_pause_task (y4mdec->sinkpad);
+  }
+
+  GST_PAD_STREAM_LOCK (y4mdec->sinkpad);
+
+  seeksegment = y4mdec->segment;
+  gst_segment_do_seek (&seeksegment, rate, format, flags, start_type, start,
+      stop_type, stop, &update);
+
+  GST_DEBUG_OBJECT (y4mdec, "seek segment %" GST_SEGMENT_FORMAT, &seeksegment);
+
+  if (flush) {
+    tevent = gst_event_new_flush_stop (TRUE);
+    gst_event_set_seqnum (tevent, seqnum);
+    gst_pad_push_event (y4mdec->srcpad, tevent);
+  }
+
+  y4mdec->segment = seeksegment;
+  y4mdec->have_new_segment = TRUE;
+
+  gst_pad_start_task (y4mdec->sinkpad, (GstTaskFunction) gst_y4m_dec_loop,
+      y4mdec->sinkpad, NULL);
 
-    flow_ret = gst_pad_push (y4mdec->srcpad, buffer);
+  GST_PAD_STREAM_UNLOCK (y4mdec->sinkpad);
+
+  return TRUE;
+}
+
+static void
+gst_y4m_dec_loop (GstPad * pad)
+{
+  GstY4mDec *y4mdec = GST_Y4M_DEC (GST_PAD_PARENT (pad));
+  GstFlowReturn flow_ret;
+  GstBuffer *buffer = NULL;
+  GstMapInfo map;
+  gboolean frame_ok;
+  gsize frame_size;
+
+  if (!y4mdec->have_header) {
+    char header[MAX_HEADER_LENGTH] = { 0, };
+    gchar *stream_id;
+
+    flow_ret = gst_pad_pull_range (pad, 0, MAX_HEADER_LENGTH, &buffer);
     if (flow_ret != GST_FLOW_OK)
-      break;
+      goto pause;
+
+    gst_buffer_extract (buffer, 0, header, MAX_HEADER_LENGTH);
+    gst_buffer_unref (buffer);
+    gst_y4m_dec_terminate_header (header);
+
+    stream_id = gst_pad_create_stream_id (y4mdec->srcpad,
+        GST_ELEMENT_CAST (y4mdec), NULL);
+    gst_pad_push_event (y4mdec->srcpad, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+
+    flow_ret = gst_y4m_dec_handle_header (y4mdec, header);
+    if (flow_ret != GST_FLOW_OK)
+      goto pause;
   }
 
-  GST_DEBUG ("returning %d", flow_ret);
+  if (y4mdec->have_new_segment) {
+    y4mdec->frame_index = gst_y4m_dec_timestamp_to_frames (y4mdec,
+        y4mdec->segment.start);
+    GST_DEBUG_OBJECT (y4mdec, "new frame_index %d", y4mdec->frame_index);
 
-  return flow_ret;
+    gst_pad_push_event (y4mdec->srcpad,
+        gst_event_new_segment (&y4mdec->segment));
+    y4mdec->have_new_segment = FALSE;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (y4mdec->segment.stop) &&
+      gst_y4m_dec_frames_to_timestamp (y4mdec, y4mdec->frame_index) >=
+      y4mdec->segment.stop) {
+    flow_ret = GST_FLOW_EOS;
+    goto pause;
+  }
+
+  frame_size = FRAME_HEADER_SIZE + y4mdec->info.size;
+  flow_ret = gst_pad_pull_range (pad,
+      gst_y4m_dec_frames_to_bytes (y4mdec, y4mdec->frame_index), frame_size,
+      &buffer);
+  if (flow_ret != GST_FLOW_OK)
+    goto pause;
+
+  if (gst_buffer_get_size (buffer) < frame_size) {
+    GST_DEBUG_OBJECT (y4mdec, "short read, assuming end of stream");
+    gst_buffer_unref (buffer);
+    flow_ret = GST_FLOW_EOS;
+    goto pause;
+  }
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  frame_ok = memcmp (map.data, "FRAME\n", FRAME_HEADER_SIZE) == 0;
+  gst_buffer_unmap (buffer, &map);
+  if (!frame_ok) {
+    GST_ELEMENT_ERROR (y4mdec, STREAM, DECODE,
+        ("Failed to parse YUV4MPEG frame"), (NULL));
+    gst_buffer_unref (buffer);
+    flow_ret = GST_FLOW_ERROR;
+    goto pause;
+  }
+
+  /* the frame data is output as part of the buffer we pulled */
+  buffer = gst_buffer_make_writable (buffer);
+  gst_buffer_resize (buffer, FRAME_HEADER_SIZE, y4mdec->info.size);
+
+  flow_ret = gst_y4m_dec_push_frame (y4mdec, buffer);
+  if (flow_ret != GST_FLOW_OK)
+    goto pause;
+
+  return;
+
+pause:
+  {
+    const gchar *reason = gst_flow_get_name (flow_ret);
+
+    GST_DEBUG_OBJECT (y4mdec, "pausing task, reason %s", reason);
+    gst_pad_pause_task (pad);
+    if (flow_ret == GST_FLOW_EOS) {
+      gst_pad_push_event (y4mdec->srcpad, gst_event_new_eos ());
+    } else if (flow_ret == GST_FLOW_NOT_LINKED || flow_ret < GST_FLOW_EOS) {
+      GST_ELEMENT_ERROR (y4mdec, STREAM, FAILED,
+          ("Internal data stream error."),
+          ("streaming task paused, reason %s (%d)", reason, flow_ret));
+      gst_pad_push_event (y4mdec->srcpad, gst_event_new_eos ());
+    }
+  }
 }
 
 static gboolean
@@ -800,6 +1073,12 @@ gst_y4m_dec_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
       gint64 framenum;
       guint64 byte;
 
+      if (y4mdec->pull_mode) {
+        res = gst_y4m_dec_perform_seek (y4mdec, event);
+        gst_event_unref (event);
+        break;
+      }
+
       gst_event_parse_seek (event, &rate, &format, &flags, &start_type,
           &start, &stop_type, &stop);
 
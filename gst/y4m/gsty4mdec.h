@@ -48,7 +48,9 @@ struct _GstY4mDec
   int header_size;
 
   gboolean have_new_segment;
+  /* in BYTES when driven by upstream, in TIME in pull mode */
   GstSegment segment;
+  gboolean pull_mode;
 
   GstVideoInfo info;
   GstVideoInfo out_info;
@@ -26,6 +26,10 @@
  * inverse telecine and deinterlace cases that are handled by the
  * deinterlace element.
  *
+ * 8 bit planar, NV12 and 10 bit planar formats are supported. Each frame is
+ * split into horizontal stripes which are filtered in parallel by
+ * #GstYadif:n-threads threads.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -72,10 +76,23 @@ static GstFlowReturn gst_yadif_transform (GstBaseTransform * trans,
 enum
 {
   PROP_0,
-  PROP_MODE
+  PROP_MODE,
+  PROP_N_THREADS
 };
 
 #define DEFAULT_MODE GST_DEINTERLACE_MODE_AUTO
+#define DEFAULT_N_THREADS 0
+
+/* stripes smaller than this are not worth a thread */
+#define MIN_STRIPE_HEIGHT 16
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define YADIF_CAPS_FORMATS \
+    "{Y42B,I420,Y444,NV12,I420_10LE,I422_10LE,Y444_10LE}"
+#else
+#define YADIF_CAPS_FORMATS \
+    "{Y42B,I420,Y444,NV12,I420_10BE,I422_10BE,Y444_10BE}"
+#endif
 
 /* pad templates */
 
@@ -83,7 +100,7 @@ static GstStaticPadTemplate gst_yadif_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (YADIF_CAPS_FORMATS)
         ",interlace-mode=(string){interleaved,mixed,progressive}")
     );
 
@@ -91,7 +108,7 @@ static GstStaticPadTemplate gst_yadif_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (YADIF_CAPS_FORMATS)
         ",interlace-mode=(string)progressive")
     );
 
@@ -160,11 +177,21 @@ gst_yadif_class_init (GstYadifClass * klass)
           DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to filter each frame with, 0 means one per CPU. "
+          "Changes take effect when the element is started",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_yadif_init (GstYadif * yadif)
 {
+  yadif->n_threads = DEFAULT_N_THREADS;
+
+  g_mutex_init (&yadif->stripe_lock);
+  g_cond_init (&yadif->stripe_cond);
 }
 
 void
@@ -177,6 +204,9 @@ gst_yadif_set_property (GObject * object, guint property_id,
     case PROP_MODE:
       yadif->mode = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      yadif->n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -193,6 +223,9 @@ gst_yadif_get_property (GObject * object, guint property_id,
     case PROP_MODE:
       g_value_set_enum (value, yadif->mode);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, yadif->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -212,9 +245,10 @@ gst_yadif_dispose (GObject * object)
 void
 gst_yadif_finalize (GObject * object)
 {
-  /* GstYadif *yadif = GST_YADIF (object); */
+  GstYadif *yadif = GST_YADIF (object);
 
-  /* clean up object here */
+  g_mutex_clear (&yadif->stripe_lock);
+  g_cond_clear (&yadif->stripe_cond);
 
   G_OBJECT_CLASS (gst_yadif_parent_class)->finalize (object);
 }
@@ -277,9 +311,54 @@ gst_yadif_get_unit_size (GstBaseTransform * trans, GstCaps * caps, gsize * size)
   return FALSE;
 }
 
+void yadif_filter (GstYadif * yadif, int parity, int tff, int stripe,
+    int n_stripes);
+
+static void
+gst_yadif_stripe_func (gpointer data, gpointer user_data)
+{
+  GstYadif *yadif = GST_YADIF (user_data);
+  guint stripe = GPOINTER_TO_UINT (data) - 1;
+
+  yadif_filter (yadif, yadif->parity, yadif->tff, stripe, yadif->n_stripes);
+
+  g_mutex_lock (&yadif->stripe_lock);
+  if (--yadif->stripes_pending == 0)
+    g_cond_signal (&yadif->stripe_cond);
+  g_mutex_unlock (&yadif->stripe_lock);
+}
+
 static gboolean
 gst_yadif_start (GstBaseTransform * trans)
 {
+  GstYadif *yadif = GST_YADIF (trans);
+  GError *err = NULL;
+  guint n_threads;
+
+  n_threads = yadif->n_threads;
+  if (n_threads == 0) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    n_threads = g_get_num_processors ();
+#else
+    n_threads = 1;
+#endif
+  }
+  yadif->max_stripes = MAX (n_threads, 1);
+
+  /* the streaming thread filters one of the stripes itself */
+  if (yadif->max_stripes > 1) {
+    yadif->pool = g_thread_pool_new (gst_yadif_stripe_func, yadif,
+        yadif->max_stripes - 1, TRUE, &err);
+    if (!yadif->pool) {
+      GST_WARNING_OBJECT (yadif, "Failed to create thread pool: %s",
+          err->message);
+      g_clear_error (&err);
+      yadif->max_stripes = 1;
+    }
+  }
+
+  GST_DEBUG_OBJECT (yadif, "filtering with up to %u threads",
+      yadif->max_stripes);
 
   return TRUE;
 }
@@ -287,11 +366,45 @@ gst_yadif_start (GstBaseTransform * trans)
 static gboolean
 gst_yadif_stop (GstBaseTransform * trans)
 {
+  GstYadif *yadif = GST_YADIF (trans);
+
+  if (yadif->pool) {
+    g_thread_pool_free (yadif->pool, FALSE, TRUE);
+    yadif->pool = NULL;
+  }
 
   return TRUE;
 }
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
+static void
+gst_yadif_filter_frame (GstYadif * yadif, int parity, int tff)
+{
+  guint i, n_stripes;
+
+  n_stripes = MIN (yadif->max_stripes,
+      GST_VIDEO_INFO_HEIGHT (&yadif->video_info) / MIN_STRIPE_HEIGHT);
+
+  if (n_stripes <= 1 || !yadif->pool) {
+    yadif_filter (yadif, parity, tff, 0, 1);
+    return;
+  }
+
+  yadif->parity = parity;
+  yadif->tff = tff;
+  yadif->n_stripes = n_stripes;
+  yadif->stripes_pending = n_stripes - 1;
+
+  /* stripe 0 is filtered here, pass the others + 1 to avoid NULL */
+  for (i = 1; i < n_stripes; i++)
+    g_thread_pool_push (yadif->pool, GUINT_TO_POINTER (i + 1), NULL);
+
+  yadif_filter (yadif, parity, tff, 0, n_stripes);
+
+  g_mutex_lock (&yadif->stripe_lock);
+  while (yadif->stripes_pending > 0)
+    g_cond_wait (&yadif->stripe_cond, &yadif->stripe_lock);
+  g_mutex_unlock (&yadif->stripe_lock);
+}
 
 static GstFlowReturn
 gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
@@ -315,7 +428,7 @@ gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
   yadif->next_frame = yadif->cur_frame;
   yadif->prev_frame = yadif->cur_frame;
 
-  yadif_filter (yadif, parity, tff);
+  gst_yadif_filter_frame (yadif, parity, tff);
 
   gst_video_frame_unmap (&yadif->dest_frame);
   gst_video_frame_unmap (&yadif->cur_frame);
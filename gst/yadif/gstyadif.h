@@ -53,6 +53,17 @@ struct _GstYadif
   GstVideoFrame cur_frame;
   GstVideoFrame next_frame;
   GstVideoFrame dest_frame;
+
+  /* stripe threading */
+  guint n_threads;
+  guint max_stripes;
+  GThreadPool *pool;
+  GMutex stripe_lock;
+  GCond stripe_cond;
+  guint stripes_pending;
+  int parity;
+  int tff;
+  int n_stripes;
 };
 
 struct _GstYadifClass
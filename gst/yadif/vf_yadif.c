@@ -38,13 +38,15 @@
 
 #define PERM_RWP AV_PERM_WRITE | AV_PERM_PRESERVE | AV_PERM_REUSE
 
+/* ps is the distance between two samples of the same component, this is
+ * larger than 1 for interleaved components like the chroma plane of NV12 */
 #define CHECK(j)\
-    {   int score = FFABS(cur[mrefs-1+(j)] - cur[prefs-1-(j)])\
-                  + FFABS(cur[mrefs  +(j)] - cur[prefs  -(j)])\
-                  + FFABS(cur[mrefs+1+(j)] - cur[prefs+1-(j)]);\
+    {   int score = FFABS(cur[mrefs+((j)-1)*ps] - cur[prefs-(1+(j))*ps])\
+                  + FFABS(cur[mrefs+(j)*ps] - cur[prefs-(j)*ps])\
+                  + FFABS(cur[mrefs+(1+(j))*ps] - cur[prefs+(1-(j))*ps]);\
         if (score < spatial_score) {\
             spatial_score= score;\
-            spatial_pred= (cur[mrefs  +(j)] + cur[prefs  -(j)])>>1;\
+            spatial_pred= (cur[mrefs+(j)*ps] + cur[prefs-(j)*ps])>>1;\
 
 #define FILTER \
     for (x = 0;  x < w; x++) { \
@@ -56,8 +58,8 @@
         int temporal_diff2 =(FFABS(next[mrefs] - c) + FFABS(next[prefs] - e) )>>1; \
         int diff = FFMAX3(temporal_diff0 >> 1, temporal_diff1, temporal_diff2); \
         int spatial_pred = (c+e) >> 1; \
-        int spatial_score = FFABS(cur[mrefs - 1] - cur[prefs - 1]) + FFABS(c-e) \
-                          + FFABS(cur[mrefs + 1] - cur[prefs + 1]) - 1; \
+        int spatial_score = FFABS(cur[mrefs - ps] - cur[prefs - ps]) + FFABS(c-e) \
+                          + FFABS(cur[mrefs + ps] - cur[prefs + ps]) - 1; \
  \
         CHECK(-1) CHECK(-2) }} }} \
         CHECK( 1) CHECK( 2) }} }} \
@@ -78,18 +80,30 @@
  \
         dst[0] = spatial_pred; \
  \
-        dst++; \
-        cur++; \
-        prev++; \
-        next++; \
-        prev2++; \
-        next2++; \
+        dst += ps; \
+        cur += ps; \
+        prev += ps; \
+        next += ps; \
+        prev2 += ps; \
+        next2 += ps; \
     }
 
 static void
 filter_line_c (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
     int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+  const int ps = 1;
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+
+FILTER}
+
+static void
+filter_line_c_interleaved (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode, int ps)
 {
   int x;
   guint8 *prev2 = parity ? prev : cur;
@@ -97,30 +111,72 @@ filter_line_c (guint8 * dst,
 
 FILTER}
 
-#if 0
 static void
 filter_line_c_16bit (guint16 * dst,
     guint16 * prev, guint16 * cur, guint16 * next,
     int w, int prefs, int mrefs, int parity, int mode)
 {
   int x;
+  const int ps = 1;
   guint16 *prev2 = parity ? prev : cur;
   guint16 *next2 = parity ? cur : next;
   mrefs /= 2;
   prefs /= 2;
 
 FILTER}
-#endif
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
+void yadif_filter (GstYadif * yadif, int parity, int tff, int stripe,
+    int n_stripes);
 #ifdef HAVE_CPU_X86_64
 void filter_line_x86_64 (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
     int w, int prefs, int mrefs, int parity, int mode);
+int filter_line_16bit_x86_64 (guint16 * dst,
+    guint16 * prev, guint16 * cur, guint16 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
 #endif
 
+static void
+filter_line (int depth, int ps, guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  if (depth > 8) {
+    guint16 *dst16 = (guint16 *) dst;
+    guint16 *prev16 = (guint16 *) prev;
+    guint16 *cur16 = (guint16 *) cur;
+    guint16 *next16 = (guint16 *) next;
+    int done = 0;
+
+#if HAVE_CPU_X86_64
+    /* the SIMD version works on 16 bit signed words */
+    if (depth <= 12)
+      done = filter_line_16bit_x86_64 (dst16, prev16, cur16, next16, w,
+          prefs, mrefs, parity, mode);
+#endif
+    if (done < w)
+      filter_line_c_16bit (dst16 + done, prev16 + done, cur16 + done,
+          next16 + done, w - done, prefs, mrefs, parity, mode);
+  } else if (ps > 1) {
+    filter_line_c_interleaved (dst, prev, cur, next, w, prefs, mrefs, parity,
+        mode, ps);
+  } else {
+#if HAVE_CPU_X86_64
+    if (0) {
+      filter_line_c (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
+    } else {
+      filter_line_x86_64 (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
+    }
+#else
+    filter_line_c (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
+#endif
+  }
+}
+
+/* Filters the lines of stripe @stripe out of @n_stripes of every component,
+ * the stripes can be processed in parallel */
 void
-yadif_filter (GstYadif * yadif, int parity, int tff)
+yadif_filter (GstYadif * yadif, int parity, int tff, int stripe, int n_stripes)
 {
   int y, i;
   const GstVideoInfo *vi = &yadif->video_info;
@@ -131,31 +187,29 @@ yadif_filter (GstYadif * yadif, int parity, int tff)
     int h = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (vfi, i, vi->height);
     int refs = GST_VIDEO_INFO_COMP_STRIDE (vi, i);
     int df = GST_VIDEO_INFO_COMP_PSTRIDE (vi, i);
+    int depth = GST_VIDEO_FORMAT_INFO_DEPTH (vfi, i);
+    /* distance between two samples, in samples */
+    int ps = depth > 8 ? df / 2 : df;
+    gboolean first_in_plane = GST_VIDEO_FORMAT_INFO_POFFSET (vfi, i) == 0;
+    int y_start = h * stripe / n_stripes;
+    int y_end = h * (stripe + 1) / n_stripes;
     guint8 *prev_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->prev_frame, i);
     guint8 *cur_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->cur_frame, i);
     guint8 *next_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->next_frame, i);
     guint8 *dest_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->dest_frame, i);
 
-    for (y = 0; y < h; y++) {
+    for (y = y_start; y < y_end; y++) {
       if ((y ^ parity) & 1) {
         guint8 *prev = prev_data + y * refs;
         guint8 *cur = cur_data + y * refs;
         guint8 *next = next_data + y * refs;
         guint8 *dst = dest_data + y * refs;
         int mode = ((y == 1) || (y + 2 == h)) ? 2 : yadif->mode;
-#if HAVE_CPU_X86_64
-        if (0) {
-          filter_line_c (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        } else {
-          filter_line_x86_64 (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        }
-#else
-        filter_line_c (dst, prev, cur, next, w,
+
+        filter_line (depth, ps, dst, prev, cur, next, w,
             y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-#endif
-      } else {
+      } else if (first_in_plane) {
+        /* copies all components of an interleaved plane at once */
         guint8 *dst = dest_data + y * refs;
         guint8 *cur = cur_data + y * refs;
 
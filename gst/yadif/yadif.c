@@ -24,6 +24,8 @@
 
 #if HAVE_CPU_X86_64
 
+#include <emmintrin.h>
+
 typedef struct xmm_reg
 {
   guint64 a, b;
@@ -104,4 +106,137 @@ filter_line_x86_64 (guint8 * dst,
   yadif_filter_line_sse2 (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
 }
 
+/* SSE2 version of filter_line_c_16bit, working on 8 samples at once. The
+ * computations are done on signed 16 bit words, so this is only correct for
+ * samples of up to 12 bits. Returns the number of samples that were
+ * processed, the remaining ones have to be handled by the C version. */
+
+static inline __m128i
+absdiff_epi16 (__m128i a, __m128i b)
+{
+  return _mm_max_epi16 (_mm_sub_epi16 (a, b), _mm_sub_epi16 (b, a));
+}
+
+/* (a + b) >> 1 for positive values */
+static inline __m128i
+avg_epi16 (__m128i a, __m128i b)
+{
+  return _mm_srli_epi16 (_mm_add_epi16 (a, b), 1);
+}
+
+static inline __m128i
+select_epi16 (__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b));
+}
+
+#define LOAD16(p) _mm_loadu_si128 ((const __m128i *) (p))
+
+/* Vector version of the CHECK() macro, only for the lanes in @enable.
+ * Returns the lanes where the prediction was updated */
+static inline __m128i
+check_16bit (const guint16 * cur, int mrefs, int prefs, int j,
+    __m128i enable, __m128i * spatial_score, __m128i * spatial_pred)
+{
+  __m128i score, mask;
+
+  score = _mm_add_epi16 (_mm_add_epi16 (absdiff_epi16 (LOAD16 (cur + mrefs +
+                  j - 1), LOAD16 (cur + prefs - j - 1)),
+          absdiff_epi16 (LOAD16 (cur + mrefs + j), LOAD16 (cur + prefs - j))),
+      absdiff_epi16 (LOAD16 (cur + mrefs + j + 1), LOAD16 (cur + prefs - j +
+              1)));
+
+  mask = _mm_and_si128 (enable, _mm_cmplt_epi16 (score, *spatial_score));
+  *spatial_score = select_epi16 (mask, score, *spatial_score);
+  *spatial_pred = select_epi16 (mask, avg_epi16 (LOAD16 (cur + mrefs + j),
+          LOAD16 (cur + prefs - j)), *spatial_pred);
+
+  return mask;
+}
+
+int filter_line_16bit_x86_64 (guint16 * dst,
+    guint16 * prev, guint16 * cur, guint16 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+int
+filter_line_16bit_x86_64 (guint16 * dst,
+    guint16 * prev, guint16 * cur, guint16 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  const __m128i all = _mm_set1_epi16 (-1);
+  const __m128i one = _mm_set1_epi16 (1);
+  const __m128i zero = _mm_setzero_si128 ();
+  guint16 *prev2 = parity ? prev : cur;
+  guint16 *next2 = parity ? cur : next;
+  int x;
+
+  mrefs /= 2;
+  prefs /= 2;
+
+  for (x = 0; x + 8 <= w; x += 8) {
+    __m128i c, d, e, diff, mask;
+    __m128i temporal_diff0, temporal_diff1, temporal_diff2;
+    __m128i spatial_pred, spatial_score;
+
+    c = LOAD16 (cur + mrefs);
+    e = LOAD16 (cur + prefs);
+    d = avg_epi16 (LOAD16 (prev2), LOAD16 (next2));
+
+    temporal_diff0 = absdiff_epi16 (LOAD16 (prev2), LOAD16 (next2));
+    temporal_diff1 =
+        _mm_srli_epi16 (_mm_add_epi16 (absdiff_epi16 (LOAD16 (prev + mrefs),
+                c), absdiff_epi16 (LOAD16 (prev + prefs), e)), 1);
+    temporal_diff2 =
+        _mm_srli_epi16 (_mm_add_epi16 (absdiff_epi16 (LOAD16 (next + mrefs),
+                c), absdiff_epi16 (LOAD16 (next + prefs), e)), 1);
+    diff = _mm_max_epi16 (_mm_max_epi16 (_mm_srli_epi16 (temporal_diff0, 1),
+            temporal_diff1), temporal_diff2);
+
+    spatial_pred = avg_epi16 (c, e);
+    spatial_score =
+        _mm_add_epi16 (_mm_add_epi16 (absdiff_epi16 (LOAD16 (cur + mrefs - 1),
+                LOAD16 (cur + prefs - 1)), absdiff_epi16 (c, e)),
+        absdiff_epi16 (LOAD16 (cur + mrefs + 1), LOAD16 (cur + prefs + 1)));
+    spatial_score = _mm_sub_epi16 (spatial_score, one);
+
+    mask = check_16bit (cur, mrefs, prefs, -1, all, &spatial_score,
+        &spatial_pred);
+    check_16bit (cur, mrefs, prefs, -2, mask, &spatial_score, &spatial_pred);
+    mask = check_16bit (cur, mrefs, prefs, 1, all, &spatial_score,
+        &spatial_pred);
+    check_16bit (cur, mrefs, prefs, 2, mask, &spatial_score, &spatial_pred);
+
+    if (mode < 2) {
+      __m128i b, f, dmax, dmin;
+
+      b = avg_epi16 (LOAD16 (prev2 + 2 * mrefs), LOAD16 (next2 + 2 * mrefs));
+      f = avg_epi16 (LOAD16 (prev2 + 2 * prefs), LOAD16 (next2 + 2 * prefs));
+      dmax = _mm_max_epi16 (_mm_max_epi16 (_mm_sub_epi16 (d, e),
+              _mm_sub_epi16 (d, c)), _mm_min_epi16 (_mm_sub_epi16 (b, c),
+              _mm_sub_epi16 (f, e)));
+      dmin = _mm_min_epi16 (_mm_min_epi16 (_mm_sub_epi16 (d, e),
+              _mm_sub_epi16 (d, c)), _mm_max_epi16 (_mm_sub_epi16 (b, c),
+              _mm_sub_epi16 (f, e)));
+
+      diff = _mm_max_epi16 (_mm_max_epi16 (diff, dmin),
+          _mm_sub_epi16 (zero, dmax));
+    }
+
+    /* diff is never negative, so this is the same as the clamping in C */
+    spatial_pred = _mm_max_epi16 (_mm_min_epi16 (spatial_pred,
+            _mm_add_epi16 (d, diff)), _mm_sub_epi16 (d, diff));
+
+    _mm_storeu_si128 ((__m128i *) dst, spatial_pred);
+
+    dst += 8;
+    cur += 8;
+    prev += 8;
+    next += 8;
+    prev2 += 8;
+    next2 += 8;
+  }
+
+  return x;
+}
+
 #endif
@@ -37,6 +37,10 @@ G_DEFINE_TYPE (TestElement1, test_element1, GST_TYPE_BIN);
 GType test_element2_get_type (void);
 G_DEFINE_TYPE (TestElement2, test_element2, GST_TYPE_BIN);
 
+/* Number of test elements created so far */
+static guint test_element1_count = 0;
+static guint test_element2_count = 0;
+
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC, GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("test/caps,type=(int)[1,2]"));
@@ -149,6 +153,129 @@ GST_START_TEST (test_autoconvert_simple)
 
 GST_END_TEST;
 
+static void
+push_buffers (GstPad * test_src_pad, const gchar * caps_str)
+{
+  GstCaps *caps;
+  guint i;
+
+  if (caps_str) {
+    caps = gst_caps_from_string (caps_str);
+    fail_unless (gst_pad_set_caps (test_src_pad, caps));
+    gst_caps_unref (caps);
+  }
+
+  for (i = 0; i < 5; i++) {
+    fail_unless (gst_pad_push (test_src_pad, gst_buffer_new_and_alloc (4096))
+        == GST_FLOW_OK);
+  }
+}
+
+/* The second instance and the switch back to the first caps are served from
+ * the shared factory cache, the result must be the same.
+ *
+ * testelement2 comes first in the factory list, so without the cache it is
+ * always instantiated and tried before testelement1 is selected for the
+ * first caps. With the cache, the second instance goes straight to
+ * testelement1. */
+GST_START_TEST (test_autoconvert_cached_decisions)
+{
+  GstPad *test_src_pad, *test_sink_pad;
+  GstElement *autoconvert;
+  GstCaps *caps;
+  guint count1, count2;
+  guint i;
+
+  for (i = 0; i < 2; i++) {
+    autoconvert = gst_check_setup_element ("autoconvert");
+    set_autoconvert_factories (autoconvert);
+
+    test_src_pad = gst_check_setup_src_pad (autoconvert, &src_factory);
+    gst_pad_set_active (test_src_pad, TRUE);
+    test_sink_pad = gst_check_setup_sink_pad (autoconvert, &sink_factory);
+    gst_pad_set_active (test_sink_pad, TRUE);
+
+    gst_element_set_state (GST_ELEMENT_CAST (autoconvert), GST_STATE_PLAYING);
+
+    count1 = test_element1_count;
+    count2 = test_element2_count;
+
+    caps = gst_caps_from_string ("test/caps,type=(int)1");
+    gst_check_setup_events (test_src_pad, autoconvert, caps, GST_FORMAT_BYTES);
+    gst_caps_unref (caps);
+
+    push_buffers (test_src_pad, NULL);
+
+    fail_unless_equals_int (test_element1_count, count1 + 1);
+    if (i > 0) {
+      /* only the cached factory was instantiated */
+      fail_unless_equals_int (test_element2_count, count2);
+      GST_OBJECT_LOCK (autoconvert);
+      fail_unless_equals_int (GST_BIN_NUMCHILDREN (autoconvert), 1);
+      fail_unless (G_OBJECT_TYPE (GST_BIN_CHILDREN (autoconvert)->data) ==
+          test_element1_get_type ());
+      GST_OBJECT_UNLOCK (autoconvert);
+    }
+
+    push_buffers (test_src_pad, "test/caps,type=(int)2");
+    push_buffers (test_src_pad, "test/caps,type=(int)1");
+
+    fail_unless_equals_int (g_list_length (buffers), 15);
+    gst_check_drop_buffers ();
+
+    gst_element_set_state ((GstElement *) autoconvert, GST_STATE_NULL);
+
+    gst_pad_set_active (test_src_pad, FALSE);
+    gst_pad_set_active (test_sink_pad, FALSE);
+    gst_check_teardown_src_pad (autoconvert);
+    gst_check_teardown_sink_pad (autoconvert);
+    gst_check_teardown_element (autoconvert);
+  }
+}
+
+GST_END_TEST;
+
+/* Without the "factories" property, the instances share the sorted list of
+ * all usable factories, each of them has to own its copy of it */
+GST_START_TEST (test_autoconvert_default_factories)
+{
+  GstPad *test_src_pad, *test_sink_pad;
+  GstElement *autoconvert;
+  GstCaps *caps;
+  guint i;
+
+  for (i = 0; i < 2; i++) {
+    autoconvert = gst_check_setup_element ("autoconvert");
+
+    test_src_pad = gst_check_setup_src_pad (autoconvert, &src_factory);
+    gst_pad_set_active (test_src_pad, TRUE);
+    test_sink_pad = gst_check_setup_sink_pad (autoconvert, &sink_factory);
+    gst_pad_set_active (test_sink_pad, TRUE);
+
+    gst_element_set_state (GST_ELEMENT_CAST (autoconvert), GST_STATE_PLAYING);
+
+    caps = gst_caps_from_string ("test/caps,type=(int)1");
+    gst_check_setup_events (test_src_pad, autoconvert, caps, GST_FORMAT_BYTES);
+    gst_caps_unref (caps);
+
+    push_buffers (test_src_pad, NULL);
+    push_buffers (test_src_pad, "test/caps,type=(int)2");
+
+    fail_unless_equals_int (g_list_length (buffers), 10);
+    gst_check_drop_buffers ();
+
+    gst_element_set_state ((GstElement *) autoconvert, GST_STATE_NULL);
+
+    gst_pad_set_active (test_src_pad, FALSE);
+    gst_pad_set_active (test_sink_pad, FALSE);
+    gst_check_teardown_src_pad (autoconvert);
+    gst_check_teardown_sink_pad (autoconvert);
+    gst_check_teardown_element (autoconvert);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 autoconvert_suite (void)
 {
@@ -158,6 +285,8 @@ autoconvert_suite (void)
   suite_add_tcase (s, tc_basic);
   tcase_add_checked_fixture (tc_basic, setup, teardown);
   tcase_add_test (tc_basic, test_autoconvert_simple);
+  tcase_add_test (tc_basic, test_autoconvert_cached_decisions);
+  tcase_add_test (tc_basic, test_autoconvert_default_factories);
 
   return s;
 }
@@ -214,6 +343,7 @@ test_element1_class_init (TestElement1Class * klass)
 static void
 test_element1_init (TestElement1 * elem)
 {
+  test_element1_count++;
   configure_test_element (GST_BIN_CAST (elem), "test/caps,type=(int)1");
 }
 
@@ -233,6 +363,7 @@ test_element2_class_init (TestElement2Class * klass)
 static void
 test_element2_init (TestElement2 * elem)
 {
+  test_element2_count++;
   configure_test_element (GST_BIN_CAST (elem), "test/caps,type=(int)2");
 }
 
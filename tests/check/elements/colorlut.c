@@ -0,0 +1,242 @@
+/* GStreamer
+ *
+ * unit test for colorlut
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define WIDTH 16
+#define HEIGHT 16
+
+#define RGB_CAPS "video/x-raw, format=(string)RGB, width=(int)16, " \
+    "height=(int)16, framerate=(fraction)25/1"
+#define I420_CAPS "video/x-raw, format=(string)I420, width=(int)16, " \
+    "height=(int)16, framerate=(fraction)25/1"
+
+/* both sizes without padding for 16x16 */
+#define RGB_SIZE (WIDTH * HEIGHT * 3)
+#define I420_SIZE (WIDTH * HEIGHT * 3 / 2)
+
+static gchar *
+write_lut (const gchar * tmpl, const gchar * contents)
+{
+  GError *err = NULL;
+  gchar *filename;
+  gint fd;
+
+  fd = g_file_open_tmp (tmpl, &filename, &err);
+  fail_unless (fd >= 0, "Failed to create temporary file: %s",
+      err ? err->message : "");
+  close (fd);
+  fail_unless (g_file_set_contents (filename, contents, -1, NULL));
+
+  return filename;
+}
+
+/* size 2 .cube identity, red changing fastest */
+static gchar *
+write_identity_cube (void)
+{
+  GString *s = g_string_new ("# identity\nLUT_3D_SIZE 2\n");
+  gchar *filename;
+  gint r, g, b;
+
+  for (b = 0; b < 2; b++)
+    for (g = 0; g < 2; g++)
+      for (r = 0; r < 2; r++)
+        g_string_append_printf (s, "%d.0 %d.0 %d.0\n", r, g, b);
+
+  filename = write_lut ("colorlut-XXXXXX.cube", s->str);
+  g_string_free (s, TRUE);
+
+  return filename;
+}
+
+/* size 2 10 bit .3dl identity, blue changing fastest */
+static gchar *
+write_identity_3dl (void)
+{
+  GString *s = g_string_new ("0 1023\n");
+  gchar *filename;
+  gint r, g, b;
+
+  for (r = 0; r < 2; r++)
+    for (g = 0; g < 2; g++)
+      for (b = 0; b < 2; b++)
+        g_string_append_printf (s, "%d %d %d\n", r * 1023, g * 1023,
+            b * 1023);
+
+  filename = write_lut ("colorlut-XXXXXX.3dl", s->str);
+  g_string_free (s, TRUE);
+
+  return filename;
+}
+
+/* pushes a frame with @data through colorlut with @lut and the
+ * @interpolation nick and returns the output */
+static GstBuffer *
+process (const gchar * lut, const gchar * interpolation, const gchar * caps,
+    const guint8 * data, gsize size)
+{
+  GstHarness *h = gst_harness_new ("colorlut");
+  GstBuffer *buf;
+
+  g_object_set (h->element, "location", lut, NULL);
+  gst_util_set_object_arg (G_OBJECT (h->element), "interpolation",
+      interpolation);
+  gst_harness_set_src_caps_str (h, caps);
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_fill (buf, 0, data, size);
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (buf), size);
+
+  gst_harness_teardown (h);
+
+  return buf;
+}
+
+static void
+check_unchanged (GstBuffer * buf, const guint8 * data, gsize size)
+{
+  GstMapInfo map;
+  gsize i;
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = 0; i < size; i++) {
+    fail_unless (ABS (map.data[i] - data[i]) <= 1,
+        "byte %" G_GSIZE_FORMAT " changed from %d to %d", i, data[i],
+        map.data[i]);
+  }
+  gst_buffer_unmap (buf, &map);
+}
+
+static void
+fill_pattern (guint8 * data, gsize size)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    data[i] = (i * 37 + i / 7) & 0xff;
+}
+
+static void
+check_identity (gchar * lut)
+{
+  guint8 data[RGB_SIZE];
+  const gchar *interpolations[] = { "trilinear", "tetrahedral" };
+  GstBuffer *buf;
+  gint i;
+
+  fill_pattern (data, sizeof (data));
+
+  for (i = 0; i < G_N_ELEMENTS (interpolations); i++) {
+    buf = process (lut, interpolations[i], RGB_CAPS, data, RGB_SIZE);
+    check_unchanged (buf, data, RGB_SIZE);
+    gst_buffer_unref (buf);
+
+    buf = process (lut, interpolations[i], I420_CAPS, data, I420_SIZE);
+    check_unchanged (buf, data, I420_SIZE);
+    gst_buffer_unref (buf);
+  }
+
+  g_unlink (lut);
+  g_free (lut);
+}
+
+GST_START_TEST (test_colorlut_identity_cube)
+{
+  check_identity (write_identity_cube ());
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_colorlut_identity_3dl)
+{
+  check_identity (write_identity_3dl ());
+}
+
+GST_END_TEST;
+
+/* Only white maps to white, every other corner of the cube to black. At
+ * (0.8, 0.2, 0.4) trilinear interpolation gives the product of the
+ * coordinates, 0.064, and tetrahedral interpolation their minimum, 0.2 */
+GST_START_TEST (test_colorlut_interpolation)
+{
+  GString *s = g_string_new ("LUT_3D_SIZE 2\n");
+  guint8 data[RGB_SIZE];
+  GstBuffer *buf;
+  GstMapInfo map;
+  gchar *lut;
+  gint i;
+
+  for (i = 0; i < 7; i++)
+    g_string_append (s, "0.0 0.0 0.0\n");
+  g_string_append (s, "1.0 1.0 1.0\n");
+  lut = write_lut ("colorlut-XXXXXX.cube", s->str);
+  g_string_free (s, TRUE);
+
+  for (i = 0; i < WIDTH * HEIGHT; i++) {
+    data[3 * i + 0] = 204;
+    data[3 * i + 1] = 51;
+    data[3 * i + 2] = 102;
+  }
+
+  buf = process (lut, "trilinear", RGB_CAPS, data, RGB_SIZE);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = 0; i < RGB_SIZE; i++)
+    fail_unless (ABS (map.data[i] - 16) <= 1, "trilinear gave %d",
+        map.data[i]);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  buf = process (lut, "tetrahedral", RGB_CAPS, data, RGB_SIZE);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = 0; i < RGB_SIZE; i++)
+    fail_unless (ABS (map.data[i] - 51) <= 1, "tetrahedral gave %d",
+        map.data[i]);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  g_unlink (lut);
+  g_free (lut);
+}
+
+GST_END_TEST;
+
+static Suite *
+colorlut_suite (void)
+{
+  Suite *s = suite_create ("colorlut");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_colorlut_identity_cube);
+  tcase_add_test (tc_chain, test_colorlut_identity_3dl);
+  tcase_add_test (tc_chain, test_colorlut_interpolation);
+
+  return s;
+}
+
+GST_CHECK_MAIN (colorlut);
@@ -0,0 +1,341 @@
+/* GStreamer
+ *
+ * unit test for hlssink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+static GstPad *mysrcpad;
+
+static GPtrArray *added_segments;
+static GPtrArray *added_parts;
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream = (boolean) true"));
+
+static void
+segment_added_cb (GstElement * sink, const gchar * location,
+    GstBufferList * data, GPtrArray * added)
+{
+  fail_unless (location != NULL);
+  fail_unless (data != NULL);
+  fail_unless (gst_buffer_list_length (data) > 0);
+
+  g_ptr_array_add (added, g_strdup (location));
+}
+
+static GstElement *
+setup_hlssink (GstClockTime part_duration, guint max_files)
+{
+  GstElement *hlssink;
+  GstCaps *caps;
+
+  added_segments = g_ptr_array_new_with_free_func (g_free);
+  added_parts = g_ptr_array_new_with_free_func (g_free);
+
+  hlssink = gst_check_setup_element ("hlssink");
+  /* the test schedules the key units itself */
+  g_object_set (hlssink, "in-memory", TRUE, "playlist-location", NULL,
+      "target-duration", 0, "max-files", max_files, "part-duration",
+      part_duration, NULL);
+  g_signal_connect (hlssink, "segment-added", G_CALLBACK (segment_added_cb),
+      added_segments);
+  g_signal_connect (hlssink, "part-added", G_CALLBACK (segment_added_cb),
+      added_parts);
+
+  mysrcpad = gst_check_setup_src_pad (hlssink, &srctemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  fail_unless (gst_element_set_state (hlssink,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set to playing");
+
+  caps = gst_static_pad_template_get_caps (&srctemplate);
+  gst_check_setup_events (mysrcpad, hlssink, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return hlssink;
+}
+
+static void
+cleanup_hlssink (GstElement * hlssink)
+{
+  gst_element_set_state (hlssink, GST_STATE_NULL);
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (hlssink);
+  gst_check_teardown_element (hlssink);
+
+  g_ptr_array_unref (added_segments);
+  g_ptr_array_unref (added_parts);
+}
+
+static void
+push_buffer (GstClockTime pts, GstClockTime duration, gboolean delta_unit)
+{
+  GstBuffer *buffer;
+
+  buffer = gst_buffer_new_allocate (NULL, 188, NULL);
+  gst_buffer_memset (buffer, 0, 0x47, 188);
+  GST_BUFFER_PTS (buffer) = pts;
+  GST_BUFFER_DURATION (buffer) = duration;
+  if (delta_unit)
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+}
+
+static void
+push_key_unit (GstClockTime running_time, guint count)
+{
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_video_event_new_downstream_force_key_unit (running_time,
+              running_time, running_time, TRUE, count)));
+}
+
+static guint
+get_segment_length (GstElement * hlssink, const gchar * location)
+{
+  GstBufferList *data = NULL;
+  guint length;
+
+  g_signal_emit_by_name (hlssink, "get-segment", location, &data);
+  if (data == NULL)
+    return 0;
+
+  length = gst_buffer_list_length (data);
+  gst_buffer_list_unref (data);
+
+  return length;
+}
+
+static gchar *
+get_playlist (GstElement * hlssink)
+{
+  gchar *playlist = NULL;
+
+  g_signal_emit_by_name (hlssink, "get-playlist", &playlist);
+  fail_unless (playlist != NULL);
+
+  return playlist;
+}
+
+#define assert_playlist_contains(playlist, str) \
+  fail_unless (strstr (playlist, str) != NULL, \
+      "'%s' not found in playlist:\n%s", str, playlist)
+
+GST_START_TEST (test_in_memory_segments)
+{
+  GstElement *hlssink;
+  gchar *playlist;
+
+  hlssink = setup_hlssink (0, 10);
+
+  push_buffer (0, GST_SECOND, FALSE);
+  push_buffer (GST_SECOND, GST_SECOND, TRUE);
+  push_buffer (2 * GST_SECOND, GST_SECOND, TRUE);
+  fail_unless_equals_int (added_segments->len, 0);
+
+  /* a key unit ends the segment */
+  push_key_unit (3 * GST_SECOND, 1);
+  fail_unless_equals_int (added_segments->len, 1);
+  fail_unless_equals_string (g_ptr_array_index (added_segments, 0),
+      "segment00000.ts");
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.ts"), 3);
+
+  playlist = get_playlist (hlssink);
+  assert_playlist_contains (playlist, "#EXTINF:3,\nsegment00000.ts\n");
+  fail_unless (strstr (playlist, "#EXT-X-ENDLIST") == NULL);
+  fail_unless (strstr (playlist, "#EXT-X-PART") == NULL);
+  g_free (playlist);
+
+  push_buffer (3 * GST_SECOND, GST_SECOND, FALSE);
+  push_buffer (4 * GST_SECOND, GST_SECOND, TRUE);
+
+  /* EOS ends the last segment at the end of the last buffer */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  fail_unless_equals_int (added_segments->len, 2);
+  fail_unless_equals_string (g_ptr_array_index (added_segments, 1),
+      "segment00001.ts");
+  /* only the file name is used for the lookup */
+  fail_unless_equals_int (get_segment_length (hlssink,
+          "http://localhost/hls/segment00001.ts"), 2);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00002.ts"), 0);
+
+  playlist = get_playlist (hlssink);
+  assert_playlist_contains (playlist, "#EXTINF:3,\nsegment00000.ts\n"
+      "#EXTINF:2,\nsegment00001.ts\n#EXT-X-ENDLIST");
+  g_free (playlist);
+
+  fail_unless_equals_int (added_parts->len, 0);
+
+  cleanup_hlssink (hlssink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_in_memory_max_files)
+{
+  GstElement *hlssink;
+
+  hlssink = setup_hlssink (0, 1);
+
+  push_buffer (0, GST_SECOND, FALSE);
+  push_key_unit (GST_SECOND, 1);
+  push_buffer (GST_SECOND, GST_SECOND, FALSE);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (added_segments->len, 2);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.ts"), 0);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00001.ts"), 1);
+
+  cleanup_hlssink (hlssink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_in_memory_no_timestamps)
+{
+  GstElement *hlssink;
+  gchar *playlist;
+
+  hlssink = setup_hlssink (0, 10);
+
+  push_buffer (GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, FALSE);
+  push_buffer (GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* the duration is unknown, it must not end up as garbage in the playlist */
+  fail_unless_equals_int (added_segments->len, 1);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.ts"), 2);
+  playlist = get_playlist (hlssink);
+  assert_playlist_contains (playlist, "#EXT-X-TARGETDURATION:0\n");
+  assert_playlist_contains (playlist, "#EXTINF:0,\nsegment00000.ts\n");
+  g_free (playlist);
+
+  cleanup_hlssink (hlssink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_in_memory_parts)
+{
+  GstElement *hlssink;
+  gchar *playlist;
+
+  hlssink = setup_hlssink (GST_SECOND, 10);
+
+  push_buffer (0, GST_SECOND / 2, FALSE);
+  push_buffer (GST_SECOND / 2, GST_SECOND / 2, TRUE);
+  fail_unless_equals_int (added_parts->len, 0);
+
+  /* the first buffer past the part duration starts a new part */
+  push_buffer (GST_SECOND, GST_SECOND / 2, TRUE);
+  fail_unless_equals_int (added_parts->len, 1);
+  fail_unless_equals_string (g_ptr_array_index (added_parts, 0),
+      "segment00000.0.ts");
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.0.ts"),
+      2);
+
+  /* the part is listed before its segment is complete */
+  playlist = get_playlist (hlssink);
+  assert_playlist_contains (playlist, "#EXT-X-PART-INF:PART-TARGET=1\n");
+  assert_playlist_contains (playlist,
+      "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=3\n");
+  assert_playlist_contains (playlist,
+      "#EXT-X-PART:DURATION=1,URI=\"segment00000.0.ts\",INDEPENDENT=YES\n");
+  fail_unless (strstr (playlist, "#EXTINF") == NULL);
+  g_free (playlist);
+
+  push_buffer (3 * GST_SECOND / 2, GST_SECOND / 2, TRUE);
+
+  /* the end of the segment also ends its last part */
+  push_key_unit (2 * GST_SECOND, 1);
+  fail_unless_equals_int (added_parts->len, 2);
+  fail_unless_equals_string (g_ptr_array_index (added_parts, 1),
+      "segment00000.1.ts");
+  fail_unless_equals_int (added_segments->len, 1);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.ts"), 4);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.1.ts"),
+      2);
+
+  playlist = get_playlist (hlssink);
+  assert_playlist_contains (playlist,
+      "#EXT-X-PART:DURATION=1,URI=\"segment00000.0.ts\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=1,URI=\"segment00000.1.ts\"\n"
+      "#EXTINF:2,\nsegment00000.ts\n");
+  g_free (playlist);
+
+  push_buffer (2 * GST_SECOND, GST_SECOND / 2, FALSE);
+  push_buffer (5 * GST_SECOND / 2, GST_SECOND / 2, TRUE);
+  push_buffer (3 * GST_SECOND, GST_SECOND / 2, TRUE);
+  fail_unless_equals_int (added_parts->len, 3);
+  fail_unless_equals_string (g_ptr_array_index (added_parts, 2),
+      "segment00001.0.ts");
+
+  /* the parts of the last complete segment are still listed */
+  playlist = get_playlist (hlssink);
+  assert_playlist_contains (playlist,
+      "#EXT-X-PART:DURATION=1,URI=\"segment00000.1.ts\"\n"
+      "#EXTINF:2,\nsegment00000.ts\n"
+      "#EXT-X-PART:DURATION=1,URI=\"segment00001.0.ts\",INDEPENDENT=YES\n");
+  g_free (playlist);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  fail_unless_equals_int (added_parts->len, 4);
+  fail_unless_equals_int (added_segments->len, 2);
+
+  /* older parts are dropped from the playlist and from memory */
+  playlist = get_playlist (hlssink);
+  fail_unless (strstr (playlist, "segment00000.0.ts") == NULL);
+  fail_unless (strstr (playlist, "segment00000.1.ts") == NULL);
+  assert_playlist_contains (playlist, "#EXTINF:2,\nsegment00000.ts\n"
+      "#EXT-X-PART:DURATION=1,URI=\"segment00001.0.ts\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"segment00001.1.ts\"\n"
+      "#EXTINF:1.5,\nsegment00001.ts\n#EXT-X-ENDLIST");
+  g_free (playlist);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.0.ts"),
+      0);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00000.ts"), 4);
+  fail_unless_equals_int (get_segment_length (hlssink, "segment00001.1.ts"),
+      1);
+
+  cleanup_hlssink (hlssink);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink_suite (void)
+{
+  Suite *s = suite_create ("hlssink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_in_memory_segments);
+  tcase_add_test (tc_chain, test_in_memory_max_files);
+  tcase_add_test (tc_chain, test_in_memory_no_timestamps);
+  tcase_add_test (tc_chain, test_in_memory_parts);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink);
@@ -22,6 +22,8 @@
 
 #include <gst/check/gstcheck.h>
 #include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
 
 static const gchar *
 get_mpeg2enc_element_name (void)
@@ -142,6 +144,231 @@ GST_START_TEST (test_raw_video_raw_audio)
 
 GST_END_TEST;
 
+/* Walks the KLV packets of @data. Returns FALSE at the end of the data or
+ * if the packet at @offset is truncated */
+static gboolean
+next_klv (const guint8 * data, gsize size, gsize * offset,
+    const guint8 ** key, const guint8 ** value, gsize * value_size)
+{
+  gsize pos = *offset;
+  guint64 len = 0;
+  guint i, n;
+
+  if (pos + 17 > size)
+    return FALSE;
+
+  *key = data + pos;
+  pos += 16;
+
+  if (data[pos] & 0x80) {
+    n = data[pos] & 0x7f;
+    pos++;
+    if (n == 0 || n > 8 || pos + n > size)
+      return FALSE;
+    for (i = 0; i < n; i++)
+      len = (len << 8) | data[pos + i];
+    pos += n;
+  } else {
+    len = data[pos];
+    pos++;
+  }
+
+  if (len > size - pos)
+    return FALSE;
+
+  *value = data + pos;
+  *value_size = len;
+  *offset = pos + len;
+
+  return TRUE;
+}
+
+/* Compares the registry independent bytes of a SMPTE key */
+static gboolean
+key_is (const guint8 * key, guint8 category, guint8 kind)
+{
+  static const guint8 prefix[] = { 0x06, 0x0e, 0x2b, 0x34, 0x02 };
+  static const guint8 set[] = { 0x0d, 0x01, 0x02, 0x01, 0x01 };
+
+  return memcmp (key, prefix, 5) == 0 && key[5] == category
+      && memcmp (key + 8, set, 5) == 0 && key[13] == kind;
+}
+
+#define KEY_IS_PARTITION_PACK(k) \
+  (key_is (k, 0x05, 0x02) || key_is (k, 0x05, 0x03) || key_is (k, 0x05, 0x04))
+#define KEY_IS_BODY_PARTITION_PACK(k) key_is (k, 0x05, 0x03)
+#define KEY_IS_RANDOM_INDEX_PACK(k) key_is (k, 0x05, 0x11)
+#define KEY_IS_INDEX_TABLE_SEGMENT(k) key_is (k, 0x53, 0x10)
+
+typedef struct
+{
+  guint64 start;
+  guint64 duration;
+} IndexRange;
+
+static gint
+compare_index_range (gconstpointer a, gconstpointer b)
+{
+  const IndexRange *ra = a, *rb = b;
+
+  return ra->start < rb->start ? -1 : (ra->start > rb->start ? 1 : 0);
+}
+
+/* Checks an index table segment and adds the edit units it covers to
+ * @ranges */
+static void
+check_index_table_segment (const guint8 * data, gsize size, GArray * ranges)
+{
+  IndexRange range = { G_MAXUINT64, G_MAXUINT64 };
+  guint32 edit_unit_byte_count = 0;
+  guint32 n_entries = 0, entry_size = 0;
+  const guint8 *entries = NULL;
+  guint64 prev_offset = 0;
+  guint i;
+
+  while (size >= 4) {
+    guint16 tag = GST_READ_UINT16_BE (data);
+    guint16 len = GST_READ_UINT16_BE (data + 2);
+
+    data += 4;
+    size -= 4;
+    fail_unless (len <= size);
+
+    switch (tag) {
+      case 0x3f0c:
+        fail_unless_equals_int (len, 8);
+        range.start = GST_READ_UINT64_BE (data);
+        break;
+      case 0x3f0d:
+        fail_unless_equals_int (len, 8);
+        range.duration = GST_READ_UINT64_BE (data);
+        break;
+      case 0x3f05:
+        fail_unless_equals_int (len, 4);
+        edit_unit_byte_count = GST_READ_UINT32_BE (data);
+        break;
+      case 0x3f0a:
+        fail_unless (len >= 8);
+        n_entries = GST_READ_UINT32_BE (data);
+        entry_size = GST_READ_UINT32_BE (data + 4);
+        fail_unless (entry_size >= 11);
+        fail_unless_equals_int (len, 8 + n_entries * entry_size);
+        entries = data + 8;
+        break;
+      default:
+        break;
+    }
+
+    data += len;
+    size -= len;
+  }
+
+  fail_unless (range.start != G_MAXUINT64);
+  fail_unless (range.duration != G_MAXUINT64 && range.duration > 0);
+
+  if (entries) {
+    /* VBE: one entry per edit unit with increasing stream offsets */
+    fail_unless_equals_int (n_entries, range.duration);
+    for (i = 0; i < n_entries; i++) {
+      guint64 offset = GST_READ_UINT64_BE (entries + i * entry_size + 3);
+
+      if (i > 0)
+        fail_unless (offset > prev_offset);
+      prev_offset = offset;
+    }
+  } else {
+    /* CBE: the offsets follow from the edit unit size */
+    fail_unless (edit_unit_byte_count > 0);
+  }
+
+  g_array_append_val (ranges, range);
+}
+
+GST_START_TEST (test_raw_video_raw_audio_body_partitions)
+{
+  gchar *pipeline, *location, *contents;
+  GArray *partitions, *ranges;
+  const guint8 *data, *key, *value;
+  gsize size, offset, value_size;
+  guint64 next_start = 0;
+  guint32 rip_size;
+  guint n_body_partitions = 0, i;
+  gint fd;
+
+  fd = g_file_open_tmp ("mxfmux-XXXXXX.mxf", &location, NULL);
+  fail_unless (fd != -1);
+  close (fd);
+
+  pipeline = g_strdup_printf ("videotestsrc num-buffers=250 ! "
+      "video/x-raw,format=(string)v308,width=64,height=48,framerate=25/1 ! "
+      "mxfmux name=mux body-partition-interval=1000000000 ! "
+      "filesink location=%s  "
+      "audiotestsrc num-buffers=250 ! "
+      "audioconvert ! " "audio/x-raw,rate=48000,channels=2 ! " "mux. ",
+      location);
+
+  run_test (pipeline);
+  g_free (pipeline);
+
+  fail_unless (g_file_get_contents (location, &contents, &size, NULL));
+  g_unlink (location);
+  g_free (location);
+  data = (const guint8 *) contents;
+
+  partitions = g_array_new (FALSE, FALSE, sizeof (guint64));
+  ranges = g_array_new (FALSE, FALSE, sizeof (IndexRange));
+
+  offset = 0;
+  while (offset < size) {
+    guint64 packet_offset = offset;
+
+    fail_unless (next_klv (data, size, &offset, &key, &value, &value_size));
+
+    if (KEY_IS_PARTITION_PACK (key)) {
+      g_array_append_val (partitions, packet_offset);
+      if (KEY_IS_BODY_PARTITION_PACK (key))
+        n_body_partitions++;
+    } else if (KEY_IS_INDEX_TABLE_SEGMENT (key)) {
+      check_index_table_segment (value, value_size, ranges);
+    } else if (KEY_IS_RANDOM_INDEX_PACK (key)) {
+      /* the RIP is the last packet */
+      fail_unless_equals_int (offset, size);
+    }
+  }
+
+  /* a body partition was started about every second */
+  fail_unless (n_body_partitions >= 9);
+
+  /* the index table segments cover all edit units exactly once */
+  g_array_sort (ranges, compare_index_range);
+  for (i = 0; i < ranges->len; i++) {
+    IndexRange *range = &g_array_index (ranges, IndexRange, i);
+
+    fail_unless_equals_uint64 (range->start, next_start);
+    next_start += range->duration;
+  }
+  fail_unless_equals_uint64 (next_start, 250);
+
+  /* the RIP lists every partition */
+  fail_unless (size > 4);
+  rip_size = GST_READ_UINT32_BE (data + size - 4);
+  fail_unless (rip_size <= size);
+  offset = size - rip_size;
+  fail_unless (next_klv (data, size, &offset, &key, &value, &value_size));
+  fail_unless (KEY_IS_RANDOM_INDEX_PACK (key));
+  fail_unless_equals_int (value_size, partitions->len * 12 + 4);
+  for (i = 0; i < partitions->len; i++) {
+    fail_unless_equals_uint64 (GST_READ_UINT64_BE (value + i * 12 + 4),
+        g_array_index (partitions, guint64, i));
+  }
+
+  g_array_free (ranges, TRUE);
+  g_array_free (partitions, TRUE);
+  g_free (contents);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_raw_video_stride_transform)
 {
   gchar *pipeline;
@@ -255,6 +482,7 @@ mxfmux_suite (void)
 
   tcase_add_test (tc_chain, test_mpeg2);
   tcase_add_test (tc_chain, test_raw_video_raw_audio);
+  tcase_add_test (tc_chain, test_raw_video_raw_audio_body_partitions);
   tcase_add_test (tc_chain, test_raw_video_stride_transform);
   tcase_add_test (tc_chain, test_jpeg2000_alaw);
   tcase_add_test (tc_chain, test_dnxhd_mp3);
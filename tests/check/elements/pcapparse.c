@@ -1,3 +1,6 @@
+#include <unistd.h>
+
+#include <glib/gstdio.h>
 #include "parser.h"
 #include <gst/check/gstcheck.h>
 
@@ -27,6 +30,28 @@ static guint8 pcap_frame_with_eth_padding[] = {
   0x00, 0xa0, 0x00, 0x00
 };
 
+/* little endian section header and ethernet interface description blocks */
+static guint8 pcapng_header[] = {
+  0x0a, 0x0d, 0x0d, 0x0a, 0x1c, 0x00, 0x00, 0x00, 0x4d, 0x3c, 0x2b, 0x1a,
+  0x01, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0x1c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0xff, 0xff, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00
+};
+
+/* the same packet as above in an enhanced packet block */
+static const guint pcapng_frame_offset = 28 + 14 + 20 + 8;
+static guint8 pcapng_frame[] = {
+  0x06, 0x00, 0x00, 0x00, 0x5c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x05, 0x2b, 0x05, 0x00, 0x70, 0x57, 0x89, 0x32, 0x3c, 0x00, 0x00, 0x00,
+  0x3c, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x29, 0xa6, 0x13, 0x41, 0x00, 0x0c,
+  0x29, 0xb2, 0x93, 0x7d, 0x08, 0x00, 0x45, 0x00, 0x00, 0x2c, 0x00, 0x00,
+  0x40, 0x00, 0x32, 0x11, 0x25, 0xb9, 0x52, 0xc5, 0x4d, 0xd6, 0xb9, 0x23,
+  0xc9, 0x49, 0x44, 0x66, 0x9f, 0xf2, 0x00, 0x18, 0x75, 0xe8, 0x80, 0xe3,
+  0x7c, 0xca, 0x79, 0xba, 0x09, 0xc0, 0x70, 0x6e, 0x8b, 0x33, 0x05, 0x0a,
+  0x00, 0xa0, 0x00, 0x00, 0x5c, 0x00, 0x00, 0x00
+};
+
 static gboolean
 verify_buffer (buffer_verify_data_s * vdata, GstBuffer * buffer)
 {
@@ -37,6 +62,9 @@ verify_buffer (buffer_verify_data_s * vdata, GstBuffer * buffer)
     offset = pcap_frame_with_eth_padding_offset;
     size = sizeof (pcap_frame_with_eth_padding) -
       pcap_frame_with_eth_padding_offset - 2;
+  } else if (vdata->data_to_verify == pcapng_frame) {
+    offset = pcapng_frame_offset;
+    size = sizeof (pcapng_frame) - pcapng_frame_offset - 4 - 2;
   }
 
   fail_unless_equals_int (gst_buffer_get_size (buffer), size);
@@ -69,6 +97,228 @@ GST_START_TEST (test_parse_frames_with_eth_padding)
 }
 GST_END_TEST;
 
+GST_START_TEST (test_parse_pcapng_frames)
+{
+  ctx_headers[0].data = pcapng_header;
+  ctx_headers[0].size = sizeof (pcapng_header);
+
+  gst_parser_test_split (pcapng_frame, sizeof (pcapng_frame));
+
+  ctx_headers[0].data = pcap_header;
+  ctx_headers[0].size = sizeof (pcap_header);
+}
+
+GST_END_TEST;
+
+#define N_FLOWS 2
+
+static GList *flow_buffers[N_FLOWS];
+static GList *flow_sinkpads;
+static gboolean have_no_more_pads;
+
+static GstFlowReturn
+flow_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  guint flow = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad), "flow"));
+
+  flow_buffers[flow] = g_list_append (flow_buffers[flow], buffer);
+
+  return GST_FLOW_OK;
+}
+
+static void
+pad_added_cb (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  GstPad *sinkpad;
+  guint flow;
+
+  fail_unless (sscanf (GST_PAD_NAME (pad), "src_%u", &flow) == 1);
+  fail_unless (flow < N_FLOWS);
+
+  sinkpad = gst_pad_new_from_static_template (&sinktemplate_rtp, "sink");
+  g_object_set_data (G_OBJECT (sinkpad), "flow", GUINT_TO_POINTER (flow));
+  gst_pad_set_chain_function (sinkpad, flow_chain);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  flow_sinkpads = g_list_append (flow_sinkpads, sinkpad);
+}
+
+static void
+no_more_pads_cb (GstElement * element, gpointer user_data)
+{
+  have_no_more_pads = TRUE;
+}
+
+static void
+check_flow_buffer (GstBuffer * buffer, const guint8 * frame)
+{
+  guint size = sizeof (pcap_frame_with_eth_padding) -
+      pcap_frame_with_eth_padding_offset - 2;
+
+  fail_unless_equals_int (gst_buffer_get_size (buffer), size);
+  fail_unless (gst_buffer_memcmp (buffer, 0,
+          frame + pcap_frame_with_eth_padding_offset, size) == 0);
+}
+
+GST_START_TEST (test_parse_split_flows)
+{
+  GstElement *element;
+  GstPad *srcpad;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  guint8 other_frame[sizeof (pcap_frame_with_eth_padding)];
+  guint8 *data;
+  gsize size;
+  gint i;
+
+  /* the same packet to another UDP destination port */
+  memcpy (other_frame, pcap_frame_with_eth_padding, sizeof (other_frame));
+  other_frame[16 + 14 + 20 + 3] ^= 0x01;
+  other_frame[pcap_frame_with_eth_padding_offset + 3] ^= 0xff;
+
+  caps = gst_caps_from_string ("application/x-rtp");
+  element = gst_check_setup_element ("pcapparse");
+  g_object_set (element, "caps", caps, "split-flows", TRUE, NULL);
+  gst_caps_unref (caps);
+  g_signal_connect (element, "pad-added", G_CALLBACK (pad_added_cb), NULL);
+  g_signal_connect (element, "no-more-pads", G_CALLBACK (no_more_pads_cb),
+      NULL);
+
+  srcpad = gst_check_setup_src_pad (element, &srctemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (element, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+  caps = gst_caps_from_string ("raw/x-pcap");
+  gst_check_setup_events (srcpad, element, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  /* the first flow, the second one and the first one again */
+  size = sizeof (pcap_header) + 3 * sizeof (other_frame);
+  data = g_malloc (size);
+  memcpy (data, pcap_header, sizeof (pcap_header));
+  memcpy (data + sizeof (pcap_header), pcap_frame_with_eth_padding,
+      sizeof (other_frame));
+  memcpy (data + sizeof (pcap_header) + sizeof (other_frame), other_frame,
+      sizeof (other_frame));
+  memcpy (data + sizeof (pcap_header) + 2 * sizeof (other_frame),
+      pcap_frame_with_eth_padding, sizeof (other_frame));
+  buffer = gst_buffer_new_wrapped (data, size);
+
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (g_list_length (flow_sinkpads), N_FLOWS);
+  fail_unless (have_no_more_pads);
+
+  fail_unless_equals_int (g_list_length (flow_buffers[0]), 2);
+  check_flow_buffer (flow_buffers[0]->data, pcap_frame_with_eth_padding);
+  check_flow_buffer (flow_buffers[0]->next->data,
+      pcap_frame_with_eth_padding);
+  fail_unless_equals_int (g_list_length (flow_buffers[1]), 1);
+  check_flow_buffer (flow_buffers[1]->data, other_frame);
+
+  fail_unless_equals_int (gst_element_set_state (element, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < N_FLOWS; i++) {
+    g_list_free_full (flow_buffers[i], (GDestroyNotify) gst_buffer_unref);
+    flow_buffers[i] = NULL;
+  }
+  g_list_free_full (flow_sinkpads, gst_object_unref);
+  flow_sinkpads = NULL;
+  have_no_more_pads = FALSE;
+
+  gst_pad_set_active (srcpad, FALSE);
+  gst_check_teardown_src_pad (element);
+  gst_check_teardown_element (element);
+}
+
+GST_END_TEST;
+
+#define N_PACKETS 10
+
+/* writes a pcap file with a packet every second, the RTP sequence number
+ * of each packet is its index */
+static gchar *
+create_pcap_file (void)
+{
+  GError *err = NULL;
+  gchar *filename;
+  FILE *f;
+  guint8 frame[sizeof (pcap_frame_with_eth_padding)];
+  guint32 ts_sec;
+  gint fd, i;
+
+  fd = g_file_open_tmp ("pcapparse-XXXXXX.pcap", &filename, &err);
+  fail_unless (fd >= 0, "Failed to create temporary file: %s",
+      err ? err->message : "");
+  f = fdopen (fd, "wb");
+  fail_unless (f != NULL);
+
+  fail_unless_equals_int (fwrite (pcap_header, 1, sizeof (pcap_header), f),
+      sizeof (pcap_header));
+  memcpy (frame, pcap_frame_with_eth_padding, sizeof (frame));
+  ts_sec = GST_READ_UINT32_LE (frame);
+  for (i = 0; i < N_PACKETS; i++) {
+    GST_WRITE_UINT32_LE (frame, ts_sec + i);
+    GST_WRITE_UINT16_BE (frame + pcap_frame_with_eth_padding_offset + 2, i);
+    fail_unless_equals_int (fwrite (frame, 1, sizeof (frame), f),
+        sizeof (frame));
+  }
+  fclose (f);
+
+  return filename;
+}
+
+GST_START_TEST (test_parse_pull_seek)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GstBuffer *buf;
+  guint8 seqnum[2];
+  gchar *filename, *desc;
+  gint i;
+
+  filename = create_pcap_file ();
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! pcapparse ts-offset=0 "
+      "caps=application/x-rtp ! fakesink name=sink sync=false", filename);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* backwards, so that the index has to be used and not just built */
+  for (i = N_PACKETS - 1; i >= 0; i--) {
+    fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH, i * GST_SECOND));
+    fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+            GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+    g_object_get (sink, "last-sample", &sample, NULL);
+    fail_unless (sample != NULL);
+    buf = gst_sample_get_buffer (sample);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), i * GST_SECOND);
+    fail_unless (gst_buffer_extract (buf, 2, seqnum, 2) == 2);
+    fail_unless_equals_int (GST_READ_UINT16_BE (seqnum), i);
+    gst_sample_unref (sample);
+  }
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 pcapparse_suite (void)
 {
@@ -86,6 +336,9 @@ pcapparse_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_parse_frames_with_eth_padding);
+  tcase_add_test (tc_chain, test_parse_pcapng_frames);
+  tcase_add_test (tc_chain, test_parse_split_flows);
+  tcase_add_test (tc_chain, test_parse_pull_seek);
 
   return s;
 }
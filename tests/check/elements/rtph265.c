@@ -0,0 +1,433 @@
+/* GStreamer
+ *
+ * unit tests for the RTP H.265 payloader and depayloader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+/* VPS, SPS, PPS and an IDR slice, only the NAL headers matter here */
+static const guint8 h265_vps[] = { 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff };
+static const guint8 h265_sps[] = { 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x80 };
+static const guint8 h265_pps[] = { 0x44, 0x01, 0xc1, 0x72, 0xb4 };
+static const guint8 h265_idr[] = {
+  0x26, 0x01, 0xaf, 0x06, 0xb8, 0x63, 0xef, 0x3a, 0x7f, 0x3e, 0x53, 0xff
+};
+
+static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+
+#define N_NALS 4
+
+static const guint8 *nals[N_NALS] = { h265_vps, h265_sps, h265_pps, h265_idr };
+
+static const gsize nal_sizes[N_NALS] = {
+  sizeof (h265_vps), sizeof (h265_sps), sizeof (h265_pps), sizeof (h265_idr)
+};
+
+static GstBuffer *
+create_access_unit (void)
+{
+  GstBuffer *buf;
+  gsize size = 0, offset = 0;
+  gint i;
+
+  for (i = 0; i < N_NALS; i++)
+    size += sizeof (start_code) + nal_sizes[i];
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  for (i = 0; i < N_NALS; i++) {
+    gst_buffer_fill (buf, offset, start_code, sizeof (start_code));
+    offset += sizeof (start_code);
+    gst_buffer_fill (buf, offset, nals[i], nal_sizes[i]);
+    offset += nal_sizes[i];
+  }
+  GST_BUFFER_PTS (buf) = 0;
+
+  return buf;
+}
+
+static GstHarness *
+create_payloader (gint aggregate_mode)
+{
+  GstHarness *h = gst_harness_new ("rtph265pay");
+
+  g_object_set (h->element, "aggregate-mode", aggregate_mode, NULL);
+  gst_harness_set_src_caps_str (h,
+      "video/x-h265,stream-format=byte-stream,alignment=au");
+
+  return h;
+}
+
+/* checks that the payload of @buf is an AP with the NALs from @first on */
+static void
+check_aggregation_packet (GstBuffer * buf, gint first, gint n_nals)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 *payload;
+  guint payload_len, offset;
+  gint i;
+
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  payload_len = gst_rtp_buffer_get_payload_len (&rtp);
+
+  /* PayloadHdr: type 48, LayerId 0, TID 1 */
+  fail_unless_equals_int ((payload[0] >> 1) & 0x3f, 48);
+  fail_unless_equals_int (payload[0] & 0x81, 0);
+  fail_unless_equals_int (payload[1], 0x01);
+
+  offset = 2;
+  for (i = first; i < first + n_nals; i++) {
+    fail_unless (offset + 2 <= payload_len);
+    fail_unless_equals_int (GST_READ_UINT16_BE (payload + offset),
+        nal_sizes[i]);
+    offset += 2;
+    fail_unless (offset + nal_sizes[i] <= payload_len);
+    fail_unless (memcmp (payload + offset, nals[i], nal_sizes[i]) == 0);
+    offset += nal_sizes[i];
+  }
+  fail_unless_equals_int (offset, payload_len);
+
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+GST_START_TEST (test_rtph265pay_aggregate_none)
+{
+  GstHarness *h = create_payloader (0);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+  gint i;
+
+  fail_unless_equals_int (gst_harness_push (h, create_access_unit ()),
+      GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  /* one single NAL unit packet per NAL */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), N_NALS);
+  for (i = 0; i < N_NALS; i++) {
+    buf = gst_harness_pull (h);
+    fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+    fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+        nal_sizes[i]);
+    fail_unless (memcmp (gst_rtp_buffer_get_payload (&rtp), nals[i],
+            nal_sizes[i]) == 0);
+    gst_rtp_buffer_unmap (&rtp);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph265pay_aggregate_max)
+{
+  GstHarness *h = create_payloader (2);
+  GstBuffer *buf;
+
+  fail_unless_equals_int (gst_harness_push (h, create_access_unit ()),
+      GST_FLOW_OK);
+  /* the last NAL is only known to be complete on EOS */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 0);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  /* the whole access unit fits in one AP */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+  buf = gst_harness_pull (h);
+  check_aggregation_packet (buf, 0, N_NALS);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph265pay_aggregate_zero_latency)
+{
+  GstHarness *h = create_payloader (1);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+
+  /* the parameter sets are sent as soon as the buffer was handled */
+  fail_unless_equals_int (gst_harness_push (h, create_access_unit ()),
+      GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+  buf = gst_harness_pull (h);
+  check_aggregation_packet (buf, 0, N_NALS - 1);
+  gst_buffer_unref (buf);
+
+  /* a lone NAL is sent as a single NAL unit packet */
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+  buf = gst_harness_pull (h);
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+      sizeof (h265_idr));
+  gst_rtp_buffer_unmap (&rtp);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph265pay_aggregate_mtu)
+{
+  GstHarness *h = create_payloader (2);
+  GstBuffer *buf;
+
+  /* room for the RTP header, PayloadHdr, PPS and IDR slice, which is too
+   * small for the three parameter sets */
+  g_object_set (h->element, "mtu",
+      gst_rtp_buffer_calc_packet_len (2 + 2 + sizeof (h265_pps) + 2 +
+          sizeof (h265_idr), 0, 0), NULL);
+
+  fail_unless_equals_int (gst_harness_push (h, create_access_unit ()),
+      GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 2);
+  buf = gst_harness_pull (h);
+  check_aggregation_packet (buf, 0, 2);
+  gst_buffer_unref (buf);
+  buf = gst_harness_pull (h);
+  check_aggregation_packet (buf, 2, 2);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+create_aggregation_packet (gboolean marker)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+  guint8 *payload;
+  guint payload_len = 2;
+  gint i;
+
+  for (i = 0; i < N_NALS; i++)
+    payload_len += 2 + nal_sizes[i];
+
+  buf = gst_rtp_buffer_new_allocate (payload_len, 0, 0);
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp));
+  gst_rtp_buffer_set_payload_type (&rtp, 96);
+  gst_rtp_buffer_set_marker (&rtp, marker);
+  payload = gst_rtp_buffer_get_payload (&rtp);
+
+  payload[0] = 48 << 1;
+  payload[1] = 0x01;
+  payload += 2;
+  for (i = 0; i < N_NALS; i++) {
+    GST_WRITE_UINT16_BE (payload, nal_sizes[i]);
+    memcpy (payload + 2, nals[i], nal_sizes[i]);
+    payload += 2 + nal_sizes[i];
+  }
+  gst_rtp_buffer_unmap (&rtp);
+
+  GST_BUFFER_PTS (buf) = 0;
+
+  return buf;
+}
+
+static void
+check_nal (GstBuffer * buf, gint i)
+{
+  GstMapInfo map;
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, sizeof (start_code) + nal_sizes[i]);
+  fail_unless (memcmp (map.data, start_code, sizeof (start_code)) == 0);
+  fail_unless (memcmp (map.data + sizeof (start_code), nals[i],
+          nal_sizes[i]) == 0);
+  gst_buffer_unmap (buf, &map);
+}
+
+GST_START_TEST (test_rtph265depay_aggregation_packet)
+{
+  GstHarness *h = gst_harness_new ("rtph265depay");
+  GstBuffer *buf;
+  gint i;
+
+  gst_harness_set_src_caps_str (h, "application/x-rtp,media=video,"
+      "clock-rate=90000,encoding-name=H265,payload=96");
+  gst_harness_set_sink_caps_str (h,
+      "video/x-h265,stream-format=byte-stream,alignment=nal");
+
+  fail_unless_equals_int (gst_harness_push (h,
+          create_aggregation_packet (TRUE)), GST_FLOW_OK);
+
+  /* every aggregated NAL comes out on its own */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), N_NALS);
+  for (i = 0; i < N_NALS; i++) {
+    buf = gst_harness_pull (h);
+    check_nal (buf, i);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph265depay_aggregation_packet_au)
+{
+  GstHarness *h = gst_harness_new ("rtph265depay");
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize offset = 0;
+  gint i;
+
+  gst_harness_set_src_caps_str (h, "application/x-rtp,media=video,"
+      "clock-rate=90000,encoding-name=H265,payload=96");
+  gst_harness_set_sink_caps_str (h,
+      "video/x-h265,stream-format=byte-stream,alignment=au");
+
+  fail_unless_equals_int (gst_harness_push (h,
+          create_aggregation_packet (TRUE)), GST_FLOW_OK);
+
+  /* the marker completes the access unit with all the NALs */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+  buf = gst_harness_pull (h);
+  fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = 0; i < N_NALS; i++) {
+    fail_unless (offset + sizeof (start_code) + nal_sizes[i] <= map.size);
+    fail_unless (memcmp (map.data + offset, start_code,
+            sizeof (start_code)) == 0);
+    offset += sizeof (start_code);
+    fail_unless (memcmp (map.data + offset, nals[i], nal_sizes[i]) == 0);
+    offset += nal_sizes[i];
+  }
+  fail_unless_equals_int (offset, map.size);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph265_aggregate_roundtrip)
+{
+  GstHarness *pay = create_payloader (2);
+  GstHarness *depay = gst_harness_new ("rtph265depay");
+  GstBuffer *buf;
+  gint i;
+
+  gst_harness_set_sink_caps_str (depay,
+      "video/x-h265,stream-format=byte-stream,alignment=nal");
+
+  fail_unless_equals_int (gst_harness_push (pay, create_access_unit ()),
+      GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (pay, gst_event_new_eos ()));
+  fail_unless_equals_int (gst_harness_buffers_in_queue (pay), 1);
+
+  gst_harness_set_src_caps (depay, gst_pad_get_current_caps (pay->sinkpad));
+  fail_unless_equals_int (gst_harness_push (depay, gst_harness_pull (pay)),
+      GST_FLOW_OK);
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (depay), N_NALS);
+  for (i = 0; i < N_NALS; i++) {
+    buf = gst_harness_pull (depay);
+    check_nal (buf, i);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (pay);
+  gst_harness_teardown (depay);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph265_fragmentation_roundtrip)
+{
+  GstHarness *pay = create_payloader (0);
+  GstHarness *depay = gst_harness_new ("rtph265depay");
+  GstBuffer *in, *buf;
+  GstMapInfo map;
+  guint8 *data;
+  guint i, n_packets;
+
+  gst_harness_set_sink_caps_str (depay,
+      "video/x-h265,stream-format=byte-stream,alignment=nal");
+  g_object_set (pay->element, "mtu", 200, NULL);
+
+  /* a slice much bigger than the MTU, without start code emulation */
+  in = gst_buffer_new_allocate (NULL, sizeof (start_code) + 1000, NULL);
+  fail_unless (gst_buffer_map (in, &map, GST_MAP_WRITE));
+  data = map.data;
+  memcpy (data, start_code, sizeof (start_code));
+  data[4] = 0x26;
+  data[5] = 0x01;
+  for (i = 6; i < map.size; i++)
+    data[i] = (i % 255) + 1;
+  gst_buffer_unmap (in, &map);
+  GST_BUFFER_PTS (in) = 0;
+
+  fail_unless_equals_int (gst_harness_push (pay, gst_buffer_ref (in)),
+      GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (pay, gst_event_new_eos ()));
+  n_packets = gst_harness_buffers_in_queue (pay);
+  fail_unless (n_packets > 1);
+
+  gst_harness_set_src_caps (depay, gst_pad_get_current_caps (pay->sinkpad));
+  for (i = 0; i < n_packets; i++)
+    fail_unless_equals_int (gst_harness_push (depay, gst_harness_pull (pay)),
+        GST_FLOW_OK);
+
+  /* the NAL is rebuilt from the fragments without copying them */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (depay), 1);
+  buf = gst_harness_pull (depay);
+  fail_unless (gst_buffer_n_memory (buf) > 1);
+  fail_unless_equals_int (gst_buffer_get_size (buf), gst_buffer_get_size (in));
+  fail_unless (gst_buffer_map (in, &map, GST_MAP_READ));
+  fail_unless (gst_buffer_memcmp (buf, 0, map.data, map.size) == 0);
+  gst_buffer_unmap (in, &map);
+  gst_buffer_unref (buf);
+  gst_buffer_unref (in);
+
+  gst_harness_teardown (pay);
+  gst_harness_teardown (depay);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtph265_suite (void)
+{
+  Suite *s = suite_create ("rtph265");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_rtph265pay_aggregate_none);
+  tcase_add_test (tc_chain, test_rtph265pay_aggregate_max);
+  tcase_add_test (tc_chain, test_rtph265pay_aggregate_zero_latency);
+  tcase_add_test (tc_chain, test_rtph265pay_aggregate_mtu);
+  tcase_add_test (tc_chain, test_rtph265depay_aggregation_packet);
+  tcase_add_test (tc_chain, test_rtph265depay_aggregation_packet_au);
+  tcase_add_test (tc_chain, test_rtph265_aggregate_roundtrip);
+  tcase_add_test (tc_chain, test_rtph265_fragmentation_roundtrip);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtph265);
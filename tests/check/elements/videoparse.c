@@ -0,0 +1,428 @@
+/* GStreamer
+ *
+ * unit tests for videoparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define WIDTH 4
+#define HEIGHT 2
+
+/* frames pulled in 4 MB chunks: 4 MB is not a multiple of the frame size,
+ * so the second chunk starts at frame 1398 */
+#define PULL_WIDTH 1000
+#define PULL_HEIGHT 3
+#define PULL_FRAME_SIZE (PULL_WIDTH * PULL_HEIGHT)
+#define PULL_N_FRAMES 1500
+#define PULL_CHUNK_SIZE (4 * 1024 * 1024 - (4 * 1024 * 1024) % PULL_FRAME_SIZE)
+
+#define SEEK_N_FRAMES 20
+#define FPS_N 30000
+#define FPS_D 1001
+
+/* a 4x2 GRAY8 frame with rows padded to 8 bytes */
+static const guint8 padded_frame[] = {
+  0, 1, 2, 3, 0xff, 0xff, 0xff, 0xff,
+  4, 5, 6, 7, 0xff, 0xff, 0xff, 0xff
+};
+
+static const guint8 packed_frame[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+static GstHarness *
+create_videoparse (const gchar * strides, guint framesize)
+{
+  GstHarness *h = gst_harness_new ("videoparse");
+
+  g_object_set (h->element, "format", GST_VIDEO_FORMAT_GRAY8,
+      "width", WIDTH, "height", HEIGHT, "strides", strides,
+      "framesize", framesize, NULL);
+  gst_harness_set_src_caps_str (h, "application/octet-stream");
+
+  return h;
+}
+
+static GstBuffer *
+create_buffer (const guint8 * data, gsize size)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+  gst_buffer_fill (buf, 0, data, size);
+
+  return buf;
+}
+
+/* pushes @data split in two buffers, so the frame spans both */
+static void
+push_split (GstHarness * h, const guint8 * data, gsize size)
+{
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (data,
+              size / 2)), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (data + size / 2,
+              size - size / 2)), GST_FLOW_OK);
+}
+
+/* maps @buf as a 4x2 GRAY8 frame and checks its pixels */
+static void
+check_frame (GstBuffer * buf)
+{
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  guint8 *data;
+  gint x, y;
+
+  gst_video_info_init (&info);
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_GRAY8, WIDTH, HEIGHT);
+  fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_READ));
+
+  data = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++)
+      fail_unless_equals_int (data[x], y * WIDTH + x);
+    data += GST_VIDEO_FRAME_PLANE_STRIDE (&frame, 0);
+  }
+
+  gst_video_frame_unmap (&frame);
+}
+
+/* writes @n_frames frames of @frame_size bytes to a temporary file, each
+ * frame is filled with its frame number */
+static gchar *
+create_raw_file (gsize frame_size, gint n_frames)
+{
+  GError *err = NULL;
+  gchar *filename;
+  guint8 *frame;
+  FILE *f;
+  gint fd, i;
+
+  fd = g_file_open_tmp ("videoparse-XXXXXX.raw", &filename, &err);
+  fail_unless (fd >= 0, "Failed to create temporary file: %s",
+      err ? err->message : "");
+  f = fdopen (fd, "wb");
+  fail_unless (f != NULL);
+
+  frame = g_malloc (frame_size);
+  for (i = 0; i < n_frames; i++) {
+    memset (frame, i & 0xff, frame_size);
+    fail_unless_equals_int (fwrite (frame, 1, frame_size, f), frame_size);
+  }
+  g_free (frame);
+  fclose (f);
+
+  return filename;
+}
+
+static GstElement *
+create_pipeline (const gchar * filename, const gchar * caps_props)
+{
+  GstElement *pipeline;
+  gchar *desc;
+
+  desc = g_strdup_printf ("filesrc name=src location=\"%s\" ! videoparse "
+      "format=gray8 %s ! fakesink name=sink sync=false", filename, caps_props);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  return pipeline;
+}
+
+GST_START_TEST (test_videoparse_default_layout)
+{
+  GstHarness *h = create_videoparse (NULL, 0);
+  GstBuffer *buf;
+  guint8 data[2 * sizeof (packed_frame)];
+  gint i;
+
+  memcpy (data, packed_frame, sizeof (packed_frame));
+  memcpy (data + sizeof (packed_frame), packed_frame, sizeof (packed_frame));
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (data,
+              sizeof (data))), GST_FLOW_OK);
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 2);
+  for (i = 0; i < 2; i++) {
+    buf = gst_harness_pull (h);
+    fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (packed_frame));
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), i * GST_SECOND / 25);
+    fail_unless (gst_buffer_get_video_meta (buf) == NULL);
+    check_frame (buf);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_videoparse_strides_videometa)
+{
+  GstHarness *h = create_videoparse ("8", 0);
+  GstVideoMeta *meta;
+  GstBuffer *buf;
+
+  gst_harness_add_propose_allocation_meta (h, GST_VIDEO_META_API_TYPE, NULL);
+  push_split (h, padded_frame, sizeof (padded_frame));
+
+  /* the padded frame is pushed as it is, described by the meta */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (padded_frame));
+  meta = gst_buffer_get_video_meta (buf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->width, WIDTH);
+  fail_unless_equals_int (meta->height, HEIGHT);
+  fail_unless_equals_int (meta->stride[0], 8);
+  fail_unless_equals_int (meta->offset[0], 0);
+  check_frame (buf);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_videoparse_strides_copy)
+{
+  GstHarness *h = create_videoparse ("8", 0);
+  GstBuffer *buf;
+
+  push_split (h, padded_frame, sizeof (padded_frame));
+
+  /* downstream doesn't support the meta, the frame is copied */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (packed_frame));
+  fail_unless (gst_buffer_get_video_meta (buf) == NULL);
+  fail_unless (gst_buffer_memcmp (buf, 0, packed_frame,
+          sizeof (packed_frame)) == 0);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_videoparse_framesize)
+{
+  GstHarness *h = create_videoparse (NULL, sizeof (padded_frame));
+  GstBuffer *buf;
+  guint8 data[sizeof (padded_frame)];
+
+  /* a packed frame followed by padding */
+  memset (data, 0xff, sizeof (data));
+  memcpy (data, packed_frame, sizeof (packed_frame));
+  push_split (h, data, sizeof (data));
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (data));
+  fail_unless (gst_buffer_get_video_meta (buf) == NULL);
+  check_frame (buf);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+pull_probe (GstPad * pad, GstPadProbeInfo * info, GArray * pulls)
+{
+  guint64 pull[2];
+
+  pull[0] = info->offset;
+  pull[1] = gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info));
+  g_array_append_vals (pulls, pull, 2);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pull_handoff (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    guint64 * n_frames)
+{
+  guint64 n = *n_frames;
+  guint8 byte;
+
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), n);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET_END (buf), n + 1);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf),
+      gst_util_uint64_scale (n, GST_SECOND, 25));
+  fail_unless_equals_int (gst_buffer_get_size (buf), PULL_FRAME_SIZE);
+
+  /* the frame is carved from the right place of the chunk */
+  fail_unless (gst_buffer_extract (buf, 0, &byte, 1) == 1);
+  fail_unless_equals_int (byte, n & 0xff);
+  fail_unless (gst_buffer_extract (buf, PULL_FRAME_SIZE - 1, &byte, 1) == 1);
+  fail_unless_equals_int (byte, n & 0xff);
+
+  *n_frames = n + 1;
+}
+
+GST_START_TEST (test_videoparse_pull_chunks)
+{
+  GstElement *pipeline, *src, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  GstPad *pad;
+  GArray *pulls;
+  guint64 n_frames = 0;
+  gchar *filename, *caps_props;
+
+  filename = create_raw_file (PULL_FRAME_SIZE, PULL_N_FRAMES);
+  caps_props = g_strdup_printf ("width=%d height=%d", PULL_WIDTH, PULL_HEIGHT);
+  pipeline = create_pipeline (filename, caps_props);
+  g_free (caps_props);
+
+  pulls = g_array_new (FALSE, FALSE, sizeof (guint64));
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_PULL | GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) pull_probe, pulls, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (src);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (pull_handoff), &n_frames);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless_equals_uint64 (n_frames, PULL_N_FRAMES);
+
+  /* upstream was asked for two chunks of whole frames, the second one
+   * limited by the file size */
+  fail_unless_equals_int (pulls->len, 4);
+  fail_unless_equals_uint64 (g_array_index (pulls, guint64, 0), 0);
+  fail_unless_equals_uint64 (g_array_index (pulls, guint64, 1),
+      PULL_CHUNK_SIZE);
+  fail_unless_equals_uint64 (g_array_index (pulls, guint64, 2),
+      PULL_CHUNK_SIZE);
+  fail_unless_equals_uint64 (g_array_index (pulls, guint64, 3),
+      PULL_N_FRAMES * PULL_FRAME_SIZE - PULL_CHUNK_SIZE);
+
+  g_array_unref (pulls);
+  gst_object_unref (sink);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+static GstClockTime
+frame_timestamp (gint frame)
+{
+  return gst_util_uint64_scale (frame, GST_SECOND * FPS_D, FPS_N);
+}
+
+static void
+check_seek (GstElement * pipeline, GstElement * sink, GstClockTime position,
+    gint frame)
+{
+  GstSample *sample;
+  GstBuffer *buf;
+  guint8 byte;
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, position));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  g_object_get (sink, "last-sample", &sample, NULL);
+  fail_unless (sample != NULL);
+  buf = gst_sample_get_buffer (sample);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), frame);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), frame_timestamp (frame));
+  fail_unless (gst_buffer_extract (buf, 0, &byte, 1) == 1);
+  fail_unless_equals_int (byte, frame);
+  gst_sample_unref (sample);
+}
+
+GST_START_TEST (test_videoparse_seek_frame_exact)
+{
+  GstElement *pipeline, *sink;
+  gchar *filename, *caps_props;
+  gint i;
+
+  filename = create_raw_file (WIDTH * HEIGHT, SEEK_N_FRAMES);
+  caps_props = g_strdup_printf ("width=%d height=%d framerate=%d/%d",
+      WIDTH, HEIGHT, FPS_N, FPS_D);
+  pipeline = create_pipeline (filename, caps_props);
+  g_free (caps_props);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* the frame timestamps are rounded down, seeking to one must output that
+   * frame and not the one before it. Seeking anywhere within a frame must
+   * output the frame displayed at that time */
+  for (i = SEEK_N_FRAMES - 1; i >= 0; i--) {
+    check_seek (pipeline, sink, frame_timestamp (i), i);
+    check_seek (pipeline, sink, frame_timestamp (i + 1) - 1, i);
+  }
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+static Suite *
+videoparse_suite (void)
+{
+  Suite *s = suite_create ("videoparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_videoparse_default_layout);
+  tcase_add_test (tc_chain, test_videoparse_strides_videometa);
+  tcase_add_test (tc_chain, test_videoparse_strides_copy);
+  tcase_add_test (tc_chain, test_videoparse_framesize);
+  tcase_add_test (tc_chain, test_videoparse_pull_chunks);
+  tcase_add_test (tc_chain, test_videoparse_seek_frame_exact);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videoparse);
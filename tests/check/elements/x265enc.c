@@ -149,6 +149,114 @@ GST_START_TEST (test_encode_simple)
 
 GST_END_TEST;
 
+static GList *rendition_buffers = NULL;
+
+static GstFlowReturn
+rendition_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  rendition_buffers = g_list_append (rendition_buffers, buffer);
+
+  return GST_FLOW_OK;
+}
+
+/* The renditions are only available with x265 builds that can pass the
+ * analysis in memory, the property and the pad template come together */
+GST_START_TEST (test_encode_renditions)
+{
+  GstElement *x265enc;
+  GstPad *rendition_srcpad, *rendition_sinkpad;
+  GstPadTemplate *templ;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GstSegment seg;
+  gint i;
+
+  x265enc = gst_check_setup_element ("x265enc");
+  templ = gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (x265enc),
+      "src_%u");
+
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (x265enc),
+          "renditions")) {
+    fail_unless (templ == NULL);
+    gst_check_teardown_element (x265enc);
+    return;
+  }
+  fail_unless (templ != NULL);
+
+  g_object_set (x265enc, "bitrate", 1000, "renditions", "500", NULL);
+
+  srcpad = gst_check_setup_src_pad (x265enc, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (x265enc, &sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  rendition_srcpad = gst_element_get_request_pad (x265enc, "src_%u");
+  fail_unless (rendition_srcpad != NULL);
+  fail_unless_equals_string (GST_PAD_NAME (rendition_srcpad), "src_1");
+  rendition_sinkpad = gst_pad_new_from_static_template (&sinktemplate,
+      "sink");
+  gst_pad_set_chain_function (rendition_sinkpad, rendition_chain);
+  gst_pad_set_active (rendition_sinkpad, TRUE);
+  fail_unless_equals_int (gst_pad_link (rendition_srcpad, rendition_sinkpad),
+      GST_PAD_LINK_OK);
+
+  fail_unless (gst_element_set_state (x265enc,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set to playing");
+
+  caps = gst_caps_from_string ("video/x-raw,format=(string)I420,"
+      "width=(int)320,height=(int)240,framerate=(fraction)25/1");
+  gst_check_setup_events (srcpad, x265enc, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&seg, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&seg)));
+
+  buffer = gst_buffer_new_allocate (NULL, 320 * 240 + 2 * 160 * 120, NULL);
+  gst_buffer_memset (buffer, 0, 0, -1);
+
+  for (i = 0; i < 10; i++) {
+    GST_BUFFER_TIMESTAMP (buffer) = gst_util_uint64_scale (i, GST_SECOND, 25);
+    GST_BUFFER_DURATION (buffer) = gst_util_uint64_scale (1, GST_SECOND, 25);
+    fail_unless (gst_pad_push (srcpad, gst_buffer_ref (buffer)) == GST_FLOW_OK);
+  }
+
+  gst_buffer_unref (buffer);
+
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  /* every frame is encoded by the main encoder and by the rendition, the
+   * rendition comes with its own headers and caps */
+  fail_unless_equals_int (g_list_length (buffers), 10);
+  fail_unless_equals_int (g_list_length (rendition_buffers), 10);
+  caps = gst_pad_get_current_caps (rendition_sinkpad);
+  fail_unless (caps != NULL);
+  fail_unless (gst_structure_has_name (gst_caps_get_structure (caps, 0),
+          "video/x-h265"));
+  gst_caps_unref (caps);
+
+  fail_unless (gst_element_set_state (x265enc,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+
+  g_list_free_full (rendition_buffers, (GDestroyNotify) gst_buffer_unref);
+  rendition_buffers = NULL;
+  gst_check_drop_buffers ();
+
+  gst_pad_unlink (rendition_srcpad, rendition_sinkpad);
+  gst_pad_set_active (rendition_sinkpad, FALSE);
+  gst_object_unref (rendition_sinkpad);
+  gst_element_release_request_pad (x265enc, rendition_srcpad);
+  gst_object_unref (rendition_srcpad);
+
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (x265enc);
+  gst_check_teardown_sink_pad (x265enc);
+  gst_check_teardown_element (x265enc);
+}
+
+GST_END_TEST;
+
 static Suite *
 x265enc_suite (void)
 {
@@ -158,6 +266,7 @@ x265enc_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, test_encode_simple);
+  tcase_add_test (tc_chain, test_encode_renditions);
 
   return s;
 }
@@ -0,0 +1,131 @@
+/* GStreamer
+ *
+ * unit test for y4mdec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+
+#define WIDTH 16
+#define HEIGHT 16
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+#define N_FRAMES 10
+#define FPS_N 30000
+#define FPS_D 1001
+
+/* writes a 4:2:0 stream to a temporary file, the luma of each frame is
+ * its frame number */
+static gchar *
+create_y4m_file (void)
+{
+  GError *err = NULL;
+  gchar *filename;
+  FILE *f;
+  guint8 frame[FRAME_SIZE];
+  gint fd, i;
+
+  fd = g_file_open_tmp ("y4mdec-XXXXXX.y4m", &filename, &err);
+  fail_unless (fd >= 0, "Failed to create temporary file: %s",
+      err ? err->message : "");
+  f = fdopen (fd, "wb");
+  fail_unless (f != NULL);
+
+  fprintf (f, "YUV4MPEG2 C420jpeg W%d H%d Ip F%d:%d A1:1\n", WIDTH, HEIGHT,
+      FPS_N, FPS_D);
+  for (i = 0; i < N_FRAMES; i++) {
+    memset (frame, i, WIDTH * HEIGHT);
+    memset (frame + WIDTH * HEIGHT, 128, FRAME_SIZE - WIDTH * HEIGHT);
+    fputs ("FRAME\n", f);
+    fail_unless_equals_int (fwrite (frame, 1, FRAME_SIZE, f), FRAME_SIZE);
+  }
+  fclose (f);
+
+  return filename;
+}
+
+static GstClockTime
+frame_timestamp (gint frame)
+{
+  return gst_util_uint64_scale (frame, GST_SECOND * FPS_D, FPS_N);
+}
+
+GST_START_TEST (test_y4mdec_seek_frame_exact)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GstBuffer *buf;
+  gchar *filename, *desc;
+  guint8 luma;
+  gint i;
+
+  filename = create_y4m_file ();
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! y4mdec ! "
+      "fakesink name=sink sync=false", filename);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* seeking to the (rounded down) timestamp of a frame must output that
+   * frame and not the one before it */
+  for (i = N_FRAMES - 1; i >= 0; i--) {
+    fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH, frame_timestamp (i)));
+    fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+            GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+    g_object_get (sink, "last-sample", &sample, NULL);
+    fail_unless (sample != NULL);
+    buf = gst_sample_get_buffer (sample);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), frame_timestamp (i));
+    fail_unless (gst_buffer_extract (buf, 0, &luma, 1) == 1);
+    fail_unless_equals_int (luma, i);
+    gst_sample_unref (sample);
+  }
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+static Suite *
+y4mdec_suite (void)
+{
+  Suite *s = suite_create ("y4mdec");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_y4mdec_seek_frame_exact);
+
+  return s;
+}
+
+GST_CHECK_MAIN (y4mdec);
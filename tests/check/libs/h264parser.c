@@ -144,6 +144,16 @@ static guint8 slice_eoseq_slice[] = {
   0x00, 0x00, 0x00, 0x01, 0x0b
 };
 
+/* start codes after long runs without zero bytes, and zero bytes that are
+ * not part of start codes */
+static guint8 sei_eoseq_eos[] = {
+  0x00, 0x00, 0x01, 0x06, 0x05, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x02, 0xff, 0x00,
+  0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0x00, 0x00, 0x01, 0x0a,
+  0x00, 0x00, 0x01, 0x0b
+};
+
 GST_START_TEST (test_h264_parse_slice_dpa)
 {
   GstH264ParserResult res;
@@ -211,6 +221,45 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+GST_START_TEST (test_h264_parse_start_codes)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  const guint8 *buf = sei_eoseq_eos;
+  guint n, buf_size = sizeof (sei_eoseq_eos);
+
+  res = gst_h264_parser_identify_nalu (parser, buf, 0, buf_size, &nalu);
+
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_SEI);
+  assert_equals_int (nalu.offset, 3);
+  assert_equals_int (nalu.size, 31);
+
+  n = nalu.offset + nalu.size;
+  buf += n;
+  buf_size -= n;
+
+  res = gst_h264_parser_identify_nalu (parser, buf, 0, buf_size, &nalu);
+
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_SEQ_END);
+  assert_equals_int (nalu.offset, 3);
+
+  n = nalu.offset + nalu.size;
+  buf += n;
+  buf_size -= n;
+
+  res = gst_h264_parser_identify_nalu (parser, buf, 0, buf_size, &nalu);
+
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_STREAM_END);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +270,7 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_parse_start_codes);
 
   return s;
 }
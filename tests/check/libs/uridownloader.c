@@ -0,0 +1,405 @@
+/* GStreamer
+ *
+ * unit test for GstUriDownloader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesrc.h>
+#include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gsturidownloader.h>
+
+/* Limits of the downloader */
+#define MAX_SOURCES 4
+#define CACHE_MAX_ENTRY_SIZE (256 * 1024)
+#define CACHE_MAX_SIZE (4 * 1024 * 1024)
+
+/* A source for testdl://host/name/size/cache-control URIs. It outputs size
+ * bytes set to the first character of name, preceded by a Cache-Control
+ * response header unless cache-control is "none" */
+typedef struct
+{
+  GstBaseSrc parent;
+
+  gchar *uri;
+  gboolean done;
+} TestDlSrc;
+
+typedef GstBaseSrcClass TestDlSrcClass;
+
+static void test_dl_src_uri_handler_init (gpointer g_iface,
+    gpointer iface_data);
+
+GType test_dl_src_get_type (void);
+G_DEFINE_TYPE_WITH_CODE (TestDlSrc, test_dl_src, GST_TYPE_BASE_SRC,
+    G_IMPLEMENT_INTERFACE (GST_TYPE_URI_HANDLER,
+        test_dl_src_uri_handler_init));
+
+/* Number of source elements created and of requests made so far */
+static guint sources_created = 0;
+static guint requests = 0;
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static gboolean
+test_dl_src_start (GstBaseSrc * src)
+{
+  ((TestDlSrc *) src)->done = FALSE;
+  requests++;
+
+  return TRUE;
+}
+
+static GstFlowReturn
+test_dl_src_create (GstBaseSrc * basesrc, guint64 offset, guint length,
+    GstBuffer ** buf)
+{
+  TestDlSrc *src = (TestDlSrc *) basesrc;
+  gchar *location;
+  gchar **parts;
+  gsize size;
+
+  if (src->done)
+    return GST_FLOW_EOS;
+  src->done = TRUE;
+
+  location = gst_uri_get_location (src->uri);
+  parts = g_strsplit (location, "/", -1);
+  g_free (location);
+  fail_unless_equals_int (g_strv_length (parts), 4);
+
+  if (!g_str_equal (parts[3], "none")) {
+    GstStructure *headers;
+
+    headers = gst_structure_new ("response-headers", "Cache-Control",
+        G_TYPE_STRING, parts[3], NULL);
+    gst_pad_push_event (GST_BASE_SRC_PAD (src),
+        gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM_STICKY,
+            gst_structure_new ("http-headers", "response-headers",
+                GST_TYPE_STRUCTURE, headers, NULL)));
+    gst_structure_free (headers);
+  }
+
+  size = g_ascii_strtoull (parts[2], NULL, 10);
+  *buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_memset (*buf, 0, parts[1][0], size);
+  g_strfreev (parts);
+
+  return GST_FLOW_OK;
+}
+
+static void
+test_dl_src_finalize (GObject * object)
+{
+  g_free (((TestDlSrc *) object)->uri);
+
+  G_OBJECT_CLASS (test_dl_src_parent_class)->finalize (object);
+}
+
+static void
+test_dl_src_class_init (TestDlSrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  gobject_class->finalize = test_dl_src_finalize;
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+
+  klass->start = test_dl_src_start;
+  klass->create = test_dl_src_create;
+}
+
+static void
+test_dl_src_init (TestDlSrc * src)
+{
+  sources_created++;
+}
+
+static GstURIType
+test_dl_src_uri_get_type (GType type)
+{
+  return GST_URI_SRC;
+}
+
+static const gchar *const *
+test_dl_src_uri_get_protocols (GType type)
+{
+  static const gchar *protocols[] = { "testdl", NULL };
+
+  return protocols;
+}
+
+static gchar *
+test_dl_src_uri_get_uri (GstURIHandler * handler)
+{
+  return g_strdup (((TestDlSrc *) handler)->uri);
+}
+
+static gboolean
+test_dl_src_uri_set_uri (GstURIHandler * handler, const gchar * uri,
+    GError ** error)
+{
+  TestDlSrc *src = (TestDlSrc *) handler;
+
+  g_free (src->uri);
+  src->uri = g_strdup (uri);
+
+  return TRUE;
+}
+
+static void
+test_dl_src_uri_handler_init (gpointer g_iface, gpointer iface_data)
+{
+  GstURIHandlerInterface *iface = (GstURIHandlerInterface *) g_iface;
+
+  iface->get_type = test_dl_src_uri_get_type;
+  iface->get_protocols = test_dl_src_uri_get_protocols;
+  iface->get_uri = test_dl_src_uri_get_uri;
+  iface->set_uri = test_dl_src_uri_set_uri;
+}
+
+static void
+setup (void)
+{
+  fail_unless (gst_element_register (NULL, "testdlsrc", GST_RANK_PRIMARY,
+          test_dl_src_get_type ()));
+  sources_created = 0;
+  requests = 0;
+}
+
+static void
+teardown (void)
+{
+}
+
+/* fetches @uri and checks that it contains @size bytes of @c */
+static void
+fetch (GstUriDownloader * downloader, const gchar * uri, gboolean refresh,
+    gboolean allow_cache, gchar c, gsize size)
+{
+  GstFragment *download;
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gsize i;
+
+  download = gst_uri_downloader_fetch_uri (downloader, uri, NULL, FALSE,
+      refresh, allow_cache, NULL);
+  fail_unless (download != NULL, "Failed to fetch %s", uri);
+
+  buffer = gst_fragment_get_buffer (download);
+  fail_unless (buffer != NULL);
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, size);
+  for (i = 0; i < map.size; i++)
+    fail_unless_equals_int (map.data[i], c);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  g_object_unref (download);
+}
+
+GST_START_TEST (test_source_pool)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+
+  /* one source per host */
+  fetch (downloader, "testdl://a/x/16/none", FALSE, TRUE, 'x', 16);
+  fetch (downloader, "testdl://a/y/16/none", FALSE, TRUE, 'y', 16);
+  fetch (downloader, "testdl://b/x/16/none", FALSE, TRUE, 'x', 16);
+  fetch (downloader, "testdl://a/z/16/none", FALSE, TRUE, 'z', 16);
+  fail_unless_equals_int (sources_created, 2);
+  fail_unless_equals_int (requests, 4);
+
+  /* the least recently used host, b, is dropped to make room for e */
+  fetch (downloader, "testdl://c/x/16/none", FALSE, TRUE, 'x', 16);
+  fetch (downloader, "testdl://d/x/16/none", FALSE, TRUE, 'x', 16);
+  fetch (downloader, "testdl://e/x/16/none", FALSE, TRUE, 'x', 16);
+  fail_unless_equals_int (sources_created, 2 + MAX_SOURCES - 1);
+
+  fetch (downloader, "testdl://a/x/16/none", FALSE, TRUE, 'x', 16);
+  fail_unless_equals_int (sources_created, 2 + MAX_SOURCES - 1);
+  fetch (downloader, "testdl://b/x/16/none", FALSE, TRUE, 'x', 16);
+  fail_unless_equals_int (sources_created, 2 + MAX_SOURCES);
+  fail_unless_equals_int (requests, 9);
+
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cache_control)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+
+  /* cached with a max-age */
+  fetch (downloader, "testdl://a/k/16/max-age=60", FALSE, TRUE, 'k', 16);
+  fetch (downloader, "testdl://a/k/16/max-age=60", FALSE, TRUE, 'k', 16);
+  fail_unless_equals_int (requests, 1);
+
+  /* but not for refreshing or uncached fetches */
+  fetch (downloader, "testdl://a/k/16/max-age=60", TRUE, TRUE, 'k', 16);
+  fail_unless_equals_int (requests, 2);
+  fetch (downloader, "testdl://a/k/16/max-age=60", FALSE, FALSE, 'k', 16);
+  fail_unless_equals_int (requests, 3);
+
+  /* not cached without a max-age or with no-store */
+  fetch (downloader, "testdl://a/p/16/none", FALSE, TRUE, 'p', 16);
+  fetch (downloader, "testdl://a/p/16/none", FALSE, TRUE, 'p', 16);
+  fail_unless_equals_int (requests, 5);
+  fetch (downloader, "testdl://a/q/16/no-store,max-age=60", FALSE, TRUE,
+      'q', 16);
+  fetch (downloader, "testdl://a/q/16/no-store,max-age=60", FALSE, TRUE,
+      'q', 16);
+  fail_unless_equals_int (requests, 7);
+
+  /* too big to be cached */
+  fetch (downloader, "testdl://a/b/524288/max-age=60", FALSE, TRUE, 'b',
+      2 * CACHE_MAX_ENTRY_SIZE);
+  fetch (downloader, "testdl://a/b/524288/max-age=60", FALSE, TRUE, 'b',
+      2 * CACHE_MAX_ENTRY_SIZE);
+  fail_unless_equals_int (requests, 9);
+
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cache_lru)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+  gint n = CACHE_MAX_SIZE / CACHE_MAX_ENTRY_SIZE;
+  gchar *uri;
+  gint i;
+
+  /* fill the cache */
+  for (i = 0; i < n; i++) {
+    uri = g_strdup_printf ("testdl://a/%c/262144/max-age=60", 'a' + i);
+    fetch (downloader, uri, FALSE, TRUE, 'a' + i, CACHE_MAX_ENTRY_SIZE);
+    g_free (uri);
+  }
+  fail_unless_equals_int (requests, n);
+
+  /* a is used again, so adding another entry drops b */
+  fetch (downloader, "testdl://a/a/262144/max-age=60", FALSE, TRUE, 'a',
+      CACHE_MAX_ENTRY_SIZE);
+  fail_unless_equals_int (requests, n);
+  fetch (downloader, "testdl://a/z/262144/max-age=60", FALSE, TRUE, 'z',
+      CACHE_MAX_ENTRY_SIZE);
+  fail_unless_equals_int (requests, n + 1);
+
+  fetch (downloader, "testdl://a/a/262144/max-age=60", FALSE, TRUE, 'a',
+      CACHE_MAX_ENTRY_SIZE);
+  fail_unless_equals_int (requests, n + 1);
+  fetch (downloader, "testdl://a/b/262144/max-age=60", FALSE, TRUE, 'b',
+      CACHE_MAX_ENTRY_SIZE);
+  fail_unless_equals_int (requests, n + 2);
+
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+static gboolean
+collect_data (GstUriDownloader * downloader, GstBuffer * buffer,
+    gpointer user_data)
+{
+  gsize *size = user_data;
+
+  *size += gst_buffer_get_size (buffer);
+  gst_buffer_unref (buffer);
+
+  return TRUE;
+}
+
+static gboolean
+stop_data (GstUriDownloader * downloader, GstBuffer * buffer,
+    gpointer user_data)
+{
+  gst_buffer_unref (buffer);
+
+  return FALSE;
+}
+
+GST_START_TEST (test_streaming)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+  GstFragment *download;
+  GError *err = NULL;
+  gsize size;
+  gint i;
+
+  /* the data goes to the callback only, also when it comes from the cache */
+  for (i = 0; i < 2; i++) {
+    size = 0;
+    download = gst_uri_downloader_fetch_uri_streaming (downloader,
+        "testdl://a/s/1024/max-age=60", NULL, FALSE, FALSE, TRUE, 0, -1,
+        collect_data, &size, NULL);
+    fail_unless (download != NULL);
+    fail_unless (gst_fragment_get_buffer (download) == NULL);
+    g_object_unref (download);
+    fail_unless_equals_int (size, 1024);
+    fail_unless_equals_int (requests, 1);
+  }
+
+  /* the streamed data was cached */
+  fetch (downloader, "testdl://a/s/1024/max-age=60", FALSE, TRUE, 's', 1024);
+  fail_unless_equals_int (requests, 1);
+
+  /* returning FALSE from the callback cancels the download */
+  download = gst_uri_downloader_fetch_uri_streaming (downloader,
+      "testdl://a/t/1024/none", NULL, FALSE, FALSE, TRUE, 0, -1,
+      stop_data, NULL, &err);
+  fail_unless (download == NULL);
+  fail_unless (err != NULL);
+  g_clear_error (&err);
+
+  download = gst_uri_downloader_fetch_uri_streaming (downloader,
+      "testdl://a/s/1024/max-age=60", NULL, FALSE, FALSE, TRUE, 0, -1,
+      stop_data, NULL, &err);
+  fail_unless (download == NULL);
+  fail_unless (err != NULL);
+  g_clear_error (&err);
+
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+static Suite *
+uridownloader_suite (void)
+{
+  Suite *s = suite_create ("uridownloader");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup, teardown);
+  tcase_add_test (tc_chain, test_source_pool);
+  tcase_add_test (tc_chain, test_cache_control);
+  tcase_add_test (tc_chain, test_cache_lru);
+  tcase_add_test (tc_chain, test_streaming);
+
+  return s;
+}
+
+GST_CHECK_MAIN (uridownloader);